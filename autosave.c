@@ -20,8 +20,12 @@
 #include <boolean.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 #include "general.h"
 
+/* SRAM is compared and written back in pages of this size. */
+#define AUTOSAVE_PAGE_SIZE 4096
+
 struct autosave
 {
    volatile bool quit;
@@ -31,11 +35,21 @@ struct autosave
    scond_t *cond;
    sthread_t *thread;
 
+   /* Snapshot of SRAM as last written to disk, or as last
+    * attempted if write_failed is set.
+    * Only touched by the autosave thread after init. */
    void *buffer;
    const void *retro_buffer;
    const char *path;
    size_t bufsize;
    unsigned interval;
+
+   uint8_t *dirty;
+   size_t num_pages;
+   bool need_full_write;
+   /* The last write failed, so the file does not match the
+    * snapshot. Written again even if SRAM does not change. */
+   bool write_failed;
 };
 
 /**
@@ -60,6 +74,120 @@ static void autosave_unlock(autosave_t *handle)
    slock_unlock(handle->lock);
 }
 
+static size_t autosave_page_size(const autosave_t *save, size_t page)
+{
+   size_t offset = page * AUTOSAVE_PAGE_SIZE;
+   size_t size   = save->bufsize - offset;
+
+   return size < AUTOSAVE_PAGE_SIZE ? size : AUTOSAVE_PAGE_SIZE;
+}
+
+/**
+ * autosave_snapshot:
+ * @save            : pointer to autosave object
+ *
+ * Finds the pages of SRAM that changed since the last snapshot
+ * and copies them into the snapshot buffer.
+ *
+ * The scan runs without the lock while the core may be writing
+ * to SRAM, so it is only used to find candidate pages. Candidates
+ * are copied under the lock, which gives a consistent snapshot of
+ * them. Pages changed after the scan are picked up next interval.
+ *
+ * Returns: number of dirty pages.
+ **/
+static size_t autosave_snapshot(autosave_t *save)
+{
+   size_t i, dirty = 0;
+   const uint8_t *src = (const uint8_t*)save->retro_buffer;
+   uint8_t *dst       = (uint8_t*)save->buffer;
+
+   for (i = 0; i < save->num_pages; i++)
+   {
+      size_t offset = i * AUTOSAVE_PAGE_SIZE;
+
+      save->dirty[i] = memcmp(dst + offset, src + offset,
+            autosave_page_size(save, i)) != 0;
+      dirty += save->dirty[i];
+   }
+
+   if (!dirty)
+      return 0;
+
+   autosave_lock(save);
+   for (i = 0; i < save->num_pages; i++)
+   {
+      size_t offset = i * AUTOSAVE_PAGE_SIZE;
+
+      if (save->dirty[i])
+         memcpy(dst + offset, src + offset, autosave_page_size(save, i));
+   }
+   autosave_unlock(save);
+
+   return dirty;
+}
+
+/**
+ * autosave_write:
+ * @save            : pointer to autosave object
+ *
+ * Writes the dirty pages of the snapshot into the existing save
+ * file. Contiguous dirty pages are written with a single call.
+ * The whole file is rewritten the first time, or if it cannot be
+ * opened for update.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+static bool autosave_write(autosave_t *save)
+{
+   size_t i;
+   bool failed = false;
+   FILE *file  = NULL;
+
+   if (!save->need_full_write)
+      file = fopen(save->path, "r+b");
+
+   if (!file)
+   {
+      file = fopen(save->path, "wb");
+      if (!file)
+         return false;
+
+      failed |= fwrite(save->buffer, 1, save->bufsize, file)
+         != save->bufsize;
+   }
+   else
+   {
+      for (i = 0; i < save->num_pages && !failed; i++)
+      {
+         size_t size;
+         size_t first = i;
+
+         if (!save->dirty[i])
+            continue;
+
+         while (i + 1 < save->num_pages && save->dirty[i + 1])
+            i++;
+
+         size = (i - first) * AUTOSAVE_PAGE_SIZE
+            + autosave_page_size(save, i);
+
+         failed |= fseek(file, (long)(first * AUTOSAVE_PAGE_SIZE),
+               SEEK_SET) != 0;
+         failed |= fwrite((const uint8_t*)save->buffer
+               + first * AUTOSAVE_PAGE_SIZE, 1, size, file) != size;
+      }
+   }
+
+   failed |= fflush(file) != 0;
+   failed |= fclose(file) != 0;
+
+   if (!failed)
+      save->need_full_write = false;
+
+   return !failed;
+}
+
 /**
  * autosave_thread:
  * @data            : pointer to autosave object
@@ -73,40 +201,31 @@ static void autosave_thread(void *data)
 
    while (!save->quit)
    {
-      bool differ = false;
-
-      autosave_lock(save);
-      differ = memcmp(save->buffer, save->retro_buffer,
-            save->bufsize) != 0;
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
-      autosave_unlock(save);
+      size_t dirty = autosave_snapshot(save);
 
-      if (differ)
+      if (dirty || save->write_failed)
       {
-         /* Should probably deal with this more elegantly. */
-         FILE *file = fopen(save->path, "wb");
+         /* Avoid spamming down stderr ... */
+         if (first_log)
+         {
+            RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
+                  save->path, save->interval);
+            first_log = false;
+         }
+         else if (dirty)
+            RARCH_LOG("SRAM changed ... autosaving %u page(s) ...\n",
+                  (unsigned)dirty);
+         else
+            RARCH_LOG("Retrying failed autosave ...\n");
+
+         save->write_failed = !autosave_write(save);
 
-         if (file)
+         if (save->write_failed)
          {
-            bool failed = false;
-
-            /* Avoid spamming down stderr ... */
-            if (first_log)
-            {
-               RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
-                     save->path, save->interval);
-               first_log = false;
-            }
-            else
-               RARCH_LOG("SRAM changed ... autosaving ...\n");
-
-            failed |= fwrite(save->buffer, 1, save->bufsize, file)
-               != save->bufsize;
-            failed |= fflush(file) != 0;
-            failed |= fclose(file) != 0;
-            if (failed)
-               RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+            RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+            /* The file may be partly written, so the retry
+             * rewrites all of it. */
+            save->need_full_write = true;
          }
       }
 
@@ -144,9 +263,14 @@ autosave_t *autosave_new(const char *path, const void *data, size_t size,
    handle->path = path;
    handle->buffer = malloc(size);
    handle->retro_buffer = data;
+   handle->num_pages = (size + AUTOSAVE_PAGE_SIZE - 1) / AUTOSAVE_PAGE_SIZE;
+   handle->dirty = (uint8_t*)calloc(handle->num_pages + 1, 1);
+   handle->need_full_write = true;
 
-   if (!handle->buffer)
+   if (!handle->buffer || !handle->dirty)
    {
+      free(handle->buffer);
+      free(handle->dirty);
       free(handle);
       return NULL;
    }
@@ -183,6 +307,7 @@ void autosave_free(autosave_t *handle)
    scond_free(handle->cond);
 
    free(handle->buffer);
+   free(handle->dirty);
    free(handle);
 }
 
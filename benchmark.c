@@ -0,0 +1,413 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <compat/strl.h>
+#include <file/config_file.h>
+#include <file/dir_list.h>
+#include <string/string_list.h>
+#include "benchmark.h"
+#include "general.h"
+#include "performance.h"
+#include "settings_data.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if !defined(_WIN32) && !defined(RARCH_CONSOLE)
+#include <sys/resource.h>
+#endif
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) || defined(__QNX__)
+#define BENCHMARK_TICK_UNIT "ns"
+#else
+#define BENCHMARK_TICK_UNIT "ticks"
+#endif
+
+/* Times each startup workload is repeated. */
+#define BENCHMARK_WORKLOAD_RUNS 20
+
+typedef struct benchmark_workload
+{
+   rarch_perf_histogram_t run_time;
+   unsigned items;
+   unsigned keys;
+} benchmark_workload_t;
+
+static struct
+{
+   rarch_perf_histogram_t frame_time;
+   retro_time_t start;
+   retro_time_t last;
+   uint64_t frames;
+   int64_t heap_start;
+   benchmark_workload_t config;
+   benchmark_workload_t settings;
+} benchmark;
+
+/* Bytes allocated with malloc and not freed, -1 if unknown. */
+static int64_t benchmark_heap_in_use(void)
+{
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 33)
+   struct mallinfo2 info = mallinfo2();
+   return (int64_t)info.uordblks + (int64_t)info.hblkhd;
+#else
+   struct mallinfo info = mallinfo();
+   return (int64_t)(unsigned)info.uordblks + (int64_t)(unsigned)info.hblkhd;
+#endif
+#else
+   return -1;
+#endif
+}
+
+/* Resident set size in KiB, -1 if unknown. */
+static int64_t benchmark_rss(void)
+{
+#if defined(__linux__)
+   long pages = 0, resident = 0;
+   FILE *file = fopen("/proc/self/statm", "r");
+
+   if (!file)
+      return -1;
+   if (fscanf(file, "%ld %ld", &pages, &resident) != 2)
+      resident = -1;
+   fclose(file);
+
+   return resident < 0 ? -1 : (int64_t)resident * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+   return -1;
+#endif
+}
+
+/* Peak resident set size in KiB, -1 if unknown. */
+static int64_t benchmark_peak_rss(void)
+{
+#if !defined(_WIN32) && !defined(RARCH_CONSOLE)
+   struct rusage usage;
+
+   if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return -1;
+#if defined(__APPLE__)
+   return (int64_t)usage.ru_maxrss / 1024;
+#else
+   return (int64_t)usage.ru_maxrss;
+#endif
+#else
+   return -1;
+#endif
+}
+
+static void benchmark_write_string(FILE *file, const char *str)
+{
+   fputc('"', file);
+
+   for (; str && *str; str++)
+   {
+      unsigned char c = (unsigned char)*str;
+
+      if (c == '"' || c == '\\')
+         fprintf(file, "\\%c", c);
+      else if (c < 0x20)
+         fprintf(file, "\\u%04x", c);
+      else
+         fputc(c, file);
+   }
+
+   fputc('"', file);
+}
+
+static void benchmark_write_percentiles(FILE *file,
+      const rarch_perf_histogram_t *hist)
+{
+   rarch_perf_stats_t stats = {0};
+
+   if (hist)
+      rarch_perf_stats_from_histogram(&stats, hist);
+
+   fprintf(file, "\"min\": %llu, \"p50\": %llu, \"p90\": %llu, "
+         "\"p99\": %llu, \"max\": %llu",
+         (unsigned long long)stats.min, (unsigned long long)stats.p50,
+         (unsigned long long)stats.p90, (unsigned long long)stats.p99,
+         (unsigned long long)stats.max);
+}
+
+static void benchmark_write_counters(FILE *file,
+      const struct retro_perf_counter **counters, unsigned num)
+{
+   unsigned i;
+   bool first = true;
+
+   fputs("[", file);
+
+   for (i = 0; i < num; i++)
+   {
+      const struct retro_perf_counter *perf = counters[i];
+
+      if (!perf || !perf->call_cnt)
+         continue;
+
+      fputs(first ? "\n      { \"ident\": " : ",\n      { \"ident\": ", file);
+      benchmark_write_string(file, perf->ident);
+      fprintf(file, ", \"calls\": %llu, \"total\": %llu, \"mean\": %llu, ",
+            (unsigned long long)perf->call_cnt,
+            (unsigned long long)perf->total,
+            (unsigned long long)(perf->total / perf->call_cnt));
+      benchmark_write_percentiles(file, rarch_perf_get_histogram(perf));
+      fputs(" }", file);
+      first = false;
+   }
+
+   fputs(first ? "]" : "\n   ]", file);
+}
+
+/* Loads each file, reads every key back and writes every key
+ * again, like loading and saving the configuration does.
+ * Returns the number of keys seen. */
+static unsigned benchmark_config_run(const struct string_list *files)
+{
+   unsigned i;
+   unsigned keys = 0;
+
+   for (i = 0; i < files->size; i++)
+   {
+      struct config_file_entry entry = {0};
+      config_file_t *conf = config_file_new(files->elems[i].data);
+
+      if (!conf)
+         continue;
+
+      if (config_get_entry_list_head(conf, &entry))
+      {
+         do
+         {
+            const char *value = NULL;
+
+            if (config_get_string_ref(conf, entry.key, &value))
+               config_set_string(conf, entry.key, value);
+            keys++;
+         } while (config_get_entry_list_next(&entry));
+      }
+
+      config_file_free(conf);
+   }
+
+   return keys;
+}
+
+/* Times loading the configuration and every core info file. */
+static void benchmark_config(void)
+{
+   unsigned i;
+   union string_list_elem_attr attr;
+   struct string_list *files = string_list_new();
+   struct string_list *infos = NULL;
+
+   if (!files)
+      return;
+
+   attr.i = 0;
+   if (*g_extern.config_path)
+      string_list_append(files, g_extern.config_path, attr);
+
+   if (*g_settings.libretro_info_path)
+      infos = dir_list_new(g_settings.libretro_info_path, "info", false);
+   for (i = 0; infos && i < infos->size; i++)
+      string_list_append(files, infos->elems[i].data, attr);
+   dir_list_free(infos);
+
+   benchmark.config.items = files->size;
+
+   for (i = 0; files->size && i < BENCHMARK_WORKLOAD_RUNS; i++)
+   {
+      retro_time_t start = rarch_get_time_usec();
+
+      benchmark.config.keys = benchmark_config_run(files);
+      rarch_perf_histogram_add(&benchmark.config.run_time,
+            rarch_get_time_usec() - start);
+   }
+
+   string_list_free(files);
+}
+
+/* Builds the full settings list and looks every setting up by
+ * name, like populating the settings menu does. */
+static void benchmark_settings(void)
+{
+   unsigned i;
+
+   for (i = 0; i < BENCHMARK_WORKLOAD_RUNS; i++)
+   {
+      unsigned items = 0, keys = 0;
+      retro_time_t start = rarch_get_time_usec();
+      rarch_setting_t *list = setting_data_new(SL_FLAG_ALL_SETTINGS);
+      rarch_setting_t *setting = list;
+
+      if (!list)
+         return;
+
+      for (; setting->type != ST_NONE; setting++, items++)
+      {
+         if (setting->type > ST_GROUP || !setting->name)
+            continue;
+
+         setting_data_find_setting(list, setting->name);
+         keys++;
+      }
+
+      settings_list_free(list);
+      rarch_perf_histogram_add(&benchmark.settings.run_time,
+            rarch_get_time_usec() - start);
+
+      benchmark.settings.items = items;
+      benchmark.settings.keys  = keys;
+   }
+}
+
+static void benchmark_write_workload(FILE *file, const char *ident,
+      const char *items, const char *keys,
+      const benchmark_workload_t *workload)
+{
+   const rarch_perf_histogram_t *hist = &workload->run_time;
+
+   fputs("      ", file);
+   benchmark_write_string(file, ident);
+   fprintf(file, ": { \"runs\": %llu, \"%s\": %u, \"%s\": %u, "
+         "\"mean\": %.3f, ",
+         (unsigned long long)hist->count, items, workload->items,
+         keys, workload->keys,
+         hist->count ? (double)hist->total / hist->count : 0.0);
+   benchmark_write_percentiles(file, hist);
+   fputs(" }", file);
+}
+
+void benchmark_init(void)
+{
+   strlcpy(g_settings.video.driver, "null", sizeof(g_settings.video.driver));
+   strlcpy(g_settings.audio.driver, "null", sizeof(g_settings.audio.driver));
+   strlcpy(g_settings.input.driver, "null", sizeof(g_settings.input.driver));
+   strlcpy(g_settings.input.joypad_driver, "null",
+         sizeof(g_settings.input.joypad_driver));
+
+   g_settings.video.vsync                       = false;
+   g_settings.video.threaded                    = false;
+   g_settings.video.frame_delay                 = 0;
+   g_settings.audio.sync                        = false;
+   g_settings.fastforward_ratio_throttle_enable = false;
+   g_settings.config_save_on_exit               = false;
+
+   g_extern.perfcnt_enable = true;
+
+   memset(&benchmark, 0, sizeof(benchmark));
+   benchmark_config();
+   benchmark_settings();
+   benchmark.heap_start = benchmark_heap_in_use();
+}
+
+void benchmark_frame(void)
+{
+   retro_time_t now = rarch_get_time_usec();
+
+   if (benchmark.frames)
+      rarch_perf_histogram_add(&benchmark.frame_time, now - benchmark.last);
+   else
+      benchmark.start = now;
+
+   benchmark.last = now;
+   benchmark.frames++;
+}
+
+bool benchmark_report(const char *path)
+{
+   FILE *file     = NULL;
+   double seconds = 0.0;
+   uint64_t timed = benchmark.frame_time.count;
+   int64_t heap   = benchmark_heap_in_use();
+   int64_t rss    = benchmark_rss();
+   int64_t peak   = benchmark_peak_rss();
+
+   /* Frame times are measured between frames, the first
+    * one only starts the clock. */
+   if (timed)
+      seconds = (benchmark.last - benchmark.start) / 1000000.0;
+
+   if (!(file = fopen(path, "w")))
+   {
+      RARCH_ERR("Could not open benchmark report \"%s\".\n", path);
+      return false;
+   }
+
+   fputs("{\n   \"version\": ", file);
+   benchmark_write_string(file, PACKAGE_VERSION);
+   fputs(",\n   \"core\": { \"name\": ", file);
+   benchmark_write_string(file, g_extern.system.info.library_name);
+   fputs(", \"version\": ", file);
+   benchmark_write_string(file, g_extern.system.info.library_version);
+   fputs(" },\n   \"content\": ", file);
+   benchmark_write_string(file, g_extern.fullpath);
+   fputs(",\n   \"movie\": ", file);
+   benchmark_write_string(file, g_extern.bsv.movie_start_path);
+
+   fprintf(file, ",\n   \"frames\": %llu,\n   \"seconds\": %.6f,\n"
+         "   \"fps\": %.3f,\n",
+         (unsigned long long)benchmark.frames, seconds,
+         seconds > 0.0 ? timed / seconds : 0.0);
+
+   fprintf(file, "   \"frame_time_usec\": { \"mean\": %.3f, ",
+         timed ? (seconds * 1000000.0) / timed : 0.0);
+   benchmark_write_percentiles(file, &benchmark.frame_time);
+
+   fprintf(file, " },\n   \"memory\": { \"heap_start\": %lld, "
+         "\"heap_end\": %lld, \"rss_kb\": %lld, \"peak_rss_kb\": %lld },\n",
+         (long long)benchmark.heap_start, (long long)heap,
+         (long long)rss, (long long)(peak < rss ? rss : peak));
+
+   fputs("   \"workloads_usec\": {\n", file);
+   benchmark_write_workload(file, "config_load", "files", "keys",
+         &benchmark.config);
+   fputs(",\n", file);
+   benchmark_write_workload(file, "settings_list", "settings", "lookups",
+         &benchmark.settings);
+   fputs("\n   },\n", file);
+
+   fputs("   \"tick_unit\": \"" BENCHMARK_TICK_UNIT "\",\n   \"retroarch\": ",
+         file);
+   benchmark_write_counters(file, perf_counters_rarch, perf_ptr_rarch);
+   fputs(",\n   \"libretro\": ", file);
+   benchmark_write_counters(file, perf_counters_libretro, perf_ptr_libretro);
+   fputs("\n}\n", file);
+
+   if (fclose(file) != 0)
+   {
+      RARCH_ERR("Could not write benchmark report \"%s\".\n", path);
+      return false;
+   }
+
+   RARCH_LOG("[Benchmark]: %llu frames in %.3f seconds (%.2f fps), report written to \"%s\".\n",
+         (unsigned long long)benchmark.frames, seconds,
+         seconds > 0.0 ? timed / seconds : 0.0, path);
+   return true;
+}
@@ -0,0 +1,66 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_BENCHMARK_H
+#define __RARCH_BENCHMARK_H
+
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * benchmark_init:
+ *
+ * Overrides the loaded configuration for a headless benchmark run:
+ * null video, audio and input drivers, no vsync, audio sync or
+ * frame limiting, and the configuration is not saved on exit.
+ * Enables performance counters.
+ *
+ * Before the run starts, times a few startup workloads: loading
+ * the configuration file and every core info file, and building
+ * and searching the full settings list.
+ *
+ * Content is usually driven by a movie played back with -P,
+ * and the run bounded with --max-frames or --eof-exit.
+ **/
+void benchmark_init(void);
+
+/**
+ * benchmark_frame:
+ *
+ * Marks the end of a frame run by the core.
+ **/
+void benchmark_frame(void);
+
+/**
+ * benchmark_report:
+ * @path                : Path to write the report to.
+ *
+ * Writes a JSON report of the run: frames per second, frame time,
+ * workload and counter percentiles and memory usage. Needs to be called
+ * while the core is still loaded, core counters go away with it.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool benchmark_report(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -125,7 +125,7 @@ cheat_manager_t *cheat_manager_load(const char *path)
    for (i = 0; i < cheats; i++)
    {
       char key[64], desc_key[256], code_key[256], enable_key[256];
-      char *tmp = NULL;
+      const char *tmp = NULL;
       bool tmp_bool = false;
 
       snprintf(key, sizeof(key), "cheat%u", i);
@@ -133,10 +133,10 @@ cheat_manager_t *cheat_manager_load(const char *path)
       snprintf(code_key, sizeof(code_key), "cheat%u_code", i);
       snprintf(enable_key, sizeof(enable_key), "cheat%u_enable", i);
 
-      if (config_get_string(conf, desc_key, &tmp))
+      if (config_get_string_ref(conf, desc_key, &tmp))
          cheat->cheats[i].desc   = strdup(tmp);
 
-      if (config_get_string(conf, code_key, &tmp))
+      if (config_get_string_ref(conf, code_key, &tmp))
          cheat->cheats[i].code   = strdup(tmp);
 
       if (config_get_bool(conf, enable_key, &tmp_bool))
@@ -22,6 +22,7 @@
 #endif
 
 #include "general.h"
+#include "performance.h"
 #include "compat/strl.h"
 #include "compat/posix_string.h"
 #include <file/file_path.h>
@@ -36,6 +37,7 @@
 
 #define DEFAULT_NETWORK_CMD_PORT 55355
 #define STDIN_BUF_SIZE 4096
+#define REPLY_PACKET_SIZE 1024
 
 struct rarch_cmd
 {
@@ -47,6 +49,11 @@ struct rarch_cmd
 
 #if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
    int net_fd;
+
+   /* Sender of the commands being parsed,
+    * replies go to stdout if not set. */
+   struct sockaddr_storage reply_addr;
+   socklen_t reply_addr_len;
 #endif
 
    bool state[RARCH_BIND_LIST_END];
@@ -174,6 +181,14 @@ struct cmd_action_map
    const char *arg_desc;
 };
 
+/* Commands replying to the sender. */
+struct cmd_query_map
+{
+   const char *str;
+   bool (*query)(char *reply, size_t size);
+   size_t reply_size;
+};
+
 static const struct cmd_map map[] = {
    { "FAST_FORWARD",           RARCH_FAST_FORWARD_KEY },
    { "FAST_FORWARD_HOLD",      RARCH_FAST_FORWARD_HOLD_KEY },
@@ -239,10 +254,147 @@ static bool cmd_set_shader(const char *arg)
    return driver.video->set_shader(driver.video_data, type, arg);
 }
 
+static bool cmd_perf_trace(const char *arg)
+{
+   char dir[PATH_MAX_LENGTH], path[PATH_MAX_LENGTH];
+
+   /* Commands can come from the network, so they only name the
+    * trace, which is written next to the save states. */
+   if (!*arg || strpbrk(arg, "/\\:") || strstr(arg, ".."))
+   {
+      RARCH_ERR("Trace name \"%s\" is not a plain file name.\n", arg);
+      return false;
+   }
+
+   fill_pathname_basedir(dir, g_extern.savestate_name, sizeof(dir));
+
+   if (strlen(dir) + strlen(arg) + 1 >= sizeof(path))
+      return false;
+
+   fill_pathname_join(path, dir, arg, sizeof(path));
+   RARCH_LOG("Writing trace to \"%s\".\n", path);
+   return rarch_perf_trace_write(path);
+}
+
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER", cmd_set_shader, "<shader path>" },
+   { "PERF_TRACE", cmd_perf_trace, "<trace file name>" },
 };
 
+/* Longest counter name printed by PERF_STATS. */
+#define PERF_STATS_IDENT_MAX 64
+/* Source, name, nine 20 digit numbers and their labels. */
+#define PERF_STATS_LINE_SIZE (16 + PERF_STATS_IDENT_MAX + 9 * (8 + 20))
+#define PERF_STATS_REPLY_SIZE (2 * MAX_COUNTERS * PERF_STATS_LINE_SIZE)
+
+static bool cmd_perf_stats(char *reply, size_t size)
+{
+   unsigned i, num;
+   size_t len = 0;
+   rarch_perf_stats_t *stats = (rarch_perf_stats_t*)
+      calloc(2 * MAX_COUNTERS, sizeof(*stats));
+
+   if (!stats)
+      return false;
+
+   num = rarch_perf_snapshot(stats, 2 * MAX_COUNTERS, false);
+
+   for (i = 0; i < num && len < size; i++)
+      len += snprintf(reply + len, size - len,
+            "%s %.*s count=%llu total=%llu min=%llu p50=%llu p90=%llu "
+            "p99=%llu p999=%llu max=%llu\n",
+            stats[i].libretro ? "libretro" : "retroarch",
+            PERF_STATS_IDENT_MAX, stats[i].ident,
+            (unsigned long long)stats[i].count,
+            (unsigned long long)stats[i].total,
+            (unsigned long long)stats[i].min,
+            (unsigned long long)stats[i].p50,
+            (unsigned long long)stats[i].p90,
+            (unsigned long long)stats[i].p99,
+            (unsigned long long)stats[i].p999,
+            (unsigned long long)stats[i].max);
+
+   if (!num)
+      strlcpy(reply, g_extern.perfcnt_enable ?
+            "No counters ran.\n" : "Performance counters are disabled.\n",
+            size);
+
+   free(stats);
+   return true;
+}
+
+static bool cmd_perf_reset(char *reply, size_t size)
+{
+   rarch_perf_reset();
+   strlcpy(reply, "OK\n", size);
+   return true;
+}
+
+static bool cmd_perf_trace_start(char *reply, size_t size)
+{
+   strlcpy(reply, rarch_perf_trace_begin() ? "OK\n" : "ERROR\n", size);
+   return true;
+}
+
+static bool cmd_perf_trace_stop(char *reply, size_t size)
+{
+   rarch_perf_trace_end();
+   strlcpy(reply, "OK\n", size);
+   return true;
+}
+
+static const struct cmd_query_map query_map[] = {
+   { "PERF_STATS",       cmd_perf_stats,       PERF_STATS_REPLY_SIZE },
+   { "PERF_RESET",       cmd_perf_reset,       64 },
+   { "PERF_TRACE_START", cmd_perf_trace_start, 64 },
+   { "PERF_TRACE_STOP",  cmd_perf_trace_stop,  64 },
+};
+
+static int command_get_query(const char *tok)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(query_map); i++)
+      if (strcmp(tok, query_map[i].str) == 0)
+         return i;
+   return -1;
+}
+
+static void command_reply(rarch_cmd_t *handle, const char *reply)
+{
+#if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
+   size_t len = strlen(reply);
+
+   if (handle->reply_addr_len)
+   {
+      /* Split at line ends, so each packet stands on its own. */
+      while (len)
+      {
+         size_t chunk = len;
+
+         if (chunk > REPLY_PACKET_SIZE)
+         {
+            chunk = REPLY_PACKET_SIZE;
+            while (chunk > 1 && reply[chunk - 1] != '\n')
+               chunk--;
+            if (chunk == 1)
+               chunk = REPLY_PACKET_SIZE;
+         }
+
+         sendto(handle->net_fd, reply, chunk, 0,
+               (struct sockaddr*)&handle->reply_addr,
+               handle->reply_addr_len);
+         reply += chunk;
+         len   -= chunk;
+      }
+      return;
+   }
+#endif
+
+   fputs(reply, stdout);
+   fflush(stdout);
+}
+
 static bool command_get_arg(const char *tok,
       const char **arg, unsigned *index)
 {
@@ -288,8 +440,18 @@ static void parse_sub_msg(rarch_cmd_t *handle, const char *tok)
 {
    const char *arg = NULL;
    unsigned index  = 0;
+   int query       = command_get_query(tok);
+
+   if (query >= 0)
+   {
+      size_t size = query_map[query].reply_size;
+      char *reply = (char*)malloc(size);
 
-   if (command_get_arg(tok, &arg, &index))
+      if (reply && query_map[query].query(reply, size))
+         command_reply(handle, reply);
+      free(reply);
+   }
+   else if (command_get_arg(tok, &arg, &index))
    {
       if (arg)
       {
@@ -347,8 +509,11 @@ static void network_cmd_poll(rarch_cmd_t *handle)
    for (;;)
    {
       char buf[1024];
-      ssize_t ret = recvfrom(handle->net_fd, buf,
-            sizeof(buf) - 1, 0, NULL, NULL);
+      ssize_t ret;
+
+      handle->reply_addr_len = sizeof(handle->reply_addr);
+      ret = recvfrom(handle->net_fd, buf, sizeof(buf) - 1, 0,
+            (struct sockaddr*)&handle->reply_addr, &handle->reply_addr_len);
 
       if (ret <= 0)
          break;
@@ -356,6 +521,8 @@ static void network_cmd_poll(rarch_cmd_t *handle)
       buf[ret] = '\0';
       parse_msg(handle, buf);
    }
+
+   handle->reply_addr_len = 0;
 }
 #endif
 
@@ -582,7 +749,7 @@ static bool verify_command(const char *cmd)
 {
    unsigned i;
 
-   if (command_get_arg(cmd, NULL, NULL))
+   if (command_get_arg(cmd, NULL, NULL) || command_get_query(cmd) >= 0)
       return true;
 
    RARCH_ERR("Command \"%s\" is not recognized by RetroArch.\n", cmd);
@@ -593,6 +760,9 @@ static bool verify_command(const char *cmd)
    for (i = 0; i < sizeof(action_map) / sizeof(action_map[0]); i++)
       RARCH_ERR("\t\t%s %s\n", action_map[i].str, action_map[i].arg_desc);
 
+   for (i = 0; i < sizeof(query_map) / sizeof(query_map[0]); i++)
+      RARCH_ERR("\t\t%s\n", query_map[i].str);
+
    return false;
 }
 
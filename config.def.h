@@ -563,6 +563,11 @@ static const bool rewind_enable = false;
  * 15-20MB per minute. Very game dependant. */
 static const unsigned rewind_buffer_size = 20 << 20; /* 20MiB */
 
+/* Size of the in-memory cache of decompressed archive members.
+ * Loading the same zipped or 7z content again is served from
+ * memory instead of being decompressed again. 0 disables the cache. */
+static const unsigned archive_cache_size = 0;
+
 /* How many frames to rewind at a time. */
 static const unsigned rewind_granularity = 1;
 
@@ -587,6 +592,10 @@ static const bool block_sram_overwrite = false;
  * to the highest existing value. */
 static const bool savestate_auto_index = false;
 
+/* Compresses savestates with deflate before writing them to disk.
+ * Compressed savestates can only be loaded by builds with zlib support. */
+static const bool savestate_compression = false;
+
 /* Automatically saves a savestate at the end of RetroArch's lifetime.
  * The path is $SRAM_PATH.auto.
  * RetroArch will automatically load any savestate with this path on 
@@ -635,6 +644,10 @@ static const unsigned turbo_duty_cycle = 3;
  * gamepads, plug-and-play style. */
 static const bool input_autodetect_enable = true;
 
+/* Read input events on a separate thread as they arrive,
+ * instead of once per frame (udev only). */
+static const bool input_threaded = false;
+
 /* Show the input descriptors set by the core instead 
  * of the default ones. */
 static const bool input_descriptor_label_show = true;
@@ -28,6 +28,15 @@
 #include "compat/strl.h"
 #include "hash.h"
 #include "file_extract.h"
+#include "performance.h"
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 #ifdef _WIN32
 #ifdef _XBOX
@@ -46,7 +55,9 @@
  * @buf          : buffer of the content file.
  * @size         : size   of the content file.
  *
- * Apply patch to the content file in-memory.
+ * Apply patch to the content file in-memory. The target is sized
+ * from the patch header. IPS patches are applied to @buf in place,
+ * BPS and UPS need the source intact and write to a new buffer.
  *
  **/
 static void patch_content(uint8_t **buf, ssize_t *size)
@@ -62,10 +73,11 @@ static void patch_content(uint8_t **buf, ssize_t *size)
    const char *patch_path = NULL;
    patch_error_t err = PATCH_UNKNOWN;
    patch_func_t func = NULL;
+   patch_size_func_t size_func = NULL;
 
    ssize_t patch_size = 0;
    void *patch_data = NULL;
-   bool success = false;
+   bool in_place = false;
 
    bool allow_bps = !g_extern.ups_pref && !g_extern.ips_pref;
    bool allow_ups = !g_extern.bps_pref && !g_extern.ips_pref;
@@ -83,6 +95,7 @@ static void patch_content(uint8_t **buf, ssize_t *size)
       patch_desc = "UPS";
       patch_path = g_extern.ups_name;
       func = ups_apply_patch;
+      size_func = ups_get_target_size;
    }
    else if (allow_bps && *g_extern.bps_name
          && (patch_size = read_file(g_extern.bps_name, &patch_data)) >= 0)
@@ -90,6 +103,7 @@ static void patch_content(uint8_t **buf, ssize_t *size)
       patch_desc = "BPS";
       patch_path = g_extern.bps_name;
       func = bps_apply_patch;
+      size_func = bps_get_target_size;
    }
    else if (allow_ips && *g_extern.ips_name
          && (patch_size = read_file(g_extern.ips_name, &patch_data)) >= 0)
@@ -97,6 +111,8 @@ static void patch_content(uint8_t **buf, ssize_t *size)
       patch_desc = "IPS";
       patch_path = g_extern.ips_name;
       func = ips_apply_patch;
+      size_func = ips_get_target_size;
+      in_place = true;
    }
    else
    {
@@ -107,40 +123,63 @@ static void patch_content(uint8_t **buf, ssize_t *size)
    RARCH_LOG("Found %s file in \"%s\", attempting to patch ...\n",
          patch_desc, patch_path);
 
-   target_size = ret_size * 4; /* Just to be sure. */
+   err = size_func((const uint8_t*)patch_data, patch_size,
+         ret_size, &target_size);
+
+   if (err != PATCH_SUCCESS)
+      goto error;
 
-   patched_content = (uint8_t*)malloc(target_size);
+   if (in_place)
+   {
+      patched_content = ret_buf;
+
+      if (target_size > (size_t)ret_size)
+      {
+         patched_content = (uint8_t*)realloc(ret_buf, target_size);
+         if (!patched_content)
+         {
+            RARCH_ERR("Failed to allocate memory for patched content ...\n");
+            goto done;
+         }
+
+         /* Bytes the patch does not cover. */
+         memset(patched_content + ret_size, 0, target_size - ret_size);
+         ret_buf = *buf = patched_content;
+      }
+   }
+   else
+      patched_content = (uint8_t*)malloc(target_size);
 
    if (!patched_content)
    {
       RARCH_ERR("Failed to allocate memory for patched content ...\n");
-      goto error;
+      goto done;
    }
 
    err = func((const uint8_t*)patch_data, patch_size, ret_buf,
          ret_size, patched_content, &target_size);
 
-   if (err == PATCH_SUCCESS)
+   if (err != PATCH_SUCCESS)
    {
-      RARCH_LOG("Content patched successfully (%s).\n", patch_desc);
-      success = true;
+      if (!in_place)
+         free(patched_content);
+      goto error;
    }
-   else
-      RARCH_ERR("Failed to patch %s: Error #%u\n", patch_desc,
-            (unsigned)err);
 
-   if (success)
-   {
+   RARCH_LOG("Content patched successfully (%s).\n", patch_desc);
+
+   if (!in_place)
       free(ret_buf);
-      *buf = patched_content;
-      *size = target_size;
-   }
+   *buf = patched_content;
+   *size = target_size;
 
    free(patch_data);
    return;
 
 error:
-   *buf = ret_buf;
+   RARCH_ERR("Failed to patch %s: Error #%u\n", patch_desc,
+         (unsigned)err);
+done:
    *size = ret_size;
    free(patch_data);
 }
@@ -227,18 +266,367 @@ struct sram_block
    size_t size;
 };
 
+#define SAVESTATE_ZLIB_MAGIC "RASTATEZ"
+#define SAVESTATE_ZLIB_MAGIC_SIZE 8
+#define SAVESTATE_ZLIB_HEADER_SIZE (SAVESTATE_ZLIB_MAGIC_SIZE + 4)
+
+/* Savestates are serialized into pooled buffers on the main thread.
+ * Compression and the disk write happen on a single background
+ * thread, which works through the queued saves in order. */
+#define STATE_WRITER_JOBS    2
+#define STATE_WRITER_RESULTS 8
+
+struct state_writer_job
+{
+   uint8_t *data;
+   size_t data_cap;
+   size_t size;
+   bool compress;
+   char path[PATH_MAX_LENGTH];
+};
+
+struct state_writer_result
+{
+   char path[PATH_MAX_LENGTH];
+   bool success;
+};
+
+struct state_writer
+{
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool quit;
+#endif
+   struct state_writer_job jobs[STATE_WRITER_JOBS];
+   /* Running counts, jobs[queued % STATE_WRITER_JOBS] is filled
+    * next and jobs[written % STATE_WRITER_JOBS] written next. */
+   unsigned queued;
+   unsigned written;
+
+   /* Finished saves, waiting for save_state_poll. */
+   struct state_writer_result results[STATE_WRITER_RESULTS];
+   unsigned results_write;
+   unsigned results_read;
+
+   /* Only used by the writer. */
+   uint8_t *cdata;
+   size_t cdata_cap;
+};
+
+static struct state_writer state_writer;
+
+static struct retro_perf_counter save_state_serialize_perf =
+   {"save_state_serialize"};
+static struct retro_perf_counter save_state_compress_perf =
+   {"save_state_compress"};
+static struct retro_perf_counter save_state_write_perf =
+   {"save_state_write"};
+
+static void state_writer_lock(void)
+{
+#ifdef HAVE_THREADS
+   if (state_writer.lock)
+      slock_lock(state_writer.lock);
+#endif
+}
+
+static void state_writer_unlock(void)
+{
+#ifdef HAVE_THREADS
+   if (state_writer.lock)
+      slock_unlock(state_writer.lock);
+#endif
+}
+
+/**
+ * write_file_atomic:
+ * @path      : path to file.
+ * @header    : optional header written before @data.
+ * @header_size : size of @header.
+ * @data      : contents to write to the file.
+ * @size      : size of @data.
+ *
+ * Writes to a temporary file and renames it over @path, so @path
+ * never contains a partially written file.
+ *
+ * Returns: true if successful, false otherwise.
+ **/
+static bool write_file_atomic(const char *path,
+      const void *header, size_t header_size,
+      const void *data, size_t size)
+{
+   bool ret = false;
+   char tmp_path[PATH_MAX_LENGTH];
+   FILE *file = NULL;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+   file = fopen(tmp_path, "wb");
+   if (!file)
+      return false;
+
+   ret = fwrite(header, 1, header_size, file) == header_size
+      && fwrite(data, 1, size, file) == size;
+
+   if (fclose(file) != 0)
+      ret = false;
+
+   if (ret)
+   {
+#if defined(_WIN32) && !defined(_XBOX)
+      /* rename() does not replace existing files on Windows. */
+      ret = MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+#ifdef _XBOX
+      remove(path);
+#endif
+      ret = rename(tmp_path, path) == 0;
+#endif
+   }
+
+   if (!ret)
+      remove(tmp_path);
+
+   return ret;
+}
+
+#ifdef HAVE_ZLIB_DEFLATE
+/**
+ * state_writer_compress:
+ * @writer    : state writer.
+ * @job       : save to compress.
+ * @header    : header to fill in.
+ * @csize     : size of compressed data.
+ *
+ * Deflates the serialized state into the pooled compression buffer.
+ *
+ * Returns: true if successful, false otherwise.
+ **/
+static bool state_writer_compress(struct state_writer *writer,
+      const struct state_writer_job *job, uint8_t *header, uLongf *csize)
+{
+   uLongf bound = compressBound(job->size);
+
+   if (bound > writer->cdata_cap)
+   {
+      uint8_t *cdata = (uint8_t*)realloc(writer->cdata, bound);
+      if (!cdata)
+         return false;
+      writer->cdata     = cdata;
+      writer->cdata_cap = bound;
+   }
+
+   *csize = bound;
+   if (compress2(writer->cdata, csize, job->data, job->size,
+            Z_BEST_SPEED) != Z_OK)
+      return false;
+
+   memcpy(header, SAVESTATE_ZLIB_MAGIC, SAVESTATE_ZLIB_MAGIC_SIZE);
+   header[SAVESTATE_ZLIB_MAGIC_SIZE + 0] = (job->size >>  0) & 0xff;
+   header[SAVESTATE_ZLIB_MAGIC_SIZE + 1] = (job->size >>  8) & 0xff;
+   header[SAVESTATE_ZLIB_MAGIC_SIZE + 2] = (job->size >> 16) & 0xff;
+   header[SAVESTATE_ZLIB_MAGIC_SIZE + 3] = (job->size >> 24) & 0xff;
+   return true;
+}
+#endif
+
+/**
+ * state_writer_write:
+ * @writer    : state writer.
+ * @job       : save to write.
+ *
+ * Compresses (if enabled) and writes a queued save to disk.
+ *
+ * Returns: true if successful, false otherwise.
+ **/
+static bool state_writer_write(struct state_writer *writer,
+      const struct state_writer_job *job)
+{
+   bool ret = false;
+   uint8_t header[SAVESTATE_ZLIB_HEADER_SIZE];
+   const void *out = job->data;
+   size_t out_size = job->size;
+   size_t header_size = 0;
+
+#ifdef HAVE_ZLIB_DEFLATE
+   if (job->compress)
+   {
+      uLongf csize = 0;
+
+      rarch_perf_start(&save_state_compress_perf);
+      if (state_writer_compress(writer, job, header, &csize))
+      {
+         out         = writer->cdata;
+         out_size    = csize;
+         header_size = SAVESTATE_ZLIB_HEADER_SIZE;
+      }
+      else
+         RARCH_WARN("Failed to compress state, saving uncompressed.\n");
+      rarch_perf_stop(&save_state_compress_perf);
+   }
+#endif
+
+   rarch_perf_start(&save_state_write_perf);
+   ret = write_file_atomic(job->path, header, header_size,
+         out, out_size);
+   rarch_perf_stop(&save_state_write_perf);
+
+   if (ret)
+      RARCH_LOG("Saved state to \"%s\" (%u bytes).\n",
+            job->path, (unsigned)(header_size + out_size));
+   else
+      RARCH_ERR("Failed to save state to \"%s\".\n", job->path);
+
+   return ret;
+}
+
+/* Writes the oldest queued save. Must be called with the lock held,
+ * which is dropped while writing. */
+static void state_writer_process(struct state_writer *writer)
+{
+   bool success;
+   struct state_writer_result *result = NULL;
+   struct state_writer_job *job =
+      &writer->jobs[writer->written % STATE_WRITER_JOBS];
+
+   state_writer_unlock();
+   success = state_writer_write(writer, job);
+   state_writer_lock();
+
+   /* Should nobody poll, the oldest results are dropped. */
+   if (writer->results_write - writer->results_read >= STATE_WRITER_RESULTS)
+      writer->results_read++;
+
+   result = &writer->results[writer->results_write++ % STATE_WRITER_RESULTS];
+   strlcpy(result->path, job->path, sizeof(result->path));
+   result->success = success;
+
+   writer->written++;
+}
+
+#ifdef HAVE_THREADS
+static void state_writer_thread(void *data)
+{
+   struct state_writer *writer = (struct state_writer*)data;
+
+   slock_lock(writer->lock);
+
+   for (;;)
+   {
+      while (writer->written == writer->queued && !writer->quit)
+         scond_wait(writer->cond, writer->lock);
+
+      if (writer->written == writer->queued)
+         break;
+
+      state_writer_process(writer);
+      scond_broadcast(writer->cond);
+   }
+
+   slock_unlock(writer->lock);
+}
+
+static bool state_writer_init(void)
+{
+   if (state_writer.thread)
+      return true;
+
+   state_writer.lock = slock_new();
+   state_writer.cond = scond_new();
+   if (state_writer.lock && state_writer.cond)
+      state_writer.thread = sthread_create(state_writer_thread,
+            &state_writer);
+
+   if (state_writer.thread)
+      return true;
+
+   if (state_writer.lock)
+      slock_free(state_writer.lock);
+   if (state_writer.cond)
+      scond_free(state_writer.cond);
+   state_writer.lock = NULL;
+   state_writer.cond = NULL;
+   return false;
+}
+#endif
+
+/* Waits until fewer than @pending saves are still queued.
+ * Must be called with the lock held. */
+static void state_writer_wait(unsigned pending)
+{
+#ifdef HAVE_THREADS
+   if (state_writer.thread)
+   {
+      while (state_writer.queued - state_writer.written >= pending)
+         scond_wait(state_writer.cond, state_writer.lock);
+      return;
+   }
+#endif
+
+   while (state_writer.queued - state_writer.written >= pending)
+      state_writer_process(&state_writer);
+}
+
+/**
+ * save_state_flush:
+ *
+ * Waits for pending background savestate writes to finish.
+ **/
+void save_state_flush(void)
+{
+   state_writer_lock();
+   state_writer_wait(1);
+   state_writer_unlock();
+}
+
+/**
+ * save_state_poll:
+ * @path      : filled with the path of the saved state.
+ * @size      : size of @path.
+ * @success   : set to whether the state was written.
+ *
+ * Gets the outcome of a finished savestate write.
+ *
+ * Returns: true if a save finished since the last call,
+ * otherwise false.
+ **/
+bool save_state_poll(char *path, size_t size, bool *success)
+{
+   bool ret = false;
+
+   state_writer_lock();
+
+   if (state_writer.results_read != state_writer.results_write)
+   {
+      struct state_writer_result *result = &state_writer.results[
+         state_writer.results_read++ % STATE_WRITER_RESULTS];
+
+      strlcpy(path, result->path, size);
+      *success = result->success;
+      ret      = true;
+   }
+
+   state_writer_unlock();
+   return ret;
+}
+
 /**
  * save_state:
  * @path      : path of saved state that shall be written to.
  *
- * Save a state from memory to disk.
+ * Save a state from memory to disk. The state is serialized
+ * immediately, compression (if enabled) and writing the file
+ * happen on a background thread if threads are available.
+ * The outcome is reported through save_state_poll.
  *
- * Returns: true if successful, false otherwise.
+ * Returns: true if the state was serialized, false otherwise.
  **/
 bool save_state(const char *path)
 {
    bool ret = false;
-   void *data = NULL;
+   struct state_writer_job *job = NULL;
    size_t size = pretro_serialize_size();
 
    RARCH_LOG("Saving state: \"%s\".\n", path);
@@ -246,26 +634,172 @@ bool save_state(const char *path)
    if (size == 0)
       return false;
 
-   data = malloc(size);
+   rarch_perf_register(&save_state_serialize_perf);
+   rarch_perf_register(&save_state_compress_perf);
+   rarch_perf_register(&save_state_write_perf);
 
-   if (!data)
+#ifdef HAVE_THREADS
+   if (!state_writer_init())
+      RARCH_WARN("Failed to start state writer, saving synchronously.\n");
+#endif
+
+   /* Wait for a pooled buffer the writer is done with. */
+   state_writer_lock();
+   state_writer_wait(STATE_WRITER_JOBS);
+   job = &state_writer.jobs[state_writer.queued % STATE_WRITER_JOBS];
+   state_writer_unlock();
+
+   if (size > job->data_cap)
    {
-      RARCH_ERR("Failed to allocate memory for save state buffer.\n");
-      return false;
+      uint8_t *data = (uint8_t*)realloc(job->data, size);
+
+      if (!data)
+      {
+         RARCH_ERR("Failed to allocate memory for save state buffer.\n");
+         return false;
+      }
+
+      job->data     = data;
+      job->data_cap = size;
    }
 
    RARCH_LOG("State size: %d bytes.\n", (int)size);
-   ret = pretro_serialize(data, size);
 
-   if (ret)
-      ret = write_file(path, data, size);
+   rarch_perf_start(&save_state_serialize_perf);
+   ret = pretro_serialize(job->data, size);
+   rarch_perf_stop(&save_state_serialize_perf);
 
    if (!ret)
+   {
       RARCH_ERR("Failed to save state to \"%s\".\n", path);
+      return false;
+   }
 
-   free(data);
+   job->size     = size;
+   job->compress = g_settings.savestate_compression;
+   strlcpy(job->path, path, sizeof(job->path));
 
-   return ret;
+   state_writer_lock();
+   state_writer.queued++;
+#ifdef HAVE_THREADS
+   if (state_writer.thread)
+      scond_broadcast(state_writer.cond);
+   else
+#endif
+      state_writer_wait(1);
+   state_writer_unlock();
+
+   return true;
+}
+
+/**
+ * save_state_deinit:
+ *
+ * Waits for pending savestate writes, stops the writer and frees
+ * the pooled savestate buffers.
+ **/
+void save_state_deinit(void)
+{
+   unsigned i;
+
+   save_state_flush();
+
+#ifdef HAVE_THREADS
+   if (state_writer.thread)
+   {
+      slock_lock(state_writer.lock);
+      state_writer.quit = true;
+      scond_broadcast(state_writer.cond);
+      slock_unlock(state_writer.lock);
+
+      sthread_join(state_writer.thread);
+      slock_free(state_writer.lock);
+      scond_free(state_writer.cond);
+   }
+#endif
+
+   for (i = 0; i < STATE_WRITER_JOBS; i++)
+      free(state_writer.jobs[i].data);
+   free(state_writer.cdata);
+   memset(&state_writer, 0, sizeof(state_writer));
+}
+
+/**
+ * read_state_file:
+ * @path      : path that state will be loaded from.
+ * @buf       : buffer to allocate and read the state into.
+ *
+ * Reads a savestate, inflating compressed savestates while
+ * they are streamed from disk.
+ *
+ * Returns: size of the state, -1 on error.
+ **/
+static ssize_t read_state_file(const char *path, void **buf)
+{
+#ifdef HAVE_ZLIB
+   uint8_t header[SAVESTATE_ZLIB_HEADER_SIZE];
+   uint8_t chunk[16 * 1024];
+   z_stream stream = {0};
+   uint8_t *data = NULL;
+   uint32_t size = 0;
+   int zret = Z_OK;
+   FILE *file = fopen(path, "rb");
+
+   if (!file)
+      return -1;
+
+   if (fread(header, 1, sizeof(header), file) != sizeof(header)
+         || memcmp(header, SAVESTATE_ZLIB_MAGIC, SAVESTATE_ZLIB_MAGIC_SIZE))
+   {
+      /* Uncompressed state. */
+      fclose(file);
+      return read_file(path, buf);
+   }
+
+   size = header[SAVESTATE_ZLIB_MAGIC_SIZE + 0] << 0
+      | header[SAVESTATE_ZLIB_MAGIC_SIZE + 1] << 8
+      | header[SAVESTATE_ZLIB_MAGIC_SIZE + 2] << 16
+      | (uint32_t)header[SAVESTATE_ZLIB_MAGIC_SIZE + 3] << 24;
+
+   data = (uint8_t*)malloc(size ? size : 1);
+   if (!data || inflateInit(&stream) != Z_OK)
+      goto error;
+
+   stream.next_out  = data;
+   stream.avail_out = size;
+
+   while (zret != Z_STREAM_END)
+   {
+      stream.avail_in = fread(chunk, 1, sizeof(chunk), file);
+      stream.next_in  = chunk;
+
+      if (!stream.avail_in)
+         break;
+
+      zret = inflate(&stream, Z_NO_FLUSH);
+      if (zret != Z_OK && zret != Z_STREAM_END)
+         break;
+   }
+
+   inflateEnd(&stream);
+
+   if (zret != Z_STREAM_END || stream.total_out != size)
+   {
+      RARCH_ERR("Failed to decompress state \"%s\".\n", path);
+      goto error;
+   }
+
+   fclose(file);
+   *buf = data;
+   return size;
+
+error:
+   free(data);
+   fclose(file);
+   return -1;
+#else
+   return read_file(path, buf);
+#endif
 }
 
 /**
@@ -284,7 +818,12 @@ bool load_state(const char *path)
    void *buf = NULL;
    struct sram_block *blocks = NULL;
 
-   ssize_t size = read_file(path, &buf);
+   ssize_t size;
+
+   /* Make sure a pending save to the same slot has hit the disk. */
+   save_state_flush();
+
+   size = read_state_file(path, &buf);
 
    RARCH_LOG("Loading state: \"%s\".\n", path);
 
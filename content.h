@@ -43,12 +43,42 @@ bool load_state(const char *path);
  * save_state:
  * @path      : path of saved state that shall be written to.
  *
- * Save a state from memory to disk.
+ * Save a state from memory to disk. The state is serialized
+ * immediately and written in the background, the outcome of
+ * the write is reported through save_state_poll.
  *
- * Returns: true if successful, false otherwise.
+ * Returns: true if the state was serialized, false otherwise.
  **/
 bool save_state(const char *path);
 
+/**
+ * save_state_poll:
+ * @path      : filled with the path of the saved state.
+ * @size      : size of @path.
+ * @success   : set to whether the state was written.
+ *
+ * Gets the outcome of a finished savestate write.
+ *
+ * Returns: true if a save finished since the last call,
+ * otherwise false.
+ **/
+bool save_state_poll(char *path, size_t size, bool *success);
+
+/**
+ * save_state_flush:
+ *
+ * Waits for pending background savestate writes to finish.
+ **/
+void save_state_flush(void);
+
+/**
+ * save_state_deinit:
+ *
+ * Waits for pending savestate writes and frees the pooled
+ * savestate buffers.
+ **/
+void save_state_deinit(void);
+
 /**
  * load_ram_file:
  * @path             : path of RAM state that will be loaded from.
@@ -15,11 +15,16 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include "core_info.h"
 #include "general.h"
 #include <file/file_path.h>
 #include "file_ext.h"
 #include "file_extract.h"
+#include "file_ops.h"
 #include <file/dir_list.h>
 #include "config.def.h"
 
@@ -27,6 +32,71 @@
 #include "config.h"
 #endif
 
+#define CORE_INFO_CACHE_MAGIC   0x49434152 /* "RACI" */
+#define CORE_INFO_CACHE_VERSION 1
+
+/* String fields of core_info_t stored in the cache. */
+static const size_t core_info_cache_fields[] = {
+   offsetof(core_info_t, path),
+   offsetof(core_info_t, display_name),
+   offsetof(core_info_t, core_name),
+   offsetof(core_info_t, systemname),
+   offsetof(core_info_t, system_manufacturer),
+   offsetof(core_info_t, supported_extensions),
+   offsetof(core_info_t, authors),
+   offsetof(core_info_t, permissions),
+   offsetof(core_info_t, licenses),
+   offsetof(core_info_t, categories),
+   offsetof(core_info_t, databases),
+   offsetof(core_info_t, notes),
+};
+
+#define CORE_INFO_CACHE_FIELDS \
+   (sizeof(core_info_cache_fields) / sizeof(core_info_cache_fields[0]))
+
+/* On-disk layout (native endian, the cache is local):
+ *
+ * core_info_cache_header_t
+ * char modules_path[modules_path_len]
+ * char info_path[info_path_len]
+ * core_info_cache_record_t records[count]
+ * core_info_cache_firmware_t firmware[firmware_count]
+ * char strings[strings_size] (NUL-terminated strings)
+ *
+ * String references are offsets into strings plus one, 0 is NULL.
+ */
+typedef struct core_info_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   int64_t modules_mtime;
+   int64_t info_mtime;
+   uint32_t modules_path_len;
+   uint32_t info_path_len;
+   uint32_t count;
+   uint32_t firmware_count;
+   uint32_t all_ext;
+   uint32_t strings_size;
+} core_info_cache_header_t;
+
+typedef struct core_info_cache_record
+{
+   int64_t info_mtime; /* -1 if there was no info file. */
+   uint32_t strings[CORE_INFO_CACHE_FIELDS];
+   uint32_t firmware_first;
+   uint32_t firmware_count;
+   uint32_t has_info;
+   uint32_t supports_no_game;
+} core_info_cache_record_t;
+
+typedef struct core_info_cache_firmware
+{
+   uint32_t path;
+   uint32_t desc;
+   uint32_t optional;
+   uint32_t pad;
+} core_info_cache_firmware_t;
+
 static void core_info_list_resolve_all_extensions(
       core_info_list_t *core_info_list)
 {
@@ -59,45 +129,435 @@ static void core_info_list_resolve_all_extensions(
    }
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+static void core_info_resolve_firmware(core_info_t *info,
+      config_file_t *conf)
 {
-   size_t i;
    unsigned c;
+   unsigned count = 0;
 
-   if (!core_info_list)
+   if (!config_get_uint(conf, "firmware_count", &count) || !count)
+      return;
+
+   info->firmware = (core_info_firmware_t*)
+      calloc(count, sizeof(*info->firmware));
+
+   if (!info->firmware)
+      return;
+
+   info->firmware_count = count;
+
+   for (c = 0; c < count; c++)
+   {
+      char path_key[64], desc_key[64], opt_key[64];
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key, sizeof(opt_key), "firmware%u_opt", c);
+
+      config_get_string(conf, path_key, &info->firmware[c].path);
+      config_get_string(conf, desc_key, &info->firmware[c].desc);
+      config_get_bool(conf, opt_key , &info->firmware[c].optional);
+   }
+}
+
+static void core_info_resolve_lists(core_info_t *info)
+{
+   if (info->supported_extensions)
+   {
+      info->supported_extensions_list =
+         string_split(info->supported_extensions, "|");
+      info->supported_extensions_set  =
+         string_ext_set_new(info->supported_extensions_list);
+   }
+   if (info->authors)
+      info->authors_list = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list = string_split(info->licenses, "|");
+   if (info->categories)
+      info->categories_list = string_split(info->categories, "|");
+   if (info->databases)
+      info->databases_list = string_split(info->databases, "|");
+   if (info->notes)
+      info->note_list = string_split(info->notes, "|");
+}
+
+/**
+ * core_info_get_info_path:
+ * @core_path        : path to core.
+ * @info_dir         : directory holding the info files.
+ * @s                : output path.
+ * @len              : size of @s.
+ *
+ * Gets the path of the info file describing @core_path.
+ **/
+static void core_info_get_info_path(const char *core_path,
+      const char *info_dir, char *s, size_t len)
+{
+   char info_path_base[PATH_MAX_LENGTH];
+
+   fill_pathname_base(info_path_base, core_path, sizeof(info_path_base));
+   path_remove_extension(info_path_base);
+
+#if defined(RARCH_MOBILE) || defined(RARCH_CONSOLE)
+   {
+      char *substr = strrchr(info_path_base, '_');
+      if (substr)
+         *substr = '\0';
+   }
+#endif
+
+   strlcat(info_path_base, ".info", sizeof(info_path_base));
+   fill_pathname_join(s, info_dir, info_path_base, len);
+}
+
+static int64_t core_info_mtime(const char *path)
+{
+   struct stat st;
+
+   if (stat(path, &st) != 0)
+      return -1;
+   return (int64_t)st.st_mtime;
+}
+
+static void core_info_parse(core_info_t *info, const char *info_path)
+{
+   config_file_t *conf = config_file_new(info_path);
+
+   if (!conf)
       return;
 
+   config_get_string(conf, "display_name", &info->display_name);
+   config_get_string(conf, "corename", &info->core_name);
+   config_get_string(conf, "systemname", &info->systemname);
+   config_get_string(conf, "manufacturer", &info->system_manufacturer);
+   config_get_string(conf, "supported_extensions",
+         &info->supported_extensions);
+   config_get_string(conf, "authors", &info->authors);
+   config_get_string(conf, "permissions", &info->permissions);
+   config_get_string(conf, "license", &info->licenses);
+   config_get_string(conf, "categories", &info->categories);
+   config_get_string(conf, "database", &info->databases);
+   config_get_string(conf, "notes", &info->notes);
+   config_get_bool(conf, "supports_no_game", &info->supports_no_game);
+
+   core_info_resolve_firmware(info, conf);
+   core_info_resolve_lists(info);
+
+   info->has_info = true;
+   config_file_free(conf);
+}
+
+static bool core_info_cache_path(char *s, size_t len)
+{
+   if (!*g_settings.playlist_directory)
+      return false;
+
+   if (!path_is_directory(g_settings.playlist_directory)
+         && !path_mkdir(g_settings.playlist_directory))
+      return false;
+
+   fill_pathname_join(s, g_settings.playlist_directory,
+         "core_info.cache", len);
+   return true;
+}
+
+/* Appends str to the string blob, returns its reference. */
+static uint32_t core_info_cache_push_string(char **blob, size_t *size,
+      size_t *cap, const char *str)
+{
+   uint32_t ref;
+   size_t len;
+
+   if (!str)
+      return 0;
+
+   len = strlen(str) + 1;
+
+   if (*size + len > *cap)
+   {
+      size_t new_cap = *cap ? *cap : 4096;
+      char *new_blob = NULL;
+
+      while (*size + len > new_cap)
+         new_cap *= 2;
+
+      new_blob = (char*)realloc(*blob, new_cap);
+      if (!new_blob)
+         return 0;
+
+      *blob = new_blob;
+      *cap  = new_cap;
+   }
+
+   memcpy(*blob + *size, str, len);
+   ref    = *size + 1;
+   *size += len;
+   return ref;
+}
+
+/**
+ * core_info_cache_save:
+ * @core_info_list   : freshly parsed core info list.
+ * @modules_path     : directory the cores were listed from.
+ * @info_dir         : directory holding the info files.
+ *
+ * Writes @core_info_list to the core info cache, so that the next
+ * core_info_list_new() call with unchanged directories does not
+ * need to list the cores or parse any info file.
+ **/
+static void core_info_cache_save(const core_info_list_t *core_info_list,
+      const char *modules_path, const char *info_dir)
+{
+   size_t i, j;
+   char path[PATH_MAX_LENGTH];
+   core_info_cache_header_t header    = {0};
+   core_info_cache_record_t *records  = NULL;
+   core_info_cache_firmware_t *firmware = NULL;
+   char *strings      = NULL;
+   size_t strings_size = 0, strings_cap = 0, firmware_count = 0;
+   FILE *file         = NULL;
+
+   if (!core_info_cache_path(path, sizeof(path)))
+      return;
+
+   for (i = 0; i < core_info_list->count; i++)
+      firmware_count += core_info_list->list[i].firmware_count;
+
+   records  = (core_info_cache_record_t*)
+      calloc(core_info_list->count + 1, sizeof(*records));
+   firmware = (core_info_cache_firmware_t*)
+      calloc(firmware_count + 1, sizeof(*firmware));
+
+   if (!records || !firmware)
+      goto end;
+
+   header.magic            = CORE_INFO_CACHE_MAGIC;
+   header.version          = CORE_INFO_CACHE_VERSION;
+   header.modules_mtime    = core_info_mtime(modules_path);
+   header.info_mtime       = core_info_mtime(info_dir);
+   header.modules_path_len = strlen(modules_path);
+   header.info_path_len    = strlen(info_dir);
+   header.count            = core_info_list->count;
+   header.firmware_count   = firmware_count;
+   header.all_ext          = core_info_cache_push_string(&strings,
+         &strings_size, &strings_cap, core_info_list->all_ext);
+
+   firmware_count = 0;
+
    for (i = 0; i < core_info_list->count; i++)
    {
-      unsigned count = 0;
-      core_info_t *info = (core_info_t*)&core_info_list->list[i];
+      char info_path[PATH_MAX_LENGTH];
+      const core_info_t *info = &core_info_list->list[i];
+      core_info_cache_record_t *record = &records[i];
 
-      if (!info->data)
-         continue;
+      core_info_get_info_path(info->path, info_dir,
+            info_path, sizeof(info_path));
 
-      if (!config_get_uint(info->data, "firmware_count", &count))
-         continue;
+      record->info_mtime       = info->has_info ?
+         core_info_mtime(info_path) : -1;
+      record->has_info         = info->has_info;
+      record->supports_no_game = info->supports_no_game;
+      record->firmware_first   = firmware_count;
+      record->firmware_count   = info->firmware_count;
 
-      info->firmware = (core_info_firmware_t*)
-         calloc(count, sizeof(*info->firmware));
+      for (j = 0; j < CORE_INFO_CACHE_FIELDS; j++)
+         record->strings[j] = core_info_cache_push_string(&strings,
+               &strings_size, &strings_cap,
+               *(char* const*)((const uint8_t*)info
+                  + core_info_cache_fields[j]));
 
-      if (!info->firmware)
-         continue;
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         core_info_cache_firmware_t *fw = &firmware[firmware_count++];
+
+         fw->path     = core_info_cache_push_string(&strings,
+               &strings_size, &strings_cap, info->firmware[j].path);
+         fw->desc     = core_info_cache_push_string(&strings,
+               &strings_size, &strings_cap, info->firmware[j].desc);
+         fw->optional = info->firmware[j].optional;
+      }
+   }
+
+   header.strings_size = strings_size;
+
+   file = fopen(path, "wb");
+   if (!file)
+      goto end;
 
-      for (c = 0; c < count; c++)
+   fwrite(&header, sizeof(header), 1, file);
+   fwrite(modules_path, 1, header.modules_path_len, file);
+   fwrite(info_dir, 1, header.info_path_len, file);
+   fwrite(records, sizeof(*records), header.count, file);
+   fwrite(firmware, sizeof(*firmware), header.firmware_count, file);
+
+   if (fwrite(strings, 1, strings_size, file) != strings_size)
+      RARCH_WARN("Failed to write core info cache: %s.\n", path);
+
+   fclose(file);
+
+end:
+   free(records);
+   free(firmware);
+   free(strings);
+}
+
+static char *core_info_cache_strdup(const char *strings,
+      size_t strings_size, uint32_t ref)
+{
+   if (!ref || ref > strings_size)
+      return NULL;
+   return strdup(strings + ref - 1);
+}
+
+/**
+ * core_info_cache_load:
+ * @modules_path     : directory to list cores from.
+ * @info_dir         : directory holding the info files.
+ *
+ * Loads the core info cache in one read, if neither directory
+ * nor any of the cached info files changed since it was written.
+ *
+ * Returns: core info list on success, otherwise NULL.
+ **/
+static core_info_list_t *core_info_cache_load(const char *modules_path,
+      const char *info_dir)
+{
+   size_t i, j;
+   char path[PATH_MAX_LENGTH];
+   const core_info_cache_header_t *header     = NULL;
+   const core_info_cache_record_t *records    = NULL;
+   const core_info_cache_firmware_t *firmware = NULL;
+   const char *strings  = NULL;
+   const uint8_t *ptr   = NULL;
+   uint8_t *buf         = NULL;
+   core_info_list_t *core_info_list = NULL;
+   long len             = 0;
+
+   if (!core_info_cache_path(path, sizeof(path)))
+      return NULL;
+
+   if (!path_file_exists(path))
+      return NULL;
+
+   len = read_file(path, (void**)&buf);
+   if (len < (long)sizeof(*header))
+      goto error;
+
+   header = (const core_info_cache_header_t*)buf;
+
+   if (header->magic != CORE_INFO_CACHE_MAGIC
+         || header->version != CORE_INFO_CACHE_VERSION
+         || header->modules_path_len != strlen(modules_path)
+         || header->info_path_len != strlen(info_dir))
+      goto error;
+
+   if ((size_t)len != sizeof(*header)
+         + header->modules_path_len + header->info_path_len
+         + header->count * sizeof(*records)
+         + header->firmware_count * sizeof(*firmware)
+         + header->strings_size)
+      goto error;
+
+   ptr = buf + sizeof(*header);
+   if (memcmp(ptr, modules_path, header->modules_path_len))
+      goto error;
+   ptr += header->modules_path_len;
+   if (memcmp(ptr, info_dir, header->info_path_len))
+      goto error;
+   ptr += header->info_path_len;
+
+   if (header->modules_mtime != core_info_mtime(modules_path)
+         || header->info_mtime != core_info_mtime(info_dir))
+      goto error;
+
+   records  = (const core_info_cache_record_t*)ptr;
+   ptr     += header->count * sizeof(*records);
+   firmware = (const core_info_cache_firmware_t*)ptr;
+   ptr     += header->firmware_count * sizeof(*firmware);
+   strings  = (const char*)ptr;
+
+   if (header->strings_size && strings[header->strings_size - 1] != '\0')
+      goto error;
+
+   core_info_list = (core_info_list_t*)calloc(1, sizeof(*core_info_list));
+   if (!core_info_list)
+      goto error;
+
+   core_info_list->list = (core_info_t*)
+      calloc(header->count + 1, sizeof(*core_info_list->list));
+   if (!core_info_list->list)
+      goto error;
+
+   core_info_list->count = header->count;
+
+   for (i = 0; i < header->count; i++)
+   {
+      core_info_cache_record_t record;
+      char info_path[PATH_MAX_LENGTH];
+      core_info_t *info = &core_info_list->list[i];
+
+      /* Copy, records are not necessarily aligned in buf. */
+      memcpy(&record, &records[i], sizeof(record));
+
+      for (j = 0; j < CORE_INFO_CACHE_FIELDS; j++)
+         *(char**)((uint8_t*)info + core_info_cache_fields[j]) =
+            core_info_cache_strdup(strings, header->strings_size,
+                  record.strings[j]);
+
+      if (!info->path)
+         goto error;
+
+      /* An info file edited in place does not touch the
+       * directory mtime. */
+      core_info_get_info_path(info->path, info_dir,
+            info_path, sizeof(info_path));
+      if (record.info_mtime != (record.has_info ?
+               core_info_mtime(info_path) : -1))
+         goto error;
+
+      if (record.firmware_first + record.firmware_count
+            > header->firmware_count)
+         goto error;
+
+      if (record.firmware_count)
       {
-         char path_key[64], desc_key[64], opt_key[64];
+         info->firmware = (core_info_firmware_t*)
+            calloc(record.firmware_count, sizeof(*info->firmware));
+         if (!info->firmware)
+            goto error;
 
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key, sizeof(opt_key), "firmware%u_opt", c);
+         info->firmware_count = record.firmware_count;
+      }
 
-         config_get_string(info->data, path_key, &info->firmware[c].path);
-         config_get_string(info->data, desc_key, &info->firmware[c].desc);
-         config_get_bool(info->data, opt_key , &info->firmware[c].optional);
+      for (j = 0; j < record.firmware_count; j++)
+      {
+         core_info_cache_firmware_t fw;
+
+         memcpy(&fw, &firmware[record.firmware_first + j], sizeof(fw));
+         info->firmware[j].path     = core_info_cache_strdup(strings,
+               header->strings_size, fw.path);
+         info->firmware[j].desc     = core_info_cache_strdup(strings,
+               header->strings_size, fw.desc);
+         info->firmware[j].optional = fw.optional;
       }
+
+      info->has_info         = record.has_info;
+      info->supports_no_game = record.supports_no_game;
+      core_info_resolve_lists(info);
    }
+
+   core_info_list->all_ext = core_info_cache_strdup(strings,
+         header->strings_size, header->all_ext);
+
+   free(buf);
+   return core_info_list;
+
+error:
+   core_info_list_free(core_info_list);
+   free(buf);
+   return NULL;
 }
 
 core_info_list_t *core_info_list_new(const char *modules_path)
@@ -105,7 +565,15 @@ core_info_list_t *core_info_list_new(const char *modules_path)
    size_t i;
    core_info_t *core_info = NULL;
    core_info_list_t *core_info_list = NULL;
-   struct string_list *contents = (struct string_list*)
+   struct string_list *contents = NULL;
+   const char *info_dir = (*g_settings.libretro_info_path) ?
+      g_settings.libretro_info_path : modules_path;
+
+   core_info_list = core_info_cache_load(modules_path, info_dir);
+   if (core_info_list)
+      return core_info_list;
+
+   contents = (struct string_list*)
       dir_list_new(modules_path, EXT_EXECUTABLES, false);
 
    if (!contents)
@@ -124,94 +592,24 @@ core_info_list_t *core_info_list_new(const char *modules_path)
 
    for (i = 0; i < contents->size; i++)
    {
-      char info_path_base[PATH_MAX_LENGTH], info_path[PATH_MAX_LENGTH];
+      char info_path[PATH_MAX_LENGTH];
       core_info[i].path = strdup(contents->elems[i].data);
 
       if (!core_info[i].path)
          break;
 
-      fill_pathname_base(info_path_base, contents->elems[i].data,
-            sizeof(info_path_base));
-      path_remove_extension(info_path_base);
-
-#if defined(RARCH_MOBILE) || defined(RARCH_CONSOLE)
-      char *substr = strrchr(info_path_base, '_');
-      if (substr)
-         *substr = '\0';
-#endif
-
-      strlcat(info_path_base, ".info", sizeof(info_path_base));
-
-      fill_pathname_join(info_path, (*g_settings.libretro_info_path) ?
-            g_settings.libretro_info_path : modules_path,
-            info_path_base, sizeof(info_path));
-
-      core_info[i].data = config_file_new(info_path);
-
-      if (core_info[i].data)
-      {
-         unsigned count = 0;
-         config_get_string(core_info[i].data, "display_name",
-               &core_info[i].display_name);
-         config_get_string(core_info[i].data, "corename",
-               &core_info[i].core_name);
-         config_get_string(core_info[i].data, "systemname",
-               &core_info[i].systemname);
-         config_get_string(core_info[i].data, "manufacturer",
-               &core_info[i].system_manufacturer);
-         config_get_uint(core_info[i].data, "firmware_count", &count);
-         core_info[i].firmware_count = count;
-         if (config_get_string(core_info[i].data, "supported_extensions",
-                  &core_info[i].supported_extensions) &&
-               core_info[i].supported_extensions)
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
-
-         if (config_get_string(core_info[i].data, "authors",
-                  &core_info[i].authors) &&
-               core_info[i].authors)
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-
-         if (config_get_string(core_info[i].data, "permissions",
-                  &core_info[i].permissions) &&
-               core_info[i].permissions)
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-
-         if (config_get_string(core_info[i].data, "license",
-                  &core_info[i].licenses) &&
-               core_info[i].licenses)
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
-
-         if (config_get_string(core_info[i].data, "categories",
-                  &core_info[i].categories) &&
-               core_info[i].categories)
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
-
-         if (config_get_string(core_info[i].data, "database",
-                  &core_info[i].databases) &&
-               core_info[i].databases)
-            core_info[i].databases_list =
-               string_split(core_info[i].databases, "|");
-
-         if (config_get_string(core_info[i].data, "notes",
-                  &core_info[i].notes) &&
-               core_info[i].notes)
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
-
-         config_get_bool(core_info[i].data, "supports_no_game",
-               &core_info[i].supports_no_game);
-      }
+      core_info_get_info_path(contents->elems[i].data, info_dir,
+            info_path, sizeof(info_path));
+      core_info_parse(&core_info[i], info_path);
 
       if (!core_info[i].display_name)
          core_info[i].display_name = strdup(path_basename(core_info[i].path));
    }
 
    core_info_list_resolve_all_extensions(core_info_list);
-   core_info_list_resolve_all_firmware(core_info_list);
+
+   if (i == contents->size)
+      core_info_cache_save(core_info_list, modules_path, info_dir);
 
    dir_list_free(contents);
    return core_info_list;
@@ -238,6 +636,7 @@ void core_info_list_free(core_info_list_t *core_info_list)
          continue;
 
       free(info->path);
+      free(info->core_name);
       free(info->systemname);
       free(info->system_manufacturer);
       free(info->display_name);
@@ -250,13 +649,13 @@ void core_info_list_free(core_info_list_t *core_info_list)
       free(info->notes);
       if (info->supported_extensions_list)
          string_list_free(info->supported_extensions_list);
+      string_ext_set_free(info->supported_extensions_set);
       string_list_free(info->authors_list);
       string_list_free(info->note_list);
       string_list_free(info->permissions_list);
       string_list_free(info->licenses_list);
       string_list_free(info->categories_list);
       string_list_free(info->databases_list);
-      config_file_free(info->data);
 
       for (j = 0; j < info->firmware_count; j++)
       {
@@ -279,7 +678,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-      num += !!core_info_list->list[i].data;
+      num += core_info_list->list[i].has_info;
 
    return num;
 }
@@ -332,22 +731,22 @@ bool core_info_does_support_any_file(const core_info_t *core,
       const struct string_list *list)
 {
    size_t i;
-   if (!list || !core || !core->supported_extensions_list)
+   if (!list || !core || !core->supported_extensions_set)
       return false;
 
    for (i = 0; i < list->size; i++)
-      if (string_list_find_elem_prefix(core->supported_extensions_list,
-               ".", path_get_extension(list->elems[i].data)))
+      if (string_ext_set_find(core->supported_extensions_set,
+               path_get_extension(list->elems[i].data)))
          return true;
    return false;
 }
 
 bool core_info_does_support_file(const core_info_t *core, const char *path)
 {
-   if (!path || !core || !core->supported_extensions_list)
+   if (!path || !core || !core->supported_extensions_set)
       return false;
-   return string_list_find_elem_prefix(
-         core->supported_extensions_list, ".", path_get_extension(path));
+   return string_ext_set_find(core->supported_extensions_set,
+         path_get_extension(path));
 }
 
 const char *core_info_list_get_all_extensions(core_info_list_t *core_info_list)
@@ -357,21 +756,11 @@ const char *core_info_list_get_all_extensions(core_info_list_t *core_info_list)
    return core_info_list->all_ext;
 }
 
-/* qsort_r() is not in standard C, sadly. */
-static const char *core_info_tmp_path;
-static const struct string_list *core_info_tmp_list;
-
 static int core_info_qsort_cmp(const void *a_, const void *b_)
 {
    const core_info_t *a = (const core_info_t*)a_;
    const core_info_t *b = (const core_info_t*)b_;
-   int support_a        = core_info_does_support_any_file(a, core_info_tmp_list) ||
-      core_info_does_support_file(a, core_info_tmp_path);
-   int support_b        = core_info_does_support_any_file(b, core_info_tmp_list) ||
-      core_info_does_support_file(b, core_info_tmp_path);
 
-   if (support_a != support_b)
-      return support_b - support_a;
    return strcasecmp(a->display_name, b->display_name);
 }
 
@@ -384,43 +773,38 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
    if (!core_info_list)
       return;
 
-   (void)list;
-
-   core_info_tmp_path = path;
-
 #ifdef HAVE_ZLIB
    if (!strcasecmp(path_get_extension(path), "zip"))
       list = zlib_get_file_list(path, NULL);
-   core_info_tmp_list = list;
 #endif
 
-   /* Let supported core come first in list so we can return 
-    * a pointer to them. */
-   qsort(core_info_list->list, core_info_list->count,
-         sizeof(core_info_t), core_info_qsort_cmp);
-
-   for (i = 0; i < core_info_list->count; i++, supported++)
+   /* Let supported cores come first in list so we can return 
+    * a pointer to them. Each core is only matched once. */
+   for (i = 0; i < core_info_list->count; i++)
    {
-      const core_info_t *core = &core_info_list->list[i];
-
-      if (!core)
-         continue;
+      core_info_t *core = &core_info_list->list[i];
 
-      if (core_info_does_support_file(core, path))
+      if (!core_info_does_support_file(core, path)
+            && !core_info_does_support_any_file(core, list))
          continue;
 
-#ifdef HAVE_ZLIB
-      if (core_info_does_support_any_file(core, list))
-         continue;
-#endif
-
-      break;
+      if (i != supported)
+      {
+         core_info_t tmp = core_info_list->list[supported];
+         core_info_list->list[supported] = *core;
+         *core = tmp;
+      }
+      supported++;
    }
 
-#ifdef HAVE_ZLIB
+   qsort(core_info_list->list, supported,
+         sizeof(core_info_t), core_info_qsort_cmp);
+   qsort(core_info_list->list + supported,
+         core_info_list->count - supported,
+         sizeof(core_info_t), core_info_qsort_cmp);
+
    if (list)
       string_list_free(list);
-#endif
 
    *infos = core_info_list->list;
    *num_infos = supported;
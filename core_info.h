@@ -38,7 +38,6 @@ typedef struct
 typedef struct
 {
    char *path;
-   config_file_t *data;
    char *display_name;
    char *core_name;
    char *system_manufacturer;
@@ -54,12 +53,15 @@ typedef struct
    struct string_list *databases_list;
    struct string_list *note_list;   
    struct string_list *supported_extensions_list;
+   struct string_ext_set *supported_extensions_set;
    struct string_list *authors_list;
    struct string_list *permissions_list;
    struct string_list *licenses_list;
 
    core_info_firmware_t *firmware;
    size_t firmware_count;
+   /* Whether an info file was found for this core. */
+   bool has_info;
    bool supports_no_game;
    void *userdata;
 } core_info_t;
@@ -89,7 +89,8 @@ static bool parse_variable(core_option_manager_t *opt, size_t idx,
 {
    size_t i;
    const char *val_start;
-   char *value, *desc_end, *config_val = NULL;
+   const char *config_val = NULL;
+   char *value, *desc_end;
    struct core_option *option = (struct core_option*)&opt->opts[idx];
 
    if (!option)
@@ -117,7 +118,7 @@ static bool parse_variable(core_option_manager_t *opt, size_t idx,
       return false;
    }
 
-   if (config_get_string(opt->conf, option->key, &config_val))
+   if (config_get_string_ref(opt->conf, option->key, &config_val))
    {
       for (i = 0; i < option->vals->size; i++)
       {
@@ -127,8 +128,6 @@ static bool parse_variable(core_option_manager_t *opt, size_t idx,
             break;
          }
       }
-
-      free(config_val);
    }
 
    free(value);
@@ -19,6 +19,9 @@
 #include "hash.h"
 #include "file_ops.h"
 #include "file_extract.h"
+#ifdef HAVE_ZLIB
+#include "file_archive_index.h"
+#endif
 #include "general.h"
 #include <file/file_path.h>
 #include "file_ext.h"
@@ -46,17 +49,6 @@ int database_open_cursor(libretrodb_t *db,
    return 0;
 }
 
-#ifdef HAVE_ZLIB
-static bool zlib_compare_crc32(const char *name, const char *valid_exts,
-      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
-      uint32_t crc32, void *userdata)
-{
-   RARCH_LOG("CRC32: 0x%x\n", crc32);
-
-   return true;
-}
-#endif
-
 int database_info_write_rdl(const char *dir)
 {
    size_t i;
@@ -83,33 +75,40 @@ int database_info_write_rdl(const char *dir)
 #ifdef HAVE_ZLIB
       if (!strcmp(path_get_extension(name), "zip"))
       {
+         size_t j;
+         archive_index_t *index = archive_index_get(name);
+
          RARCH_LOG("[ZIP]: name: %s\n", name);
 
-         if (!zlib_parse_file(name, NULL, zlib_compare_crc32,
-                  (void*)parent_dir))
+         if (!index)
             RARCH_LOG("Could not process ZIP file.\n");
+
+         /* CRCs come straight from the archive index. */
+         for (j = 0; j < archive_index_size(index); j++)
+            RARCH_LOG("CRC32: 0x%x\n",
+                  (unsigned)archive_index_at(index, j)->crc32);
+
+         archive_index_release(index);
       }
       else
 #endif
       {
-         ssize_t ret;
-         uint32_t crc, target_crc = 0;
-         uint8_t *ret_buf = NULL;
-
-         (void)target_crc;
+         rarch_hash_ctx_t hash;
+         char digest[41];
 
          RARCH_LOG("name: %s\n", name);
-         ret = read_file(name, (void**)&ret_buf);
 
-         if (ret <= 0)
+         /* Stream the file through all digests in one pass instead of
+          * loading it whole. */
+         if (!rarch_hash_file(&hash, name,
+                  RARCH_HASH_CRC32 | RARCH_HASH_MD5 | RARCH_HASH_SHA1))
             continue;
 
-         crc = crc32_calculate(ret_buf, ret);
-
-         RARCH_LOG("CRC32: 0x%x .\n", (unsigned)crc);
-
-         if (ret_buf)
-            free(ret_buf);
+         RARCH_LOG("CRC32: 0x%x .\n", (unsigned)hash.crc32);
+         rarch_hash_to_string(digest, hash.md5_digest, 16);
+         RARCH_LOG("MD5: %s .\n", digest);
+         rarch_hash_to_string(digest, hash.sha1_digest, 20);
+         RARCH_LOG("SHA1: %s .\n", digest);
       }
    }
 
@@ -118,73 +117,110 @@ int database_info_write_rdl(const char *dir)
    return 0;
 }
 
-static char *bin_to_hex_alloc(const uint8_t *data, size_t len)
+static char *bin_to_hex_alloc(struct rmsgpack_dom_arena *arena,
+      const uint8_t *data, size_t len)
 {
    size_t i;
-   char *ret= (char*)malloc(len*2+1);
-   
+   char *ret = (char*)rmsgpack_dom_arena_alloc(arena, len * 2 + 1);
+
+   if (!ret)
+      return NULL;
+
    for (i = 0; i < len; i++)
-      snprintf(ret+i*2, 3, "%02X", data[i]);
+      snprintf(ret + i * 2, 3, "%02X", data[i]);
+   ret[len * 2] = '\0';
+   return ret;
+}
+
+static char *database_info_strdup(struct rmsgpack_dom_arena *arena,
+      const struct rmsgpack_dom_value *val)
+{
+   char *ret = NULL;
+
+   if (val->type != RDT_STRING)
+      return NULL;
+
+   ret = (char*)rmsgpack_dom_arena_alloc(arena, val->string.len + 1);
+   if (!ret)
+      return NULL;
+
+   memcpy(ret, val->string.buff, val->string.len);
+   ret[val->string.len] = '\0';
    return ret;
 }
 
+/* Publishers, developers, ratings and the like repeat across
+ * entries, so they are stored once per list. */
+static char *database_info_intern(struct rmsgpack_dom_arena *arena,
+      const struct rmsgpack_dom_value *val)
+{
+   if (val->type != RDT_STRING)
+      return NULL;
+   return (char*)rmsgpack_dom_arena_intern(arena,
+         val->string.buff, val->string.len);
+}
+
+/**
+ * database_info_list_new:
+ * @rdb_path         : path to database.
+ * @query            : query to match entries against, or NULL.
+ *
+ * Reads the entries of @rdb_path matching @query. The strings of
+ * all entries are stored in the list and freed with it.
+ *
+ * Returns: list of entries, or NULL on error.
+ **/
 database_info_list_t *database_info_list_new(const char *rdb_path, const char *query)
 {
    libretrodb_t db;
    libretrodb_cursor_t cur;
    struct rmsgpack_dom_value item;
    size_t j;
+   size_t cap = 0;
    unsigned k = 0;
    database_info_t *database_info = NULL;
    database_info_list_t *database_info_list = NULL;
+   struct rmsgpack_dom_arena *arena = NULL;
 
    if ((libretrodb_open(rdb_path, &db)) != 0)
       return NULL;
    if ((database_open_cursor(&db, &cur, query) != 0))
+   {
+      libretrodb_close(&db);
       return NULL;
+   }
 
    database_info_list = (database_info_list_t*)calloc(1, sizeof(*database_info_list));
    if (!database_info_list)
       goto error;
 
+   arena = &database_info_list->strings;
+   rmsgpack_dom_arena_init(arena);
+
    while (libretrodb_cursor_read_item(&cur, &item) == 0)
    {
       database_info_t *db_info = NULL;
       if (item.type != RDT_MAP)
          continue;
 
-      database_info = (database_info_t*)realloc(database_info, (k+1) * sizeof(database_info_t));
+      if (k == cap)
+      {
+         database_info_t *tmp = NULL;
 
-      if (!database_info)
-         goto error;
+         cap = cap ? cap * 2 : 16;
+         tmp = (database_info_t*)realloc(database_info,
+               cap * sizeof(database_info_t));
 
-      db_info = &database_info[k];
+         if (!tmp)
+            goto error;
 
-      if (!db_info)
-         continue;
+         database_info            = tmp;
+         database_info_list->list = database_info;
+      }
 
-      db_info->name                   = NULL;
-      db_info->description            = NULL;
-      db_info->publisher              = NULL;
-      db_info->developer              = NULL;
-      db_info->origin                 = NULL;
-      db_info->franchise              = NULL;
-      db_info->bbfc_rating            = NULL;
-      db_info->elspa_rating           = NULL;
-      db_info->esrb_rating            = NULL;
-      db_info->pegi_rating            = NULL;
-      db_info->cero_rating            = NULL;
-      db_info->edge_magazine_review   = NULL;
-      db_info->enhancement_hw         = NULL;
-      db_info->crc32                  = NULL;
-      db_info->sha1                   = NULL;
-      db_info->md5                    = NULL;
-      db_info->famitsu_magazine_rating= 0;
-      db_info->edge_magazine_rating   = 0;
-      db_info->edge_magazine_issue    = 0;
-      db_info->max_users              = 0;
-      db_info->releasemonth           = 0;
-      db_info->releaseyear            = 0;
+      db_info = &database_info[k];
+
+      memset(db_info, 0, sizeof(*db_info));
       db_info->analog_supported       = -1;
       db_info->rumble_supported       = -1;
 
@@ -193,81 +229,67 @@ database_info_list_t *database_info_list_new(const char *rdb_path, const char *q
          struct rmsgpack_dom_value *key = &item.map.items[j].key;
          struct rmsgpack_dom_value *val = &item.map.items[j].value;
 
-         if (!strcmp(key->string.buff, "name"))
-            db_info->name = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "description"))
-            db_info->description = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "publisher"))
-            db_info->publisher = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "developer"))
-            db_info->developer = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "origin"))
-            db_info->origin = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "franchise"))
-            db_info->franchise = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "bbfc_rating"))
-            db_info->bbfc_rating = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "esrb_rating"))
-            db_info->esrb_rating = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "elspa_rating"))
-            db_info->elspa_rating = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "cero_rating"))
-            db_info->cero_rating = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "pegi_rating"))
-            db_info->pegi_rating = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "enhancement_hw"))
-            db_info->enhancement_hw = strdup(val->string.buff);
-
-         if (!strcmp(key->string.buff, "edge_review"))
-            db_info->edge_magazine_review = strdup(val->string.buff);
+         if (key->type != RDT_STRING)
+            continue;
 
-         if (!strcmp(key->string.buff, "edge_rating"))
+         if (!strcmp(key->string.buff, "name"))
+            db_info->name = database_info_strdup(arena, val);
+         else if (!strcmp(key->string.buff, "description"))
+            db_info->description = database_info_strdup(arena, val);
+         else if (!strcmp(key->string.buff, "publisher"))
+            db_info->publisher = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "developer"))
+            db_info->developer = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "origin"))
+            db_info->origin = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "franchise"))
+            db_info->franchise = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "bbfc_rating"))
+            db_info->bbfc_rating = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "esrb_rating"))
+            db_info->esrb_rating = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "elspa_rating"))
+            db_info->elspa_rating = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "cero_rating"))
+            db_info->cero_rating = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "pegi_rating"))
+            db_info->pegi_rating = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "enhancement_hw"))
+            db_info->enhancement_hw = database_info_intern(arena, val);
+         else if (!strcmp(key->string.buff, "edge_review"))
+            db_info->edge_magazine_review = database_info_strdup(arena, val);
+         else if (!strcmp(key->string.buff, "edge_rating"))
             db_info->edge_magazine_rating = val->uint_;
-
-         if (!strcmp(key->string.buff, "edge_issue"))
+         else if (!strcmp(key->string.buff, "edge_issue"))
             db_info->edge_magazine_issue = val->uint_;
-
-         if (!strcmp(key->string.buff, "famitsu_rating"))
+         else if (!strcmp(key->string.buff, "famitsu_rating"))
             db_info->famitsu_magazine_rating = val->uint_;
-
-         if (!strcmp(key->string.buff, "users"))
+         else if (!strcmp(key->string.buff, "users"))
             db_info->max_users = val->uint_;
-
-         if (!strcmp(key->string.buff, "releasemonth"))
+         else if (!strcmp(key->string.buff, "releasemonth"))
             db_info->releasemonth = val->uint_;
-
-         if (!strcmp(key->string.buff, "releaseyear"))
+         else if (!strcmp(key->string.buff, "releaseyear"))
             db_info->releaseyear = val->uint_;
-
-         if (!strcmp(key->string.buff, "rumble"))
+         else if (!strcmp(key->string.buff, "rumble"))
             db_info->rumble_supported = val->uint_;
-
-         if (!strcmp(key->string.buff, "analog"))
+         else if (!strcmp(key->string.buff, "analog"))
             db_info->analog_supported = val->uint_;
-
-         if (!strcmp(key->string.buff, "crc"))
-            db_info->crc32 = bin_to_hex_alloc((uint8_t*)val->binary.buff, val->binary.len);
-         if (!strcmp(key->string.buff, "sha1"))
-            db_info->sha1 = bin_to_hex_alloc((uint8_t*)val->binary.buff, val->binary.len);
-         if (!strcmp(key->string.buff, "md5"))
-            db_info->md5 = bin_to_hex_alloc((uint8_t*)val->binary.buff, val->binary.len);
+         else if (!strcmp(key->string.buff, "crc"))
+            db_info->crc32 = bin_to_hex_alloc(arena,
+                  (uint8_t*)val->binary.buff, val->binary.len);
+         else if (!strcmp(key->string.buff, "sha1"))
+            db_info->sha1 = bin_to_hex_alloc(arena,
+                  (uint8_t*)val->binary.buff, val->binary.len);
+         else if (!strcmp(key->string.buff, "md5"))
+            db_info->md5 = bin_to_hex_alloc(arena,
+                  (uint8_t*)val->binary.buff, val->binary.len);
       }
       k++;
+      database_info_list->count = k;
    }
 
-   database_info_list->list  = database_info;
-   database_info_list->count = k;
+   libretrodb_cursor_close(&cur);
+   libretrodb_close(&db);
 
    return database_info_list;
 
@@ -280,53 +302,10 @@ error:
 
 void database_info_list_free(database_info_list_t *database_info_list)
 {
-   size_t i;
-
    if (!database_info_list)
       return;
 
-   for (i = 0; i < database_info_list->count; i++)
-   {
-      database_info_t *info = &database_info_list->list[i];
-
-      if (!info)
-         continue;
-
-      if (info->name)
-         free(info->name);
-      if (info->description)
-         free(info->description);
-      if (info->publisher)
-         free(info->publisher);
-      if (info->developer)
-         free(info->developer);
-      if (info->origin)
-         free(info->origin);
-      if (info->franchise)
-         free(info->franchise);
-      if (info->edge_magazine_review)
-         free(info->edge_magazine_review);
-
-      if (info->cero_rating)
-         free(info->cero_rating);
-      if (info->pegi_rating)
-         free(info->pegi_rating);
-      if (info->enhancement_hw)
-         free(info->enhancement_hw);
-      if (info->elspa_rating)
-         free(info->elspa_rating);
-      if (info->esrb_rating)
-         free(info->esrb_rating);
-      if (info->bbfc_rating)
-         free(info->bbfc_rating);
-      if (info->crc32)
-         free(info->crc32);
-      if (info->sha1)
-         free(info->sha1);
-      if (info->md5)
-         free(info->md5);
-   }
-
+   rmsgpack_dom_arena_free(&database_info_list->strings);
    free(database_info_list->list);
    free(database_info_list);
 }
@@ -58,6 +58,8 @@ typedef struct
 {
    database_info_t *list;
    size_t count;
+   /* Storage for the strings of list. */
+   struct rmsgpack_dom_arena strings;
 } database_info_list_t;
 
 database_info_list_t *database_info_list_new(const char *rdb_path, const char *query);
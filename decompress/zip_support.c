@@ -24,6 +24,9 @@
 #include <retro_miscellaneous.h>
 #include <file/file_path.h>
 #include "zip_support.h"
+#include "../file_archive_index.h"
+#include "../file_extract.h"
+#include "../file_ops.h"
 
 #include "../deps/rzlib/unzip.h"
 
@@ -48,7 +51,40 @@ int read_zip_file(const char * archive_path,
    unz_global_info global_info;
    ssize_t bytes_read = -1;
    bool finished_reading = false;
-   unzFile *zipfile = (unzFile*)unzOpen( archive_path );
+   unzFile *zipfile = NULL;
+   void *data = NULL;
+   archive_index_t *index = archive_index_get(archive_path);
+   const archive_index_entry_t *entry = archive_index_find(
+         index, relative_path);
+
+   /* Fast path, the archive index tells us where the file is. */
+   if (entry)
+      bytes_read = zlib_read_file_at(archive_path, entry->offset,
+            entry->cmode, entry->csize, entry->size, entry->crc32, &data);
+
+   archive_index_release(index);
+
+   if (bytes_read >= 0)
+   {
+      if (!optional_outfile)
+      {
+         *buf = data;
+         return bytes_read;
+      }
+
+      if (!write_file(optional_outfile, data, bytes_read))
+      {
+         RARCH_ERR("Error writing to %s.\n",optional_outfile);
+         bytes_read = -1;
+      }
+      else
+         bytes_read = 0;
+
+      free(data);
+      return bytes_read;
+   }
+
+   zipfile = (unzFile*)unzOpen( archive_path );
 
    if (!zipfile)
    {
@@ -0,0 +1,319 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <compat/strl.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "file_archive_cache.h"
+#include "file_ops.h"
+#include "general.h"
+
+/* Decompressed archive members, most recently used first. */
+typedef struct archive_cache_entry
+{
+   char path[PATH_MAX_LENGTH];
+   uint64_t archive_size;
+   time_t archive_mtime;
+   void *data;
+   size_t size;
+   struct archive_cache_entry *prev;
+   struct archive_cache_entry *next;
+} archive_cache_entry_t;
+
+typedef struct archive_cache
+{
+   archive_cache_entry_t *head;
+   archive_cache_entry_t *tail;
+   size_t total_size;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} archive_cache_t;
+
+static archive_cache_t archive_cache;
+
+static void archive_cache_lock(void)
+{
+#ifdef HAVE_THREADS
+   if (archive_cache.lock)
+      slock_lock(archive_cache.lock);
+#endif
+}
+
+static void archive_cache_unlock(void)
+{
+#ifdef HAVE_THREADS
+   if (archive_cache.lock)
+      slock_unlock(archive_cache.lock);
+#endif
+}
+
+/**
+ * archive_cache_stat:
+ * @path             : path to archive member ("archive#member").
+ * @size             : size of the archive.
+ * @mtime            : modification time of the archive.
+ *
+ * Stats the archive part of @path.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ */
+static bool archive_cache_stat(const char *path,
+      uint64_t *size, time_t *mtime)
+{
+   struct stat st;
+   char archive_path[PATH_MAX_LENGTH];
+   char *delim = NULL;
+
+   strlcpy(archive_path, path, sizeof(archive_path));
+   delim = strchr(archive_path, '#');
+   if (delim)
+      *delim = '\0';
+
+   if (stat(archive_path, &st) != 0)
+      return false;
+
+   *size  = (uint64_t)st.st_size;
+   *mtime = st.st_mtime;
+   return true;
+}
+
+static void archive_cache_unlink(archive_cache_entry_t *entry)
+{
+   if (entry->prev)
+      entry->prev->next = entry->next;
+   else
+      archive_cache.head = entry->next;
+
+   if (entry->next)
+      entry->next->prev = entry->prev;
+   else
+      archive_cache.tail = entry->prev;
+
+   entry->prev = NULL;
+   entry->next = NULL;
+}
+
+static void archive_cache_push_front(archive_cache_entry_t *entry)
+{
+   entry->prev = NULL;
+   entry->next = archive_cache.head;
+
+   if (archive_cache.head)
+      archive_cache.head->prev = entry;
+   archive_cache.head = entry;
+
+   if (!archive_cache.tail)
+      archive_cache.tail = entry;
+}
+
+static void archive_cache_evict(archive_cache_entry_t *entry)
+{
+   archive_cache_unlink(entry);
+   archive_cache.total_size -= entry->size;
+   free(entry->data);
+   free(entry);
+}
+
+static size_t archive_cache_limit(void)
+{
+   return g_settings.archive_cache_size;
+}
+
+/**
+ * archive_cache_find:
+ * @path             : path to archive member ("archive#member").
+ *
+ * Finds a valid entry for @path and moves it to the front.
+ * Stale entries are evicted. Must be called with the lock held.
+ *
+ * Returns: cache entry on a hit, otherwise NULL.
+ */
+static archive_cache_entry_t *archive_cache_find(const char *path)
+{
+   uint64_t archive_size;
+   time_t archive_mtime;
+   archive_cache_entry_t *entry = NULL;
+
+   for (entry = archive_cache.head; entry; entry = entry->next)
+      if (!strcmp(entry->path, path))
+         break;
+
+   if (!entry)
+      return NULL;
+
+   if (!archive_cache_stat(path, &archive_size, &archive_mtime)
+         || archive_size != entry->archive_size
+         || archive_mtime != entry->archive_mtime)
+   {
+      archive_cache_evict(entry);
+      return NULL;
+   }
+
+   if (entry != archive_cache.head)
+   {
+      archive_cache_unlink(entry);
+      archive_cache_push_front(entry);
+   }
+
+   return entry;
+}
+
+bool archive_cache_enabled(void)
+{
+   return archive_cache_limit() != 0;
+}
+
+ssize_t archive_cache_read(const char *path, void **buf)
+{
+   ssize_t ret = -1;
+   archive_cache_entry_t *entry = NULL;
+
+   if (!archive_cache_enabled())
+      return -1;
+
+   archive_cache_lock();
+
+   entry = archive_cache_find(path);
+   if (entry)
+   {
+      /* Keep the trailing '\0' read_file() guarantees. */
+      uint8_t *out = (uint8_t*)malloc(entry->size + 1);
+
+      if (out)
+      {
+         memcpy(out, entry->data, entry->size);
+         out[entry->size] = '\0';
+         *buf = out;
+         ret  = entry->size;
+      }
+   }
+
+   archive_cache_unlock();
+
+   if (ret >= 0)
+      RARCH_LOG("Archive cache hit: %s.\n", path);
+
+   return ret;
+}
+
+bool archive_cache_write_file(const char *path, const char *out_path)
+{
+   bool ret = false;
+   archive_cache_entry_t *entry = NULL;
+
+   if (!archive_cache_enabled())
+      return false;
+
+   archive_cache_lock();
+
+   entry = archive_cache_find(path);
+   if (entry)
+      ret = write_file(out_path, entry->data, entry->size);
+
+   archive_cache_unlock();
+
+   if (ret)
+      RARCH_LOG("Archive cache hit: %s.\n", path);
+
+   return ret;
+}
+
+void archive_cache_insert(const char *path, const void *data, size_t size)
+{
+   uint64_t archive_size;
+   time_t archive_mtime;
+   archive_cache_entry_t *entry = NULL;
+   size_t limit = archive_cache_limit();
+
+   if (!limit || !data || size > limit)
+      return;
+
+   if (!archive_cache_stat(path, &archive_size, &archive_mtime))
+      return;
+
+   entry = (archive_cache_entry_t*)calloc(1, sizeof(*entry));
+   if (!entry)
+      return;
+
+   entry->data = malloc(size);
+   if (!entry->data)
+   {
+      free(entry);
+      return;
+   }
+
+   memcpy(entry->data, data, size);
+   strlcpy(entry->path, path, sizeof(entry->path));
+   entry->size          = size;
+   entry->archive_size  = archive_size;
+   entry->archive_mtime = archive_mtime;
+
+   archive_cache_lock();
+
+   {
+      archive_cache_entry_t *old = NULL;
+
+      for (old = archive_cache.head; old; old = old->next)
+      {
+         if (!strcmp(old->path, path))
+         {
+            archive_cache_evict(old);
+            break;
+         }
+      }
+   }
+
+   while (archive_cache.tail && archive_cache.total_size + size > limit)
+      archive_cache_evict(archive_cache.tail);
+
+   archive_cache_push_front(entry);
+   archive_cache.total_size += size;
+
+   archive_cache_unlock();
+}
+
+void archive_cache_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!archive_cache.lock)
+      archive_cache.lock = slock_new();
+#endif
+}
+
+void archive_cache_free(void)
+{
+   archive_cache_lock();
+
+   while (archive_cache.head)
+      archive_cache_evict(archive_cache.head);
+
+   archive_cache_unlock();
+
+#ifdef HAVE_THREADS
+   if (archive_cache.lock)
+      slock_free(archive_cache.lock);
+   archive_cache.lock = NULL;
+#endif
+}
@@ -0,0 +1,92 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_FILE_ARCHIVE_CACHE_H
+#define __RARCH_FILE_ARCHIVE_CACHE_H
+
+#include <boolean.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * archive_cache_read:
+ * @path             : path to archive member ("archive#member").
+ * @buf              : buffer to allocate and copy the member into.
+ *                     Needs to be freed manually.
+ *
+ * Looks up an already decompressed archive member in the
+ * in-memory LRU cache. Entries are invalidated when the size or
+ * modification time of the archive changes.
+ *
+ * Returns: size of the member on a cache hit, -1 otherwise.
+ */
+ssize_t archive_cache_read(const char *path, void **buf);
+
+/**
+ * archive_cache_write_file:
+ * @path             : path to archive member ("archive#member").
+ * @out_path         : path of the file to write the member to.
+ *
+ * Writes a cached archive member straight to disk, without
+ * decompressing it again.
+ *
+ * Returns: true (1) on a cache hit that was written, false (0) otherwise.
+ */
+bool archive_cache_write_file(const char *path, const char *out_path);
+
+/**
+ * archive_cache_insert:
+ * @path             : path to archive member ("archive#member").
+ * @data             : decompressed contents of the member.
+ * @size             : size of @data.
+ *
+ * Adds a copy of a decompressed archive member to the cache,
+ * evicting the least recently used members until the cache fits
+ * within g_settings.archive_cache_size. Does nothing if the cache
+ * is disabled or the member is larger than the cache.
+ */
+void archive_cache_insert(const char *path, const void *data, size_t size);
+
+/**
+ * archive_cache_enabled:
+ *
+ * Returns: true (1) if the archive cache is enabled, otherwise false (0).
+ */
+bool archive_cache_enabled(void);
+
+/**
+ * archive_cache_init:
+ *
+ * Sets up the lock guarding the cache. Must be called before
+ * any other thread can access the cache.
+ */
+void archive_cache_init(void);
+
+/**
+ * archive_cache_free:
+ *
+ * Frees all cached archive members.
+ */
+void archive_cache_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
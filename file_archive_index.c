@@ -0,0 +1,610 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "file_archive_index.h"
+#include "file_extract.h"
+#include "file_ops.h"
+#include "general.h"
+#include "hash.h"
+
+#define ARCHIVE_INDEX_MAGIC   0x58494152 /* "RAIX" */
+#define ARCHIVE_INDEX_VERSION 1
+#define ARCHIVE_INDEX_MEMO    8
+
+/* On-disk layout (native endian, the index is a local cache):
+ *
+ * archive_index_header_t
+ * char path[path_len]
+ * archive_index_record_t records[count]
+ * char names[names_size] (NUL-terminated names)
+ */
+typedef struct archive_index_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint64_t archive_size;
+   int64_t archive_mtime;
+   uint32_t path_len;
+   uint32_t count;
+   uint32_t names_size;
+   uint32_t pad;
+} archive_index_header_t;
+
+typedef struct archive_index_record
+{
+   uint32_t name_offset;
+   uint32_t cmode;
+   uint32_t offset;
+   uint32_t csize;
+   uint32_t size;
+   uint32_t crc32;
+} archive_index_record_t;
+
+struct archive_index
+{
+   char path[PATH_MAX_LENGTH];
+   uint64_t archive_size;
+   int64_t archive_mtime;
+
+   archive_index_entry_t *entries;
+   size_t count;
+   size_t cap;
+
+   char *names;
+   size_t names_size;
+   size_t names_cap;
+
+   /* Open addressing, stores entry index + 1, 0 is empty. */
+   uint32_t *buckets;
+   size_t bucket_mask;
+
+   /* Held by the memo and by each caller of archive_index_get.
+    * Only changed with the memo lock held. */
+   unsigned refs;
+};
+
+/* Most recently used first. */
+static archive_index_t *archive_index_memo[ARCHIVE_INDEX_MEMO];
+
+#ifdef HAVE_THREADS
+static slock_t *archive_index_memo_lock;
+#endif
+
+static void archive_index_lock(void)
+{
+#ifdef HAVE_THREADS
+   if (archive_index_memo_lock)
+      slock_lock(archive_index_memo_lock);
+#endif
+}
+
+static void archive_index_unlock(void)
+{
+#ifdef HAVE_THREADS
+   if (archive_index_memo_lock)
+      slock_unlock(archive_index_memo_lock);
+#endif
+}
+
+static uint32_t archive_index_hash(const char *str)
+{
+   uint32_t hash = 5381;
+   while (*str)
+      hash = (hash << 5) + hash + (uint8_t)*str++;
+   return hash;
+}
+
+static void archive_index_free(archive_index_t *index)
+{
+   if (!index)
+      return;
+
+   free(index->entries);
+   free(index->names);
+   free(index->buckets);
+   free(index);
+}
+
+/* Must be called with the memo lock held. */
+static void archive_index_unref(archive_index_t *index)
+{
+   if (index && --index->refs == 0)
+      archive_index_free(index);
+}
+
+static bool archive_index_stat(const char *path,
+      uint64_t *size, int64_t *mtime)
+{
+   struct stat st;
+
+   if (stat(path, &st) != 0)
+      return false;
+
+   *size  = (uint64_t)st.st_size;
+   *mtime = (int64_t)st.st_mtime;
+   return true;
+}
+
+static bool archive_index_push(archive_index_t *index, const char *name,
+      unsigned cmode, uint32_t offset, uint32_t csize, uint32_t size,
+      uint32_t crc32)
+{
+   archive_index_entry_t *entry = NULL;
+   size_t name_len = strlen(name) + 1;
+
+   if (index->count >= index->cap)
+   {
+      size_t new_cap = index->cap ? index->cap * 2 : 32;
+      archive_index_entry_t *new_entries = (archive_index_entry_t*)
+         realloc(index->entries, new_cap * sizeof(*new_entries));
+
+      if (!new_entries)
+         return false;
+
+      index->entries = new_entries;
+      index->cap     = new_cap;
+   }
+
+   if (index->names_size + name_len > index->names_cap)
+   {
+      size_t new_cap = index->names_cap ? index->names_cap * 2 : 1024;
+      char *new_names = NULL;
+
+      while (new_cap < index->names_size + name_len)
+         new_cap *= 2;
+
+      new_names = (char*)realloc(index->names, new_cap);
+      if (!new_names)
+         return false;
+
+      index->names     = new_names;
+      index->names_cap = new_cap;
+   }
+
+   memcpy(index->names + index->names_size, name, name_len);
+
+   entry = &index->entries[index->count++];
+
+   /* Store the offset for now, names may still move.
+    * Resolved in archive_index_finalize. */
+   entry->name   = (char*)(uintptr_t)index->names_size;
+   entry->cmode  = cmode;
+   entry->offset = offset;
+   entry->csize  = csize;
+   entry->size   = size;
+   entry->crc32  = crc32;
+
+   index->names_size += name_len;
+   return true;
+}
+
+/**
+ * archive_index_finalize:
+ * @index            : archive index handle.
+ *
+ * Resolves entry names and builds the name hash table.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ */
+static bool archive_index_finalize(archive_index_t *index)
+{
+   size_t i, buckets = 16;
+
+   while (buckets < index->count * 2)
+      buckets *= 2;
+
+   index->buckets = (uint32_t*)calloc(buckets, sizeof(uint32_t));
+   if (!index->buckets)
+      return false;
+
+   index->bucket_mask = buckets - 1;
+
+   for (i = 0; i < index->count; i++)
+   {
+      archive_index_entry_t *entry = &index->entries[i];
+      size_t name_offset           = (size_t)(uintptr_t)entry->name;
+      size_t slot                  = 0;
+
+      if (name_offset >= index->names_size)
+         return false;
+
+      entry->name = index->names + name_offset;
+      slot        = archive_index_hash(entry->name) & index->bucket_mask;
+
+      while (index->buckets[slot])
+         slot = (slot + 1) & index->bucket_mask;
+
+      index->buckets[slot] = i + 1;
+   }
+
+   return true;
+}
+
+static bool archive_index_build_cb(const char *name, unsigned cmode,
+      uint32_t offset, uint32_t csize, uint32_t size, uint32_t crc32,
+      void *userdata)
+{
+   archive_index_t *index = (archive_index_t*)userdata;
+   size_t len             = strlen(name);
+
+   /* Skip directories. */
+   if (!len || name[len - 1] == '/' || name[len - 1] == '\\')
+      return true;
+
+   return archive_index_push(index, name, cmode, offset,
+         csize, size, crc32);
+}
+
+static bool archive_index_file_path(char *out, size_t size,
+      const char *archive_path)
+{
+   char name[32];
+   char dir[PATH_MAX_LENGTH];
+
+   if (!*g_settings.playlist_directory)
+      return false;
+
+   fill_pathname_join(dir, g_settings.playlist_directory,
+         "archive_index", sizeof(dir));
+
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+      return false;
+
+   snprintf(name, sizeof(name), "%08x.idx", (unsigned)
+         crc32_calculate((const uint8_t*)archive_path, strlen(archive_path)));
+   fill_pathname_join(out, dir, name, size);
+   return true;
+}
+
+static void archive_index_save(const archive_index_t *index)
+{
+   size_t i;
+   char path[PATH_MAX_LENGTH];
+   archive_index_header_t header = {0};
+   FILE *file = NULL;
+
+   if (!archive_index_file_path(path, sizeof(path), index->path))
+      return;
+
+   file = fopen(path, "wb");
+   if (!file)
+      return;
+
+   header.magic         = ARCHIVE_INDEX_MAGIC;
+   header.version       = ARCHIVE_INDEX_VERSION;
+   header.archive_size  = index->archive_size;
+   header.archive_mtime = index->archive_mtime;
+   header.path_len      = strlen(index->path);
+   header.count         = index->count;
+   header.names_size    = index->names_size;
+
+   fwrite(&header, sizeof(header), 1, file);
+   fwrite(index->path, 1, header.path_len, file);
+
+   for (i = 0; i < index->count; i++)
+   {
+      archive_index_record_t record;
+      const archive_index_entry_t *entry = &index->entries[i];
+
+      record.name_offset = entry->name - index->names;
+      record.cmode       = entry->cmode;
+      record.offset      = entry->offset;
+      record.csize       = entry->csize;
+      record.size        = entry->size;
+      record.crc32       = entry->crc32;
+      fwrite(&record, sizeof(record), 1, file);
+   }
+
+   if (fwrite(index->names, 1, index->names_size, file)
+         != index->names_size)
+      RARCH_WARN("Failed to write archive index: %s.\n", path);
+
+   fclose(file);
+}
+
+/**
+ * archive_index_load:
+ * @path             : path to ZIP archive.
+ * @archive_size     : current size of the archive.
+ * @archive_mtime    : current modification time of the archive.
+ *
+ * Loads the index file of @path in one read, if it is up to date.
+ *
+ * Returns: archive index on success, otherwise NULL.
+ */
+static archive_index_t *archive_index_load(const char *path,
+      uint64_t archive_size, int64_t archive_mtime)
+{
+   size_t i;
+   char index_path[PATH_MAX_LENGTH];
+   const archive_index_header_t *header  = NULL;
+   const archive_index_record_t *records = NULL;
+   const uint8_t *ptr    = NULL;
+   uint8_t *buf          = NULL;
+   archive_index_t *index = NULL;
+   long len              = 0;
+
+   if (!archive_index_file_path(index_path, sizeof(index_path), path))
+      return NULL;
+
+   if (!path_file_exists(index_path))
+      return NULL;
+
+   len = read_file(index_path, (void**)&buf);
+   if (len < (long)sizeof(*header))
+      goto error;
+
+   header = (const archive_index_header_t*)buf;
+
+   if (header->magic != ARCHIVE_INDEX_MAGIC
+         || header->version != ARCHIVE_INDEX_VERSION
+         || header->archive_size != archive_size
+         || header->archive_mtime != archive_mtime
+         || header->path_len != strlen(path))
+      goto error;
+
+   if ((size_t)len != sizeof(*header) + header->path_len
+         + header->count * sizeof(archive_index_record_t)
+         + header->names_size)
+      goto error;
+
+   ptr = buf + sizeof(*header);
+   if (memcmp(ptr, path, header->path_len))
+      goto error;
+   ptr += header->path_len;
+
+   records = (const archive_index_record_t*)ptr;
+   ptr    += header->count * sizeof(archive_index_record_t);
+
+   index = (archive_index_t*)calloc(1, sizeof(*index));
+   if (!index)
+      goto error;
+
+   index->entries = (archive_index_entry_t*)
+      calloc(header->count ? header->count : 1, sizeof(*index->entries));
+   index->names   = (char*)malloc(header->names_size + 1);
+
+   if (!index->entries || !index->names)
+      goto error;
+
+   memcpy(index->names, ptr, header->names_size);
+   index->names[header->names_size] = '\0';
+   index->names_size = header->names_size;
+   index->names_cap  = header->names_size + 1;
+   index->cap        = header->count;
+
+   for (i = 0; i < header->count; i++)
+   {
+      /* Copy, records are not necessarily aligned in buf. */
+      archive_index_record_t record;
+      archive_index_entry_t *entry = &index->entries[i];
+
+      memcpy(&record, &records[i], sizeof(record));
+
+      entry->name   = (char*)(uintptr_t)record.name_offset;
+      entry->cmode  = record.cmode;
+      entry->offset = record.offset;
+      entry->csize  = record.csize;
+      entry->size   = record.size;
+      entry->crc32  = record.crc32;
+   }
+   index->count = header->count;
+
+   if (!archive_index_finalize(index))
+      goto error;
+
+   strlcpy(index->path, path, sizeof(index->path));
+   index->archive_size  = archive_size;
+   index->archive_mtime = archive_mtime;
+
+   free(buf);
+   return index;
+
+error:
+   archive_index_free(index);
+   free(buf);
+   return NULL;
+}
+
+static archive_index_t *archive_index_build(const char *path,
+      uint64_t archive_size, int64_t archive_mtime)
+{
+   archive_index_t *index = (archive_index_t*)calloc(1, sizeof(*index));
+
+   if (!index)
+      return NULL;
+
+   strlcpy(index->path, path, sizeof(index->path));
+   index->archive_size  = archive_size;
+   index->archive_mtime = archive_mtime;
+
+   if (!zlib_parse_file_offsets(path, archive_index_build_cb, index))
+      goto error;
+
+   if (!archive_index_finalize(index))
+      goto error;
+
+   archive_index_save(index);
+   return index;
+
+error:
+   archive_index_free(index);
+   return NULL;
+}
+
+archive_index_t *archive_index_get(const char *path)
+{
+   unsigned i;
+   uint64_t archive_size;
+   int64_t archive_mtime;
+   archive_index_t *index = NULL;
+
+   if (!path || !archive_index_stat(path, &archive_size, &archive_mtime))
+      return NULL;
+
+   archive_index_lock();
+
+   for (i = 0; i < ARCHIVE_INDEX_MEMO && archive_index_memo[i]; i++)
+   {
+      if (strcmp(archive_index_memo[i]->path, path))
+         continue;
+
+      index = archive_index_memo[i];
+      memmove(&archive_index_memo[1], &archive_index_memo[0],
+            i * sizeof(archive_index_memo[0]));
+      archive_index_memo[0] = index;
+
+      if (index->archive_size == archive_size
+            && index->archive_mtime == archive_mtime)
+      {
+         index->refs++;
+         archive_index_unlock();
+         return index;
+      }
+
+      /* Stale, drop it and rebuild. */
+      memmove(&archive_index_memo[0], &archive_index_memo[1],
+            (ARCHIVE_INDEX_MEMO - 1) * sizeof(archive_index_memo[0]));
+      archive_index_memo[ARCHIVE_INDEX_MEMO - 1] = NULL;
+      archive_index_unref(index);
+      break;
+   }
+
+   archive_index_unlock();
+
+   /* Not holding the lock while reading the archive. Should two
+    * threads build the same index, the memo simply holds both. */
+   index = archive_index_load(path, archive_size, archive_mtime);
+   if (!index)
+      index = archive_index_build(path, archive_size, archive_mtime);
+   if (!index)
+      return NULL;
+
+   index->refs = 2;
+
+   archive_index_lock();
+   archive_index_unref(archive_index_memo[ARCHIVE_INDEX_MEMO - 1]);
+   memmove(&archive_index_memo[1], &archive_index_memo[0],
+         (ARCHIVE_INDEX_MEMO - 1) * sizeof(archive_index_memo[0]));
+   archive_index_memo[0] = index;
+   archive_index_unlock();
+
+   return index;
+}
+
+void archive_index_release(archive_index_t *index)
+{
+   if (!index)
+      return;
+
+   archive_index_lock();
+   archive_index_unref(index);
+   archive_index_unlock();
+}
+
+const archive_index_entry_t *archive_index_find(
+      const archive_index_t *index, const char *name)
+{
+   size_t slot;
+
+   if (!index || !name)
+      return NULL;
+
+   slot = archive_index_hash(name) & index->bucket_mask;
+
+   while (index->buckets[slot])
+   {
+      const archive_index_entry_t *entry =
+         &index->entries[index->buckets[slot] - 1];
+
+      if (!strcmp(entry->name, name))
+         return entry;
+
+      slot = (slot + 1) & index->bucket_mask;
+   }
+
+   return NULL;
+}
+
+size_t archive_index_size(const archive_index_t *index)
+{
+   if (!index)
+      return 0;
+   return index->count;
+}
+
+const archive_index_entry_t *archive_index_at(
+      const archive_index_t *index, size_t idx)
+{
+   if (!index || idx >= index->count)
+      return NULL;
+   return &index->entries[idx];
+}
+
+bool archive_index_get_crc(const char *path, const char *name,
+      uint32_t *crc)
+{
+   archive_index_t *index             = archive_index_get(path);
+   const archive_index_entry_t *entry = archive_index_find(index, name);
+
+   if (entry)
+      *crc = entry->crc32;
+
+   archive_index_release(index);
+   return entry != NULL;
+}
+
+void archive_index_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!archive_index_memo_lock)
+      archive_index_memo_lock = slock_new();
+#endif
+}
+
+void archive_index_free_all(void)
+{
+   unsigned i;
+
+   archive_index_lock();
+
+   for (i = 0; i < ARCHIVE_INDEX_MEMO; i++)
+   {
+      archive_index_unref(archive_index_memo[i]);
+      archive_index_memo[i] = NULL;
+   }
+
+   archive_index_unlock();
+
+#ifdef HAVE_THREADS
+   if (archive_index_memo_lock)
+      slock_free(archive_index_memo_lock);
+   archive_index_memo_lock = NULL;
+#endif
+}
@@ -0,0 +1,124 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2015 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_FILE_ARCHIVE_INDEX_H
+#define __RARCH_FILE_ARCHIVE_INDEX_H
+
+#include <boolean.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct archive_index_entry
+{
+   char *name;
+   unsigned cmode;
+   uint32_t offset; /* Offset of the compressed data. */
+   uint32_t csize;
+   uint32_t size;
+   uint32_t crc32;
+} archive_index_entry_t;
+
+typedef struct archive_index archive_index_t;
+
+/**
+ * archive_index_get:
+ * @path             : path to ZIP archive.
+ *
+ * Gets the central directory index of an archive. The index is
+ * looked up in memory first, then in the index file stored in the
+ * playlist directory, and only built from the archive itself if
+ * neither matches the current size and modification time of @path.
+ *
+ * The returned index stays valid until it is handed back with
+ * archive_index_release, even if another thread evicts it from
+ * the index cache meanwhile.
+ *
+ * Returns: archive index on success, otherwise NULL.
+ */
+archive_index_t *archive_index_get(const char *path);
+
+/**
+ * archive_index_release:
+ * @index            : archive index handle, may be NULL.
+ *
+ * Releases an index returned by archive_index_get.
+ */
+void archive_index_release(archive_index_t *index);
+
+/**
+ * archive_index_find:
+ * @index            : archive index handle.
+ * @name             : name of file inside the archive.
+ *
+ * Returns: index entry of @name if found, otherwise NULL.
+ */
+const archive_index_entry_t *archive_index_find(
+      const archive_index_t *index, const char *name);
+
+/**
+ * archive_index_size:
+ * @index            : archive index handle.
+ *
+ * Returns: number of entries in the archive index.
+ */
+size_t archive_index_size(const archive_index_t *index);
+
+/**
+ * archive_index_at:
+ * @index            : archive index handle.
+ * @idx              : position of entry, in central directory order.
+ *
+ * Returns: index entry at @idx.
+ */
+const archive_index_entry_t *archive_index_at(
+      const archive_index_t *index, size_t idx);
+
+/**
+ * archive_index_get_crc:
+ * @path             : path to ZIP archive.
+ * @name             : name of file inside the archive.
+ * @crc              : CRC32 of file.
+ *
+ * Gets the CRC32 of a file inside an archive without decompressing it.
+ *
+ * Returns: true (1) if @name was found, otherwise false (0).
+ */
+bool archive_index_get_crc(const char *path, const char *name,
+      uint32_t *crc);
+
+/**
+ * archive_index_init:
+ *
+ * Sets up the lock guarding the index cache. Must be called before
+ * any other thread can access the index cache.
+ */
+void archive_index_init(void);
+
+/**
+ * archive_index_free_all:
+ *
+ * Frees all archive indexes held in memory.
+ */
+void archive_index_free_all(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
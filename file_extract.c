@@ -28,6 +28,7 @@
 #include <zlib.h>
 
 #include "hash.h"
+#include "file_archive_index.h"
 
 /* File backends. Can be fleshed out later, but keep it simple for now.
  * The file is mapped to memory directly (via mmap() or just 
@@ -270,44 +271,27 @@ end:
 }
 
 /**
- * zlib_parse_file:
- * @file                        : filename path of archive
- * @valid_exts                  : Valid extensions of archive to be parsed. 
- *                                If NULL, allow all.
- * @file_cb                     : file_cb function pointer
- * @userdata                    : userdata to pass to file_cb function pointer.
+ * zlib_walk_central_directory:
+ * @data                        : contents of the archive.
+ * @zip_size                    : size of @data.
+ * @dir_cb                      : callback for every central directory entry.
+ * @userdata                    : userdata to pass to dir_cb function pointer.
  *
- * Low-level file parsing. Enumerates over all files and calls 
- * file_cb with userdata.
+ * Locates the end of central directory record and enumerates
+ * all central directory entries.
  *
  * Returns: true (1) on success, otherwise false (0).
  **/
-bool zlib_parse_file(const char *file, const char *valid_exts,
-      zlib_file_cb file_cb, void *userdata)
+static bool zlib_walk_central_directory(const uint8_t *data, size_t zip_size,
+      zlib_offset_cb dir_cb, void *userdata)
 {
-   void *handle;
    const uint8_t *footer    = NULL;
    const uint8_t *directory = NULL;
-   const uint8_t *data      = NULL;
-   ssize_t zip_size = 0;
    bool ret = true;
-   const struct zlib_file_backend *backend = zlib_get_default_file_backend();
-
-   if (!backend)
-      return false;
-
-   (void)valid_exts;
 
-   handle = backend->open(file);
-   if (!handle)
-      GOTO_END_ERROR();
-
-   zip_size = backend->size(handle);
    if (zip_size < 22)
       GOTO_END_ERROR();
 
-   data = backend->data(handle);
-
    footer = data + zip_size - 22;
    for (;; footer--)
    {
@@ -329,7 +313,6 @@ bool zlib_parse_file(const char *file, const char *valid_exts,
       unsigned cmode, namelength, extralength, commentlength,
                offsetNL, offsetEL;
       char filename[PATH_MAX_LENGTH] = {0};
-      const uint8_t *cdata = NULL;
       uint32_t signature = read_le(directory + 0, 4);
 
       if (signature != 0x02014b50)
@@ -353,26 +336,207 @@ bool zlib_parse_file(const char *file, const char *valid_exts,
       offsetNL      = read_le(data + offset + 26, 2);
       offsetEL      = read_le(data + offset + 28, 2);
 
-      cdata = data + offset + 30 + offsetNL + offsetEL;
+      offset       += 30 + offsetNL + offsetEL;
 
 #if 0
-      RARCH_LOG("OFFSET: %u, CSIZE: %u, SIZE: %u.\n", offset + 30 + 
-      offsetNL + offsetEL, csize, size);
+      RARCH_LOG("OFFSET: %u, CSIZE: %u, SIZE: %u.\n", offset, csize, size);
 #endif
 
-      if (!file_cb(filename, valid_exts, cdata, cmode,
+      if (!dir_cb(filename, cmode, offset,
                csize, size, checksum, userdata))
          break;
 
       directory += 46 + namelength + extralength + commentlength;
    }
 
+end:
+   return ret;
+}
+
+struct zlib_parse_file_userdata
+{
+   const uint8_t *data;
+   const char *valid_exts;
+   zlib_file_cb file_cb;
+   void *userdata;
+};
+
+static bool zlib_parse_file_dir_cb(const char *name, unsigned cmode,
+      uint32_t offset, uint32_t csize, uint32_t size, uint32_t checksum,
+      void *userdata)
+{
+   struct zlib_parse_file_userdata *data =
+      (struct zlib_parse_file_userdata*)userdata;
+
+   return data->file_cb(name, data->valid_exts, data->data + offset, cmode,
+         csize, size, checksum, data->userdata);
+}
+
+/**
+ * zlib_parse_file:
+ * @file                        : filename path of archive
+ * @valid_exts                  : Valid extensions of archive to be parsed. 
+ *                                If NULL, allow all.
+ * @file_cb                     : file_cb function pointer
+ * @userdata                    : userdata to pass to file_cb function pointer.
+ *
+ * Low-level file parsing. Enumerates over all files and calls 
+ * file_cb with userdata.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool zlib_parse_file(const char *file, const char *valid_exts,
+      zlib_file_cb file_cb, void *userdata)
+{
+   void *handle;
+   bool ret = true;
+   struct zlib_parse_file_userdata data = {0};
+   const struct zlib_file_backend *backend = zlib_get_default_file_backend();
+
+   if (!backend)
+      return false;
+
+   handle = backend->open(file);
+   if (!handle)
+      GOTO_END_ERROR();
+
+   data.data       = backend->data(handle);
+   data.valid_exts = valid_exts;
+   data.file_cb    = file_cb;
+   data.userdata   = userdata;
+
+   ret = zlib_walk_central_directory(data.data, backend->size(handle),
+         zlib_parse_file_dir_cb, &data);
+
+end:
+   if (handle)
+      backend->free(handle);
+   return ret;
+}
+
+/**
+ * zlib_parse_file_offsets:
+ * @file                        : filename path of archive
+ * @offset_cb                   : offset_cb function pointer
+ * @userdata                    : userdata to pass to offset_cb function pointer.
+ *
+ * Enumerates over all files and calls offset_cb with the offset
+ * of the compressed data of every file inside the archive.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool zlib_parse_file_offsets(const char *file,
+      zlib_offset_cb offset_cb, void *userdata)
+{
+   void *handle;
+   bool ret = true;
+   const struct zlib_file_backend *backend = zlib_get_default_file_backend();
+
+   if (!backend)
+      return false;
+
+   handle = backend->open(file);
+   if (!handle)
+      GOTO_END_ERROR();
+
+   ret = zlib_walk_central_directory(backend->data(handle),
+         backend->size(handle), offset_cb, userdata);
+
 end:
    if (handle)
       backend->free(handle);
    return ret;
 }
 
+/**
+ * zlib_read_file_at:
+ * @file                        : filename path of archive
+ * @offset                      : offset of the compressed data.
+ * @cmode                       : compression method.
+ * @csize                       : size of compressed data.
+ * @size                        : size of uncompressed data.
+ * @checksum                    : CRC32 checksum of uncompressed data.
+ * @buf                         : buffer to allocate and decompress into.
+ *                                Needs to be freed manually.
+ *
+ * Decompresses a single file from the archive without walking the
+ * central directory, e.g. using an offset from the archive index.
+ *
+ * Returns: number of bytes read, -1 on error.
+ **/
+long zlib_read_file_at(const char *file, uint32_t offset, unsigned cmode,
+      uint32_t csize, uint32_t size, uint32_t checksum, void **buf)
+{
+   void *handle;
+   const uint8_t *cdata = NULL;
+   uint8_t *out_data    = NULL;
+   long ret = -1;
+   const struct zlib_file_backend *backend = zlib_get_default_file_backend();
+
+   if (!backend)
+      return -1;
+
+   handle = backend->open(file);
+   if (!handle)
+      return -1;
+
+   if ((size_t)offset + csize > backend->size(handle))
+      goto end;
+
+   cdata    = backend->data(handle) + offset;
+   out_data = (uint8_t*)malloc(size + 1);
+
+   if (!out_data)
+      goto end;
+
+   switch (cmode)
+   {
+      /* Uncompressed. */
+      case 0:
+         if (csize != size)
+            goto end;
+         memcpy(out_data, cdata, size);
+         break;
+      /* Deflate. */
+      case 8:
+         {
+            z_stream stream = {0};
+
+            if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+               goto end;
+
+            stream.next_in   = (uint8_t*)cdata;
+            stream.avail_in  = csize;
+            stream.next_out  = out_data;
+            stream.avail_out = size;
+
+            if (inflate(&stream, Z_FINISH) != Z_STREAM_END)
+            {
+               inflateEnd(&stream);
+               goto end;
+            }
+            inflateEnd(&stream);
+         }
+         break;
+      default:
+         goto end;
+   }
+
+   if (crc32_calculate(out_data, size) != checksum)
+      RARCH_WARN("File CRC differs from ZIP CRC. ZIP: 0x%x.\n",
+            (unsigned)checksum);
+
+   out_data[size] = '\0';
+   *buf     = out_data;
+   out_data = NULL;
+   ret      = size;
+
+end:
+   free(out_data);
+   backend->free(handle);
+   return ret;
+}
+
 struct zip_extract_userdata
 {
    char *zip_path;
@@ -480,77 +644,64 @@ end:
    return ret;
 }
 
-static bool zlib_get_file_list_cb(const char *path, const char *valid_exts,
-      const uint8_t *cdata,
-      unsigned cmode, uint32_t csize, uint32_t size, uint32_t checksum,
-      void *userdata)
+/**
+ * zlib_get_file_list:
+ * @path                        : filename path of archive
+ * @valid_exts                  : Valid extensions of archive to be parsed. 
+ *                                If NULL, allow all.
+ *
+ * Lists the files of the archive using its archive index, so
+ * listing an unchanged archive does not walk its central directory.
+ *
+ * Returns: string listing of files from archive on success, otherwise NULL.
+ **/
+struct string_list *zlib_get_file_list(const char *path, const char *valid_exts)
 {
-   union string_list_elem_attr attr;
+   size_t i;
    struct string_list *ext_list = NULL;
-   const char *file_ext = NULL;
-   struct string_list *list = (struct string_list*)userdata;
+   struct string_list *list     = NULL;
+   archive_index_t *index       = archive_index_get(path);
 
-   (void)cdata;
-   (void)cmode;
-   (void)csize;
-   (void)size;
-   (void)checksum;
-   (void)valid_exts;
-   (void)file_ext;
-   (void)ext_list;
+   if (!index)
+   {
+      RARCH_ERR("Parsing ZIP failed.\n");
+      return NULL;
+   }
 
-   memset(&attr, 0, sizeof(attr));
+   list = string_list_new();
+   if (!list)
+   {
+      archive_index_release(index);
+      return NULL;
+   }
 
    if (valid_exts)
       ext_list = string_split(valid_exts, "|");
 
-   if (ext_list)
+   for (i = 0; i < archive_index_size(index); i++)
    {
-      char last_char = ' ';
+      union string_list_elem_attr attr;
+      const archive_index_entry_t *entry = archive_index_at(index, i);
 
-      /* Checks if this entry is a directory or a file. */
-      last_char = path[strlen(path)-1];
+      memset(&attr, 0, sizeof(attr));
 
-      if (last_char == '/' || last_char == '\\' ) /* Skip if directory. */
-         goto error;
+      if (ext_list)
+      {
+         const char *file_ext = path_get_extension(entry->name);
 
-      file_ext = path_get_extension(path);
+         if (!file_ext || 
+               !string_list_find_elem_prefix(ext_list, ".", file_ext))
+            continue;
 
-      if (!file_ext || 
-            !string_list_find_elem_prefix(ext_list, ".", file_ext))
-         goto error;
+         attr.i = RARCH_COMPRESSED_FILE_IN_ARCHIVE;
+      }
 
-      attr.i = RARCH_COMPRESSED_FILE_IN_ARCHIVE;
-      string_list_free(ext_list);
+      if (!string_list_append(list, entry->name, attr))
+         break;
    }
 
-   return string_list_append(list, path, attr);
-error:
    string_list_free(ext_list);
-   return false;
-}
-
-/**
- * zlib_get_file_list:
- * @path                        : filename path of archive
- *
- * Returns: string listing of files from archive on success, otherwise NULL.
- **/
-struct string_list *zlib_get_file_list(const char *path, const char *valid_exts)
-{
-   struct string_list *list = string_list_new();
-
-   if (!list)
-      return NULL;
-
-   if (!zlib_parse_file(path, valid_exts,
-            zlib_get_file_list_cb, list))
-   {
-      RARCH_ERR("Parsing ZIP failed.\n");
-      string_list_free(list);
-      return NULL;
-   }
-
+   archive_index_release(index);
    return list;
 }
 
@@ -34,6 +34,12 @@ typedef bool (*zlib_file_cb)(const char *name, const char *valid_exts,
       const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
       uint32_t crc32, void *userdata);
 
+/* Returns true when parsing should continue. False to stop.
+ * @offset is the offset of the compressed data inside the archive. */
+typedef bool (*zlib_offset_cb)(const char *name, unsigned cmode,
+      uint32_t offset, uint32_t csize, uint32_t size,
+      uint32_t crc32, void *userdata);
+
 /**
  * zlib_parse_file:
  * @file                        : filename path of archive
@@ -50,6 +56,39 @@ typedef bool (*zlib_file_cb)(const char *name, const char *valid_exts,
 bool zlib_parse_file(const char *file, const char *valid_exts,
       zlib_file_cb file_cb, void *userdata);
 
+/**
+ * zlib_parse_file_offsets:
+ * @file                        : filename path of archive
+ * @offset_cb                   : offset_cb function pointer
+ * @userdata                    : userdata to pass to offset_cb function pointer.
+ *
+ * Enumerates over all files and calls offset_cb with the offset
+ * of the compressed data of every file inside the archive.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool zlib_parse_file_offsets(const char *file,
+      zlib_offset_cb offset_cb, void *userdata);
+
+/**
+ * zlib_read_file_at:
+ * @file                        : filename path of archive
+ * @offset                      : offset of the compressed data.
+ * @cmode                       : compression method.
+ * @csize                       : size of compressed data.
+ * @size                        : size of uncompressed data.
+ * @checksum                    : CRC32 checksum of uncompressed data.
+ * @buf                         : buffer to allocate and decompress into.
+ *                                Needs to be freed manually.
+ *
+ * Decompresses a single file from the archive without walking the
+ * central directory, e.g. using an offset from the archive index.
+ *
+ * Returns: number of bytes read, -1 on error.
+ **/
+long zlib_read_file_at(const char *file, uint32_t offset, unsigned cmode,
+      uint32_t csize, uint32_t size, uint32_t checksum, void **buf);
+
 /**
  * zlib_extract_first_content_file:
  * @zip_path                    : filename path to ZIP archive.
@@ -27,6 +27,7 @@
 
 #ifdef HAVE_COMPRESSION
 #include "file_extract.h"
+#include "file_archive_cache.h"
 #endif
 
 #ifdef __HAIKU__
@@ -138,14 +139,49 @@ error:
 }
 
 #ifdef HAVE_COMPRESSION
+/**
+ * read_archive_member:
+ * @archive_path     : path to archive.
+ * @relative_path    : path of the member inside the archive.
+ * @buf              : buffer to allocate and decompress the member into.
+ * @optional_filename: if not NULL, decompress to this file instead.
+ *
+ * Dispatches to the archive backend matching the extension
+ * of @archive_path.
+ *
+ * Returns: number of bytes read, -1 on error.
+ */
+static long read_archive_member(const char *archive_path,
+      const char *relative_path, void **buf,
+      const char *optional_filename)
+{
+   const char *file_ext = path_get_extension(archive_path);
+
+#ifdef HAVE_7ZIP
+   if (strcasecmp(file_ext,"7z") == 0)
+      return read_7zip_file(archive_path, relative_path, buf,
+            optional_filename);
+#endif
+#ifdef HAVE_ZLIB
+   if (strcasecmp(file_ext,"zip") == 0)
+      return read_zip_file(archive_path, relative_path, buf,
+            optional_filename);
+#endif
+   return -1;
+}
+
 /* Generic compressed file loader.
  * Extracts to buf, unless optional_filename != 0
  * Then extracts to optional_filename and leaves buf alone.
+ *
+ * Decompressed members are kept in the archive cache (if enabled),
+ * so loading the same member again is served from memory.
  */
 long read_compressed_file(const char * path, void **buf,
       const char* optional_filename)
 {
-   const char* file_ext;
+   long ret;
+   void *data = NULL;
    char archive_path[PATH_MAX_LENGTH], *archive_found = NULL;
 
    /* Safety check.
@@ -178,16 +214,45 @@ long read_compressed_file(const char * path, void **buf,
    *archive_found = '\0';
    archive_found+=1;
 
-   file_ext = path_get_extension(archive_path);
-#ifdef HAVE_7ZIP
-   if (strcasecmp(file_ext,"7z") == 0)
-      return read_7zip_file(archive_path,archive_found,buf,optional_filename);
-#endif
-#ifdef HAVE_ZLIB
-   if (strcasecmp(file_ext,"zip") == 0)
-      return read_zip_file(archive_path,archive_found,buf,optional_filename);
-#endif
-   return -1;
+   if (!archive_cache_enabled())
+      return read_archive_member(archive_path, archive_found, buf,
+            optional_filename);
+
+   if (optional_filename)
+   {
+      if (archive_cache_write_file(path, optional_filename))
+         return 0;
+   }
+   else
+   {
+      ret = archive_cache_read(path, buf);
+      if (ret >= 0)
+         return ret;
+   }
+
+   /* Cache miss, decompress to memory so the member can be cached. */
+   ret = read_archive_member(archive_path, archive_found, &data, NULL);
+   if (ret < 0)
+      return ret;
+
+   archive_cache_insert(path, data, ret);
+
+   if (!optional_filename)
+   {
+      *buf = data;
+      return ret;
+   }
+
+   if (!write_file(optional_filename, data, ret))
+   {
+      RARCH_ERR("Could not write outfilepath %s.\n", optional_filename);
+      ret = -1;
+   }
+   else
+      ret = 0;
+
+   free(data);
+   return ret;
 }
 #endif
 
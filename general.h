@@ -263,6 +263,10 @@ struct settings
       char joypad_driver[32];
       char keyboard_layout[64];
 
+      /* Read input events on a thread of their own,
+       * for drivers supporting it (udev for now). */
+      bool threaded;
+
       unsigned remap_ids[MAX_USERS][RARCH_BIND_LIST_END];
       struct retro_keybind binds[MAX_USERS][RARCH_BIND_LIST_END];
       struct retro_keybind autoconf_binds[MAX_USERS][RARCH_BIND_LIST_END];
@@ -342,6 +346,7 @@ struct settings
    char system_directory[PATH_MAX_LENGTH];
 
    char extraction_directory[PATH_MAX_LENGTH];
+   size_t archive_cache_size;
    char playlist_directory[PATH_MAX_LENGTH];
 
    bool history_list_enable;
@@ -358,6 +363,7 @@ struct settings
 
    bool block_sram_overwrite;
    bool savestate_auto_index;
+   bool savestate_compression;
    bool savestate_auto_save;
    bool savestate_auto_load;
 
@@ -605,6 +611,10 @@ struct global
 
       /* Immediate playback/recording. */
       char movie_start_path[PATH_MAX_LENGTH];
+      /* BSV2 copy of the movie played back, see bsv_movie_upgrade. */
+      char movie_upgrade_path[PATH_MAX_LENGTH];
+      /* Playback starts from the keyframe at or before this frame. */
+      uint32_t movie_start_frame;
       bool movie_start_recording;
       bool movie_start_playback;
       bool movie_end;
@@ -660,6 +670,15 @@ struct global
    unsigned frame_count;
    unsigned max_frames;
 
+   /* Raw evdev event stream to play back as an extra device. */
+   char evdev_replay[PATH_MAX_LENGTH];
+
+   struct
+   {
+      bool enable;
+      char report_path[PATH_MAX_LENGTH];
+   } benchmark;
+
    char title_buf[64];
 
    struct
@@ -1577,6 +1577,10 @@ static bool gl_frame(void *data, const void *frame,
 
    gl_set_prev_texture(gl, &gl->tex_info);
 
+   /* Menu text and the OSD message go out in one batch. */
+   if (gl->font_driver && gl->font_handle && gl->font_driver->begin_batch)
+      gl->font_driver->begin_batch(gl->font_handle);
+
 #if defined(HAVE_MENU)
    if (g_extern.is_menu
          && driver.menu_ctx && driver.menu_ctx->frame)
@@ -1589,6 +1593,9 @@ static bool gl_frame(void *data, const void *frame,
    if (msg && gl->font_driver && gl->font_handle)
       gl->font_driver->render_msg(gl->font_handle, msg, NULL);
 
+   if (gl->font_driver && gl->font_handle && gl->font_driver->end_batch)
+      gl->font_driver->end_batch(gl->font_handle);
+
 #ifdef HAVE_OVERLAY
    if (gl->overlay_enable)
       gl_render_overlay(gl);
@@ -38,6 +38,8 @@ static bool null_gfx_frame(void *data, const void *frame,
    (void)pitch;
    (void)msg;
 
+   g_extern.frame_count++;
+
    return true;
 }
 
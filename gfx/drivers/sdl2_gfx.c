@@ -89,38 +89,18 @@ static inline void sdl_tex_zero(sdl2_tex_t *t)
    t->w = t->h = t->pitch = 0;
 }
 
-static void sdl2_init_font(sdl2_video_t *vid, const char *font_path,
-                          unsigned font_size)
+/* (Re)creates the font texture from the atlas, which the font
+ * renderer may have added glyphs to since. */
+static void sdl2_update_font_texture(sdl2_video_t *vid)
 {
-   int i, r, g, b;
+   int i;
    SDL_Color colors[256];
    SDL_Surface *tmp;
    SDL_Palette *pal = NULL;
-   const struct font_atlas *atlas = NULL;
+   struct font_atlas *atlas = vid->font_driver->get_atlas(vid->font_data);
 
-   if (!g_settings.video.font_enable)
-      return;
-
-   if (!font_renderer_create_default(&vid->font_driver, &vid->font_data,
-                                    *font_path ? font_path : NULL, font_size))
-   {
-      RARCH_WARN("[SDL]: Could not initialize fonts.\n");
-      return;
-   }
-
-   r = g_settings.video.msg_color_r * 255;
-   g = g_settings.video.msg_color_g * 255;
-   b = g_settings.video.msg_color_b * 255;
-
-   r = (r < 0) ? 0 : (r > 255 ? 255 : r);
-   g = (g < 0) ? 0 : (g > 255 ? 255 : g);
-   b = (b < 0) ? 0 : (b > 255 ? 255 : b);
-
-   vid->font_r = r;
-   vid->font_g = g;
-   vid->font_b = b;
-
-   atlas = vid->font_driver->get_atlas(vid->font_data);
+   sdl_tex_zero(&vid->font);
+   vid->font.active = false;
 
    tmp = SDL_CreateRGBSurfaceFrom(atlas->buffer, atlas->width,
          atlas->height, 8, atlas->width,
@@ -152,11 +132,44 @@ static void sdl2_init_font(sdl2_video_t *vid, const char *font_path,
 
    SDL_FreePalette(pal);
    SDL_FreeSurface(tmp);
+
+   atlas->dirty = false;
+}
+
+static void sdl2_init_font(sdl2_video_t *vid, const char *font_path,
+                          unsigned font_size)
+{
+   int r, g, b;
+
+   if (!g_settings.video.font_enable)
+      return;
+
+   if (!font_renderer_create_default(&vid->font_driver, &vid->font_data,
+                                    *font_path ? font_path : NULL, font_size))
+   {
+      RARCH_WARN("[SDL]: Could not initialize fonts.\n");
+      return;
+   }
+
+   r = g_settings.video.msg_color_r * 255;
+   g = g_settings.video.msg_color_g * 255;
+   b = g_settings.video.msg_color_b * 255;
+
+   r = (r < 0) ? 0 : (r > 255 ? 255 : r);
+   g = (g < 0) ? 0 : (g > 255 ? 255 : g);
+   b = (b < 0) ? 0 : (b > 255 ? 255 : b);
+
+   vid->font_r = r;
+   vid->font_g = g;
+   vid->font_b = b;
+
+   sdl2_update_font_texture(vid);
 }
 
 static void sdl2_render_msg(sdl2_video_t *vid, const char *msg)
 {
    int x, y, delta_x, delta_y;
+   const char *p;
    unsigned width  = vid->vp.width;
    unsigned height = vid->vp.height;
 
@@ -168,6 +181,16 @@ static void sdl2_render_msg(sdl2_video_t *vid, const char *msg)
    delta_x = 0;
    delta_y = 0;
 
+   /* Rasterize missing glyphs before drawing from the texture. */
+   for (p = msg; *p; p++)
+      vid->font_driver->get_glyph(vid->font_data, (uint8_t)*p);
+
+   if (vid->font_driver->get_atlas(vid->font_data)->dirty)
+      sdl2_update_font_texture(vid);
+
+   if (!vid->font.active)
+      return;
+
    SDL_SetTextureColorMod(vid->font.tex, vid->font_r, vid->font_g, vid->font_b);
 
    for (; *msg; msg++)
@@ -18,18 +18,16 @@
 #include "../video_shader_driver.h"
 
 #define emit(c, vx, vy) do { \
-   font_vertex[     2 * (6 * i + c) + 0] = (x + (delta_x + off_x + vx * width) * scale) * inv_win_width; \
-   font_vertex[     2 * (6 * i + c) + 1] = (y + (delta_y - off_y - vy * height) * scale) * inv_win_height; \
-   font_tex_coords[ 2 * (6 * i + c) + 0] = (tex_x + vx * width) * inv_tex_size_x; \
-   font_tex_coords[ 2 * (6 * i + c) + 1] = (tex_y + vy * height) * inv_tex_size_y; \
-   font_color[      4 * (6 * i + c) + 0] = color[0]; \
-   font_color[      4 * (6 * i + c) + 1] = color[1]; \
-   font_color[      4 * (6 * i + c) + 2] = color[2]; \
-   font_color[      4 * (6 * i + c) + 3] = color[3]; \
+   vertex[   2 * (base + c) + 0] = (x + (delta_x + off_x + vx * width) * scale) * inv_win_width; \
+   vertex[   2 * (base + c) + 1] = (y + (delta_y - off_y - vy * height) * scale) * inv_win_height; \
+   tex_coord[2 * (base + c) + 0] = (tex_x + vx * width) * inv_tex_size_x; \
+   tex_coord[2 * (base + c) + 1] = (tex_y + vy * height) * inv_tex_size_y; \
+   vcolor[   4 * (base + c) + 0] = color[0]; \
+   vcolor[   4 * (base + c) + 1] = color[1]; \
+   vcolor[   4 * (base + c) + 2] = color[2]; \
+   vcolor[   4 * (base + c) + 3] = color[3]; \
 } while(0)
 
-#define MAX_MSG_LEN_CHUNK 64
-
 typedef struct
 {
    gl_t *gl;
@@ -38,14 +36,75 @@ typedef struct
 
    const font_renderer_driver_t *font_driver;
    void *font_data;
+
+   /* RGBA copy of the atlas region being uploaded. */
+   uint8_t *upload_buffer;
+   size_t upload_size;
+
+   /* Glyph quads not drawn yet. */
+   GLfloat *vertex;
+   GLfloat *tex_coord;
+   GLfloat *color;
+   unsigned vertices;
+   unsigned capacity;
+
+   bool batching;
+   bool batch_full_screen;
 } gl_raster_t;
 
+/* Uploads the atlas region the font renderer wrote since the
+ * last upload. Expects font->tex to be bound. */
+static void gl_raster_font_upload_atlas(gl_raster_t *font)
+{
+   unsigned i, j;
+   size_t size;
+   uint8_t *dst = NULL;
+   struct font_atlas *atlas = font->font_driver->get_atlas(font->font_data);
+
+   if (!atlas || !atlas->dirty)
+      return;
+
+   size = atlas->dirty_width * atlas->dirty_height * 4;
+
+   if (size > font->upload_size)
+   {
+      uint8_t *tmp = (uint8_t*)realloc(font->upload_buffer, size);
+      if (!tmp)
+         return;
+      font->upload_buffer = tmp;
+      font->upload_size   = size;
+   }
+
+   /* Ideally, we'd use single component textures, but the 
+    * difference in ways to do that between core GL and GLES/legacy GL
+    * is too great to bother going down that route. */
+   dst = font->upload_buffer;
+
+   for (j = 0; j < atlas->dirty_height; j++)
+   {
+      const uint8_t *src = atlas->buffer + atlas->dirty_x
+         + (atlas->dirty_y + j) * atlas->width;
+
+      for (i = 0; i < atlas->dirty_width; i++)
+      {
+         *dst++ = 0xff;
+         *dst++ = 0xff;
+         *dst++ = 0xff;
+         *dst++ = *src++;
+      }
+   }
+
+   glTexSubImage2D(GL_TEXTURE_2D, 0, atlas->dirty_x, atlas->dirty_y,
+         atlas->dirty_width, atlas->dirty_height,
+         GL_RGBA, GL_UNSIGNED_BYTE, font->upload_buffer);
+
+   atlas->dirty = false;
+}
+
 static void *gl_raster_font_init_font(void *gl_data,
       const char *font_path, float font_size)
 {
-   unsigned width, height;
-   uint8_t *tmp_buffer;
-   const struct font_atlas *atlas = NULL;
+   struct font_atlas *atlas = NULL;
    gl_raster_t *font = (gl_raster_t*)calloc(1, sizeof(*font));
 
    if (!font)
@@ -70,38 +129,18 @@ static void *gl_raster_font_init_font(void *gl_data,
 
    atlas = font->font_driver->get_atlas(font->font_data);
 
-   width = next_pow2(atlas->width);
-   height = next_pow2(atlas->height);
+   font->tex_width  = next_pow2(atlas->width);
+   font->tex_height = next_pow2(atlas->height);
 
-   /* Ideally, we'd use single component textures, but the 
-    * difference in ways to do that between core GL and GLES/legacy GL
-    * is too great to bother going down that route. */
-   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, font->tex_width, font->tex_height,
          0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
-   tmp_buffer = (uint8_t*)malloc(atlas->width * atlas->height * 4);
-
-   if (tmp_buffer)
-   {
-      unsigned i;
-      uint8_t       *dst = tmp_buffer;
-      const uint8_t *src = atlas->buffer;
-
-      for (i = 0; i < atlas->width * atlas->height; i++)
-      {
-         *dst++ = 0xff;
-         *dst++ = 0xff;
-         *dst++ = 0xff;
-         *dst++ = *src++;
-      }
-
-      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, atlas->width,
-            atlas->height, GL_RGBA, GL_UNSIGNED_BYTE, tmp_buffer);
-      free(tmp_buffer);
-   }
-
-   font->tex_width  = width;
-   font->tex_height = height;
+   atlas->dirty        = true;
+   atlas->dirty_x      = 0;
+   atlas->dirty_y      = 0;
+   atlas->dirty_width  = atlas->width;
+   atlas->dirty_height = atlas->height;
+   gl_raster_font_upload_atlas(font);
 
    glBindTexture(GL_TEXTURE_2D, font->gl->texture[font->gl->tex_index]);
    return font;
@@ -117,56 +156,87 @@ static void gl_raster_font_free_font(void *data)
       font->font_driver->free(font->font_data);
 
    glDeleteTextures(1, &font->tex);
+   free(font->upload_buffer);
+   free(font->vertex);
+   free(font->tex_coord);
+   free(font->color);
    free(font);
 }
 
-static int get_message_width(gl_raster_t *font, const char *msg)
+static const struct font_glyph *gl_raster_font_lookup(
+      gl_raster_t *font, uint32_t code)
 {
-   int delta_x;
-   unsigned i, msg_len_full, msg_len;
-
-   msg_len_full   = strlen(msg);
-   msg_len        = min(msg_len_full, MAX_MSG_LEN_CHUNK);
+   const struct font_glyph *glyph = 
+      font->font_driver->get_glyph(font->font_data, code);
+   if (!glyph)
+      glyph = font->font_driver->get_glyph(font->font_data, '?'); /* Do something smarter here ... */
+   return glyph;
+}
 
-   delta_x        = 0;
+static int get_message_width(gl_raster_t *font, const char *msg)
+{
+   uint32_t code;
+   int delta_x = 0;
 
-   while (msg_len_full)
+   while ((code = font_renderer_utf8_next(&msg)))
    {
-      for (i = 0; i < msg_len; i++)
-      {
-         const struct font_glyph *glyph = 
-            font->font_driver->get_glyph(font->font_data, (uint8_t)msg[i]);
-         if (!glyph)
-            glyph = font->font_driver->get_glyph(font->font_data, '?'); /* Do something smarter here ... */
-         if (!glyph)
-            continue;
-
-         delta_x += glyph->advance_x;
-      }
+      const struct font_glyph *glyph = gl_raster_font_lookup(font, code);
+      if (!glyph)
+         continue;
 
-      msg_len_full -= msg_len;
-      msg += msg_len;
-      msg_len = min(msg_len_full, MAX_MSG_LEN_CHUNK);
+      delta_x += glyph->advance_x;
    }
 
    return delta_x;
 }
 
+static bool gl_raster_font_reserve(gl_raster_t *font, unsigned vertices)
+{
+   GLfloat *tmp;
+   unsigned capacity = font->capacity ? font->capacity : 6 * 64;
+
+   if (font->vertices + vertices <= font->capacity)
+      return true;
+
+   while (capacity < font->vertices + vertices)
+      capacity *= 2;
+
+   tmp = (GLfloat*)realloc(font->vertex, 2 * capacity * sizeof(GLfloat));
+   if (!tmp)
+      return false;
+   font->vertex = tmp;
+
+   tmp = (GLfloat*)realloc(font->tex_coord, 2 * capacity * sizeof(GLfloat));
+   if (!tmp)
+      return false;
+   font->tex_coord = tmp;
+
+   tmp = (GLfloat*)realloc(font->color, 4 * capacity * sizeof(GLfloat));
+   if (!tmp)
+      return false;
+   font->color = tmp;
+
+   font->capacity = capacity;
+   return true;
+}
+
+/* Appends the glyph quads of @msg. Positions are relative to the
+ * current viewport. */
 static void render_message(gl_raster_t *font, const char *msg, GLfloat scale,
       const GLfloat color[4], GLfloat pos_x, GLfloat pos_y, bool align_right)
 {
    int x, y, delta_x, delta_y;
    float inv_tex_size_x, inv_tex_size_y, inv_win_width, inv_win_height;
-   unsigned i, msg_len_full, msg_len;
-   GLfloat font_tex_coords[2 * 6 * MAX_MSG_LEN_CHUNK];
-   GLfloat font_vertex[2 * 6 * MAX_MSG_LEN_CHUNK]; 
-   GLfloat font_color[4 * 6 * MAX_MSG_LEN_CHUNK];
+   uint32_t code;
+   GLfloat *vertex, *tex_coord, *vcolor;
    gl_t *gl = font->gl;
 
-   glBindTexture(GL_TEXTURE_2D, font->tex);
+   if (!gl_raster_font_reserve(font, 6 * strlen(msg)))
+      return;
 
-   msg_len_full   = strlen(msg);
-   msg_len        = min(msg_len_full, MAX_MSG_LEN_CHUNK);
+   vertex         = font->vertex;
+   tex_coord      = font->tex_coord;
+   vcolor         = font->color;
 
    x              = roundf(pos_x * gl->vp.width);
    y              = roundf(pos_y * gl->vp.height);
@@ -181,54 +251,65 @@ static void render_message(gl_raster_t *font, const char *msg, GLfloat scale,
    inv_win_width  = 1.0f / font->gl->vp.width;
    inv_win_height = 1.0f / font->gl->vp.height;
 
-   while (msg_len_full)
+   while ((code = font_renderer_utf8_next(&msg)))
    {
-      /* Rebind shaders so attrib cache gets reset. */
-      if (gl->shader && gl->shader->use)
-         gl->shader->use(gl, GL_SHADER_STOCK_BLEND);
-
-      for (i = 0; i < msg_len; i++)
-      {
-         int off_x, off_y, tex_x, tex_y, width, height;
-         const struct font_glyph *glyph = 
-            font->font_driver->get_glyph(font->font_data, (uint8_t)msg[i]);
-         if (!glyph)
-            glyph = font->font_driver->get_glyph(font->font_data, '?'); /* Do something smarter here ... */
-         if (!glyph)
-            continue;
-
-         off_x  = glyph->draw_offset_x;
-         off_y  = glyph->draw_offset_y;
-         tex_x  = glyph->atlas_offset_x;
-         tex_y  = glyph->atlas_offset_y;
-         width  = glyph->width;
-         height = glyph->height;
-
-         emit(0, 0, 1); /* Bottom-left */
-         emit(1, 1, 1); /* Bottom-right */
-         emit(2, 0, 0); /* Top-left */
-
-         emit(3, 1, 0); /* Top-right */
-         emit(4, 0, 0); /* Top-left */
-         emit(5, 1, 1); /* Bottom-right */
+      int off_x, off_y, tex_x, tex_y, width, height;
+      unsigned base = font->vertices;
+      const struct font_glyph *glyph = gl_raster_font_lookup(font, code);
+      if (!glyph)
+         continue;
+
+      off_x  = glyph->draw_offset_x;
+      off_y  = glyph->draw_offset_y;
+      tex_x  = glyph->atlas_offset_x;
+      tex_y  = glyph->atlas_offset_y;
+      width  = glyph->width;
+      height = glyph->height;
+
+      emit(0, 0, 1); /* Bottom-left */
+      emit(1, 1, 1); /* Bottom-right */
+      emit(2, 0, 0); /* Top-left */
+
+      emit(3, 1, 0); /* Top-right */
+      emit(4, 0, 0); /* Top-left */
+      emit(5, 1, 1); /* Bottom-right */
 #undef emit
 
-         delta_x += glyph->advance_x;
-         delta_y -= glyph->advance_y;
-      }
+      font->vertices += 6;
 
-      gl->coords.tex_coord = font_tex_coords;
-      gl->coords.vertex    = font_vertex;
-      gl->coords.color     = font_color;
-      gl->coords.vertices  = 6 * msg_len;
-      gl->shader->set_coords(&gl->coords);
-      gl->shader->set_mvp(gl, &gl->mvp_no_rot);
-      glDrawArrays(GL_TRIANGLES, 0, 6 * msg_len);
-
-      msg_len_full -= msg_len;
-      msg += msg_len;
-      msg_len = min(msg_len_full, MAX_MSG_LEN_CHUNK);
+      delta_x += glyph->advance_x;
+      delta_y -= glyph->advance_y;
    }
+}
+
+/* Draws all pending glyph quads with one draw call. */
+static void gl_raster_font_draw_vertices(gl_raster_t *font)
+{
+   gl_t *gl = font->gl;
+
+   if (!font->vertices)
+      return;
+
+   glEnable(GL_BLEND);
+   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   glBlendEquation(GL_FUNC_ADD);
+
+   glBindTexture(GL_TEXTURE_2D, font->tex);
+   gl_raster_font_upload_atlas(font);
+
+   /* Rebind shaders so attrib cache gets reset. */
+   if (gl->shader && gl->shader->use)
+      gl->shader->use(gl, GL_SHADER_STOCK_BLEND);
+
+   gl->coords.tex_coord = font->tex_coord;
+   gl->coords.vertex    = font->vertex;
+   gl->coords.color     = font->color;
+   gl->coords.vertices  = font->vertices;
+   gl->shader->set_coords(&gl->coords);
+   gl->shader->set_mvp(gl, &gl->mvp_no_rot);
+   glDrawArrays(GL_TRIANGLES, 0, font->vertices);
+
+   font->vertices = 0;
 
    /* Post - Go back to old rendering path. */
    gl->coords.vertex    = gl->vertex_ptr;
@@ -236,6 +317,21 @@ static void render_message(gl_raster_t *font, const char *msg, GLfloat scale,
    gl->coords.color     = gl->white_color_ptr;
    gl->coords.vertices  = 4;
    glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+
+   glDisable(GL_BLEND);
+}
+
+static void gl_raster_font_flush_batch(gl_raster_t *font)
+{
+   gl_t *gl = font->gl;
+
+   if (!font->vertices)
+      return;
+
+   gl_set_viewport(gl, gl->win_width, gl->win_height,
+         font->batch_full_screen, false);
+   gl_raster_font_draw_vertices(font);
+   gl_set_viewport(gl, gl->win_width, gl->win_height, false, true);
 }
 
 static void gl_raster_font_render_msg(void *data, const char *msg,
@@ -292,11 +388,18 @@ static void gl_raster_font_render_msg(void *data, const char *msg,
       drop_mod = 0.3f;
    }
 
+   /* Vertices are relative to the viewport,
+    * which differs between full screen and game. */
+   if (font->batching && font->batch_full_screen != full_screen)
+      gl_raster_font_flush_batch(font);
+
+   if (!font->batching && font->font_driver->begin_frame)
+      font->font_driver->begin_frame(font->font_data);
+
+   font->batch_full_screen = full_screen;
+
    gl_set_viewport(gl, gl->win_width, gl->win_height,
          full_screen, false);
-   glEnable(GL_BLEND);
-   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-   glBlendEquation(GL_FUNC_ADD);
 
    if (drop_x || drop_y)
    {
@@ -311,7 +414,9 @@ static void gl_raster_font_render_msg(void *data, const char *msg,
    }
    render_message(font, msg, scale, color, x, y, align_right);
 
-   glDisable(GL_BLEND);
+   if (!font->batching)
+      gl_raster_font_draw_vertices(font);
+
    gl_set_viewport(gl, gl->win_width, gl->win_height, false, true);
 }
 
@@ -322,7 +427,40 @@ static const struct font_glyph *gl_raster_font_get_glyph(
 
    if (!font)
       return NULL;
-   return font->font_driver->get_glyph((void*)font->font_driver, code);
+   return font->font_driver->get_glyph(font->font_data, code);
+}
+
+static void gl_raster_font_begin_batch(void *data)
+{
+   gl_raster_t *font = (gl_raster_t*)data;
+
+   if (!font)
+      return;
+
+   if (font->font_driver->begin_frame)
+      font->font_driver->begin_frame(font->font_data);
+
+   font->vertices = 0;
+   font->batching = true;
+}
+
+static void gl_raster_font_flush(void *data)
+{
+   gl_raster_t *font = (gl_raster_t*)data;
+
+   if (font && font->batching)
+      gl_raster_font_flush_batch(font);
+}
+
+static void gl_raster_font_end_batch(void *data)
+{
+   gl_raster_t *font = (gl_raster_t*)data;
+
+   if (!font || !font->batching)
+      return;
+
+   gl_raster_font_flush_batch(font);
+   font->batching = false;
 }
 
 gl_font_renderer_t gl_raster_font = {
@@ -331,4 +469,7 @@ gl_font_renderer_t gl_raster_font = {
    gl_raster_font_render_msg,
    "GL raster",
    gl_raster_font_get_glyph,
+   gl_raster_font_begin_batch,
+   gl_raster_font_flush,
+   gl_raster_font_end_batch,
 };
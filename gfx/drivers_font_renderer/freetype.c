@@ -20,13 +20,39 @@
 #include <string.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <retro_miscellaneous.h>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
-#define ATLAS_ROWS 8
-#define ATLAS_COLS 16
-#define ATLAS_SIZE (ATLAS_ROWS * ATLAS_COLS)
+/* Glyphs are rasterized on first use and packed into shelves, rows
+ * of the atlas holding glyphs of similar height. When the atlas is
+ * full, the least recently used shelf is evicted and reused. Shelves
+ * used since the last begin_frame are only evicted when nothing else
+ * can be, so consumers that never call it get plain LRU. */
+
+#define FT_ATLAS_HASH_SIZE  256
+#define FT_ATLAS_MAX_GLYPHS 1024
+#define FT_ATLAS_MAX_SIZE   2048
+/* Blank texels right of and below every glyph,
+ * so linear filtering does not bleed between neighbours. */
+#define FT_ATLAS_PADDING    1
+
+struct ft_shelf
+{
+   unsigned y;
+   unsigned height;
+   unsigned x;         /* Next free column. */
+   uint64_t last_used; /* Clock when a glyph of this shelf was last used. */
+};
+
+struct ft_glyph
+{
+   struct font_glyph glyph;
+   uint32_t code;
+   int shelf;          /* -1 for blank glyphs, which take no space. */
+   int next;           /* Hash chain or free list link. */
+};
 
 typedef struct freetype_renderer
 {
@@ -34,128 +60,444 @@ typedef struct freetype_renderer
    FT_Face face;
 
    struct font_atlas atlas;
-   struct font_glyph glyphs[ATLAS_SIZE];
+
+   struct ft_glyph glyphs[FT_ATLAS_MAX_GLYPHS];
+   int hash[FT_ATLAS_HASH_SIZE];
+   int free_glyphs;
+
+   struct ft_shelf *shelves;
+   unsigned shelf_count;
+   unsigned shelf_capacity;
+   unsigned shelf_top;
+
+   /* Advanced on every glyph lookup. */
+   uint64_t clock;
+   /* Clock at the last begin_frame. */
+   uint64_t frame_start;
 } font_renderer_t;
 
-static const struct font_atlas *font_renderer_ft_get_atlas(void *data)
+static INLINE unsigned ft_hash(uint32_t code)
 {
-   font_renderer_t *handle = (font_renderer_t*)data;
-   if (!handle)
-      return NULL;
-   return &handle->atlas;
+   return (code * 2654435761u) >> 24;
 }
 
-static const struct font_glyph *font_renderer_ft_get_glyph(
-      void *data, uint32_t code)
+static struct font_atlas *font_renderer_ft_get_atlas(void *data)
 {
    font_renderer_t *handle = (font_renderer_t*)data;
    if (!handle)
       return NULL;
-   return code < ATLAS_SIZE ? &handle->glyphs[code] : NULL;
+   return &handle->atlas;
 }
 
-static void font_renderer_ft_free(void *data)
+static void ft_atlas_mark_dirty(struct font_atlas *atlas,
+      unsigned x, unsigned y, unsigned width, unsigned height)
 {
-   font_renderer_t *handle = (font_renderer_t*)data;
-   if (!handle)
+   unsigned x1, y1;
+
+   if (!atlas->dirty)
+   {
+      atlas->dirty        = true;
+      atlas->dirty_x      = x;
+      atlas->dirty_y      = y;
+      atlas->dirty_width  = width;
+      atlas->dirty_height = height;
       return;
+   }
 
-   free(handle->atlas.buffer);
+   x1 = max(atlas->dirty_x + atlas->dirty_width, x + width);
+   y1 = max(atlas->dirty_y + atlas->dirty_height, y + height);
 
-   if (handle->face)
-      FT_Done_Face(handle->face);
-   if (handle->lib)
-      FT_Done_FreeType(handle->lib);
-   free(handle);
+   atlas->dirty_x      = min(atlas->dirty_x, x);
+   atlas->dirty_y      = min(atlas->dirty_y, y);
+   atlas->dirty_width  = x1 - atlas->dirty_x;
+   atlas->dirty_height = y1 - atlas->dirty_y;
 }
 
-static bool font_renderer_create_atlas(font_renderer_t *handle)
+static int ft_glyph_find(font_renderer_t *handle, uint32_t code)
+{
+   int i;
+
+   for (i = handle->hash[ft_hash(code)]; i >= 0; i = handle->glyphs[i].next)
+      if (handle->glyphs[i].code == code)
+         return i;
+   return -1;
+}
+
+/* Drops all glyphs of shelf @index and makes its space reusable. */
+static void ft_shelf_evict(font_renderer_t *handle, unsigned index)
 {
    unsigned i;
-   bool ret = true;
 
-   uint8_t *buffer[ATLAS_SIZE] = {NULL};
-   unsigned pitches[ATLAS_SIZE] = {0};
+   for (i = 0; i < FT_ATLAS_HASH_SIZE; i++)
+   {
+      int *link = &handle->hash[i];
 
-   unsigned max_width = 0;
-   unsigned max_height = 0;
+      while (*link >= 0)
+      {
+         struct ft_glyph *glyph = &handle->glyphs[*link];
+
+         if (glyph->shelf != (int)index)
+         {
+            link = &glyph->next;
+            continue;
+         }
+
+         {
+            int next             = glyph->next;
+            glyph->next          = handle->free_glyphs;
+            handle->free_glyphs  = *link;
+            *link                = next;
+         }
+      }
+   }
+
+   handle->shelves[index].x = 0;
+}
+
+static INLINE bool ft_shelf_in_frame(const font_renderer_t *handle,
+      const struct ft_shelf *shelf)
+{
+   return shelf->last_used > handle->frame_start;
+}
+
+/* Least recently used shelf at least @height high, or -1. Unless
+ * @any, shelves holding a glyph of the current frame are skipped. */
+static int ft_shelf_find_victim(font_renderer_t *handle, unsigned height,
+      bool any)
+{
+   unsigned i;
+   int victim = -1;
 
-   for (i = 0; i < ATLAS_SIZE; i++)
+   for (i = 0; i < handle->shelf_count; i++)
    {
-      struct font_glyph *glyph = &handle->glyphs[i];
+      const struct ft_shelf *shelf = &handle->shelves[i];
 
-      if (!glyph)
+      /* Empty shelves have nothing to give back. */
+      if (!shelf->x || shelf->height < height)
          continue;
+      if (!any && ft_shelf_in_frame(handle, shelf))
+         continue;
+      if (victim < 0
+            || shelf->last_used < handle->shelves[victim].last_used)
+         victim = i;
+   }
+
+   return victim;
+}
+
+/* For glyphs taller than any shelf that can be evicted, evicts the
+ * least recently used run of adjacent shelves high enough together
+ * and merges them into one. Returns the merged shelf, or -1. */
+static int ft_shelf_merge_victims(font_renderer_t *handle, unsigned height,
+      bool any)
+{
+   unsigned i, j, k;
+   int first = -1, last = -1;
+   uint64_t best_used = 0;
+
+   for (i = 0; i < handle->shelf_count; i++)
+   {
+      unsigned total = 0;
+      uint64_t used  = 0;
+
+      for (j = i; j < handle->shelf_count && total < height; j++)
+      {
+         const struct ft_shelf *shelf = &handle->shelves[j];
+
+         if (!any && ft_shelf_in_frame(handle, shelf))
+            break;
+         total += shelf->height;
+         used   = max(used, shelf->last_used);
+      }
 
-      if (FT_Load_Char(handle->face, i, FT_LOAD_RENDER))
+      if (total < height)
+         continue;
+      if (first < 0 || used < best_used)
       {
-         ret = false;
-         goto end;
+         first     = i;
+         last      = j - 1;
+         best_used = used;
       }
+   }
 
-      FT_Render_Glyph(handle->face->glyph, FT_RENDER_MODE_NORMAL);
-      FT_GlyphSlot slot = handle->face->glyph;
+   if (first < 0)
+      return -1;
 
-      /* Some glyphs can be blank. */
-      buffer[i] = (uint8_t*)calloc(slot->bitmap.rows * slot->bitmap.pitch, 1);
+   for (i = first; i <= (unsigned)last; i++)
+   {
+      ft_shelf_evict(handle, i);
+      if (i > (unsigned)first)
+         handle->shelves[first].height += handle->shelves[i].height;
+   }
 
-      glyph->width = slot->bitmap.width;
-      glyph->height = slot->bitmap.rows;
-      pitches[i] = slot->bitmap.pitch;
+   if (last == first)
+      return first;
 
-      glyph->advance_x = slot->advance.x >> 6;
-      glyph->advance_y = slot->advance.y >> 6;
-      glyph->draw_offset_x = slot->bitmap_left;
-      glyph->draw_offset_y = -slot->bitmap_top;
+   /* Shelves are kept in atlas order, renumber the ones after. */
+   k = last - first;
+   memmove(&handle->shelves[first + 1], &handle->shelves[last + 1],
+         (handle->shelf_count - last - 1) * sizeof(*handle->shelves));
+   handle->shelf_count -= k;
 
-      if (buffer[i])
-         memcpy(buffer[i], slot->bitmap.buffer,
-               slot->bitmap.rows * pitches[i]);
-      max_width = max(max_width, (unsigned)slot->bitmap.width);
-      max_height = max(max_height, (unsigned)slot->bitmap.rows);
+   for (i = 0; i < FT_ATLAS_HASH_SIZE; i++)
+   {
+      int index;
+      for (index = handle->hash[i]; index >= 0;
+            index = handle->glyphs[index].next)
+         if (handle->glyphs[index].shelf > last)
+            handle->glyphs[index].shelf -= k;
    }
 
-   handle->atlas.width = max_width * ATLAS_COLS;
-   handle->atlas.height = max_height * ATLAS_ROWS;
+   return first;
+}
+
+static int ft_shelf_alloc(font_renderer_t *handle,
+      unsigned width, unsigned height)
+{
+   unsigned i;
+   int best = -1;
 
-   handle->atlas.buffer = (uint8_t*)
-      calloc(handle->atlas.width * handle->atlas.height, 1);
+   for (i = 0; i < handle->shelf_count; i++)
+   {
+      const struct ft_shelf *shelf = &handle->shelves[i];
 
-   if (!handle->atlas.buffer)
+      if (shelf->height < height
+            || shelf->x + width > handle->atlas.width)
+         continue;
+      if (best < 0 || shelf->height < handle->shelves[best].height)
+         best = i;
+   }
+
+   if (best >= 0 && handle->shelves[best].height < height * 2)
+      return best;
+
+   /* Round heights up so glyphs of similar size share shelves. */
+   height = min((height + 3) & ~3u, handle->atlas.height);
+
+   if (handle->shelf_top + height <= handle->atlas.height)
    {
-      ret = false;
-      goto end;
+      struct ft_shelf *shelf = NULL;
+
+      if (handle->shelf_count == handle->shelf_capacity)
+      {
+         unsigned capacity = handle->shelf_capacity ?
+            handle->shelf_capacity * 2 : 16;
+         struct ft_shelf *shelves = (struct ft_shelf*)realloc(
+               handle->shelves, capacity * sizeof(*shelves));
+
+         if (!shelves)
+            return best;
+
+         handle->shelves        = shelves;
+         handle->shelf_capacity = capacity;
+      }
+
+      shelf            = &handle->shelves[handle->shelf_count];
+      shelf->y         = handle->shelf_top;
+      shelf->height    = height;
+      shelf->x         = 0;
+      shelf->last_used = handle->clock;
+
+      handle->shelf_top += height;
+      return handle->shelf_count++;
    }
 
-   /* Blit our texture atlas. */
-   for (i = 0; i < ATLAS_SIZE; i++)
+   if (best >= 0)
+      return best;
+
+   /* Glyphs of the current frame go last. A consumer still holding
+    * them then draws garbage for a frame, rather than nothing. */
+   best = ft_shelf_find_victim(handle, height, false);
+   if (best < 0)
    {
-      unsigned r, c;
-      uint8_t *dst      = NULL;
-      unsigned offset_x = (i % ATLAS_COLS) * max_width;
-      unsigned offset_y = (i / ATLAS_COLS) * max_height;
+      best = ft_shelf_merge_victims(handle, height, false);
+      if (best >= 0)
+         return best;
 
-      handle->glyphs[i].atlas_offset_x = offset_x;
-      handle->glyphs[i].atlas_offset_y = offset_y;
+      best = ft_shelf_find_victim(handle, height, true);
+      if (best < 0)
+         return ft_shelf_merge_victims(handle, height, true);
+   }
 
-      dst = (uint8_t*)handle->atlas.buffer;
-      dst += offset_x + offset_y * handle->atlas.width;
+   ft_shelf_evict(handle, best);
+   return best;
+}
+
+static int ft_glyph_alloc(font_renderer_t *handle)
+{
+   int index = handle->free_glyphs;
 
-      if (buffer[i])
+   if (index < 0)
+   {
+      int victim = ft_shelf_find_victim(handle, 0, false);
+      if (victim < 0)
+         victim = ft_shelf_find_victim(handle, 0, true);
+      if (victim < 0)
+         return -1;
+      ft_shelf_evict(handle, victim);
+      index = handle->free_glyphs;
+      if (index < 0)
+         return -1;
+   }
+
+   handle->free_glyphs = handle->glyphs[index].next;
+   return index;
+}
+
+static int ft_glyph_rasterize(font_renderer_t *handle, uint32_t code)
+{
+   unsigned r, width, height;
+   int index, shelf_index = -1;
+   unsigned x = 0, y = 0;
+   struct ft_glyph *glyph = NULL;
+   FT_GlyphSlot slot      = NULL;
+
+   if (!FT_Get_Char_Index(handle->face, code))
+      return -1;
+   if (FT_Load_Char(handle->face, code, FT_LOAD_RENDER))
+      return -1;
+
+   slot   = handle->face->glyph;
+   width  = slot->bitmap.width;
+   height = slot->bitmap.rows;
+
+   /* Take the glyph slot first, evicting for it can free atlas space
+    * but not the other way around. */
+   index = ft_glyph_alloc(handle);
+   if (index < 0)
+      return -1;
+
+   if (width && height)
+   {
+      struct ft_shelf *shelf = NULL;
+
+      shelf_index = ft_shelf_alloc(handle,
+            width + FT_ATLAS_PADDING, height + FT_ATLAS_PADDING);
+      if (shelf_index < 0)
       {
-         const uint8_t *src = (const uint8_t*)buffer[i];
+         handle->glyphs[index].next = handle->free_glyphs;
+         handle->free_glyphs        = index;
+         return -1;
+      }
+
+      shelf     = &handle->shelves[shelf_index];
+      x         = shelf->x;
+      y         = shelf->y;
+      shelf->x += width + FT_ATLAS_PADDING;
+   }
+
+   glyph                       = &handle->glyphs[index];
+   glyph->code                 = code;
+   glyph->shelf                = shelf_index;
+   glyph->glyph.width          = width;
+   glyph->glyph.height         = height;
+   glyph->glyph.atlas_offset_x = x;
+   glyph->glyph.atlas_offset_y = y;
+   glyph->glyph.advance_x      = slot->advance.x >> 6;
+   glyph->glyph.advance_y      = slot->advance.y >> 6;
+   glyph->glyph.draw_offset_x  = slot->bitmap_left;
+   glyph->glyph.draw_offset_y  = -slot->bitmap_top;
+
+   glyph->next = handle->hash[ft_hash(code)];
+   handle->hash[ft_hash(code)] = index;
+
+   if (shelf_index < 0)
+      return index;
+
+   /* Copy the glyph along with its padding, which may still
+    * hold texels of an evicted glyph. */
+   for (r = 0; r < height + FT_ATLAS_PADDING; r++)
+   {
+      uint8_t *dst = handle->atlas.buffer
+         + (y + r) * handle->atlas.width + x;
 
-         for (r = 0; r < handle->glyphs[i].height;
-               r++, dst += handle->atlas.width, src += pitches[i])
-            for (c = 0; c < handle->glyphs[i].width; c++)
-               dst[c] = src[c];
+      if (r < height)
+      {
+         memcpy(dst, slot->bitmap.buffer + (int)r * slot->bitmap.pitch, width);
+         memset(dst + width, 0, FT_ATLAS_PADDING);
       }
+      else
+         memset(dst, 0, width + FT_ATLAS_PADDING);
    }
 
-end:
-   for (i = 0; i < ATLAS_SIZE; i++)
-      free(buffer[i]);
-   return ret;
+   ft_atlas_mark_dirty(&handle->atlas, x, y,
+         width + FT_ATLAS_PADDING, height + FT_ATLAS_PADDING);
+
+   return index;
+}
+
+static const struct font_glyph *font_renderer_ft_get_glyph(
+      void *data, uint32_t code)
+{
+   int index;
+   font_renderer_t *handle = (font_renderer_t*)data;
+   if (!handle)
+      return NULL;
+
+   index = ft_glyph_find(handle, code);
+   if (index < 0)
+      index = ft_glyph_rasterize(handle, code);
+   if (index < 0)
+      return NULL;
+
+   if (handle->glyphs[index].shelf >= 0)
+      handle->shelves[handle->glyphs[index].shelf].last_used = ++handle->clock;
+
+   return &handle->glyphs[index].glyph;
+}
+
+static void font_renderer_ft_begin_frame(void *data)
+{
+   font_renderer_t *handle = (font_renderer_t*)data;
+   if (handle)
+      handle->frame_start = handle->clock;
+}
+
+static void font_renderer_ft_free(void *data)
+{
+   font_renderer_t *handle = (font_renderer_t*)data;
+   if (!handle)
+      return;
+
+   free(handle->atlas.buffer);
+   free(handle->shelves);
+
+   if (handle->face)
+      FT_Done_Face(handle->face);
+   if (handle->lib)
+      FT_Done_FreeType(handle->lib);
+   free(handle);
+}
+
+static bool font_renderer_create_atlas(font_renderer_t *handle)
+{
+   unsigned i;
+   unsigned cell_width  = handle->face->size->metrics.x_ppem
+      + FT_ATLAS_PADDING;
+   unsigned cell_height = ((handle->face->size->metrics.height + 63) >> 6)
+      + FT_ATLAS_PADDING;
+
+   /* 16x8 em sized cells, which holds the printable characters of
+    * Latin-1 at once. Glyphs past that are cached as they come. */
+   handle->atlas.width  = min(next_pow2(cell_width  * 16), FT_ATLAS_MAX_SIZE);
+   handle->atlas.height = min(next_pow2(cell_height * 8), FT_ATLAS_MAX_SIZE);
+   handle->atlas.buffer = (uint8_t*)
+      calloc(handle->atlas.width * handle->atlas.height, 1);
+
+   if (!handle->atlas.buffer)
+      return false;
+
+   for (i = 0; i < FT_ATLAS_HASH_SIZE; i++)
+      handle->hash[i] = -1;
+   for (i = 0; i < FT_ATLAS_MAX_GLYPHS; i++)
+      handle->glyphs[i].next = i + 1 < FT_ATLAS_MAX_GLYPHS ? (int)i + 1 : -1;
+   handle->free_glyphs = 0;
+
+   /* Printable ASCII is needed right away by about any message. */
+   for (i = ' '; i < 127; i++)
+      font_renderer_ft_get_glyph(handle, i);
+
+   return true;
 }
 
 static void *font_renderer_ft_init(const char *font_path, float font_size)
@@ -233,4 +575,5 @@ font_renderer_driver_t freetype_font_renderer = {
    font_renderer_ft_free,
    font_renderer_ft_get_default_font,
    "freetype",
+   font_renderer_ft_begin_frame,
 };
@@ -31,6 +31,14 @@ typedef struct gl_font_renderer
    const char *ident;
 
    const struct font_glyph *(*get_glyph)(void *data, uint32_t code);
+
+   /* Optional. Messages rendered between begin_batch and end_batch
+    * are drawn together by end_batch, with a single draw call for
+    * those sharing a viewport. flush_batch draws the messages so far,
+    * for callers about to draw over them. */
+   void (*begin_batch)(void *data);
+   void (*flush_batch)(void *data);
+   void (*end_batch)(void *data);
 } gl_font_renderer_t;
 
 extern gl_font_renderer_t gl_raster_font;
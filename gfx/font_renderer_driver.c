@@ -64,3 +64,56 @@ bool font_renderer_create_default(
    *handle = NULL;
    return false;
 }
+
+uint32_t font_renderer_utf8_next(const char **str)
+{
+   unsigned i, len;
+   uint32_t code;
+   const uint8_t *s = (const uint8_t*)*str;
+
+   if (!*s)
+      return 0;
+
+   if (s[0] < 0x80)
+   {
+      *str += 1;
+      return s[0];
+   }
+   else if ((s[0] & 0xe0) == 0xc0)
+   {
+      len  = 2;
+      code = s[0] & 0x1f;
+   }
+   else if ((s[0] & 0xf0) == 0xe0)
+   {
+      len  = 3;
+      code = s[0] & 0x0f;
+   }
+   else if ((s[0] & 0xf8) == 0xf0)
+   {
+      len  = 4;
+      code = s[0] & 0x07;
+   }
+   else
+      goto invalid;
+
+   for (i = 1; i < len; i++)
+   {
+      if ((s[i] & 0xc0) != 0x80)
+         goto invalid;
+      code = (code << 6) | (s[i] & 0x3f);
+   }
+
+   /* Reject overlong forms, surrogates and values past U+10FFFF. */
+   if ((len == 2 && code < 0x80) || (len == 3 && code < 0x800)
+         || (len == 4 && code < 0x10000)
+         || (code >= 0xd800 && code < 0xe000) || code > 0x10ffff)
+      goto invalid;
+
+   *str += len;
+   return code;
+
+invalid:
+   *str += 1;
+   return 0xfffd;
+}
@@ -27,7 +27,12 @@
  * be drawn in a single draw call.
  *
  * It is up to the code using this interface to actually 
- * generate proper vertex buffers and upload the atlas texture to GPU. */
+ * generate proper vertex buffers and upload the atlas texture to GPU.
+ *
+ * Renderers may rasterize glyphs into the atlas on demand from
+ * get_glyph. They mark the region they wrote as dirty, and code
+ * keeping a copy of the atlas re-uploads that region and clears
+ * the flag. */
 
 struct font_glyph
 {
@@ -53,13 +58,20 @@ struct font_atlas
    uint8_t *buffer; /* Alpha channel. */
    unsigned width;
    unsigned height;
+
+   /* Region written since dirty was last cleared. */
+   bool dirty;
+   unsigned dirty_x;
+   unsigned dirty_y;
+   unsigned dirty_width;
+   unsigned dirty_height;
 };
 
 typedef struct font_renderer_driver
 {
    void *(*init)(const char *font_path, float font_size);
 
-   const struct font_atlas *(*get_atlas)(void *data);
+   struct font_atlas *(*get_atlas)(void *data);
 
    /* Returns NULL if no glyph for this code is found. */
    const struct font_glyph *(*get_glyph)(void *data, uint32_t code);
@@ -69,6 +81,13 @@ typedef struct font_renderer_driver
    const char *(*get_default_font)(void);
 
    const char *ident;
+
+   /* Optional. Glyphs returned by get_glyph since the last call are
+    * kept in the atlas until the next one, unless they alone fill it.
+    * Renderers with a fixed atlas leave this NULL, renderers with a
+    * glyph cache evict glyphs not used since first. Consumers that
+    * never call it get least recently used eviction. */
+   void (*begin_frame)(void *data);
 } font_renderer_driver_t;
 
 extern font_renderer_driver_t freetype_font_renderer;
@@ -79,5 +98,17 @@ extern font_renderer_driver_t bitmap_font_renderer;
 bool font_renderer_create_default(const font_renderer_driver_t **driver,
       void **handle, const char *font_path, unsigned font_size);
 
+/**
+ * font_renderer_utf8_next:
+ * @str                 : Pointer to UTF-8 string, advanced past
+ *                        the decoded character.
+ *
+ * Decodes the next character of *@str. Malformed sequences decode
+ * to U+FFFD one byte at a time.
+ *
+ * Returns: Unicode code point, or 0 at the end of the string.
+ **/
+uint32_t font_renderer_utf8_next(const char **str);
+
 #endif
 
@@ -49,6 +49,7 @@ CONSOLE EXTENSIONS
 
 #ifdef HAVE_ZLIB
 #include "../file_extract.c"
+#include "../file_archive_index.c"
 #include "../decompress/zip_support.c"
 #endif
 
@@ -61,6 +62,7 @@ PERFORMANCE
 #endif
 
 #include "../performance.c"
+#include "../benchmark.c"
 
 /*============================================================
 COMPATIBILITY
@@ -773,6 +775,10 @@ DEPENDENCIES
 #include "../decompress/7zip_support.c"
 #endif
 
+#ifdef HAVE_COMPRESSION
+#include "../file_archive_cache.c"
+#endif
+
 /*============================================================
 XML
 ============================================================ */
@@ -798,7 +804,6 @@ XML
  LIBRETRODB
 ============================================================ */
 #ifdef HAVE_LIBRETRODB
-#include "../libretrodb/bintree.c"
 #include "../libretrodb/libretrodb.c"
 #include "../libretrodb/rmsgpack.c"
 #include "../libretrodb/rmsgpack_dom.c"
@@ -42,6 +42,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <boolean.h>
 
 #include <compat/msvc.h>
 #ifdef HAVE_CONFIG_H
@@ -58,24 +59,33 @@
  **/
 void sha256_hash(char *out, const uint8_t *in, size_t size);
 
-#ifdef HAVE_ZLIB
-#include <zlib.h>
+/**
+ * crc32_calculate:
+ * @data              : Input.
+ * @length            : Size of @data.
+ *
+ * Returns: CRC32 of @data.
+ **/
+uint32_t crc32_calculate(const uint8_t *data, size_t length);
 
-static inline uint32_t crc32_calculate(const uint8_t *data, size_t length)
-{
-   return crc32(0, data, length);
-}
+/**
+ * crc32_update:
+ * @crc               : CRC32 of the preceding data, 0 at the start.
+ * @data              : Input.
+ * @length            : Size of @data.
+ *
+ * Returns: CRC32 of the preceding data followed by @data.
+ **/
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length);
 
-static inline uint32_t crc32_adjust(uint32_t crc, uint8_t data)
-{
-   /* zlib and nall have different
-    * assumptions on "sign" for this function. */
-   return ~crc32(~crc, &data, 1);
-}
-#else
-uint32_t crc32_calculate(const uint8_t *data, size_t length);
+/**
+ * crc32_adjust:
+ * @crc               : CRC32 register, i.e. the inverted CRC32.
+ * @data              : Input byte.
+ *
+ * Returns: CRC32 register after @data.
+ **/
 uint32_t crc32_adjust(uint32_t crc, uint8_t data);
-#endif
 
 typedef struct SHA1Context
 {
@@ -91,7 +101,118 @@ typedef struct SHA1Context
    int Corrupted;              /* Is the message digest corruped?  */
 } SHA1Context;
 
+struct md5_ctx
+{
+   uint32_t h[4];
+   uint8_t in[64];
+   unsigned inlen;
+   uint64_t len;
+};
+
+struct sha256_ctx 
+{
+   union
+   {
+      uint8_t u8[64];
+      uint32_t u32[16];
+   } in;
+   unsigned inlen;
+
+   uint32_t w[64];
+   uint32_t h[8];
+   uint64_t len;
+};
+
+enum rarch_hash_type
+{
+   RARCH_HASH_CRC32  = (1 << 0),
+   RARCH_HASH_MD5    = (1 << 1),
+   RARCH_HASH_SHA1   = (1 << 2),
+   RARCH_HASH_SHA256 = (1 << 3)
+};
+
+/* Computes several digests of a stream in a single pass. */
+typedef struct rarch_hash_ctx
+{
+   unsigned types;
+
+   uint32_t crc;
+   struct md5_ctx md5;
+   SHA1Context sha1;
+   struct sha256_ctx sha256;
+
+   /* Digests, valid after rarch_hash_final. */
+   uint32_t crc32;
+   uint8_t md5_digest[16];
+   uint8_t sha1_digest[20];
+   uint8_t sha256_digest[32];
+} rarch_hash_ctx_t;
+
+#define RARCH_HASH_SIMD_PCLMUL (1 << 0)
+#define RARCH_HASH_SIMD_SHA    (1 << 1)
+
+/**
+ * rarch_hash_init_simd:
+ * @mask              : Accelerated paths allowed, RARCH_HASH_SIMD_* flags.
+ *
+ * Restricts CRC32 and SHA-1 to the accelerated paths in @mask that the
+ * CPU supports. Until called, every supported path is used.
+ **/
+void rarch_hash_init_simd(unsigned mask);
+
+/**
+ * rarch_hash_init:
+ * @ctx               : Hash context.
+ * @types             : Digests to compute, RARCH_HASH_* flags.
+ *
+ * Initializes @ctx for a new stream.
+ **/
+void rarch_hash_init(rarch_hash_ctx_t *ctx, unsigned types);
+
+/**
+ * rarch_hash_update:
+ * @ctx               : Hash context.
+ * @data              : Input.
+ * @size              : Size of @data.
+ *
+ * Feeds @data to all digests of @ctx. Large inputs are hashed in
+ * cache-sized slices, so each slice is only loaded from memory once
+ * for all digests.
+ **/
+void rarch_hash_update(rarch_hash_ctx_t *ctx, const void *data, size_t size);
+
+/**
+ * rarch_hash_final:
+ * @ctx               : Hash context.
+ *
+ * Finishes the stream and stores the digests in @ctx.
+ **/
+void rarch_hash_final(rarch_hash_ctx_t *ctx);
+
+/**
+ * rarch_hash_file:
+ * @ctx               : Hash context.
+ * @path              : Path to file.
+ * @types             : Digests to compute, RARCH_HASH_* flags.
+ *
+ * Computes the digests of a file in a single streaming pass,
+ * without loading it into memory.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool rarch_hash_file(rarch_hash_ctx_t *ctx, const char *path,
+      unsigned types);
+
+/**
+ * rarch_hash_to_string:
+ * @out               : Output, at least 2 * @size + 1 bytes.
+ * @digest            : Digest.
+ * @size              : Size of @digest.
+ *
+ * Formats @digest as upper case hex.
+ **/
+void rarch_hash_to_string(char *out, const uint8_t *digest, size_t size);
+
 int sha1_calculate(const char *path, char *result);
 
 #endif
-
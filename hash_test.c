@@ -0,0 +1,223 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2015 - Daniel De Matteis
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hash.h"
+
+/* Checks the accelerated CRC32 and SHA-1 paths against the portable
+ * ones, on lengths and alignments that exercise the tails, and times
+ * every digest with "bench". Build with "make hash_test". */
+
+struct simd_level
+{
+   const char *name;
+   unsigned mask;
+};
+
+static const struct simd_level simd_levels[] = {
+   { "C",      0 },
+   { "PCLMUL", RARCH_HASH_SIMD_PCLMUL },
+   { "SHA",    RARCH_HASH_SIMD_SHA },
+};
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng_next(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static double time_now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void hash_buffer(rarch_hash_ctx_t *ctx, const uint8_t *data,
+      size_t size, unsigned types, size_t split)
+{
+   rarch_hash_init(ctx, types);
+   rarch_hash_update(ctx, data, split);
+   rarch_hash_update(ctx, data + split, size - split);
+   rarch_hash_final(ctx);
+}
+
+static int check_vectors(void)
+{
+   static const char abc_md5[]    = "900150983CD24FB0D6963F7D28E17F72";
+   static const char abc_sha1[]   = "A9993E364706816ABA3E25717850C26C9CD0D89D";
+   static const char abc_sha256[] =
+      "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD";
+   char out[65];
+   int failed = 0;
+   rarch_hash_ctx_t ctx;
+
+   if (crc32_calculate((const uint8_t*)"123456789", 9) != 0xcbf43926)
+   {
+      fprintf(stderr, "CRC32 of \"123456789\" is wrong.\n");
+      failed = 1;
+   }
+
+   hash_buffer(&ctx, (const uint8_t*)"abc", 3,
+         RARCH_HASH_MD5 | RARCH_HASH_SHA1 | RARCH_HASH_SHA256, 1);
+
+   rarch_hash_to_string(out, ctx.md5_digest, 16);
+   failed |= strcmp(out, abc_md5) != 0;
+   rarch_hash_to_string(out, ctx.sha1_digest, 20);
+   failed |= strcmp(out, abc_sha1) != 0;
+   rarch_hash_to_string(out, ctx.sha256_digest, 32);
+   failed |= strcmp(out, abc_sha256) != 0;
+
+   if (failed)
+      fprintf(stderr, "Test vectors failed.\n");
+   return failed;
+}
+
+/* Hashes @size bytes at @offset with the portable paths and with
+ * @level, returns 0 if the CRC32 and SHA-1 are the same. */
+static int check_hash(const uint8_t *data, size_t size,
+      const struct simd_level *level)
+{
+   rarch_hash_ctx_t ref, ctx;
+   size_t split = size ? rng_next() % size : 0;
+   const unsigned types = RARCH_HASH_CRC32 | RARCH_HASH_SHA1;
+
+   rarch_hash_init_simd(0);
+   hash_buffer(&ref, data, size, types, size);
+
+   rarch_hash_init_simd(level->mask);
+   hash_buffer(&ctx, data, size, types, split);
+
+   if (ref.crc32 != ctx.crc32
+         || memcmp(ref.sha1_digest, ctx.sha1_digest, 20))
+   {
+      fprintf(stderr, "%s: %u bytes split at %u differ.\n",
+            level->name, (unsigned)size, (unsigned)split);
+      return 1;
+   }
+
+   return 0;
+}
+
+static int run_checks(void)
+{
+   unsigned i, j;
+   int failed = 0, checked = 0;
+   size_t size;
+   const size_t max_size = 4 << 20;
+   uint8_t *data = (uint8_t*)malloc(max_size + 16);
+
+   if (!data)
+      return 1;
+
+   for (i = 0; i < max_size + 16; i++)
+      data[i] = rng_next() >> 24;
+
+   failed |= check_vectors();
+
+   for (j = 1; j < sizeof(simd_levels) / sizeof(simd_levels[0]); j++)
+   {
+      const struct simd_level *level = &simd_levels[j];
+
+      /* Every length up to a few blocks, at every alignment. */
+      for (size = 0; size <= 300; size++)
+      {
+         for (i = 0; i < 16; i++)
+            failed |= check_hash(data + i, size, level);
+         checked += 16;
+      }
+
+      failed |= check_hash(data + 3, max_size, level);
+      failed |= check_hash(data, max_size - 1, level);
+      checked += 2;
+   }
+
+   free(data);
+   fprintf(stderr, "%d checks, %s.\n", checked, failed ? "FAILED" : "all passed");
+   return failed ? 1 : 0;
+}
+
+static void run_bench(unsigned megabytes)
+{
+   static const struct
+   {
+      const char *name;
+      unsigned type;
+   } digests[] = {
+      { "crc32",  RARCH_HASH_CRC32 },
+      { "md5",    RARCH_HASH_MD5 },
+      { "sha1",   RARCH_HASH_SHA1 },
+      { "sha256", RARCH_HASH_SHA256 },
+      { "all",    RARCH_HASH_CRC32 | RARCH_HASH_MD5 | RARCH_HASH_SHA1 },
+   };
+   unsigned i, j;
+   const size_t size = (size_t)megabytes << 20;
+   uint8_t *data     = (uint8_t*)malloc(size);
+
+   if (!data)
+      return;
+
+   memset(data, 0x5a, size);
+
+   fprintf(stderr, "%-10s", "MB/s");
+   for (j = 0; j < sizeof(simd_levels) / sizeof(simd_levels[0]); j++)
+      fprintf(stderr, "%10s", simd_levels[j].name);
+   fprintf(stderr, "\n");
+
+   for (i = 0; i < sizeof(digests) / sizeof(digests[0]); i++)
+   {
+      fprintf(stderr, "%-10s", digests[i].name);
+
+      for (j = 0; j < sizeof(simd_levels) / sizeof(simd_levels[0]); j++)
+      {
+         double start;
+         rarch_hash_ctx_t ctx;
+
+         rarch_hash_init_simd(simd_levels[j].mask);
+
+         start = time_now();
+         hash_buffer(&ctx, data, size, digests[i].type, 0);
+         fprintf(stderr, "%10.0f", megabytes / (time_now() - start));
+      }
+
+      fprintf(stderr, "\n");
+   }
+
+   free(data);
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc > 1 && strcmp(argv[1], "bench") == 0)
+   {
+      run_bench(argc > 2 ? atoi(argv[2]) : 256);
+      return 0;
+   }
+
+   if (argc > 1)
+   {
+      fprintf(stderr, "Usage: %s [bench [megabytes]]\n", argv[0]);
+      return 1;
+   }
+
+   return run_checks();
+}
@@ -17,7 +17,9 @@
 #include "../input_joypad.h"
 #include "../input_keymaps.h"
 #include "../../general.h"
+#include "../../performance.h"
 #include <file/file_path.h>
+#include <retro_miscellaneous.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <string.h>
@@ -39,6 +41,10 @@
 #include "../../config.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 /* Need libxkbcommon to translate raw evdev events to characters
  * which can be passed to keyboard callback in a sensible way. */
 
@@ -59,6 +65,9 @@ struct input_device
    dev_t dev;
    device_handle_cb handle_cb;
    char devnode[PATH_MAX_LENGTH];
+   /* Event timestamps are on the CLOCK_MONOTONIC timeline
+    * of rarch_get_perf_counter, see udev_input_event_time. */
+   bool monotonic;
 
    union
    {
@@ -77,6 +86,22 @@ struct input_device
    } state;
 };
 
+/* Events read by the input thread, applied in udev_input_poll. */
+#define UDEV_QUEUE_SIZE 1024
+
+struct udev_queued_event
+{
+   struct input_device *dev;
+   struct input_event event;
+   retro_perf_tick_t time;
+   /* @dev was unplugged, free it once its events are applied. */
+   bool removed;
+};
+
+/* Events applied by the last poll, their latency is measured
+ * when the core first reads input state. */
+#define UDEV_LATENCY_EVENTS 64
+
 struct udev_input
 {
    struct udev *udev;
@@ -100,8 +125,30 @@ struct udev_input
    int16_t mouse_x;
    int16_t mouse_y;
    bool mouse_l, mouse_r, mouse_m, mouse_wu, mouse_wd;
+
+   retro_perf_tick_t latency[UDEV_LATENCY_EVENTS];
+   unsigned latency_count;
+
+#ifdef HAVE_THREADS
+   sthread_t *replay_thread;
+   int replay_fd;
+   char replay_path[PATH_MAX_LENGTH];
+
+   /* Single producer, single consumer queue. Only the input thread
+    * touches the device list and the hotplug monitor while it runs. */
+   sthread_t *thread;
+   volatile bool thread_quit;
+   int wake_fd[2];
+   struct udev_queued_event queue[UDEV_QUEUE_SIZE];
+   volatile unsigned queue_read;
+   volatile unsigned queue_write;
+#endif
 };
 
+/* epoll markers for the non-device file descriptors. */
+static int udev_wake_marker;
+static int udev_hotplug_marker;
+
 #ifdef HAVE_XKBCOMMON
 void handle_xkb(
       struct xkb_state *xkb_state, 
@@ -249,6 +296,70 @@ static void udev_handle_mouse(udev_input_t *udev,
    }
 }
 
+static void udev_handle_replay(udev_input_t *udev,
+      const struct input_event *event, struct input_device *dev)
+{
+   /* Recordings may come from a keyboard or a mouse. */
+   if (event->type == EV_REL ||
+         (event->type == EV_KEY && event->code >= BTN_MOUSE
+          && event->code < BTN_JOYSTICK))
+      udev_handle_mouse(udev, event, dev);
+   else
+      udev_handle_keyboard(udev, event, dev);
+}
+
+static retro_perf_tick_t udev_input_event_time(
+      const struct input_device *dev, const struct input_event *event)
+{
+   if (!dev->monotonic)
+      return rarch_get_perf_counter();
+
+   return (retro_perf_tick_t)event->time.tv_sec * 1000000000
+      + (retro_perf_tick_t)event->time.tv_usec * 1000;
+}
+
+static void udev_input_apply_event(udev_input_t *udev,
+      struct input_device *dev, const struct input_event *event,
+      retro_perf_tick_t time)
+{
+   dev->handle_cb(udev, event, dev);
+
+   if (event->type == EV_KEY && event->value != 2
+         && udev->latency_count < UDEV_LATENCY_EVENTS)
+      udev->latency[udev->latency_count++] = time;
+}
+
+/**
+ * udev_input_measure_latency:
+ * @udev                : udev handle.
+ *
+ * Measures the time from key and button events arriving to the
+ * core reading input state after they were applied.
+ **/
+static void udev_input_measure_latency(udev_input_t *udev)
+{
+   unsigned i;
+   retro_perf_tick_t now;
+   RARCH_PERFORMANCE_INIT(input_latency);
+
+   if (g_extern.perfcnt_enable)
+   {
+      now = rarch_get_perf_counter();
+
+      for (i = 0; i < udev->latency_count; i++)
+      {
+         retro_perf_tick_t ticks = now > udev->latency[i] ?
+            now - udev->latency[i] : 0;
+
+         input_latency.call_cnt++;
+         input_latency.total += ticks;
+         rarch_perf_sample(&input_latency, udev->latency[i], ticks);
+      }
+   }
+
+   udev->latency_count = 0;
+}
+
 static bool hotplug_available(udev_input_t *udev)
 {
    struct pollfd fds = {0};
@@ -262,14 +373,21 @@ static bool hotplug_available(udev_input_t *udev)
    return (poll(&fds, 1, 0) == 1) && (fds.revents & POLLIN);
 }
 
+static bool register_device(udev_input_t *udev,
+      struct input_device *device);
+
+#ifdef HAVE_THREADS
+static void udev_queue_push(udev_input_t *udev, struct input_device *dev,
+      const struct input_event *event, retro_perf_tick_t time, bool removed);
+#endif
+
 static bool add_device(udev_input_t *udev,
       const char *devnode, device_handle_cb cb)
 {
    int fd;
    struct stat st;
-   struct input_device **tmp;
+   int clock_id                = CLOCK_MONOTONIC;
    struct input_device *device = NULL;
-   struct epoll_event event = {0};
 
    if (stat(devnode, &st) < 0)
       return false;
@@ -288,6 +406,7 @@ static bool add_device(udev_input_t *udev,
    device->fd = fd;
    device->dev = st.st_dev;
    device->handle_cb = cb;
+   device->monotonic = ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0;
 
    strlcpy(device->devnode, devnode, sizeof(device->devnode));
 
@@ -301,16 +420,28 @@ static bool add_device(udev_input_t *udev,
       return false;
    }
 
-   tmp = (struct input_device**)realloc(udev->devices,
-         (udev->num_devices + 1) * sizeof(*udev->devices));
-
-   if (!tmp)
+   if (!register_device(udev, device))
    {
       close(fd);
       free(device);
       return false;
    }
 
+   return true;
+}
+
+static bool register_device(udev_input_t *udev,
+      struct input_device *device)
+{
+   struct input_device **tmp;
+   struct epoll_event event = {0};
+
+   tmp = (struct input_device**)realloc(udev->devices,
+         (udev->num_devices + 1) * sizeof(*udev->devices));
+
+   if (!tmp)
+      return false;
+
    tmp[udev->num_devices++] = device;
    udev->devices = tmp;
 
@@ -318,9 +449,9 @@ static bool add_device(udev_input_t *udev,
    event.data.ptr = device;
 
    /* Shouldn't happen, but just check it. */
-   if (epoll_ctl(udev->epfd, EPOLL_CTL_ADD, fd, &event) < 0)
+   if (epoll_ctl(udev->epfd, EPOLL_CTL_ADD, device->fd, &event) < 0)
       RARCH_ERR("Failed to add FD (%d) to epoll list (%s).\n",
-            fd, strerror(errno));
+            device->fd, strerror(errno));
 
    return true;
 }
@@ -333,11 +464,22 @@ static void remove_device(udev_input_t *udev, const char *devnode)
    {
       if (!strcmp(devnode, udev->devices[i]->devnode))
       {
-         close(udev->devices[i]->fd);
-         free(udev->devices[i]);
+         struct input_device *device = udev->devices[i];
+
+         close(device->fd);
          memmove(udev->devices + i, udev->devices + i + 1,
                (udev->num_devices - (i + 1)) * sizeof(*udev->devices));
          udev->num_devices--;
+
+#ifdef HAVE_THREADS
+         /* Events of the device may still be queued. */
+         if (udev->thread)
+         {
+            udev_queue_push(udev, device, NULL, 0, true);
+            continue;
+         }
+#endif
+         free(device);
       }
    }
 }
@@ -401,6 +543,274 @@ end:
    udev_device_unref(dev);
 }
 
+static void udev_read_device(udev_input_t *udev,
+      struct input_device *device, bool queue)
+{
+   int j, len;
+   struct input_event input_events[32];
+
+   while ((len = read(device->fd, input_events, sizeof(input_events))) > 0)
+   {
+      len /= sizeof(*input_events);
+      for (j = 0; j < len; j++)
+      {
+         retro_perf_tick_t time = udev_input_event_time(device,
+               &input_events[j]);
+
+#ifdef HAVE_THREADS
+         if (queue)
+         {
+            udev_queue_push(udev, device, &input_events[j], time, false);
+            continue;
+         }
+#endif
+         udev_input_apply_event(udev, device, &input_events[j], time);
+      }
+   }
+}
+
+#ifdef HAVE_THREADS
+static void udev_queue_push(udev_input_t *udev, struct input_device *dev,
+      const struct input_event *event, retro_perf_tick_t time, bool removed)
+{
+   struct udev_queued_event *entry = NULL;
+
+   /* Wait for the frontend to catch up rather than drop
+    * a key release. */
+   while (udev->queue_write - udev->queue_read >= UDEV_QUEUE_SIZE)
+   {
+      if (udev->thread_quit)
+         return;
+      rarch_sleep(1);
+   }
+
+   entry = &udev->queue[udev->queue_write & (UDEV_QUEUE_SIZE - 1)];
+   entry->dev     = dev;
+   entry->time    = time;
+   entry->removed = removed;
+   if (event)
+      entry->event = *event;
+
+   __sync_synchronize();
+   udev->queue_write++;
+}
+
+/* Applies the queued events, called from the thread
+ * input is polled from. */
+static void udev_queue_drain(udev_input_t *udev)
+{
+   unsigned i;
+   unsigned end = udev->queue_write;
+
+   __sync_synchronize();
+
+   for (i = udev->queue_read; i != end; i++)
+   {
+      struct udev_queued_event *entry =
+         &udev->queue[i & (UDEV_QUEUE_SIZE - 1)];
+
+      if (entry->removed)
+         free(entry->dev);
+      else
+         udev_input_apply_event(udev, entry->dev,
+               &entry->event, entry->time);
+   }
+
+   __sync_synchronize();
+   udev->queue_read = end;
+}
+
+/* Blocks on the devices and timestamps their events
+ * as soon as they arrive. */
+static void udev_input_thread(void *data)
+{
+   udev_input_t *udev = (udev_input_t*)data;
+
+   while (!udev->thread_quit)
+   {
+      int i;
+      struct epoll_event events[32];
+      int ret = epoll_wait(udev->epfd, events, ARRAY_SIZE(events), -1);
+
+      for (i = 0; i < ret; i++)
+      {
+         if (!(events[i].events & EPOLLIN))
+            continue;
+
+         if (events[i].data.ptr == &udev_wake_marker)
+            continue;
+
+         if (events[i].data.ptr == &udev_hotplug_marker)
+         {
+            while (hotplug_available(udev))
+               handle_hotplug(udev);
+            continue;
+         }
+
+         udev_read_device(udev,
+               (struct input_device*)events[i].data.ptr, true);
+      }
+   }
+}
+
+/* Plays back a raw evdev stream through a pipe with its original
+ * pacing, so it reaches the driver like a real device would. */
+static void udev_input_replay_thread(void *data)
+{
+   ssize_t ret;
+   struct input_event event;
+   struct timeval first = {0};
+   retro_perf_tick_t start = 0;
+   bool started            = false;
+   udev_input_t *udev      = (udev_input_t*)data;
+   FILE *file              = fopen(udev->replay_path, "rb");
+
+   if (!file)
+   {
+      RARCH_ERR("[udev]: Could not open evdev replay \"%s\".\n",
+            udev->replay_path);
+      return;
+   }
+
+   while (!udev->thread_quit
+         && fread(&event, sizeof(event), 1, file) == 1)
+   {
+      retro_perf_tick_t due, now;
+
+      if (!started)
+      {
+         first   = event.time;
+         start   = rarch_get_perf_counter();
+         started = true;
+      }
+
+      due = start + ((retro_perf_tick_t)(event.time.tv_sec - first.tv_sec)
+            * 1000000 + (event.time.tv_usec - first.tv_usec)) * 1000;
+
+      while (!udev->thread_quit && (now = rarch_get_perf_counter()) < due)
+      {
+         retro_perf_tick_t left = (due - now) / 1000000;
+         rarch_sleep(left > 10 ? 10 : (left ? (unsigned)left : 1));
+      }
+
+      /* Stamp the time of arrival, see udev_input_event_time. */
+      now                = rarch_get_perf_counter();
+      event.time.tv_sec  = now / 1000000000;
+      event.time.tv_usec = (now % 1000000000) / 1000;
+
+      /* The pipe is non-blocking, so a full pipe nobody drains
+       * any more does not keep the thread from quitting. Writes
+       * this small are atomic, they either go through or fail. */
+      while ((ret = write(udev->replay_fd, &event, sizeof(event))) < 0
+            && errno == EAGAIN && !udev->thread_quit)
+         rarch_sleep(1);
+
+      if (ret != sizeof(event))
+         break;
+   }
+
+   RARCH_LOG("[udev]: Evdev replay \"%s\" ended.\n", udev->replay_path);
+   fclose(file);
+}
+
+static bool udev_input_init_replay(udev_input_t *udev, const char *path)
+{
+   int fds[2];
+   struct input_device *device = NULL;
+
+   if (pipe(fds) < 0)
+      return false;
+
+   fcntl(fds[0], F_SETFL, O_NONBLOCK);
+   fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+   if (!(device = (struct input_device*)calloc(1, sizeof(*device))))
+      goto error;
+
+   device->fd        = fds[0];
+   device->handle_cb = udev_handle_replay;
+   device->monotonic = true;
+   strlcpy(device->devnode, path, sizeof(device->devnode));
+
+   if (!register_device(udev, device))
+      goto error;
+
+   /* The write end stays open until the driver is freed,
+    * so the end of the recording does not hang up the pipe. */
+   udev->replay_fd = fds[1];
+   strlcpy(udev->replay_path, path, sizeof(udev->replay_path));
+
+   if (!(udev->replay_thread = sthread_create(
+               udev_input_replay_thread, udev)))
+      return false;
+
+   RARCH_LOG("[udev]: Playing back evdev replay \"%s\".\n", path);
+   return true;
+
+error:
+   free(device);
+   close(fds[0]);
+   close(fds[1]);
+   return false;
+}
+
+static bool udev_input_init_thread(udev_input_t *udev)
+{
+   struct epoll_event event = {0};
+
+   if (pipe(udev->wake_fd) < 0)
+   {
+      udev->wake_fd[0] = udev->wake_fd[1] = -1;
+      return false;
+   }
+
+   event.events   = EPOLLIN;
+   event.data.ptr = &udev_wake_marker;
+   if (epoll_ctl(udev->epfd, EPOLL_CTL_ADD, udev->wake_fd[0], &event) < 0)
+      return false;
+
+   if (udev->monitor)
+   {
+      event.data.ptr = &udev_hotplug_marker;
+      epoll_ctl(udev->epfd, EPOLL_CTL_ADD,
+            udev_monitor_get_fd(udev->monitor), &event);
+   }
+
+   udev->thread = sthread_create(udev_input_thread, udev);
+   return udev->thread != NULL;
+}
+
+static void udev_input_stop_threads(udev_input_t *udev)
+{
+   udev->thread_quit = true;
+
+   if (udev->thread)
+   {
+      /* Wake it up from epoll_wait. */
+      ssize_t ret = write(udev->wake_fd[1], "", 1);
+      (void)ret;
+
+      sthread_join(udev->thread);
+      udev_queue_drain(udev);
+      udev->thread = NULL;
+   }
+
+   if (udev->replay_thread)
+   {
+      sthread_join(udev->replay_thread);
+      udev->replay_thread = NULL;
+   }
+
+   if (udev->wake_fd[0] >= 0)
+      close(udev->wake_fd[0]);
+   if (udev->wake_fd[1] >= 0)
+      close(udev->wake_fd[1]);
+   if (udev->replay_fd >= 0)
+      close(udev->replay_fd);
+   udev->wake_fd[0] = udev->wake_fd[1] = udev->replay_fd = -1;
+}
+#endif
+
 static void udev_input_poll(void *data)
 {
    int i, ret;
@@ -408,6 +818,16 @@ static void udev_input_poll(void *data)
    udev_input_t *udev = (udev_input_t*)data;
 
    udev->mouse_x = udev->mouse_y = 0;
+   udev->latency_count = 0;
+
+#ifdef HAVE_THREADS
+   if (udev->thread)
+   {
+      /* Resolve state with everything read up to now. */
+      udev_queue_drain(udev);
+      goto joypad;
+   }
+#endif
 
    while (hotplug_available(udev))
       handle_hotplug(udev);
@@ -417,20 +837,13 @@ static void udev_input_poll(void *data)
    for (i = 0; i < ret; i++)
    {
       if (events[i].events & EPOLLIN)
-      {
-         int j, len;
-         struct input_device *device = (struct input_device*)events[i].data.ptr;
-         struct input_event input_events[32];
-
-         while ((len = read(device->fd, input_events, sizeof(input_events))) > 0)
-         {
-            len /= sizeof(*input_events);
-            for (j = 0; j < len; j++)
-               device->handle_cb(udev, &input_events[j], device);
-         }
-      }
+         udev_read_device(udev,
+               (struct input_device*)events[i].data.ptr, false);
    }
 
+#ifdef HAVE_THREADS
+joypad:
+#endif
    if (udev->joypad)
       udev->joypad->poll();
 }
@@ -515,6 +928,9 @@ static int16_t udev_input_state(void *data, const struct retro_keybind **binds,
    int16_t ret;
    udev_input_t *udev = (udev_input_t*)data;
 
+   if (udev->latency_count)
+      udev_input_measure_latency(udev);
+
    switch (device)
    {
       case RETRO_DEVICE_JOYPAD:
@@ -557,6 +973,10 @@ static void udev_input_free(void *data)
    if (!data || !udev)
       return;
 
+#ifdef HAVE_THREADS
+   udev_input_stop_threads(udev);
+#endif
+
    if (udev->joypad)
       udev->joypad->destroy();
 
@@ -697,6 +1117,11 @@ static void *udev_input_init(void)
    if (!udev)
       return NULL;
 
+   udev->epfd = -1;
+#ifdef HAVE_THREADS
+   udev->wake_fd[0] = udev->wake_fd[1] = udev->replay_fd = -1;
+#endif
+
    udev->udev = udev_new();
    if (!udev->udev)
    {
@@ -801,6 +1226,20 @@ static void *udev_input_init(void)
    if (!udev->num_devices)
       RARCH_WARN("[udev]: Couldn't open any keyboard, mouse or touchpad. Are permissions set correctly for /dev/input/event*?\n");
 
+#ifdef HAVE_THREADS
+   if (*g_extern.evdev_replay &&
+         !udev_input_init_replay(udev, g_extern.evdev_replay))
+      RARCH_ERR("[udev]: Failed to start evdev replay.\n");
+
+   if (g_settings.input.threaded)
+   {
+      if (udev_input_init_thread(udev))
+         RARCH_LOG("[udev]: Reading input on a separate thread.\n");
+      else
+         RARCH_ERR("[udev]: Failed to start input thread.\n");
+   }
+#endif
+
    udev->joypad = input_joypad_init_driver(g_settings.input.joypad_driver);
    input_keymaps_init_keyboard_lut(rarch_key_map_linux);
 
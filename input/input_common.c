@@ -269,7 +269,7 @@ void input_config_parse_joy_button(config_file_t *conf, const char *prefix,
       const char *btn, struct retro_keybind *bind)
 {
    char tmp[64], key[64], key_label[64];
-   char *tmp_a = NULL;
+   const char *tmp_a = NULL;
 
    snprintf(key, sizeof(key), "%s_%s_btn", prefix, btn);
    snprintf(key_label, sizeof(key_label), "%s_%s_btn_label", prefix, btn);
@@ -288,7 +288,7 @@ void input_config_parse_joy_button(config_file_t *conf, const char *prefix,
       }
    }
 
-   if (config_get_string(conf, key_label, &tmp_a))
+   if (config_get_string_ref(conf, key_label, &tmp_a))
       strlcpy(bind->joykey_label, tmp_a, sizeof(bind->joykey_label));
 }
 
@@ -296,7 +296,7 @@ void input_config_parse_joy_axis(config_file_t *conf, const char *prefix,
       const char *axis, struct retro_keybind *bind)
 {
    char tmp[64], key[64], key_label[64];
-   char *tmp_a = NULL;
+   const char *tmp_a = NULL;
 
    snprintf(key, sizeof(key), "%s_%s_axis", prefix, axis);
    snprintf(key_label, sizeof(key_label), "%s_%s_axis_label", prefix, axis);
@@ -318,7 +318,7 @@ void input_config_parse_joy_axis(config_file_t *conf, const char *prefix,
       bind->orig_joyaxis = bind->joyaxis;
    }
 
-   if (config_get_string(conf, key_label, &tmp_a))
+   if (config_get_string_ref(conf, key_label, &tmp_a))
       strlcpy(bind->joyaxis_label, tmp_a, sizeof(bind->joyaxis_label));
 }
 
@@ -43,11 +43,228 @@
 #endif
 
 #define MAX_INCLUDE_DEPTH 16
+#define CONFIG_ARENA_BLOCK_SIZE 4096
+#define CONFIG_INDEX_MIN_SIZE 32
 
+/* Entries, keys and values are carved out of a chain of blocks
+ * owned by the config file, so that loading a config costs a
+ * handful of allocations rather than three per line. */
+struct config_arena_block
+{
+   struct config_arena_block *next;
+   size_t size;
+   size_t used;
+};
+
+struct config_index_slot
+{
+   uint32_t hash;
+   struct config_entry_list *entry;
+};
 
 static config_file_t *config_file_new_internal(const char *path, unsigned depth);
 void config_file_free(config_file_t *conf);
 
+static void *config_arena_alloc(config_file_t *conf, size_t size)
+{
+   uint8_t *data = NULL;
+   struct config_arena_block *block = conf->arena;
+   size_t header = (sizeof(*block) + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+   size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+   if (!block || block->size - block->used < size)
+   {
+      size_t block_size = size > CONFIG_ARENA_BLOCK_SIZE ?
+         size : CONFIG_ARENA_BLOCK_SIZE;
+
+      block = (struct config_arena_block*)malloc(header + block_size);
+      if (!block)
+         return NULL;
+
+      block->size = block_size;
+      block->used = 0;
+      block->next = conf->arena;
+      conf->arena = block;
+   }
+
+   data         = (uint8_t*)block + header + block->used;
+   block->used += size;
+   return data;
+}
+
+static char *config_arena_strndup(config_file_t *conf,
+      const char *str, size_t len)
+{
+   char *dst = (char*)config_arena_alloc(conf, len + 1);
+   if (!dst)
+      return NULL;
+
+   memcpy(dst, str, len);
+   dst[len] = '\0';
+   return dst;
+}
+
+static char *config_arena_strdup(config_file_t *conf, const char *str)
+{
+   return config_arena_strndup(conf, str, strlen(str));
+}
+
+/* Hands the blocks of src over to dst. */
+static void config_arena_merge(config_file_t *dst, config_file_t *src)
+{
+   struct config_arena_block *block = src->arena;
+
+   if (!block)
+      return;
+
+   while (block->next)
+      block = block->next;
+
+   block->next = dst->arena;
+   dst->arena  = src->arena;
+   src->arena  = NULL;
+}
+
+static void config_arena_free(config_file_t *conf)
+{
+   struct config_arena_block *block = conf->arena;
+
+   while (block)
+   {
+      struct config_arena_block *next = block->next;
+      free(block);
+      block = next;
+   }
+
+   conf->arena = NULL;
+}
+
+static uint32_t config_hash_key(const char *key)
+{
+   uint32_t hash = 5381;
+
+   while (*key)
+      hash = (hash << 5) + hash + (uint8_t)*key++;
+
+   return hash;
+}
+
+static struct config_index_slot *config_index_slot_find(
+      struct config_index_slot *index, size_t size,
+      uint32_t hash, const char *key)
+{
+   size_t mask = size - 1;
+   size_t i    = hash & mask;
+
+   while (index[i].entry)
+   {
+      if (index[i].hash == hash && strcmp(index[i].entry->key, key) == 0)
+         break;
+      i = (i + 1) & mask;
+   }
+
+   return &index[i];
+}
+
+static void config_index_free(config_file_t *conf)
+{
+   free(conf->index);
+   conf->index       = NULL;
+   conf->index_size  = 0;
+   conf->index_count = 0;
+}
+
+/* Adds entry unless its key is already indexed,
+ * so an earlier entry always takes priority. */
+static void config_index_insert(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   uint32_t hash = config_hash_key(entry->key);
+   struct config_index_slot *slot = config_index_slot_find(
+         conf->index, conf->index_size, hash, entry->key);
+
+   if (slot->entry)
+      return;
+
+   slot->hash  = hash;
+   slot->entry = entry;
+   conf->index_count++;
+}
+
+/**
+ * config_index_rebuild:
+ * @conf             : config file handle.
+ *
+ * Rebuilds the hash index from the entry list. If the index
+ * cannot be allocated, lookups fall back to walking the list.
+ **/
+static void config_index_rebuild(config_file_t *conf)
+{
+   size_t count = 0;
+   size_t size  = CONFIG_INDEX_MIN_SIZE;
+   struct config_entry_list *list = NULL;
+
+   config_index_free(conf);
+
+   for (list = conf->entries; list; list = list->next)
+      count++;
+
+   while (size < count * 2)
+      size *= 2;
+
+   conf->index = (struct config_index_slot*)
+      calloc(size, sizeof(*conf->index));
+   if (!conf->index)
+      return;
+
+   conf->index_size = size;
+
+   for (list = conf->entries; list; list = list->next)
+      config_index_insert(conf, list);
+}
+
+/* Indexes an entry that has just been linked into the list. */
+static void config_index_add(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   if (!conf->index || (conf->index_count + 1) * 2 > conf->index_size)
+   {
+      config_index_rebuild(conf);
+      return;
+   }
+
+   config_index_insert(conf, entry);
+}
+
+static struct config_entry_list *config_get_entry(
+      config_file_t *conf, const char *key)
+{
+   struct config_entry_list *list = NULL;
+
+   if (conf->index)
+      return config_index_slot_find(conf->index, conf->index_size,
+            config_hash_key(key), key)->entry;
+
+   for (list = conf->entries; list; list = list->next)
+      if (strcmp(key, list->key) == 0)
+         return list;
+
+   return NULL;
+}
+
+static void config_add_entry(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   if (conf->entries)
+      conf->tail->next = entry;
+   else
+      conf->entries = entry;
+
+   conf->tail = entry;
+   config_index_add(conf, entry);
+}
+
 static char *getaline(FILE *file)
 {
    char* newline = (char*)malloc(9);
@@ -82,9 +299,10 @@ static char *getaline(FILE *file)
    return newline; 
 }
 
+/* Returns a pointer into line, which is modified in place. */
 static char *extract_value(char *line, bool is_value)
 {
-   char *save = NULL, *tok = NULL;
+   char *save = NULL;
 
    if (is_value)
    {
@@ -106,19 +324,13 @@ static char *extract_value(char *line, bool is_value)
    if (*line == '"')
    {
       line++;
-      tok = strtok_r(line, "\"", &save);
-      if (!tok)
-         return NULL;
-      return strdup(tok);
+      return strtok_r(line, "\"", &save);
    }
    else if (*line == '\0') /* Nothing */
       return NULL;
 
    /* We don't have that. Read until next space. */
-   tok = strtok_r(line, " \n\t\f\r\v", &save);
-   if (tok)
-      return strdup(tok);
-   return NULL;
+   return strtok_r(line, " \n\t\f\r\v", &save);
 }
 
 static void set_list_readonly(struct config_entry_list *list)
@@ -133,35 +345,24 @@ static void set_list_readonly(struct config_entry_list *list)
 /* Move semantics? */
 static void add_child_list(config_file_t *parent, config_file_t *child)
 {
-   if (parent->entries)
-   {
-      struct config_entry_list *head = parent->entries;
-      while (head->next)
-         head = head->next;
+   struct config_entry_list *list = child->entries;
 
-      set_list_readonly(child->entries);
-      head->next = child->entries;
-   }
+   set_list_readonly(child->entries);
+
+   if (parent->entries)
+      parent->tail->next = child->entries;
    else
-   {
-      set_list_readonly(child->entries);
       parent->entries = child->entries;
-   }
 
-   child->entries = NULL;
+   if (child->tail)
+      parent->tail = child->tail;
 
-   /* Rebase tail. */
-   if (parent->entries)
-   {
-      struct config_entry_list *head = 
-         (struct config_entry_list*)parent->entries;
+   for (; list; list = list->next)
+      config_index_add(parent, list);
 
-      while (head->next)
-         head = head->next;
-      parent->tail = head;
-   }
-   else
-      parent->tail = NULL;
+   config_arena_merge(parent, child);
+   child->entries = NULL;
+   child->tail    = NULL;
 }
 
 static void add_include_list(config_file_t *conf, const char *path)
@@ -215,15 +416,11 @@ static void add_sub_conf(config_file_t *conf, char *line)
    sub_conf = (config_file_t*)
       config_file_new_internal(real_path, conf->include_depth + 1);
    if (!sub_conf)
-   {
-      free(path);
       return;
-   }
 
    /* Pilfer internal list. */
    add_child_list(conf, sub_conf);
    config_file_free(sub_conf);
-   free(path);
 }
 
 static char *strip_comment(char *str)
@@ -265,23 +462,16 @@ static char *strip_comment(char *str)
    return str;
 }
 
-static bool parse_line(config_file_t *conf,
-      struct config_entry_list *list, char *line)
+static bool parse_line(config_file_t *conf, char *line)
 {
-   char* comment = NULL;
-   char* key = (char*)malloc(9);
-   char* key_tmp = NULL;
-   size_t cur_size = 8;
-   size_t idx = 0;
-
-   if (!key)
-      return false;
+   char *comment = NULL;
+   char *key     = NULL;
+   char *value   = NULL;
+   size_t key_len;
+   struct config_entry_list *list = NULL;
 
    if (!line || !*line)
-   {
-      free(key);
       return false;
-   }
 
    comment = strip_comment(line);
 
@@ -292,7 +482,6 @@ static bool parse_line(config_file_t *conf,
       if (strstr(comment, "include ") == comment)
       {
          add_sub_conf(conf, comment + strlen("include "));
-         free(key);
          return false;
       }
    }
@@ -305,35 +494,27 @@ static bool parse_line(config_file_t *conf,
    while (isspace(*line))
       line++;
 
+   key = line;
    while (isgraph(*line))
-   {
-      if (idx == cur_size)
-      {
-         cur_size *= 2;
-         key_tmp = (char*)realloc(key, cur_size + 1);
-
-         if (!key_tmp)
-         {
-            free(key);
-            return false;
-         }
+      line++;
+   key_len = line - key;
 
-         key = key_tmp;
-      }
+   value = extract_value(line, true);
+   if (!value)
+      return false;
 
-      key[idx++] = *line++;
-   }
-   key[idx] = '\0';
-   list->key = key;
+   list = (struct config_entry_list*)config_arena_alloc(conf, sizeof(*list));
+   if (!list)
+      return false;
 
-   list->value = extract_value(line, true);
-   if (!list->value)
-   {
-      list->key = NULL;
-      free(key);
+   memset(list, 0, sizeof(*list));
+   list->key        = config_arena_strndup(conf, key, key_len);
+   list->value      = config_arena_strdup(conf, value);
+   if (!list->key || !list->value)
       return false;
-   }
+   list->value_size = strlen(list->value) + 1;
 
+   config_add_entry(conf, list);
    return true;
 }
 
@@ -346,10 +527,16 @@ bool config_append_file(config_file_t *conf, const char *path)
    if (new_conf->tail)
    {
       new_conf->tail->next = conf->entries;
+      if (!conf->entries)
+         conf->tail = new_conf->tail;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
+      new_conf->tail       = NULL;
+
+      config_index_rebuild(conf);
    }
 
+   config_arena_merge(conf, new_conf);
    config_file_free(new_conf);
    return true;
 }
@@ -384,36 +571,17 @@ static config_file_t *config_file_new_internal(
 
    while (!feof(file))
    {
-      struct config_entry_list *list = (struct config_entry_list*)
-         calloc(1, sizeof(*list));
-      char *line = NULL;
+      char *line = getaline(file);
 
-      if (!list)
+      if (!line)
       {
          config_file_free(conf);
          fclose(file);
          return NULL;
       }
 
-      line = getaline(file);
-
-      if (line)
-      {
-         if (parse_line(conf, list, line))
-         {
-            if (conf->entries)
-               conf->tail->next = list;
-            else
-               conf->entries = list;
-
-            conf->tail = list;
-         }
-
-         free(line);
-      }
-
-      if (list != conf->tail)
-         free(list);
+      parse_line(conf, line);
+      free(line);
    }
    fclose(file);
 
@@ -439,34 +607,7 @@ config_file_t *config_file_new_from_string(const char *from_string)
       return conf;
 
    for (i = 0; i < lines->size; i++)
-   {
-      struct config_entry_list *list = (struct config_entry_list*)
-         calloc(1, sizeof(*list));
-      char* line = lines->elems[i].data;
-
-      if (!list)
-      {
-         string_list_free(lines);
-         config_file_free(conf);
-         return NULL;
-      }
-
-      if (line)
-      {
-         if (parse_line(conf, list, line))
-         {
-            if (conf->entries)
-               conf->tail->next = list;
-            else
-               conf->entries = list;
-
-            conf->tail = list;
-         }
-      }
-
-      if (list != conf->tail)
-         free(list);
-   }
+      parse_line(conf, lines->elems[i].data);
 
    string_list_free(lines);
 
@@ -481,20 +622,11 @@ config_file_t *config_file_new(const char *path)
 void config_file_free(config_file_t *conf)
 {
    struct config_include_list *inc_tmp = NULL;
-   struct config_entry_list *tmp = NULL;
    if (!conf)
       return;
 
-   tmp = conf->entries;
-   while (tmp)
-   {
-      struct config_entry_list *hold = NULL;
-      free(tmp->key);
-      free(tmp->value);
-      hold = tmp;
-      tmp = tmp->next;
-      free(hold);
-   }
+   config_index_free(conf);
+   config_arena_free(conf);
 
    inc_tmp = (struct config_include_list*)conf->includes;
    while (inc_tmp)
@@ -512,176 +644,141 @@ void config_file_free(config_file_t *conf)
 
 bool config_get_double(config_file_t *conf, const char *key, double *in)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         *in = strtod(list->value, NULL);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   *in = strtod(list->value, NULL);
+   return true;
 }
 
 bool config_get_float(config_file_t *conf, const char *key, float *in)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         /* strtof() is C99/POSIX. Just use the more portable kind. */
-         *in = (float)strtod(list->value, NULL);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   /* strtof() is C99/POSIX. Just use the more portable kind. */
+   *in = (float)strtod(list->value, NULL);
+   return true;
 }
 
 bool config_get_int(config_file_t *conf, const char *key, int *in)
 {
-   struct config_entry_list *list = conf->entries;
+   int val;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         int val;
-         errno = 0;
-         val = strtol(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   errno = 0;
+   val = strtol(list->value, NULL, 0);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 {
-   struct config_entry_list *list = conf->entries;
+   uint64_t val;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         uint64_t val;
-         errno = 0;
-         val = strtoull(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   errno = 0;
+   val = strtoull(list->value, NULL, 0);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 {
-   struct config_entry_list *list = conf->entries;
+   unsigned val;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list != NULL)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         unsigned val;
-         errno = 0;
-         val = strtoul(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
+   if (!list)
+      return false;
+
+   errno = 0;
+   val = strtoul(list->value, NULL, 0);
+   if (errno != 0)
+      return false;
 
-   return false;
+   *in = val;
+   return true;
 }
 
 bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 {
-   struct config_entry_list *list = conf->entries;
+   unsigned val;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         unsigned val;
-         errno = 0;
-         val = strtoul(list->value, NULL, 16);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   errno = 0;
+   val = strtoul(list->value, NULL, 16);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_char(config_file_t *conf, const char *key, char *in)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         if (list->value[0] && list->value[1])
-            return false;
-         *in = *list->value;
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   if (list->value[0] && list->value[1])
+      return false;
+
+   *in = *list->value;
+   return true;
 }
 
 bool config_get_string(config_file_t *conf, const char *key, char **str)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         *str = strdup(list->value);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   *str = strdup(list->value);
+   return true;
+}
+
+bool config_get_string_ref(config_file_t *conf, const char *key,
+      const char **str)
+{
+   const struct config_entry_list *list = config_get_entry(conf, key);
+
+   if (!list)
+      return false;
+
+   *str = list->value;
+   return true;
 }
 
 bool config_get_array(config_file_t *conf, const char *key,
       char *buf, size_t size)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-         return strlcpy(buf, list->value, size) < size;
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   return strlcpy(buf, list->value, size) < size;
 }
 
 bool config_get_path(config_file_t *conf, const char *key,
@@ -690,77 +787,88 @@ bool config_get_path(config_file_t *conf, const char *key,
 #if defined(RARCH_CONSOLE)
    return config_get_array(conf, key, buf, size);
 #else
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         fill_pathname_expand_special(buf, list->value, size);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   fill_pathname_expand_special(buf, list->value, size);
+   return true;
 #endif
 }
 
 bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *list = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         if (strcasecmp(list->value, "true") == 0)
-            *in = true;
-         else if (strcasecmp(list->value, "1") == 0)
-            *in = true;
-         else if (strcasecmp(list->value, "false") == 0)
-            *in = false;
-         else if (strcasecmp(list->value, "0") == 0)
-            *in = false;
-         else
-            return false;
-
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!list)
+      return false;
+
+   if (strcasecmp(list->value, "true") == 0)
+      *in = true;
+   else if (strcasecmp(list->value, "1") == 0)
+      *in = true;
+   else if (strcasecmp(list->value, "false") == 0)
+      *in = false;
+   else if (strcasecmp(list->value, "0") == 0)
+      *in = false;
+   else
+      return false;
+
+   return true;
 }
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
-   struct config_entry_list *elem = NULL;
-   struct config_entry_list *list = conf->entries;
-   struct config_entry_list *last = list;
-   while (list)
+   size_t len = strlen(val);
+   struct config_entry_list *list = config_get_entry(conf, key);
+
+   /* The indexed entry is the first one with this key. If it came
+    * from an #include, look further down for a writable one. */
+   if (list && list->readonly)
+   {
+      for (list = list->next; list; list = list->next)
+         if (!list->readonly && strcmp(key, list->key) == 0)
+            break;
+   }
+
+   if (list)
    {
-      if (!list->readonly && (strcmp(key, list->key) == 0))
+      char *value = list->value;
+
+      /* Reuse the old storage if the new value fits in it. When it
+       * does not, at least double it, so that a key rewritten over
+       * and over costs the arena a bounded amount however its
+       * length changes. The old block stays in the arena. */
+      if (len + 1 > list->value_size)
       {
-         free(list->value);
-         list->value = strdup(val);
-         return;
+         size_t size = list->value_size * 2;
+         if (size < len + 1)
+            size = len + 1;
+
+         value = (char*)config_arena_alloc(conf, size);
+         if (!value)
+            return;
+         list->value_size = size;
       }
 
-      last = list;
-      list = list->next;
+      memmove(value, val, len + 1);
+      list->value = value;
+      return;
    }
 
-   elem = (struct config_entry_list*)calloc(1, sizeof(*elem));
-
-   if (!elem)
+   list = (struct config_entry_list*)config_arena_alloc(conf, sizeof(*list));
+   if (!list)
       return;
 
-   elem->key = strdup(key);
-   elem->value = strdup(val);
+   memset(list, 0, sizeof(*list));
+   list->key        = config_arena_strdup(conf, key);
+   list->value      = config_arena_strndup(conf, val, len);
+   if (!list->key || !list->value)
+      return;
+   list->value_size = len + 1;
 
-   if (last)
-      last->next = elem;
-   else
-      conf->entries = elem;
+   config_add_entry(conf, list);
 }
 
 void config_set_path(config_file_t *conf, const char *entry, const char *val)
@@ -871,16 +979,7 @@ void config_file_dump(config_file_t *conf, FILE *file)
 
 bool config_entry_exists(config_file_t *conf, const char *entry)
 {
-   struct config_entry_list *list = conf->entries;
-
-   while (list)
-   {
-      if (strcmp(entry, list->key) == 0)
-         return true;
-      list = list->next;
-   }
-
-   return false;
+   return config_get_entry(conf, entry) != NULL;
 }
 
 bool config_get_entry_list_head(config_file_t *conf,
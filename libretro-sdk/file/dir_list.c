@@ -134,7 +134,7 @@ static bool dirent_is_directory(const char *path,
  * @is_dir       : is the directory listing a directory?
  * @include_dirs : include directories as part of the finished directory listing?
  * @list         : pointer to directory listing.
- * @ext_list     : pointer to allowed file extensions listing.
+ * @ext_set      : pointer to set of allowed file extensions.
  * @file_ext     : file extension of the directory listing entry.
  *
  * Parses a directory listing.
@@ -144,7 +144,7 @@ static bool dirent_is_directory(const char *path,
  **/
 static int parse_dir_entry(const char *name, char *file_path,
       bool is_dir, bool include_dirs,
-      struct string_list *list, struct string_list *ext_list,
+      struct string_list *list, const struct string_ext_set *ext_set,
       const char *file_ext)
 {
    union string_list_elem_attr attr;
@@ -156,7 +156,7 @@ static int parse_dir_entry(const char *name, char *file_path,
    if (!is_dir)
    {
       is_compressed_file = path_is_compressed_file(file_path);
-      if (string_list_find_elem_prefix(ext_list, ".", file_ext))
+      if (string_ext_set_find(ext_set, file_ext))
          supported_by_core = true;
    }
 
@@ -166,7 +166,7 @@ static int parse_dir_entry(const char *name, char *file_path,
    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
       return 1;
 
-   if (!is_compressed_file && !is_dir && ext_list && !supported_by_core)
+   if (!is_compressed_file && !is_dir && ext_set && !supported_by_core)
       return 1;
 
    if (is_dir)
@@ -191,21 +191,51 @@ static int parse_dir_entry(const char *name, char *file_path,
 }
 
 /**
- * dir_list_new:
+ * dir_list_flush:
+ * @list         : pointer to the current batch, replaced by a new one.
+ * @cb           : batch callback.
+ * @userdata     : userdata passed to @cb.
+ *
+ * Hands the current batch over to @cb and starts a new one.
+ *
+ * Returns: true if reading should go on, otherwise false.
+ **/
+static bool dir_list_flush(struct string_list **list,
+      dir_list_batch_cb_t cb, void *userdata)
+{
+   struct string_list *batch = *list;
+
+   if (!(*list = string_list_new()))
+   {
+      string_list_free(batch);
+      return false;
+   }
+
+   return cb(batch, userdata);
+}
+
+/**
+ * dir_list_read:
  * @dir          : directory path.
  * @ext          : allowed extensions of file directory entries to include.
  * @include_dirs : include directories as part of the finished directory listing?
+ * @batch_size   : number of entries per batch, 0 to pass all entries at once.
+ * @cb           : called with each batch of entries, takes ownership of it.
+ *                 Returns false to stop reading.
+ * @userdata     : userdata passed to @cb.
  *
- * Create a directory listing.
+ * Reads a directory listing in batches, as the directory is read.
+ * The last batch, which may be empty, is passed once the whole
+ * directory has been read.
  *
- * Returns: pointer to a directory listing of type 'struct string_list *' on success,
- * NULL in case of error. Has to be freed manually.
+ * Returns: true (1) if the whole directory was read, otherwise false (0).
  **/
-struct string_list *dir_list_new(const char *dir,
-      const char *ext, bool include_dirs)
+bool dir_list_read(const char *dir, const char *ext, bool include_dirs,
+      size_t batch_size, dir_list_batch_cb_t cb, void *userdata)
 {
    char path_buf[PATH_MAX_LENGTH];
-   struct string_list *ext_list, *list;
+   struct string_ext_set *ext_set = NULL;
+   struct string_list *list;
 #ifdef _WIN32
    WIN32_FIND_DATA ffd;
    HANDLE hFind = INVALID_HANDLE_VALUE;
@@ -214,14 +244,21 @@ struct string_list *dir_list_new(const char *dir,
    const struct dirent *entry = NULL;
 #endif
 
-   ext_list = NULL;
    (void)path_buf;
 
    if (!(list = string_list_new()))
-      return NULL;
+      return false;
 
    if (ext)
-      ext_list = string_split(ext, "|");
+   {
+      struct string_list *ext_list = string_split(ext, "|");
+
+      ext_set = string_ext_set_new(ext_list);
+      string_list_free(ext_list);
+
+      if (!ext_set)
+         goto error;
+   }
 
 #ifdef _WIN32
    snprintf(path_buf, sizeof(path_buf), "%s\\*", dir);
@@ -241,18 +278,22 @@ struct string_list *dir_list_new(const char *dir,
       fill_pathname_join(file_path, dir, name, sizeof(file_path));
 
       ret = parse_dir_entry(name, file_path, is_dir,
-            include_dirs, list, ext_list, file_ext);
+            include_dirs, list, ext_set, file_ext);
 
       if (ret == -1)
          goto error;
 
       if (ret == 1)
          continue;
+
+      if (batch_size && list->size >= batch_size
+            && !dir_list_flush(&list, cb, userdata))
+         goto error;
    }while (FindNextFile(hFind, &ffd) != 0);
 
    FindClose(hFind);
-   string_list_free(ext_list);
-   return list;
+   string_ext_set_free(ext_set);
+   return cb(list, userdata);
 
 error:
    if (hFind != INVALID_HANDLE_VALUE)
@@ -275,19 +316,23 @@ error:
       is_dir = dirent_is_directory(file_path, entry);
 
       ret = parse_dir_entry(name, file_path, is_dir,
-            include_dirs, list, ext_list, file_ext);
+            include_dirs, list, ext_set, file_ext);
 
       if (ret == -1)
          goto error;
 
       if (ret == 1)
          continue;
+
+      if (batch_size && list->size >= batch_size
+            && !dir_list_flush(&list, cb, userdata))
+         goto error;
    }
 
    closedir(directory);
 
-   string_list_free(ext_list);
-   return list;
+   string_ext_set_free(ext_set);
+   return cb(list, userdata);
 
 error:
 
@@ -296,6 +341,34 @@ error:
 
 #endif
    string_list_free(list);
-   string_list_free(ext_list);
-   return NULL;
+   string_ext_set_free(ext_set);
+   return false;
+}
+
+static bool dir_list_new_cb(struct string_list *list, void *userdata)
+{
+   *(struct string_list**)userdata = list;
+   return true;
+}
+
+/**
+ * dir_list_new:
+ * @dir          : directory path.
+ * @ext          : allowed extensions of file directory entries to include.
+ * @include_dirs : include directories as part of the finished directory listing?
+ *
+ * Create a directory listing.
+ *
+ * Returns: pointer to a directory listing of type 'struct string_list *' on success,
+ * NULL in case of error. Has to be freed manually.
+ **/
+struct string_list *dir_list_new(const char *dir,
+      const char *ext, bool include_dirs)
+{
+   struct string_list *list = NULL;
+
+   if (!dir_list_read(dir, ext, include_dirs, 0, dir_list_new_cb, &list))
+      return NULL;
+
+   return list;
 }
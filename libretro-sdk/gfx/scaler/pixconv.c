@@ -20,7 +20,9 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+
 #include <gfx/scaler/pixconv.h>
+#include <retro_inline.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,46 +32,33 @@
 #undef __SSE2__
 #endif
 
-#if defined(__SSE2__)
-#include <emmintrin.h>
+/* With GCC and Clang, SIMD versions are built for their instruction
+ * set regardless of compiler flags and picked by conv_init_simd.
+ * Other compilers only get those enabled at compile time. */
+#if !defined(SCALER_NO_SIMD) && (defined(__i386__) || defined(__x86_64__)) \
+   && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define PIXCONV_HAVE_SSE2
+#define PIXCONV_HAVE_AVX2
+#define PIXCONV_SSE2_TARGET __attribute__((target("sse2")))
+#define PIXCONV_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(__SSE2__)
+#define PIXCONV_HAVE_SSE2
+#define PIXCONV_SSE2_TARGET
+#ifdef __AVX2__
+#define PIXCONV_HAVE_AVX2
+#define PIXCONV_AVX2_TARGET
+#endif
 #endif
 
-#if defined(__SSE2_)
-void conv_rgb565_0rgb1555(void *output_, const void *input_,
-      int width, int height,
-      int out_stride, int in_stride)
-{
-   int h, w;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint16_t *output = (uint16_t*)output_;
-
-   int max_width = width - 7;
-
-   const __m128i hi_mask   = _mm_set1_epi16(0x7fe0);
-   const __m128i lo_mask   = _mm_set1_epi16(0x1f);
+#if defined(PIXCONV_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
 
-   for (h = 0; h < height;
-         h++, output += out_stride >> 1, input += in_stride >> 1)
-   {
-      for (w = 0; w < max_width; w += 8)
-      {
-         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
-         __m128i lo = _mm_and_si128(in, lo_mask);
-         _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
-      }
+#if defined(PIXCONV_HAVE_AVX2)
+#include <immintrin.h>
+#endif
 
-      for (; w < width; w++)
-      {
-         uint16_t col = input[w];
-         uint16_t hi = (col >> 1) & 0x7fe0;
-         uint16_t lo = col & 0x1f;
-         output[w] = hi | lo;
-      }
-   }
-}
-#else
-void conv_rgb565_0rgb1555(void *output_, const void *input_,
+static void conv_rgb565_0rgb1555_C(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -90,49 +79,8 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
    }
 }
 
-#endif
-
-#if defined(__SSE2__)
-void conv_0rgb1555_rgb565(void *output_, const void *input_,
-      int width, int height,
-      int out_stride, int in_stride)
-{
-   int h, w;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint16_t *output = (uint16_t*)output_;
-
-   int max_width = width - 7;
-
-   const __m128i hi_mask   = _mm_set1_epi16(
-         (int16_t)((0x1f << 11) | (0x1f << 6)));
-   const __m128i lo_mask   = _mm_set1_epi16(0x1f);
-   const __m128i glow_mask = _mm_set1_epi16(1 << 5);
-
-   for (h = 0; h < height;
-         h++, output += out_stride >> 1, input += in_stride >> 1)
-   {
-      for (w = 0; w < max_width; w += 8)
-      {
-         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i rg   = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
-         __m128i b    = _mm_and_si128(in, lo_mask);
-         __m128i glow = _mm_and_si128(_mm_srli_epi16(in, 4), glow_mask);
-         _mm_storeu_si128((__m128i*)(output + w),
-               _mm_or_si128(rg, _mm_or_si128(b, glow)));
-      }
 
-      for (; w < width; w++)
-      {
-         uint16_t col = input[w];
-         uint16_t rg = (col << 1) & ((0x1f << 11) | (0x1f << 6));
-         uint16_t b = col & 0x1f;
-         uint16_t glow = (col >> 4) & (1 << 5);
-         output[w] = rg | b | glow;
-      }
-   }
-}
-#else
-void conv_0rgb1555_rgb565(void *output_, const void *input_,
+static void conv_0rgb1555_rgb565_C(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -153,10 +101,8 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
       }
    }
 }
-#endif
 
-#if defined(__SSE2__)
-void conv_0rgb1555_argb8888(void *output_, const void *input_,
+static void conv_0rgb1555_argb8888_C(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -164,43 +110,10 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
    const uint16_t *input = (const uint16_t*)input_;
    uint32_t *output      = (uint32_t*)output_;
 
-   const __m128i pix_mask_r  = _mm_set1_epi16(0x1f << 10);
-   const __m128i pix_mask_gb = _mm_set1_epi16(0x1f <<  5);
-   const __m128i mul15_mid   = _mm_set1_epi16(0x4200);
-   const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
-   const __m128i a           = _mm_set1_epi16(0x00ff);
-
-   int max_width = width - 7;
-
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 1)
    {
-      for (w = 0; w < max_width; w += 8)
-      {
-         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i r = _mm_and_si128(in, pix_mask_r);
-         __m128i g = _mm_and_si128(in, pix_mask_gb);
-         __m128i b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_gb);
-
-         r = _mm_mulhi_epi16(r, mul15_hi);
-         g = _mm_mulhi_epi16(g, mul15_mid);
-         b = _mm_mulhi_epi16(b, mul15_mid);
-
-         __m128i res_lo_bg = _mm_unpacklo_epi8(b, g);
-         __m128i res_hi_bg = _mm_unpackhi_epi8(b, g);
-         __m128i res_lo_ra = _mm_unpacklo_epi8(r, a);
-         __m128i res_hi_ra = _mm_unpackhi_epi8(r, a);
-
-         __m128i res_lo = _mm_or_si128(res_lo_bg,
-               _mm_slli_si128(res_lo_ra, 2));
-         __m128i res_hi = _mm_or_si128(res_hi_bg,
-               _mm_slli_si128(res_hi_ra, 2));
-
-         _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
-         _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
-      }
-
-      for (; w < width; w++)
+      for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
          uint32_t r = (col >> 10) & 0x1f;
@@ -210,12 +123,12 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
          g = (g << 3) | (g >> 2);
          b = (b << 3) | (b >> 2);
 
-         output[w] = (0xff << 24) | (r << 16) | (g << 8) | (b << 0);
+         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
       }
    }
 }
-#else
-void conv_0rgb1555_argb8888(void *output_, const void *input_,
+
+static void conv_rgb565_argb8888_C(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -229,21 +142,19 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
       for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r = (col >> 10) & 0x1f;
-         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t r = (col >> 11) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
          uint32_t b = (col >>  0) & 0x1f;
          r = (r << 3) | (r >> 2);
-         g = (g << 3) | (g >> 2);
+         g = (g << 2) | (g >> 4);
          b = (b << 3) | (b >> 2);
 
          output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
       }
    }
 }
-#endif
 
-#if defined(__SSE2__)
-void conv_rgb565_argb8888(void *output_, const void *input_,
+static void conv_rgba4444_argb8888_C(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
@@ -251,669 +162,1523 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
    const uint16_t *input = (const uint16_t*)input_;
    uint32_t *output      = (uint32_t*)output_;
 
-   const __m128i pix_mask_r = _mm_set1_epi16(0x1f << 10);
-   const __m128i pix_mask_g = _mm_set1_epi16(0x3f <<  5);
-   const __m128i pix_mask_b = _mm_set1_epi16(0x1f <<  5);
-   const __m128i mul16_r    = _mm_set1_epi16(0x0210);
-   const __m128i mul16_g    = _mm_set1_epi16(0x2080);
-   const __m128i mul16_b    = _mm_set1_epi16(0x4200);
-   const __m128i a          = _mm_set1_epi16(0x00ff);
-
-   int max_width = width - 7;
-
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 1)
    {
-      for (w = 0; w < max_width; w += 8)
+      for (w = 0; w < width; w++)
       {
-         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i r = _mm_and_si128(_mm_srli_epi16(in, 1), pix_mask_r);
-         __m128i g = _mm_and_si128(in, pix_mask_g);
-         __m128i b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_b);
-
-         r = _mm_mulhi_epi16(r, mul16_r);
-         g = _mm_mulhi_epi16(g, mul16_g);
-         b = _mm_mulhi_epi16(b, mul16_b);
-
-         __m128i res_lo_bg = _mm_unpacklo_epi8(b, g);
-         __m128i res_hi_bg = _mm_unpackhi_epi8(b, g);
-         __m128i res_lo_ra = _mm_unpacklo_epi8(r, a);
-         __m128i res_hi_ra = _mm_unpackhi_epi8(r, a);
-
-         __m128i res_lo = _mm_or_si128(res_lo_bg,
-               _mm_slli_si128(res_lo_ra, 2));
-         __m128i res_hi = _mm_or_si128(res_hi_bg,
-               _mm_slli_si128(res_hi_ra, 2));
+         uint32_t col = input[w];
+         uint32_t r = (col >> 12) & 0xf;
+         uint32_t g = (col >>  8) & 0xf;
+         uint32_t b = (col >>  4) & 0xf;
+         uint32_t a = (col >>  0) & 0xf;
+         r = (r << 4) | r;
+         g = (g << 4) | g;
+         b = (b << 4) | b;
+         a = (a << 4) | a;
 
-         _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
-         _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
+         output[w] = (a << 24) | (r << 16) | (g << 8) | (b << 0);
       }
+   }
+}
 
-      for (; w < width; w++)
+static void conv_0rgb1555_bgr24_C(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+      for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r = (col >> 11) & 0x1f;
-         uint32_t g = (col >>  5) & 0x3f;
          uint32_t b = (col >>  0) & 0x1f;
-         r = (r << 3) | (r >> 2);
-         g = (g << 2) | (g >> 4);
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t r = (col >> 10) & 0x1f;
          b = (b << 3) | (b >> 2);
+         g = (g << 3) | (g >> 2);
+         r = (r << 3) | (r >> 2);
 
-         output[w] = (0xff << 24) | (r << 16) | (g << 8) | (b << 0);
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
       }
    }
 }
-#else
-void conv_rgb565_argb8888(void *output_, const void *input_,
+
+static void conv_rgb565_bgr24_C(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint16_t *input = (const uint16_t*)input_;
-   uint32_t *output      = (uint32_t*)output_;
+   uint8_t *output       = (uint8_t*)output_;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride >> 1)
+         h++, output += out_stride, input += in_stride >> 1)
    {
+      uint8_t *out = output;
       for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r = (col >> 11) & 0x1f;
-         uint32_t g = (col >>  5) & 0x3f;
          uint32_t b = (col >>  0) & 0x1f;
-         r = (r << 3) | (r >> 2);
-         g = (g << 2) | (g >> 4);
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t r = (col >> 11) & 0x1f;
          b = (b << 3) | (b >> 2);
+         g = (g << 2) | (g >> 4);
+         r = (r << 3) | (r >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
+
+static void conv_bgr24_argb8888_C(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
 
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *inp = input;
+      for (w = 0; w < width; w++)
+      {
+         uint32_t b = *inp++;
+         uint32_t g = *inp++;
+         uint32_t r = *inp++;
          output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
       }
    }
 }
-#endif
 
-void conv_rgba4444_argb8888(void *output_, const void *input_,
+static void conv_argb8888_0rgb1555_C(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint32_t *output      = (uint32_t*)output_;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride >> 1)
+         h++, output += out_stride >> 1, input += in_stride >> 2)
    {
       for (w = 0; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r = (col >> 12) & 0xf;
-         uint32_t g = (col >>  8) & 0xf;
-         uint32_t b = (col >>  4) & 0xf;
-         uint32_t a = (col >>  0) & 0xf;
-         r = (r << 4) | r;
-         g = (g << 4) | g;
-         b = (b << 4) | b;
-         a = (a << 4) | a;
-
-         output[w] = (a << 24) | (r << 16) | (g << 8) | (b << 0);
+         uint16_t r = (col >> 19) & 0x1f;
+         uint16_t g = (col >> 11) & 0x1f;
+         uint16_t b = (col >>  3) & 0x1f;
+         output[w] = (r << 10) | (g << 5) | (b << 0);
       }
    }
 }
 
-#if defined(__SSE2__)
-/* :( TODO: Make this saner. */
-static inline void store_bgr24_sse2(void *output, __m128i a,
-      __m128i b, __m128i c, __m128i d)
+static void conv_argb8888_rgb565_C(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
 {
-   const __m128i mask_0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
-   const __m128i mask_1 = _mm_set_epi32(0, 0, 0x00ffffff, 0);
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      for (w = 0; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint16_t r = (col >> 19) & 0x1f;
+         uint16_t g = (col >> 10) & 0x3f;
+         uint16_t b = (col >>  3) & 0x1f;
+         output[w] = (r << 11) | (g << 5) | (b << 0);
+      }
+   }
+}
+
+static void conv_argb8888_bgr24_C(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 2)
+   {
+      uint8_t *out = output;
+      for (w = 0; w < width; w++)
+      {
+         uint32_t col = input[w];
+         *out++ = (uint8_t)(col >>  0);
+         *out++ = (uint8_t)(col >>  8);
+         *out++ = (uint8_t)(col >> 16);
+      }
+   }
+}
+
+static void conv_argb8888_abgr8888_C(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 2)
+   {
+      for (w = 0; w < width; w++)
+      {
+         uint32_t col = input[w];
+         output[w] = ((col << 16) & 0xff0000) | 
+            ((col >> 16) & 0xff) | (col & 0xff00ff00);
+      }
+   }
+}
+
+#define YUV_SHIFT 6
+#define YUV_OFFSET (1 << (YUV_SHIFT - 1))
+#define YUV_MAT_Y (1 << 6)
+#define YUV_MAT_U_G (-22)
+#define YUV_MAT_U_B (113)
+#define YUV_MAT_V_R (90)
+#define YUV_MAT_V_G (-46)
+
+static void conv_yuyv_argb8888_C(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t *dst = output;
+
+      for (w = 0; w < width; w += 2, src += 4, dst += 2)
+      {
+         int _y0 = src[0];
+         int  u = src[1] - 128;
+         int _y1 = src[2];
+         int  v = src[3] - 128;
+
+         uint8_t r0 = clamp_8bit((YUV_MAT_Y * _y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         uint8_t r1 = clamp_8bit((YUV_MAT_Y * _y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
+         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
+      }
+   }
+}
+
+#ifdef PIXCONV_HAVE_SSE2
+static PIXCONV_SSE2_TARGET void conv_rgb565_0rgb1555_SSE2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output = (uint16_t*)output_;
+
+   int max_width = width - 7;
+
+   const __m128i hi_mask   = _mm_set1_epi16(0x7fe0);
+   const __m128i lo_mask   = _mm_set1_epi16(0x1f);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
+         __m128i lo = _mm_and_si128(in, lo_mask);
+         _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
+      }
+
+      for (; w < width; w++)
+      {
+         uint16_t col = input[w];
+         uint16_t hi = (col >> 1) & 0x7fe0;
+         uint16_t lo = col & 0x1f;
+         output[w] = hi | lo;
+      }
+   }
+}
+
+static PIXCONV_SSE2_TARGET void conv_0rgb1555_rgb565_SSE2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output = (uint16_t*)output_;
+
+   int max_width = width - 7;
+
+   const __m128i hi_mask   = _mm_set1_epi16(
+         (int16_t)((0x1f << 11) | (0x1f << 6)));
+   const __m128i lo_mask   = _mm_set1_epi16(0x1f);
+   const __m128i glow_mask = _mm_set1_epi16(1 << 5);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         __m128i rg   = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+         __m128i b    = _mm_and_si128(in, lo_mask);
+         __m128i glow = _mm_and_si128(_mm_srli_epi16(in, 4), glow_mask);
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_or_si128(rg, _mm_or_si128(b, glow)));
+      }
+
+      for (; w < width; w++)
+      {
+         uint16_t col = input[w];
+         uint16_t rg = (col << 1) & ((0x1f << 11) | (0x1f << 6));
+         uint16_t b = col & 0x1f;
+         uint16_t glow = (col >> 4) & (1 << 5);
+         output[w] = rg | b | glow;
+      }
+   }
+}
+
+static PIXCONV_SSE2_TARGET void conv_0rgb1555_argb8888_SSE2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m128i pix_mask_r  = _mm_set1_epi16(0x1f << 10);
+   const __m128i pix_mask_gb = _mm_set1_epi16(0x1f <<  5);
+   const __m128i mul15_mid   = _mm_set1_epi16(0x4200);
+   const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
+   const __m128i a           = _mm_set1_epi16(0x00ff);
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         __m128i r = _mm_and_si128(in, pix_mask_r);
+         __m128i g = _mm_and_si128(in, pix_mask_gb);
+         __m128i b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_gb);
+
+         r = _mm_mulhi_epi16(r, mul15_hi);
+         g = _mm_mulhi_epi16(g, mul15_mid);
+         b = _mm_mulhi_epi16(b, mul15_mid);
+
+         __m128i res_lo_bg = _mm_unpacklo_epi8(b, g);
+         __m128i res_hi_bg = _mm_unpackhi_epi8(b, g);
+         __m128i res_lo_ra = _mm_unpacklo_epi8(r, a);
+         __m128i res_hi_ra = _mm_unpackhi_epi8(r, a);
+
+         __m128i res_lo = _mm_or_si128(res_lo_bg,
+               _mm_slli_si128(res_lo_ra, 2));
+         __m128i res_hi = _mm_or_si128(res_hi_bg,
+               _mm_slli_si128(res_hi_ra, 2));
+
+         _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
+         _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t r = (col >> 10) & 0x1f;
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t b = (col >>  0) & 0x1f;
+         r = (r << 3) | (r >> 2);
+         g = (g << 3) | (g >> 2);
+         b = (b << 3) | (b >> 2);
+
+         output[w] = (0xff << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+
+static PIXCONV_SSE2_TARGET void conv_rgb565_argb8888_SSE2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m128i pix_mask_r = _mm_set1_epi16(0x1f << 10);
+   const __m128i pix_mask_g = _mm_set1_epi16(0x3f <<  5);
+   const __m128i pix_mask_b = _mm_set1_epi16(0x1f <<  5);
+   const __m128i mul16_r    = _mm_set1_epi16(0x0210);
+   const __m128i mul16_g    = _mm_set1_epi16(0x2080);
+   const __m128i mul16_b    = _mm_set1_epi16(0x4200);
+   const __m128i a          = _mm_set1_epi16(0x00ff);
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         __m128i r = _mm_and_si128(_mm_srli_epi16(in, 1), pix_mask_r);
+         __m128i g = _mm_and_si128(in, pix_mask_g);
+         __m128i b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_b);
+
+         r = _mm_mulhi_epi16(r, mul16_r);
+         g = _mm_mulhi_epi16(g, mul16_g);
+         b = _mm_mulhi_epi16(b, mul16_b);
+
+         __m128i res_lo_bg = _mm_unpacklo_epi8(b, g);
+         __m128i res_hi_bg = _mm_unpackhi_epi8(b, g);
+         __m128i res_lo_ra = _mm_unpacklo_epi8(r, a);
+         __m128i res_hi_ra = _mm_unpackhi_epi8(r, a);
+
+         __m128i res_lo = _mm_or_si128(res_lo_bg,
+               _mm_slli_si128(res_lo_ra, 2));
+         __m128i res_hi = _mm_or_si128(res_hi_bg,
+               _mm_slli_si128(res_hi_ra, 2));
+
+         _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
+         _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t r = (col >> 11) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t b = (col >>  0) & 0x1f;
+         r = (r << 3) | (r >> 2);
+         g = (g << 2) | (g >> 4);
+         b = (b << 3) | (b >> 2);
+
+         output[w] = (0xff << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+
+/* :( TODO: Make this saner. */
+static INLINE PIXCONV_SSE2_TARGET void store_bgr24_sse2(void *output, __m128i a,
+      __m128i b, __m128i c, __m128i d)
+{
+   const __m128i mask_0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
+   const __m128i mask_1 = _mm_set_epi32(0, 0, 0x00ffffff, 0);
    const __m128i mask_2 = _mm_set_epi32(0, 0x00ffffff, 0, 0);
    const __m128i mask_3 = _mm_set_epi32(0x00ffffff, 0, 0, 0);
 
-   __m128i a0 = _mm_and_si128(a, mask_0);
-   __m128i a1 = _mm_srli_si128(_mm_and_si128(a, mask_1),  1);
-   __m128i a2 = _mm_srli_si128(_mm_and_si128(a, mask_2),  2);
-   __m128i a3 = _mm_srli_si128(_mm_and_si128(a, mask_3),  3);
-   __m128i a4 = _mm_slli_si128(_mm_and_si128(b, mask_0), 12);
-   __m128i a5 = _mm_slli_si128(_mm_and_si128(b, mask_1), 11);
+   __m128i a0 = _mm_and_si128(a, mask_0);
+   __m128i a1 = _mm_srli_si128(_mm_and_si128(a, mask_1),  1);
+   __m128i a2 = _mm_srli_si128(_mm_and_si128(a, mask_2),  2);
+   __m128i a3 = _mm_srli_si128(_mm_and_si128(a, mask_3),  3);
+   __m128i a4 = _mm_slli_si128(_mm_and_si128(b, mask_0), 12);
+   __m128i a5 = _mm_slli_si128(_mm_and_si128(b, mask_1), 11);
+
+   __m128i b0 = _mm_srli_si128(_mm_and_si128(b, mask_1), 5);
+   __m128i b1 = _mm_srli_si128(_mm_and_si128(b, mask_2), 6);
+   __m128i b2 = _mm_srli_si128(_mm_and_si128(b, mask_3), 7);
+   __m128i b3 = _mm_slli_si128(_mm_and_si128(c, mask_0), 8);
+   __m128i b4 = _mm_slli_si128(_mm_and_si128(c, mask_1), 7);
+   __m128i b5 = _mm_slli_si128(_mm_and_si128(c, mask_2), 6);
+
+   __m128i c0 = _mm_srli_si128(_mm_and_si128(c, mask_2), 10);
+   __m128i c1 = _mm_srli_si128(_mm_and_si128(c, mask_3), 11);
+   __m128i c2 = _mm_slli_si128(_mm_and_si128(d, mask_0),  4);
+   __m128i c3 = _mm_slli_si128(_mm_and_si128(d, mask_1),  3);
+   __m128i c4 = _mm_slli_si128(_mm_and_si128(d, mask_2),  2);
+   __m128i c5 = _mm_slli_si128(_mm_and_si128(d, mask_3),  1);
+
+   __m128i *out = (__m128i*)output;
+
+   _mm_storeu_si128(out + 0,
+         _mm_or_si128(a0, _mm_or_si128(a1, _mm_or_si128(a2,
+                  _mm_or_si128(a3, _mm_or_si128(a4, a5))))));
+
+   _mm_storeu_si128(out + 1,
+         _mm_or_si128(b0, _mm_or_si128(b1, _mm_or_si128(b2,
+                  _mm_or_si128(b3, _mm_or_si128(b4, b5))))));
+
+   _mm_storeu_si128(out + 2,
+         _mm_or_si128(c0, _mm_or_si128(c1, _mm_or_si128(c2,
+                  _mm_or_si128(c3, _mm_or_si128(c4, c5))))));
+}
+
+static PIXCONV_SSE2_TARGET void conv_0rgb1555_bgr24_SSE2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   const __m128i pix_mask_r  = _mm_set1_epi16(0x1f << 10);
+   const __m128i pix_mask_gb = _mm_set1_epi16(0x1f <<  5);
+   const __m128i mul15_mid   = _mm_set1_epi16(0x4200);
+   const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
+   const __m128i a           = _mm_set1_epi16(0x00ff);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         const __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w + 0));
+         const __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 8));
+         __m128i r0 = _mm_and_si128(in0, pix_mask_r);
+         __m128i r1 = _mm_and_si128(in1, pix_mask_r);
+         __m128i g0 = _mm_and_si128(in0, pix_mask_gb);
+         __m128i g1 = _mm_and_si128(in1, pix_mask_gb);
+         __m128i b0 = _mm_and_si128(_mm_slli_epi16(in0, 5), pix_mask_gb);
+         __m128i b1 = _mm_and_si128(_mm_slli_epi16(in1, 5), pix_mask_gb);
+
+         r0 = _mm_mulhi_epi16(r0, mul15_hi);
+         r1 = _mm_mulhi_epi16(r1, mul15_hi);
+         g0 = _mm_mulhi_epi16(g0, mul15_mid);
+         g1 = _mm_mulhi_epi16(g1, mul15_mid);
+         b0 = _mm_mulhi_epi16(b0, mul15_mid);
+         b1 = _mm_mulhi_epi16(b1, mul15_mid);
+
+         __m128i res_lo_bg0 = _mm_unpacklo_epi8(b0, g0);
+         __m128i res_lo_bg1 = _mm_unpacklo_epi8(b1, g1);
+         __m128i res_hi_bg0 = _mm_unpackhi_epi8(b0, g0);
+         __m128i res_hi_bg1 = _mm_unpackhi_epi8(b1, g1);
+         __m128i res_lo_ra0 = _mm_unpacklo_epi8(r0, a);
+         __m128i res_lo_ra1 = _mm_unpacklo_epi8(r1, a);
+         __m128i res_hi_ra0 = _mm_unpackhi_epi8(r0, a);
+         __m128i res_hi_ra1 = _mm_unpackhi_epi8(r1, a);
+
+         __m128i res_lo0 = _mm_or_si128(res_lo_bg0,
+               _mm_slli_si128(res_lo_ra0, 2));
+         __m128i res_lo1 = _mm_or_si128(res_lo_bg1,
+               _mm_slli_si128(res_lo_ra1, 2));
+         __m128i res_hi0 = _mm_or_si128(res_hi_bg0,
+               _mm_slli_si128(res_hi_ra0, 2));
+         __m128i res_hi1 = _mm_or_si128(res_hi_bg1,
+               _mm_slli_si128(res_hi_ra1, 2));
+
+         /* Non-POT pixel sizes ftl :( */
+         store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t b = (col >>  0) & 0x1f;
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t r = (col >> 10) & 0x1f;
+         b = (b << 3) | (b >> 2);
+         g = (g << 3) | (g >> 2);
+         r = (r << 3) | (r >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
+
+static PIXCONV_SSE2_TARGET void conv_rgb565_bgr24_SSE2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output      = (uint8_t*)output_;
+
+   const __m128i pix_mask_r = _mm_set1_epi16(0x1f << 10);
+   const __m128i pix_mask_g = _mm_set1_epi16(0x3f <<  5);
+   const __m128i pix_mask_b = _mm_set1_epi16(0x1f <<  5);
+   const __m128i mul16_r    = _mm_set1_epi16(0x0210);
+   const __m128i mul16_g    = _mm_set1_epi16(0x2080);
+   const __m128i mul16_b    = _mm_set1_epi16(0x4200);
+   const __m128i a          = _mm_set1_epi16(0x00ff);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height; h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         const __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w));
+         const __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 8));
+         __m128i r0 = _mm_and_si128(_mm_srli_epi16(in0, 1), pix_mask_r);
+         __m128i g0 = _mm_and_si128(in0, pix_mask_g);
+         __m128i b0 = _mm_and_si128(_mm_slli_epi16(in0, 5), pix_mask_b);
+         __m128i r1 = _mm_and_si128(_mm_srli_epi16(in1, 1), pix_mask_r);
+         __m128i g1 = _mm_and_si128(in1, pix_mask_g);
+         __m128i b1 = _mm_and_si128(_mm_slli_epi16(in1, 5), pix_mask_b);
+
+         r0 = _mm_mulhi_epi16(r0, mul16_r);
+         g0 = _mm_mulhi_epi16(g0, mul16_g);
+         b0 = _mm_mulhi_epi16(b0, mul16_b);
+         r1 = _mm_mulhi_epi16(r1, mul16_r);
+         g1 = _mm_mulhi_epi16(g1, mul16_g);
+         b1 = _mm_mulhi_epi16(b1, mul16_b);
+
+         __m128i res_lo_bg0 = _mm_unpacklo_epi8(b0, g0);
+         __m128i res_hi_bg0 = _mm_unpackhi_epi8(b0, g0);
+         __m128i res_lo_ra0 = _mm_unpacklo_epi8(r0, a);
+         __m128i res_hi_ra0 = _mm_unpackhi_epi8(r0, a);
+         __m128i res_lo_bg1 = _mm_unpacklo_epi8(b1, g1);
+         __m128i res_hi_bg1 = _mm_unpackhi_epi8(b1, g1);
+         __m128i res_lo_ra1 = _mm_unpacklo_epi8(r1, a);
+         __m128i res_hi_ra1 = _mm_unpackhi_epi8(r1, a);
+
+         __m128i res_lo0 = _mm_or_si128(res_lo_bg0,
+               _mm_slli_si128(res_lo_ra0, 2));
+         __m128i res_hi0 = _mm_or_si128(res_hi_bg0,
+               _mm_slli_si128(res_hi_ra0, 2));
+         __m128i res_lo1 = _mm_or_si128(res_lo_bg1,
+               _mm_slli_si128(res_lo_ra1, 2));
+         __m128i res_hi1 = _mm_or_si128(res_hi_bg1,
+               _mm_slli_si128(res_hi_ra1, 2));
+
+         store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t r = (col >> 11) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t b = (col >>  0) & 0x1f;
+         r = (r << 3) | (r >> 2);
+         g = (g << 2) | (g >> 4);
+         b = (b << 3) | (b >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
+
+static PIXCONV_SSE2_TARGET void conv_argb8888_bgr24_SSE2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 2)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         store_bgr24_sse2(out,
+               _mm_loadu_si128((const __m128i*)(input + w +  0)),
+               _mm_loadu_si128((const __m128i*)(input + w +  4)),
+               _mm_loadu_si128((const __m128i*)(input + w +  8)),
+               _mm_loadu_si128((const __m128i*)(input + w + 12)));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         *out++ = (uint8_t)(col >>  0);
+         *out++ = (uint8_t)(col >>  8);
+         *out++ = (uint8_t)(col >> 16);
+      }
+   }
+}
+
+static PIXCONV_SSE2_TARGET void conv_yuyv_argb8888_SSE2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+
+   const __m128i mask_y = _mm_set1_epi16(0xffu);
+   const __m128i mask_u = _mm_set1_epi32(0xffu << 8);
+   const __m128i mask_v = _mm_set1_epi32(0xffu << 24);
+   const __m128i chroma_offset = _mm_set1_epi16(128);
+   const __m128i round_offset = _mm_set1_epi16(YUV_OFFSET);
+
+   const __m128i yuv_mul = _mm_set1_epi16(YUV_MAT_Y);
+   const __m128i u_g_mul = _mm_set1_epi16(YUV_MAT_U_G);
+   const __m128i u_b_mul = _mm_set1_epi16(YUV_MAT_U_B);
+   const __m128i v_r_mul = _mm_set1_epi16(YUV_MAT_V_R);
+   const __m128i v_g_mul = _mm_set1_epi16(YUV_MAT_V_G);
+   const __m128i a       = _mm_cmpeq_epi16(_mm_setzero_si128(),
+         _mm_setzero_si128());
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t *dst = output;
+
+      /* Each loop processes 16 pixels. */
+      for (w = 0; w + 16 <= width; w += 16, src += 32, dst += 16)
+      {
+         __m128i yuv0 = _mm_loadu_si128((const __m128i*)(src +  0)); /* [Y0, U0, Y1, V0, Y2, U1, Y3, V1, ...] */
+         __m128i yuv1 = _mm_loadu_si128((const __m128i*)(src + 16)); /* [Y0, U0, Y1, V0, Y2, U1, Y3, V1, ...] */
+
+         __m128i _y0 = _mm_and_si128(yuv0, mask_y); /* [Y0, Y1, Y2, ...] (16-bit) */
+         __m128i u0 = _mm_and_si128(yuv0, mask_u); /* [0, U0, 0, 0, 0, U1, 0, 0, ...] */
+         __m128i v0 = _mm_and_si128(yuv0, mask_v); /* [0, 0, 0, V1, 0, , 0, V1, ...] */
+         __m128i _y1 = _mm_and_si128(yuv1, mask_y); /* [Y0, Y1, Y2, ...] (16-bit) */
+         __m128i u1 = _mm_and_si128(yuv1, mask_u); /* [0, U0, 0, 0, 0, U1, 0, 0, ...] */
+         __m128i v1 = _mm_and_si128(yuv1, mask_v); /* [0, 0, 0, V1, 0, , 0, V1, ...] */
+
+         /* Juggle around to get U and V in the same 16-bit format as Y. */
+         u0 = _mm_srli_si128(u0, 1);
+         v0 = _mm_srli_si128(v0, 3);
+         u1 = _mm_srli_si128(u1, 1);
+         v1 = _mm_srli_si128(v1, 3);
+         __m128i u = _mm_packs_epi32(u0, u1);
+         __m128i v = _mm_packs_epi32(v0, v1);
+
+         /* Apply YUV offsets (U, V) -= (-128, -128). */
+         u = _mm_sub_epi16(u, chroma_offset);
+         v = _mm_sub_epi16(v, chroma_offset);
+
+         /* Upscale chroma horizontally (nearest). */
+         u0 = _mm_unpacklo_epi16(u, u);
+         u1 = _mm_unpackhi_epi16(u, u);
+         v0 = _mm_unpacklo_epi16(v, v);
+         v1 = _mm_unpackhi_epi16(v, v);
+
+         /* Apply transformations. */
+         _y0 = _mm_mullo_epi16(_y0, yuv_mul);
+         _y1 = _mm_mullo_epi16(_y1, yuv_mul);
+         __m128i u0_g   = _mm_mullo_epi16(u0, u_g_mul);
+         __m128i u1_g   = _mm_mullo_epi16(u1, u_g_mul);
+         __m128i u0_b   = _mm_mullo_epi16(u0, u_b_mul);
+         __m128i u1_b   = _mm_mullo_epi16(u1, u_b_mul);
+         __m128i v0_r   = _mm_mullo_epi16(v0, v_r_mul);
+         __m128i v1_r   = _mm_mullo_epi16(v1, v_r_mul);
+         __m128i v0_g   = _mm_mullo_epi16(v0, v_g_mul);
+         __m128i v1_g   = _mm_mullo_epi16(v1, v_g_mul);
+
+         /* Add contibutions from the transformed components. */
+         __m128i r0 = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(_y0, v0_r),
+                  round_offset), YUV_SHIFT);
+         __m128i g0 = _mm_srai_epi16(_mm_adds_epi16(
+                  _mm_adds_epi16(_mm_adds_epi16(_y0, v0_g), u0_g), round_offset), YUV_SHIFT);
+         __m128i b0 = _mm_srai_epi16(_mm_adds_epi16(
+                  _mm_adds_epi16(_y0, u0_b), round_offset), YUV_SHIFT);
+
+         __m128i r1 = _mm_srai_epi16(_mm_adds_epi16(
+                  _mm_adds_epi16(_y1, v1_r), round_offset), YUV_SHIFT);
+         __m128i g1 = _mm_srai_epi16(_mm_adds_epi16(
+                  _mm_adds_epi16(_mm_adds_epi16(_y1, v1_g), u1_g), round_offset), YUV_SHIFT);
+         __m128i b1 = _mm_srai_epi16(_mm_adds_epi16(
+                  _mm_adds_epi16(_y1, u1_b), round_offset), YUV_SHIFT);
+
+         /* Saturate into 8-bit. */
+         r0 = _mm_packus_epi16(r0, r1);
+         g0 = _mm_packus_epi16(g0, g1);
+         b0 = _mm_packus_epi16(b0, b1);
+
+         /* Interleave into ARGB. */
+         __m128i res_lo_bg = _mm_unpacklo_epi8(b0, g0);
+         __m128i res_hi_bg = _mm_unpackhi_epi8(b0, g0);
+         __m128i res_lo_ra = _mm_unpacklo_epi8(r0, a);
+         __m128i res_hi_ra = _mm_unpackhi_epi8(r0, a);
+         __m128i res0 = _mm_unpacklo_epi16(res_lo_bg, res_lo_ra);
+         __m128i res1 = _mm_unpackhi_epi16(res_lo_bg, res_lo_ra);
+         __m128i res2 = _mm_unpacklo_epi16(res_hi_bg, res_hi_ra);
+         __m128i res3 = _mm_unpackhi_epi16(res_hi_bg, res_hi_ra);
+
+         _mm_storeu_si128((__m128i*)(dst +  0), res0);
+         _mm_storeu_si128((__m128i*)(dst +  4), res1);
+         _mm_storeu_si128((__m128i*)(dst +  8), res2);
+         _mm_storeu_si128((__m128i*)(dst + 12), res3);
+      }
+
+      /* Finish off the rest (if any) in C. */
+      for (; w < width; w += 2, src += 4, dst += 2)
+      {
+         int _y0 = src[0];
+         int  u = src[1] - 128;
+         int _y1 = src[2];
+         int  v = src[3] - 128;
+
+         uint8_t r0 = clamp_8bit((YUV_MAT_Y * _y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         uint8_t r1 = clamp_8bit((YUV_MAT_Y * _y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
+         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
+      }
+   }
+}
+
+static PIXCONV_SSE2_TARGET void conv_rgba4444_argb8888_SSE2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m128i mask_g  = _mm_set1_epi16(0x0f00);
+   const __m128i mask_b  = _mm_set1_epi16(0x000f);
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
 
-   __m128i b0 = _mm_srli_si128(_mm_and_si128(b, mask_1), 5);
-   __m128i b1 = _mm_srli_si128(_mm_and_si128(b, mask_2), 6);
-   __m128i b2 = _mm_srli_si128(_mm_and_si128(b, mask_3), 7);
-   __m128i b3 = _mm_slli_si128(_mm_and_si128(c, mask_0), 8);
-   __m128i b4 = _mm_slli_si128(_mm_and_si128(c, mask_1), 7);
-   __m128i b5 = _mm_slli_si128(_mm_and_si128(c, mask_2), 6);
+         /* Nibbles are widened to bytes by multiplying with 0x11. */
+         __m128i bg = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(in, 4), mask_b),
+               _mm_and_si128(in, mask_g));
+         __m128i ra = _mm_or_si128(_mm_srli_epi16(in, 12),
+               _mm_slli_epi16(_mm_and_si128(in, mask_b), 8));
 
-   __m128i c0 = _mm_srli_si128(_mm_and_si128(c, mask_2), 10);
-   __m128i c1 = _mm_srli_si128(_mm_and_si128(c, mask_3), 11);
-   __m128i c2 = _mm_slli_si128(_mm_and_si128(d, mask_0),  4);
-   __m128i c3 = _mm_slli_si128(_mm_and_si128(d, mask_1),  3);
-   __m128i c4 = _mm_slli_si128(_mm_and_si128(d, mask_2),  2);
-   __m128i c5 = _mm_slli_si128(_mm_and_si128(d, mask_3),  1);
+         bg = _mm_or_si128(bg, _mm_slli_epi16(bg, 4));
+         ra = _mm_or_si128(ra, _mm_slli_epi16(ra, 4));
 
-   __m128i *out = (__m128i*)output;
+         _mm_storeu_si128((__m128i*)(output + w + 0),
+               _mm_unpacklo_epi16(bg, ra));
+         _mm_storeu_si128((__m128i*)(output + w + 4),
+               _mm_unpackhi_epi16(bg, ra));
+      }
 
-   _mm_storeu_si128(out + 0,
-         _mm_or_si128(a0, _mm_or_si128(a1, _mm_or_si128(a2,
-                  _mm_or_si128(a3, _mm_or_si128(a4, a5))))));
+      conv_rgba4444_argb8888_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
+   }
+}
 
-   _mm_storeu_si128(out + 1,
-         _mm_or_si128(b0, _mm_or_si128(b1, _mm_or_si128(b2,
-                  _mm_or_si128(b3, _mm_or_si128(b4, b5))))));
+static INLINE PIXCONV_SSE2_TARGET void load_bgr24_sse2(const void *input,
+      __m128i *a, __m128i *b, __m128i *c, __m128i *d)
+{
+   const __m128i mask_0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
+   const __m128i mask_1 = _mm_set_epi32(0, 0, 0x00ffffff, 0);
+   const __m128i mask_2 = _mm_set_epi32(0, 0x00ffffff, 0, 0);
+   const __m128i mask_3 = _mm_set_epi32(0x00ffffff, 0, 0, 0);
 
-   _mm_storeu_si128(out + 2,
-         _mm_or_si128(c0, _mm_or_si128(c1, _mm_or_si128(c2,
-                  _mm_or_si128(c3, _mm_or_si128(c4, c5))))));
+   const __m128i *in = (const __m128i*)input;
+   __m128i x0        = _mm_loadu_si128(in + 0);
+   __m128i x1        = _mm_loadu_si128(in + 1);
+   __m128i x2        = _mm_loadu_si128(in + 2);
+
+   /* Inverse of store_bgr24_sse2, pixel n starts at byte 3 * n. */
+   *a = _mm_or_si128(
+         _mm_or_si128(_mm_and_si128(x0, mask_0),
+            _mm_and_si128(_mm_slli_si128(x0, 1), mask_1)),
+         _mm_or_si128(_mm_and_si128(_mm_slli_si128(x0, 2), mask_2),
+            _mm_and_si128(_mm_slli_si128(x0, 3), mask_3)));
+
+   *b = _mm_or_si128(
+         _mm_or_si128(_mm_and_si128(_mm_srli_si128(x0, 12), mask_0),
+            _mm_and_si128(_mm_or_si128(_mm_srli_si128(x0, 11),
+                  _mm_slli_si128(x1, 5)), mask_1)),
+         _mm_or_si128(_mm_and_si128(_mm_slli_si128(x1, 6), mask_2),
+            _mm_and_si128(_mm_slli_si128(x1, 7), mask_3)));
+
+   *c = _mm_or_si128(
+         _mm_or_si128(_mm_and_si128(_mm_srli_si128(x1, 8), mask_0),
+            _mm_and_si128(_mm_srli_si128(x1, 7), mask_1)),
+         _mm_or_si128(_mm_and_si128(_mm_or_si128(_mm_srli_si128(x1, 6),
+                  _mm_slli_si128(x2, 10)), mask_2),
+            _mm_and_si128(_mm_slli_si128(x2, 11), mask_3)));
+
+   *d = _mm_or_si128(
+         _mm_or_si128(_mm_and_si128(_mm_srli_si128(x2, 4), mask_0),
+            _mm_and_si128(_mm_srli_si128(x2, 3), mask_1)),
+         _mm_or_si128(_mm_and_si128(_mm_srli_si128(x2, 2), mask_2),
+            _mm_and_si128(_mm_srli_si128(x2, 1), mask_3)));
 }
 
-void conv_0rgb1555_bgr24(void *output_, const void *input_,
-      int width, int height,
+static PIXCONV_SSE2_TARGET void conv_bgr24_argb8888_SSE2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint8_t *output       = (uint8_t*)output_;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
 
-   const __m128i pix_mask_r  = _mm_set1_epi16(0x1f << 10);
-   const __m128i pix_mask_gb = _mm_set1_epi16(0x1f <<  5);
-   const __m128i mul15_mid   = _mm_set1_epi16(0x4200);
-   const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
-   const __m128i a           = _mm_set1_epi16(0x00ff);
+   const __m128i alpha  = _mm_set1_epi32(0xff000000);
 
    int max_width = width - 15;
 
    for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride >> 1)
+         h++, output += out_stride >> 2, input += in_stride)
    {
-      uint8_t *out = output;
+      const uint8_t *inp = input;
 
-      for (w = 0; w < max_width; w += 16, out += 48)
+      for (w = 0; w < max_width; w += 16, inp += 48)
       {
-         const __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w + 0));
-         const __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 8));
-         __m128i r0 = _mm_and_si128(in0, pix_mask_r);
-         __m128i r1 = _mm_and_si128(in1, pix_mask_r);
-         __m128i g0 = _mm_and_si128(in0, pix_mask_gb);
-         __m128i g1 = _mm_and_si128(in1, pix_mask_gb);
-         __m128i b0 = _mm_and_si128(_mm_slli_epi16(in0, 5), pix_mask_gb);
-         __m128i b1 = _mm_and_si128(_mm_slli_epi16(in1, 5), pix_mask_gb);
+         __m128i a, b, c, d;
+         load_bgr24_sse2(inp, &a, &b, &c, &d);
 
-         r0 = _mm_mulhi_epi16(r0, mul15_hi);
-         r1 = _mm_mulhi_epi16(r1, mul15_hi);
-         g0 = _mm_mulhi_epi16(g0, mul15_mid);
-         g1 = _mm_mulhi_epi16(g1, mul15_mid);
-         b0 = _mm_mulhi_epi16(b0, mul15_mid);
-         b1 = _mm_mulhi_epi16(b1, mul15_mid);
+         _mm_storeu_si128((__m128i*)(output + w +  0), _mm_or_si128(a, alpha));
+         _mm_storeu_si128((__m128i*)(output + w +  4), _mm_or_si128(b, alpha));
+         _mm_storeu_si128((__m128i*)(output + w +  8), _mm_or_si128(c, alpha));
+         _mm_storeu_si128((__m128i*)(output + w + 12), _mm_or_si128(d, alpha));
+      }
 
-         __m128i res_lo_bg0 = _mm_unpacklo_epi8(b0, g0);
-         __m128i res_lo_bg1 = _mm_unpacklo_epi8(b1, g1);
-         __m128i res_hi_bg0 = _mm_unpackhi_epi8(b0, g0);
-         __m128i res_hi_bg1 = _mm_unpackhi_epi8(b1, g1);
-         __m128i res_lo_ra0 = _mm_unpacklo_epi8(r0, a);
-         __m128i res_lo_ra1 = _mm_unpacklo_epi8(r1, a);
-         __m128i res_hi_ra0 = _mm_unpackhi_epi8(r0, a);
-         __m128i res_hi_ra1 = _mm_unpackhi_epi8(r1, a);
+      conv_bgr24_argb8888_C(output + w, inp,
+            width - w, 1, out_stride, in_stride);
+   }
+}
 
-         __m128i res_lo0 = _mm_or_si128(res_lo_bg0,
-               _mm_slli_si128(res_lo_ra0, 2));
-         __m128i res_lo1 = _mm_or_si128(res_lo_bg1,
-               _mm_slli_si128(res_lo_ra1, 2));
-         __m128i res_hi0 = _mm_or_si128(res_hi_bg0,
-               _mm_slli_si128(res_hi_ra0, 2));
-         __m128i res_hi1 = _mm_or_si128(res_hi_bg1,
-               _mm_slli_si128(res_hi_ra1, 2));
+static PIXCONV_SSE2_TARGET void conv_argb8888_0rgb1555_SSE2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
 
-         /* Non-POT pixel sizes ftl :( */
-         store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
-      }
+   const __m128i mask_r  = _mm_set1_epi32(0x1f << 10);
+   const __m128i mask_g  = _mm_set1_epi32(0x1f <<  5);
+   const __m128i mask_b  = _mm_set1_epi32(0x1f <<  0);
 
-      for (; w < width; w++)
-      {
-         uint32_t col = input[w];
-         uint32_t b = (col >>  0) & 0x1f;
-         uint32_t g = (col >>  5) & 0x1f;
-         uint32_t r = (col >> 10) & 0x1f;
-         b = (b << 3) | (b >> 2);
-         g = (g << 3) | (g >> 2);
-         r = (r << 3) | (r >> 2);
+   int max_width = width - 7;
 
-         *out++ = b;
-         *out++ = g;
-         *out++ = r;
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w + 0));
+         __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 4));
+
+         __m128i res0 = _mm_or_si128(
+               _mm_and_si128(_mm_srli_epi32(in0, 9), mask_r),
+               _mm_or_si128(_mm_and_si128(_mm_srli_epi32(in0, 6), mask_g),
+                  _mm_and_si128(_mm_srli_epi32(in0, 3), mask_b)));
+         __m128i res1 = _mm_or_si128(
+               _mm_and_si128(_mm_srli_epi32(in1, 9), mask_r),
+               _mm_or_si128(_mm_and_si128(_mm_srli_epi32(in1, 6), mask_g),
+                  _mm_and_si128(_mm_srli_epi32(in1, 3), mask_b)));
+
+         /* Results fit in 15 bits, so signed saturation is exact. */
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_packs_epi32(res0, res1));
       }
+
+      conv_argb8888_0rgb1555_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
 
-void conv_rgb565_bgr24(void *output_, const void *input_,
-      int width, int height,
+static PIXCONV_SSE2_TARGET void conv_argb8888_rgb565_SSE2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint8_t *output      = (uint8_t*)output_;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
 
-   const __m128i pix_mask_r = _mm_set1_epi16(0x1f << 10);
-   const __m128i pix_mask_g = _mm_set1_epi16(0x3f <<  5);
-   const __m128i pix_mask_b = _mm_set1_epi16(0x1f <<  5);
-   const __m128i mul16_r    = _mm_set1_epi16(0x0210);
-   const __m128i mul16_g    = _mm_set1_epi16(0x2080);
-   const __m128i mul16_b    = _mm_set1_epi16(0x4200);
-   const __m128i a          = _mm_set1_epi16(0x00ff);
+   const __m128i mask_r  = _mm_set1_epi32(0x1f << 11);
+   const __m128i mask_g  = _mm_set1_epi32(0x3f <<  5);
+   const __m128i mask_b  = _mm_set1_epi32(0x1f <<  0);
 
-   int max_width = width - 15;
+   int max_width = width - 7;
 
-   for (h = 0; h < height; h++, output += out_stride, input += in_stride >> 1)
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      uint8_t *out = output;
-
-      for (w = 0; w < max_width; w += 16, out += 48)
+      for (w = 0; w < max_width; w += 8)
       {
-         const __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w));
-         const __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 8));
-         __m128i r0 = _mm_and_si128(_mm_srli_epi16(in0, 1), pix_mask_r);
-         __m128i g0 = _mm_and_si128(in0, pix_mask_g);
-         __m128i b0 = _mm_and_si128(_mm_slli_epi16(in0, 5), pix_mask_b);
-         __m128i r1 = _mm_and_si128(_mm_srli_epi16(in1, 1), pix_mask_r);
-         __m128i g1 = _mm_and_si128(in1, pix_mask_g);
-         __m128i b1 = _mm_and_si128(_mm_slli_epi16(in1, 5), pix_mask_b);
+         __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w + 0));
+         __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 4));
+
+         __m128i res0 = _mm_or_si128(
+               _mm_and_si128(_mm_srli_epi32(in0, 8), mask_r),
+               _mm_or_si128(_mm_and_si128(_mm_srli_epi32(in0, 5), mask_g),
+                  _mm_and_si128(_mm_srli_epi32(in0, 3), mask_b)));
+         __m128i res1 = _mm_or_si128(
+               _mm_and_si128(_mm_srli_epi32(in1, 8), mask_r),
+               _mm_or_si128(_mm_and_si128(_mm_srli_epi32(in1, 5), mask_g),
+                  _mm_and_si128(_mm_srli_epi32(in1, 3), mask_b)));
+
+         /* Sign extend so packing does not saturate. */
+         res0 = _mm_srai_epi32(_mm_slli_epi32(res0, 16), 16);
+         res1 = _mm_srai_epi32(_mm_slli_epi32(res1, 16), 16);
 
-         r0 = _mm_mulhi_epi16(r0, mul16_r);
-         g0 = _mm_mulhi_epi16(g0, mul16_g);
-         b0 = _mm_mulhi_epi16(b0, mul16_b);
-         r1 = _mm_mulhi_epi16(r1, mul16_r);
-         g1 = _mm_mulhi_epi16(g1, mul16_g);
-         b1 = _mm_mulhi_epi16(b1, mul16_b);
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_packs_epi32(res0, res1));
+      }
 
-         __m128i res_lo_bg0 = _mm_unpacklo_epi8(b0, g0);
-         __m128i res_hi_bg0 = _mm_unpackhi_epi8(b0, g0);
-         __m128i res_lo_ra0 = _mm_unpacklo_epi8(r0, a);
-         __m128i res_hi_ra0 = _mm_unpackhi_epi8(r0, a);
-         __m128i res_lo_bg1 = _mm_unpacklo_epi8(b1, g1);
-         __m128i res_hi_bg1 = _mm_unpackhi_epi8(b1, g1);
-         __m128i res_lo_ra1 = _mm_unpacklo_epi8(r1, a);
-         __m128i res_hi_ra1 = _mm_unpackhi_epi8(r1, a);
+      conv_argb8888_rgb565_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
+   }
+}
 
-         __m128i res_lo0 = _mm_or_si128(res_lo_bg0,
-               _mm_slli_si128(res_lo_ra0, 2));
-         __m128i res_hi0 = _mm_or_si128(res_hi_bg0,
-               _mm_slli_si128(res_hi_ra0, 2));
-         __m128i res_lo1 = _mm_or_si128(res_lo_bg1,
-               _mm_slli_si128(res_lo_ra1, 2));
-         __m128i res_hi1 = _mm_or_si128(res_hi_bg1,
-               _mm_slli_si128(res_hi_ra1, 2));
+static PIXCONV_SSE2_TARGET void conv_argb8888_abgr8888_SSE2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
 
-         store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
-      }
+   const __m128i mask_ag = _mm_set1_epi32(0xff00ff00);
+   const __m128i mask_b  = _mm_set1_epi32(0x000000ff);
 
-      for (; w < width; w++)
+   int max_width = width - 3;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 2)
+   {
+      for (w = 0; w < max_width; w += 4)
       {
-         uint32_t col = input[w];
-         uint32_t r = (col >> 11) & 0x1f;
-         uint32_t g = (col >>  5) & 0x3f;
-         uint32_t b = (col >>  0) & 0x1f;
-         r = (r << 3) | (r >> 2);
-         g = (g << 2) | (g >> 4);
-         b = (b << 3) | (b >> 2);
+         __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         __m128i rb = _mm_or_si128(
+               _mm_slli_epi32(_mm_and_si128(in, mask_b), 16),
+               _mm_and_si128(_mm_srli_epi32(in, 16), mask_b));
 
-         *out++ = b;
-         *out++ = g;
-         *out++ = r;
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_or_si128(_mm_and_si128(in, mask_ag), rb));
       }
+
+      conv_argb8888_abgr8888_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
-#else
-void conv_0rgb1555_bgr24(void *output_, const void *input_,
-      int width, int height,
+#endif
+
+#ifdef PIXCONV_HAVE_AVX2
+/* 256-bit unpacks work within 128-bit lanes, so 16 pixels widened
+ * in one register come out as pixels 0-3, 8-11 and 4-7, 12-15. */
+static INLINE PIXCONV_AVX2_TARGET void store_argb8888_avx2(uint32_t *output,
+      __m256i lo, __m256i hi)
+{
+   _mm256_storeu_si256((__m256i*)(output + 0),
+         _mm256_permute2x128_si256(lo, hi, 0x20));
+   _mm256_storeu_si256((__m256i*)(output + 8),
+         _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+/* Packs 16 pixels of 32-bit lanes back into pixel order. */
+static INLINE PIXCONV_AVX2_TARGET __m256i pack_16bit_avx2(__m256i a, __m256i b)
+{
+   return _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+}
+
+static PIXCONV_AVX2_TARGET void conv_rgb565_0rgb1555_AVX2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint16_t *input = (const uint16_t*)input_;
-   uint8_t *output       = (uint8_t*)output_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m256i hi_mask = _mm256_set1_epi16(0x7fe0);
+   const __m256i lo_mask = _mm256_set1_epi16(0x1f);
+
+   int max_width = width - 15;
 
    for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride >> 1)
+         h++, output += out_stride >> 1, input += in_stride >> 1)
    {
-      uint8_t *out = output;
-      for (w = 0; w < width; w++)
+      for (w = 0; w < max_width; w += 16)
       {
-         uint32_t col = input[w];
-         uint32_t b = (col >>  0) & 0x1f;
-         uint32_t g = (col >>  5) & 0x1f;
-         uint32_t r = (col >> 10) & 0x1f;
-         b = (b << 3) | (b >> 2);
-         g = (g << 3) | (g >> 2);
-         r = (r << 3) | (r >> 2);
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i hi = _mm256_and_si256(_mm256_srli_epi16(in, 1), hi_mask);
+         __m256i lo = _mm256_and_si256(in, lo_mask);
+         _mm256_storeu_si256((__m256i*)(output + w), _mm256_or_si256(hi, lo));
+      }
 
-         *out++ = b;
-         *out++ = g;
-         *out++ = r;
+      conv_rgb565_0rgb1555_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
+   }
+}
+
+static PIXCONV_AVX2_TARGET void conv_0rgb1555_rgb565_AVX2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m256i hi_mask   = _mm256_set1_epi16(
+         (int16_t)((0x1f << 11) | (0x1f << 6)));
+   const __m256i lo_mask   = _mm256_set1_epi16(0x1f);
+   const __m256i glow_mask = _mm256_set1_epi16(1 << 5);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i rg   = _mm256_and_si256(_mm256_slli_epi16(in, 1), hi_mask);
+         __m256i b    = _mm256_and_si256(in, lo_mask);
+         __m256i glow = _mm256_and_si256(_mm256_srli_epi16(in, 4), glow_mask);
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_or_si256(rg, _mm256_or_si256(b, glow)));
       }
+
+      conv_0rgb1555_rgb565_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
 
-void conv_rgb565_bgr24(void *output_, const void *input_,
-      int width, int height,
+static PIXCONV_AVX2_TARGET void conv_0rgb1555_argb8888_AVX2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint16_t *input = (const uint16_t*)input_;
-   uint8_t *output       = (uint8_t*)output_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m256i pix_mask_r  = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_gb = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul15_mid   = _mm256_set1_epi16(0x4200);
+   const __m256i mul15_hi    = _mm256_set1_epi16(0x0210);
+   const __m256i a           = _mm256_set1_epi16(0x00ff);
+
+   int max_width = width - 15;
 
    for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride >> 1)
+         h++, output += out_stride >> 2, input += in_stride >> 1)
    {
-      uint8_t *out = output;
-      for (w = 0; w < width; w++)
+      for (w = 0; w < max_width; w += 16)
       {
-         uint32_t col = input[w];
-         uint32_t b = (col >>  0) & 0x1f;
-         uint32_t g = (col >>  5) & 0x3f;
-         uint32_t r = (col >> 11) & 0x1f;
-         b = (b << 3) | (b >> 2);
-         g = (g << 2) | (g >> 4);
-         r = (r << 3) | (r >> 2);
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i r = _mm256_and_si256(in, pix_mask_r);
+         __m256i g = _mm256_and_si256(in, pix_mask_gb);
+         __m256i b = _mm256_and_si256(_mm256_slli_epi16(in, 5), pix_mask_gb);
+         __m256i bg, ra;
 
-         *out++ = b;
-         *out++ = g;
-         *out++ = r;
+         r  = _mm256_mulhi_epi16(r, mul15_hi);
+         g  = _mm256_mulhi_epi16(g, mul15_mid);
+         b  = _mm256_mulhi_epi16(b, mul15_mid);
+
+         bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+         ra = _mm256_or_si256(r, _mm256_slli_epi16(a, 8));
+
+         store_argb8888_avx2(output + w,
+               _mm256_unpacklo_epi16(bg, ra), _mm256_unpackhi_epi16(bg, ra));
       }
+
+      conv_0rgb1555_argb8888_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
-#endif
 
-void conv_bgr24_argb8888(void *output_, const void *input_,
-      int width, int height,
+static PIXCONV_AVX2_TARGET void conv_rgb565_argb8888_AVX2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
-   const uint8_t *input = (const uint8_t*)input_;
-   uint32_t *output     = (uint32_t*)output_;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m256i pix_mask_r = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_g = _mm256_set1_epi16(0x3f <<  5);
+   const __m256i pix_mask_b = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul16_r    = _mm256_set1_epi16(0x0210);
+   const __m256i mul16_g    = _mm256_set1_epi16(0x2080);
+   const __m256i mul16_b    = _mm256_set1_epi16(0x4200);
+   const __m256i a          = _mm256_set1_epi16(0x00ff);
+
+   int max_width = width - 15;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride)
+         h++, output += out_stride >> 2, input += in_stride >> 1)
    {
-      const uint8_t *inp = input;
-      for (w = 0; w < width; w++)
+      for (w = 0; w < max_width; w += 16)
       {
-         uint32_t b = *inp++;
-         uint32_t g = *inp++;
-         uint32_t r = *inp++;
-         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i r = _mm256_and_si256(_mm256_srli_epi16(in, 1), pix_mask_r);
+         __m256i g = _mm256_and_si256(in, pix_mask_g);
+         __m256i b = _mm256_and_si256(_mm256_slli_epi16(in, 5), pix_mask_b);
+         __m256i bg, ra;
+
+         r  = _mm256_mulhi_epi16(r, mul16_r);
+         g  = _mm256_mulhi_epi16(g, mul16_g);
+         b  = _mm256_mulhi_epi16(b, mul16_b);
+
+         bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+         ra = _mm256_or_si256(r, _mm256_slli_epi16(a, 8));
+
+         store_argb8888_avx2(output + w,
+               _mm256_unpacklo_epi16(bg, ra), _mm256_unpackhi_epi16(bg, ra));
       }
+
+      conv_rgb565_argb8888_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
 
-void conv_argb8888_0rgb1555(void *output_, const void *input_,
-      int width, int height,
+static PIXCONV_AVX2_TARGET void conv_rgba4444_argb8888_AVX2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
-   const uint32_t *input = (const uint32_t*)input_;
-   uint16_t *output      = (uint16_t*)output_;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m256i mask_g  = _mm256_set1_epi16(0x0f00);
+   const __m256i mask_b  = _mm256_set1_epi16(0x000f);
+
+   int max_width = width - 15;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 1, input += in_stride >> 2)
+         h++, output += out_stride >> 2, input += in_stride >> 1)
    {
-      for (w = 0; w < width; w++)
+      for (w = 0; w < max_width; w += 16)
       {
-         uint32_t col = input[w];
-         uint16_t r = (col >> 19) & 0x1f;
-         uint16_t g = (col >> 11) & 0x1f;
-         uint16_t b = (col >>  3) & 0x1f;
-         output[w] = (r << 10) | (g << 5) | (b << 0);
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i bg = _mm256_or_si256(
+               _mm256_and_si256(_mm256_srli_epi16(in, 4), mask_b),
+               _mm256_and_si256(in, mask_g));
+         __m256i ra = _mm256_or_si256(_mm256_srli_epi16(in, 12),
+               _mm256_slli_epi16(_mm256_and_si256(in, mask_b), 8));
+
+         bg = _mm256_or_si256(bg, _mm256_slli_epi16(bg, 4));
+         ra = _mm256_or_si256(ra, _mm256_slli_epi16(ra, 4));
+
+         store_argb8888_avx2(output + w,
+               _mm256_unpacklo_epi16(bg, ra), _mm256_unpackhi_epi16(bg, ra));
       }
+
+      conv_rgba4444_argb8888_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
 
-#if defined(__SSE2__)
-void conv_argb8888_bgr24(void *output_, const void *input_,
-      int width, int height,
+static PIXCONV_AVX2_TARGET void conv_argb8888_0rgb1555_AVX2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint32_t *input = (const uint32_t*)input_;
-   uint8_t *output       = (uint8_t*)output_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m256i mask_r  = _mm256_set1_epi32(0x1f << 10);
+   const __m256i mask_g  = _mm256_set1_epi32(0x1f <<  5);
+   const __m256i mask_b  = _mm256_set1_epi32(0x1f <<  0);
 
    int max_width = width - 15;
 
    for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride >> 2)
+         h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      uint8_t *out = output;
-
-      for (w = 0; w < max_width; w += 16, out += 48)
+      for (w = 0; w < max_width; w += 16)
       {
-         store_bgr24_sse2(out,
-               _mm_loadu_si128((const __m128i*)(input + w +  0)),
-               _mm_loadu_si128((const __m128i*)(input + w +  4)),
-               _mm_loadu_si128((const __m128i*)(input + w +  8)),
-               _mm_loadu_si128((const __m128i*)(input + w + 12)));
+         __m256i in0 = _mm256_loadu_si256((const __m256i*)(input + w + 0));
+         __m256i in1 = _mm256_loadu_si256((const __m256i*)(input + w + 8));
+
+         __m256i res0 = _mm256_or_si256(
+               _mm256_and_si256(_mm256_srli_epi32(in0, 9), mask_r),
+               _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(in0, 6), mask_g),
+                  _mm256_and_si256(_mm256_srli_epi32(in0, 3), mask_b)));
+         __m256i res1 = _mm256_or_si256(
+               _mm256_and_si256(_mm256_srli_epi32(in1, 9), mask_r),
+               _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(in1, 6), mask_g),
+                  _mm256_and_si256(_mm256_srli_epi32(in1, 3), mask_b)));
+
+         _mm256_storeu_si256((__m256i*)(output + w),
+               pack_16bit_avx2(res0, res1));
       }
 
-      for (; w < width; w++)
-      {
-         uint32_t col = input[w];
-         *out++ = (uint8_t)(col >>  0);
-         *out++ = (uint8_t)(col >>  8);
-         *out++ = (uint8_t)(col >> 16);
-      }
+      conv_argb8888_0rgb1555_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
-#else
-void conv_argb8888_bgr24(void *output_, const void *input_,
-      int width, int height,
+
+static PIXCONV_AVX2_TARGET void conv_argb8888_rgb565_AVX2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint32_t *input = (const uint32_t*)input_;
-   uint8_t *output       = (uint8_t*)output_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m256i mask_r  = _mm256_set1_epi32(0x1f << 11);
+   const __m256i mask_g  = _mm256_set1_epi32(0x3f <<  5);
+   const __m256i mask_b  = _mm256_set1_epi32(0x1f <<  0);
+
+   int max_width = width - 15;
 
    for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride >> 2)
+         h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      uint8_t *out = output;
-      for (w = 0; w < width; w++)
+      for (w = 0; w < max_width; w += 16)
       {
-         uint32_t col = input[w];
-         *out++ = (uint8_t)(col >>  0);
-         *out++ = (uint8_t)(col >>  8);
-         *out++ = (uint8_t)(col >> 16);
+         __m256i in0 = _mm256_loadu_si256((const __m256i*)(input + w + 0));
+         __m256i in1 = _mm256_loadu_si256((const __m256i*)(input + w + 8));
+
+         __m256i res0 = _mm256_or_si256(
+               _mm256_and_si256(_mm256_srli_epi32(in0, 8), mask_r),
+               _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(in0, 5), mask_g),
+                  _mm256_and_si256(_mm256_srli_epi32(in0, 3), mask_b)));
+         __m256i res1 = _mm256_or_si256(
+               _mm256_and_si256(_mm256_srli_epi32(in1, 8), mask_r),
+               _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(in1, 5), mask_g),
+                  _mm256_and_si256(_mm256_srli_epi32(in1, 3), mask_b)));
+
+         /* AVX2 has packus_epi32, no need to sign extend. */
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_permute4x64_epi64(_mm256_packus_epi32(res0, res1), 0xd8));
       }
+
+      conv_argb8888_rgb565_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
-#endif
 
-void conv_argb8888_abgr8888(void *output_, const void *input_,
-      int width, int height,
+static PIXCONV_AVX2_TARGET void conv_argb8888_abgr8888_AVX2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint32_t *input = (const uint32_t*)input_;
    uint32_t *output      = (uint32_t*)output_;
 
+   const __m256i shuffle = _mm256_setr_epi8(
+          2,  1,  0,  3,  6,  5,  4,  7, 10,  9,  8, 11, 14, 13, 12, 15,
+          2,  1,  0,  3,  6,  5,  4,  7, 10,  9,  8, 11, 14, 13, 12, 15);
+
+   int max_width = width - 7;
+
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      for (w = 0; w < max_width; w += 8)
       {
-         uint32_t col = input[w];
-         output[w] = ((col << 16) & 0xff0000) | 
-            ((col >> 16) & 0xff) | (col & 0xff00ff00);
+         __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_shuffle_epi8(in, shuffle));
       }
+
+      conv_argb8888_abgr8888_C(output + w, input + w,
+            width - w, 1, out_stride, in_stride);
    }
 }
 
-#define YUV_SHIFT 6
-#define YUV_OFFSET (1 << (YUV_SHIFT - 1))
-#define YUV_MAT_Y (1 << 6)
-#define YUV_MAT_U_G (-22)
-#define YUV_MAT_U_B (113)
-#define YUV_MAT_V_R (90)
-#define YUV_MAT_V_G (-46)
-
-#if defined(__SSE2__)
-void conv_yuyv_argb8888(void *output_, const void *input_,
-      int width, int height,
+static PIXCONV_AVX2_TARGET void conv_yuyv_argb8888_AVX2(void *output_,
+      const void *input_, int width, int height,
       int out_stride, int in_stride)
 {
    int h, w;
    const uint8_t *input = (const uint8_t*)input_;
    uint32_t *output     = (uint32_t*)output_;
 
-   const __m128i mask_y = _mm_set1_epi16(0xffu);
-   const __m128i mask_u = _mm_set1_epi32(0xffu << 8);
-   const __m128i mask_v = _mm_set1_epi32(0xffu << 24);
-   const __m128i chroma_offset = _mm_set1_epi16(128);
-   const __m128i round_offset = _mm_set1_epi16(YUV_OFFSET);
+   const __m256i mask_y = _mm256_set1_epi16(0xffu);
+   const __m256i mask_u = _mm256_set1_epi32(0xffu << 8);
+   const __m256i mask_v = _mm256_set1_epi32(0xffu << 24);
+   const __m256i chroma_offset = _mm256_set1_epi16(128);
+   const __m256i round_offset = _mm256_set1_epi16(YUV_OFFSET);
 
-   const __m128i yuv_mul = _mm_set1_epi16(YUV_MAT_Y);
-   const __m128i u_g_mul = _mm_set1_epi16(YUV_MAT_U_G);
-   const __m128i u_b_mul = _mm_set1_epi16(YUV_MAT_U_B);
-   const __m128i v_r_mul = _mm_set1_epi16(YUV_MAT_V_R);
-   const __m128i v_g_mul = _mm_set1_epi16(YUV_MAT_V_G);
-   const __m128i a       = _mm_cmpeq_epi16(_mm_setzero_si128(),
-         _mm_setzero_si128());
+   const __m256i yuv_mul = _mm256_set1_epi16(YUV_MAT_Y);
+   const __m256i u_g_mul = _mm256_set1_epi16(YUV_MAT_U_G);
+   const __m256i u_b_mul = _mm256_set1_epi16(YUV_MAT_U_B);
+   const __m256i v_r_mul = _mm256_set1_epi16(YUV_MAT_V_R);
+   const __m256i v_g_mul = _mm256_set1_epi16(YUV_MAT_V_G);
+   const __m256i a       = _mm256_set1_epi16(-1);
 
    for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
    {
       const uint8_t *src = input;
       uint32_t *dst = output;
 
-      /* Each loop processes 16 pixels. */
-      for (w = 0; w + 16 <= width; w += 16, src += 32, dst += 16)
+      /* Same steps as the SSE2 version, for 32 pixels. Each 128-bit
+       * lane holds 8 pixels of yuv0 or yuv1, so the results are
+       * reordered when storing. */
+      for (w = 0; w + 32 <= width; w += 32, src += 64, dst += 32)
       {
-         __m128i yuv0 = _mm_loadu_si128((const __m128i*)(src +  0)); /* [Y0, U0, Y1, V0, Y2, U1, Y3, V1, ...] */
-         __m128i yuv1 = _mm_loadu_si128((const __m128i*)(src + 16)); /* [Y0, U0, Y1, V0, Y2, U1, Y3, V1, ...] */
-
-         __m128i _y0 = _mm_and_si128(yuv0, mask_y); /* [Y0, Y1, Y2, ...] (16-bit) */
-         __m128i u0 = _mm_and_si128(yuv0, mask_u); /* [0, U0, 0, 0, 0, U1, 0, 0, ...] */
-         __m128i v0 = _mm_and_si128(yuv0, mask_v); /* [0, 0, 0, V1, 0, , 0, V1, ...] */
-         __m128i _y1 = _mm_and_si128(yuv1, mask_y); /* [Y0, Y1, Y2, ...] (16-bit) */
-         __m128i u1 = _mm_and_si128(yuv1, mask_u); /* [0, U0, 0, 0, 0, U1, 0, 0, ...] */
-         __m128i v1 = _mm_and_si128(yuv1, mask_v); /* [0, 0, 0, V1, 0, , 0, V1, ...] */
-
-         /* Juggle around to get U and V in the same 16-bit format as Y. */
-         u0 = _mm_srli_si128(u0, 1);
-         v0 = _mm_srli_si128(v0, 3);
-         u1 = _mm_srli_si128(u1, 1);
-         v1 = _mm_srli_si128(v1, 3);
-         __m128i u = _mm_packs_epi32(u0, u1);
-         __m128i v = _mm_packs_epi32(v0, v1);
-
-         /* Apply YUV offsets (U, V) -= (-128, -128). */
-         u = _mm_sub_epi16(u, chroma_offset);
-         v = _mm_sub_epi16(v, chroma_offset);
-
-         /* Upscale chroma horizontally (nearest). */
-         u0 = _mm_unpacklo_epi16(u, u);
-         u1 = _mm_unpackhi_epi16(u, u);
-         v0 = _mm_unpacklo_epi16(v, v);
-         v1 = _mm_unpackhi_epi16(v, v);
-
-         /* Apply transformations. */
-         _y0 = _mm_mullo_epi16(_y0, yuv_mul);
-         _y1 = _mm_mullo_epi16(_y1, yuv_mul);
-         __m128i u0_g   = _mm_mullo_epi16(u0, u_g_mul);
-         __m128i u1_g   = _mm_mullo_epi16(u1, u_g_mul);
-         __m128i u0_b   = _mm_mullo_epi16(u0, u_b_mul);
-         __m128i u1_b   = _mm_mullo_epi16(u1, u_b_mul);
-         __m128i v0_r   = _mm_mullo_epi16(v0, v_r_mul);
-         __m128i v1_r   = _mm_mullo_epi16(v1, v_r_mul);
-         __m128i v0_g   = _mm_mullo_epi16(v0, v_g_mul);
-         __m128i v1_g   = _mm_mullo_epi16(v1, v_g_mul);
-
-         /* Add contibutions from the transformed components. */
-         __m128i r0 = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(_y0, v0_r),
-                  round_offset), YUV_SHIFT);
-         __m128i g0 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_mm_adds_epi16(_y0, v0_g), u0_g), round_offset), YUV_SHIFT);
-         __m128i b0 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_y0, u0_b), round_offset), YUV_SHIFT);
-
-         __m128i r1 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_y1, v1_r), round_offset), YUV_SHIFT);
-         __m128i g1 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_mm_adds_epi16(_y1, v1_g), u1_g), round_offset), YUV_SHIFT);
-         __m128i b1 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_y1, u1_b), round_offset), YUV_SHIFT);
-
-         /* Saturate into 8-bit. */
-         r0 = _mm_packus_epi16(r0, r1);
-         g0 = _mm_packus_epi16(g0, g1);
-         b0 = _mm_packus_epi16(b0, b1);
-
-         /* Interleave into ARGB. */
-         __m128i res_lo_bg = _mm_unpacklo_epi8(b0, g0);
-         __m128i res_hi_bg = _mm_unpackhi_epi8(b0, g0);
-         __m128i res_lo_ra = _mm_unpacklo_epi8(r0, a);
-         __m128i res_hi_ra = _mm_unpackhi_epi8(r0, a);
-         __m128i res0 = _mm_unpacklo_epi16(res_lo_bg, res_lo_ra);
-         __m128i res1 = _mm_unpackhi_epi16(res_lo_bg, res_lo_ra);
-         __m128i res2 = _mm_unpacklo_epi16(res_hi_bg, res_hi_ra);
-         __m128i res3 = _mm_unpackhi_epi16(res_hi_bg, res_hi_ra);
-
-         _mm_storeu_si128((__m128i*)(dst +  0), res0);
-         _mm_storeu_si128((__m128i*)(dst +  4), res1);
-         _mm_storeu_si128((__m128i*)(dst +  8), res2);
-         _mm_storeu_si128((__m128i*)(dst + 12), res3);
+         __m256i yuv0 = _mm256_loadu_si256((const __m256i*)(src +  0));
+         __m256i yuv1 = _mm256_loadu_si256((const __m256i*)(src + 32));
+
+         __m256i _y0 = _mm256_and_si256(yuv0, mask_y);
+         __m256i u0 = _mm256_srli_si256(_mm256_and_si256(yuv0, mask_u), 1);
+         __m256i v0 = _mm256_srli_si256(_mm256_and_si256(yuv0, mask_v), 3);
+         __m256i _y1 = _mm256_and_si256(yuv1, mask_y);
+         __m256i u1 = _mm256_srli_si256(_mm256_and_si256(yuv1, mask_u), 1);
+         __m256i v1 = _mm256_srli_si256(_mm256_and_si256(yuv1, mask_v), 3);
+         __m256i u = _mm256_sub_epi16(_mm256_packs_epi32(u0, u1), chroma_offset);
+         __m256i v = _mm256_sub_epi16(_mm256_packs_epi32(v0, v1), chroma_offset);
+         __m256i r0, g0, b0, r1, g1, b1, bg_lo, bg_hi, ra_lo, ra_hi;
+
+         u0 = _mm256_unpacklo_epi16(u, u);
+         u1 = _mm256_unpackhi_epi16(u, u);
+         v0 = _mm256_unpacklo_epi16(v, v);
+         v1 = _mm256_unpackhi_epi16(v, v);
+
+         _y0 = _mm256_mullo_epi16(_y0, yuv_mul);
+         _y1 = _mm256_mullo_epi16(_y1, yuv_mul);
+
+         r0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y0,
+                     _mm256_mullo_epi16(v0, v_r_mul)), round_offset), YUV_SHIFT);
+         g0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(_y0, _mm256_mullo_epi16(v0, v_g_mul)),
+                     _mm256_mullo_epi16(u0, u_g_mul)), round_offset), YUV_SHIFT);
+         b0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y0,
+                     _mm256_mullo_epi16(u0, u_b_mul)), round_offset), YUV_SHIFT);
+
+         r1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y1,
+                     _mm256_mullo_epi16(v1, v_r_mul)), round_offset), YUV_SHIFT);
+         g1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(_y1, _mm256_mullo_epi16(v1, v_g_mul)),
+                     _mm256_mullo_epi16(u1, u_g_mul)), round_offset), YUV_SHIFT);
+         b1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y1,
+                     _mm256_mullo_epi16(u1, u_b_mul)), round_offset), YUV_SHIFT);
+
+         r0 = _mm256_packus_epi16(r0, r1);
+         g0 = _mm256_packus_epi16(g0, g1);
+         b0 = _mm256_packus_epi16(b0, b1);
+
+         bg_lo = _mm256_unpacklo_epi8(b0, g0);
+         bg_hi = _mm256_unpackhi_epi8(b0, g0);
+         ra_lo = _mm256_unpacklo_epi8(r0, a);
+         ra_hi = _mm256_unpackhi_epi8(r0, a);
+
+         store_argb8888_avx2(dst +  0,
+               _mm256_unpacklo_epi16(bg_lo, ra_lo),
+               _mm256_unpackhi_epi16(bg_lo, ra_lo));
+         store_argb8888_avx2(dst + 16,
+               _mm256_unpacklo_epi16(bg_hi, ra_hi),
+               _mm256_unpackhi_epi16(bg_hi, ra_hi));
       }
 
-      /* Finish off the rest (if any) in C. */
-      for (; w < width; w += 2, src += 4, dst += 2)
-      {
-         int _y0 = src[0];
-         int  u = src[1] - 128;
-         int _y1 = src[2];
-         int  v = src[3] - 128;
+      conv_yuyv_argb8888_C(dst, src, width - w, 1, out_stride, in_stride);
+   }
+}
+#endif
 
-         uint8_t r0 = clamp_8bit((YUV_MAT_Y * _y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t g0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t b0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+typedef void (*pixconv_func_t)(void*, const void*, int, int, int, int);
 
-         uint8_t r1 = clamp_8bit((YUV_MAT_Y * _y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t g1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t b1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+#ifdef PIXCONV_HAVE_SSE2
+#define PIXCONV_SSE2(name) name##_SSE2
+#else
+#define PIXCONV_SSE2(name) NULL
+#endif
 
-         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
-         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
-      }
-   }
-}
+#ifdef PIXCONV_HAVE_AVX2
+#define PIXCONV_AVX2(name) name##_AVX2
 #else
-void conv_yuyv_argb8888(void *output_, const void *input_,
-      int width, int height,
-      int out_stride, int in_stride)
-{
-   int h, w;
-   const uint8_t *input = (const uint8_t*)input_;
-   uint32_t *output     = (uint32_t*)output_;
+#define PIXCONV_AVX2(name) NULL
+#endif
 
-   for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride)
-   {
-      const uint8_t *src = input;
-      uint32_t *dst = output;
+/* Until conv_init_simd is called, use what the compiler targets. */
+#ifdef __SSE2__
+#define PIXCONV_DEFAULT(name) name##_SSE2
+#else
+#define PIXCONV_DEFAULT(name) name##_C
+#endif
 
-      for (w = 0; w < width; w += 2, src += 4, dst += 2)
-      {
-         int _y0 = src[0];
-         int  u = src[1] - 128;
-         int _y1 = src[2];
-         int  v = src[3] - 128;
+#define PIXCONV_DISPATCH(name) \
+static pixconv_func_t name##_func = PIXCONV_DEFAULT(name); \
+void name(void *output, const void *input, \
+      int width, int height, \
+      int out_stride, int in_stride) \
+{ \
+   name##_func(output, input, width, height, out_stride, in_stride); \
+}
 
-         uint8_t r0 = clamp_8bit((YUV_MAT_Y * _y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t g0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t b0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+PIXCONV_DISPATCH(conv_rgb565_0rgb1555)
+PIXCONV_DISPATCH(conv_0rgb1555_rgb565)
+PIXCONV_DISPATCH(conv_0rgb1555_argb8888)
+PIXCONV_DISPATCH(conv_rgb565_argb8888)
+PIXCONV_DISPATCH(conv_rgba4444_argb8888)
+PIXCONV_DISPATCH(conv_0rgb1555_bgr24)
+PIXCONV_DISPATCH(conv_rgb565_bgr24)
+PIXCONV_DISPATCH(conv_bgr24_argb8888)
+PIXCONV_DISPATCH(conv_argb8888_0rgb1555)
+PIXCONV_DISPATCH(conv_argb8888_rgb565)
+PIXCONV_DISPATCH(conv_argb8888_bgr24)
+PIXCONV_DISPATCH(conv_argb8888_abgr8888)
+PIXCONV_DISPATCH(conv_yuyv_argb8888)
+
+struct pixconv_impl
+{
+   pixconv_func_t *func;
+   pixconv_func_t c;
+   pixconv_func_t sse2;
+   pixconv_func_t avx2;
+};
+
+#define PIXCONV_IMPL(name, sse2, avx2) \
+   { &name##_func, name##_C, sse2(name), avx2(name) }
+#define PIXCONV_NONE(name) NULL
+
+static const struct pixconv_impl pixconv_impls[] = {
+   PIXCONV_IMPL(conv_rgb565_0rgb1555,   PIXCONV_SSE2, PIXCONV_AVX2),
+   PIXCONV_IMPL(conv_0rgb1555_rgb565,   PIXCONV_SSE2, PIXCONV_AVX2),
+   PIXCONV_IMPL(conv_0rgb1555_argb8888, PIXCONV_SSE2, PIXCONV_AVX2),
+   PIXCONV_IMPL(conv_rgb565_argb8888,   PIXCONV_SSE2, PIXCONV_AVX2),
+   PIXCONV_IMPL(conv_rgba4444_argb8888, PIXCONV_SSE2, PIXCONV_AVX2),
+   PIXCONV_IMPL(conv_0rgb1555_bgr24,    PIXCONV_SSE2, PIXCONV_NONE),
+   PIXCONV_IMPL(conv_rgb565_bgr24,      PIXCONV_SSE2, PIXCONV_NONE),
+   PIXCONV_IMPL(conv_bgr24_argb8888,    PIXCONV_SSE2, PIXCONV_NONE),
+   PIXCONV_IMPL(conv_argb8888_0rgb1555, PIXCONV_SSE2, PIXCONV_AVX2),
+   PIXCONV_IMPL(conv_argb8888_rgb565,   PIXCONV_SSE2, PIXCONV_AVX2),
+   PIXCONV_IMPL(conv_argb8888_bgr24,    PIXCONV_SSE2, PIXCONV_NONE),
+   PIXCONV_IMPL(conv_argb8888_abgr8888, PIXCONV_SSE2, PIXCONV_AVX2),
+   PIXCONV_IMPL(conv_yuyv_argb8888,     PIXCONV_SSE2, PIXCONV_AVX2),
+};
+
+/**
+ * conv_init_simd:
+ * @mask             : SIMD features of the CPU, PIXCONV_SIMD_*.
+ *
+ * Picks the fastest version of each conversion the CPU supports.
+ * Not thread-safe, call it before converting any frames.
+ **/
+void conv_init_simd(pixconv_simd_mask_t mask)
+{
+   unsigned i;
 
-         uint8_t r1 = clamp_8bit((YUV_MAT_Y * _y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t g1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
-         uint8_t b1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+   for (i = 0; i < sizeof(pixconv_impls) / sizeof(pixconv_impls[0]); i++)
+   {
+      const struct pixconv_impl *impl = &pixconv_impls[i];
 
-         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
-         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
-      }
+      *impl->func = impl->c;
+      if (impl->sse2 && (mask & PIXCONV_SIMD_SSE2))
+         *impl->func = impl->sse2;
+      if (impl->avx2 && (mask & PIXCONV_SIMD_AVX2))
+         *impl->func = impl->avx2;
    }
 }
-#endif
 
 void conv_copy(void *output_, const void *input_,
       int width, int height,
@@ -931,4 +1696,3 @@ void conv_copy(void *output_, const void *input_,
          h++, output += out_stride, input += in_stride)
       memcpy(output, input, copy_len);
 }
-
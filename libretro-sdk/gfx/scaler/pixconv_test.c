@@ -0,0 +1,263 @@
+/* Copyright  (C) 2010-2015 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (pixconv_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gfx/scaler/pixconv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/* Checks every SIMD version of the conversions against the C one,
+ * on sizes that exercise the unaligned tails, and times them with
+ * "bench". NEON versions are not covered yet. */
+
+#define PAD_BYTES 64
+#define CANARY    0xcd
+
+typedef void (*conv_func_t)(void*, const void*, int, int, int, int);
+
+struct conv_test
+{
+   const char *name;
+   conv_func_t func;
+   int in_bpp;
+   int out_bpp;
+   /* Width is in pixel pairs. */
+   int pairs;
+};
+
+#define CONV_TEST(name, in_bpp, out_bpp, pairs) { #name, name, in_bpp, out_bpp, pairs }
+
+static const struct conv_test conv_tests[] = {
+   CONV_TEST(conv_rgb565_0rgb1555,   2, 2, 0),
+   CONV_TEST(conv_0rgb1555_rgb565,   2, 2, 0),
+   CONV_TEST(conv_0rgb1555_argb8888, 2, 4, 0),
+   CONV_TEST(conv_rgb565_argb8888,   2, 4, 0),
+   CONV_TEST(conv_rgba4444_argb8888, 2, 4, 0),
+   CONV_TEST(conv_0rgb1555_bgr24,    2, 3, 0),
+   CONV_TEST(conv_rgb565_bgr24,      2, 3, 0),
+   CONV_TEST(conv_bgr24_argb8888,    3, 4, 0),
+   CONV_TEST(conv_argb8888_0rgb1555, 4, 2, 0),
+   CONV_TEST(conv_argb8888_rgb565,   4, 2, 0),
+   CONV_TEST(conv_argb8888_bgr24,    4, 3, 0),
+   CONV_TEST(conv_argb8888_abgr8888, 4, 4, 0),
+   CONV_TEST(conv_yuyv_argb8888,     2, 4, 1),
+};
+
+struct simd_level
+{
+   const char *name;
+   pixconv_simd_mask_t mask;
+};
+
+static const struct simd_level simd_levels[] = {
+   { "C",    0 },
+   { "SSE2", PIXCONV_SIMD_SSE2 },
+   { "AVX2", PIXCONV_SIMD_SSE2 | PIXCONV_SIMD_AVX2 },
+};
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng_next(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static double time_now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int simd_supported(pixconv_simd_mask_t mask)
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+   __builtin_cpu_init();
+   if ((mask & PIXCONV_SIMD_SSE2) && !__builtin_cpu_supports("sse2"))
+      return 0;
+   if ((mask & PIXCONV_SIMD_AVX2) && !__builtin_cpu_supports("avx2"))
+      return 0;
+   return 1;
+#else
+   return !mask;
+#endif
+}
+
+static uint8_t *alloc_frame(int stride, int height)
+{
+   uint8_t *frame = (uint8_t*)malloc(stride * height + PAD_BYTES);
+
+   if (!frame)
+   {
+      fprintf(stderr, "Out of memory.\n");
+      exit(1);
+   }
+
+   return frame;
+}
+
+/* Converts with the C version and @level, returns 0 if the output,
+ * including the padding past each row, is the same. */
+static int check_conv(const struct conv_test *test,
+      const struct simd_level *level, int width, int height)
+{
+   int i, ret;
+   int in_stride   = width * test->in_bpp + (rng_next() % 4) * 4;
+   int out_stride  = width * test->out_bpp + (rng_next() % 4) * 4;
+   size_t in_size  = in_stride * height + PAD_BYTES;
+   size_t out_size = out_stride * height + PAD_BYTES;
+   uint8_t *input  = alloc_frame(in_stride, height);
+   uint8_t *ref    = alloc_frame(out_stride, height);
+   uint8_t *output = alloc_frame(out_stride, height);
+
+   for (i = 0; i < (int)in_size; i++)
+      input[i] = rng_next() >> 24;
+
+   memset(ref, CANARY, out_size);
+   memset(output, CANARY, out_size);
+
+   conv_init_simd(0);
+   test->func(ref, input, width, height, out_stride, in_stride);
+
+   conv_init_simd(level->mask);
+   test->func(output, input, width, height, out_stride, in_stride);
+
+   ret = memcmp(ref, output, out_size);
+
+   if (ret)
+   {
+      for (i = 0; ref[i] == output[i]; i++);
+      fprintf(stderr, "%s %s: %dx%d differs at row %d, byte %d.\n",
+            test->name, level->name, width, height,
+            i / out_stride, i % out_stride);
+   }
+
+   free(input);
+   free(ref);
+   free(output);
+   return ret;
+}
+
+static int run_checks(void)
+{
+   unsigned i, j;
+   int width, failed = 0, checked = 0;
+
+   for (i = 0; i < sizeof(conv_tests) / sizeof(conv_tests[0]); i++)
+   {
+      const struct conv_test *test = &conv_tests[i];
+
+      for (j = 1; j < sizeof(simd_levels) / sizeof(simd_levels[0]); j++)
+      {
+         const struct simd_level *level = &simd_levels[j];
+
+         if (!simd_supported(level->mask))
+            continue;
+
+         /* Every width up to a few vectors, then some large ones. */
+         for (width = 1; width <= 100; width++)
+         {
+            if (test->pairs && (width & 1))
+               continue;
+            failed |= check_conv(test, level, width, 3);
+            checked++;
+         }
+
+         failed |= check_conv(test, level, 1280, 17);
+         failed |= check_conv(test, level, 1922, 5);
+         checked += 2;
+      }
+   }
+
+   fprintf(stderr, "%d checks, %s.\n", checked, failed ? "FAILED" : "all passed");
+   return failed ? 1 : 0;
+}
+
+static void run_bench(int frames)
+{
+   unsigned i, j;
+   const int width  = 1920;
+   const int height = 1080;
+
+   fprintf(stderr, "%-24s", "ms per 1920x1080 frame");
+   for (j = 0; j < sizeof(simd_levels) / sizeof(simd_levels[0]); j++)
+      fprintf(stderr, "%8s", simd_levels[j].name);
+   fprintf(stderr, "\n");
+
+   for (i = 0; i < sizeof(conv_tests) / sizeof(conv_tests[0]); i++)
+   {
+      const struct conv_test *test = &conv_tests[i];
+      int in_stride   = width * test->in_bpp;
+      int out_stride  = width * test->out_bpp;
+      uint8_t *input  = alloc_frame(in_stride, height);
+      uint8_t *output = alloc_frame(out_stride, height);
+
+      memset(input, 0x5a, in_stride * height);
+      fprintf(stderr, "%-24s", test->name + strlen("conv_"));
+
+      for (j = 0; j < sizeof(simd_levels) / sizeof(simd_levels[0]); j++)
+      {
+         int f;
+         double start;
+
+         if (!simd_supported(simd_levels[j].mask))
+         {
+            fprintf(stderr, "%8s", "-");
+            continue;
+         }
+
+         conv_init_simd(simd_levels[j].mask);
+         test->func(output, input, width, height, out_stride, in_stride);
+
+         start = time_now();
+         for (f = 0; f < frames; f++)
+            test->func(output, input, width, height, out_stride, in_stride);
+         fprintf(stderr, "%8.3f", (time_now() - start) * 1000 / frames);
+      }
+
+      fprintf(stderr, "\n");
+      free(input);
+      free(output);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc > 1 && strcmp(argv[1], "bench") == 0)
+   {
+      run_bench(argc > 2 ? atoi(argv[2]) : 100);
+      return 0;
+   }
+
+   if (argc > 1)
+   {
+      fprintf(stderr, "Usage: %s [bench [frames]]\n", argv[0]);
+      return 1;
+   }
+
+   return run_checks();
+}
@@ -24,11 +24,16 @@
 #include <gfx/scaler/scaler_int.h>
 #include <gfx/scaler/filter.h>
 #include <gfx/scaler/pixconv.h>
+#include <retro_inline.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 /* In case aligned allocs are needed later. */
 
 /**
@@ -61,33 +66,125 @@ void scaler_free(void *ptr)
       free(ptr);
 }
 
+/* Strips are sized so their intermediate rows take about this much. */
+#define SCALER_STRIP_BYTES   (256 * 1024)
+
+/* Output pixels per thread below which frames are not split. */
+#define SCALER_THREAD_PIXELS (128 * 1024)
+
+struct scaler_workers;
+
+struct scaler_worker
+{
+   struct scaler_workers *pool;
+
+   uint32_t *input;
+   uint64_t *scaled;
+   uint32_t *output;
+
+   /* Input rows held in scaled, reused by the next strip. */
+   int scaled_y;
+   int scaled_rows;
+
+   /* Output rows of the current frame. */
+   int out_y;
+   int out_rows;
+
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+#endif
+};
+
+struct scaler_workers
+{
+   const struct scaler_ctx *ctx;
+   struct scaler_worker *worker;
+   unsigned count;
+
+   void *output;
+   const void *input;
+
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+   scond_t *done;
+   unsigned frame;
+   unsigned pending;
+   bool quit;
+#endif
+};
+
+/* Input rows needed for output rows @y to @y + @rows. */
+static INLINE int scaler_strip_in_rows(const struct scaler_ctx *ctx,
+      int y, int rows)
+{
+   return ctx->vert.filter_pos[y + rows - 1] + ctx->vert.filter_len
+      - ctx->vert.filter_pos[y];
+}
+
 static bool allocate_frames(struct scaler_ctx *ctx)
 {
+   int y, row_size, in_rows;
+
    ctx->scaled.stride = ((ctx->out_width + 7) & ~7) * sizeof(uint64_t);
    ctx->scaled.width  = ctx->out_width;
-   ctx->scaled.height = ctx->in_height;
-   ctx->scaled.frame  = (uint64_t*)
-      scaler_alloc(sizeof(uint64_t),
-            (ctx->scaled.stride * ctx->scaled.height) >> 3);
-   if (!ctx->scaled.frame)
-      return false;
+   ctx->input.stride  = ((ctx->in_width + 7) & ~7) * sizeof(uint32_t);
+   ctx->output.stride = ((ctx->out_width + 7) & ~7) * sizeof(uint32_t);
+
+   if (ctx->unscaled)
+   {
+      ctx->strip_height = ctx->out_height;
+      return true;
+   }
+
+   /* Fit the input rows of a strip into SCALER_STRIP_BYTES. */
+   row_size = ctx->scaler_special ? ctx->input.stride : ctx->scaled.stride;
+   in_rows  = SCALER_STRIP_BYTES / row_size - ctx->vert.filter_len + 1;
+   if (in_rows < 1)
+      in_rows = 1;
+
+   ctx->strip_height = (int)((int64_t)in_rows
+         * ctx->out_height / ctx->in_height);
+   if (ctx->strip_height < 1)
+      ctx->strip_height = 1;
+   if (ctx->strip_height > ctx->out_height)
+      ctx->strip_height = ctx->out_height;
+
+   /* Strips of workers may start at any row. */
+   in_rows = 0;
+   for (y = 0; y + ctx->strip_height <= ctx->out_height; y++)
+   {
+      int rows = scaler_strip_in_rows(ctx, y, ctx->strip_height);
+      if (rows > in_rows)
+         in_rows = rows;
+   }
+
+   ctx->input.height  = in_rows;
+   ctx->scaled.height = in_rows;
+
+   if (!ctx->scaler_special)
+   {
+      ctx->scaled.frame  = (uint64_t*)
+         scaler_alloc(sizeof(uint64_t),
+               (ctx->scaled.stride * ctx->scaled.height) >> 3);
+      if (!ctx->scaled.frame)
+         return false;
+   }
 
    if (ctx->in_fmt != SCALER_FMT_ARGB8888)
    {
-      ctx->input.stride = ((ctx->in_width + 7) & ~7) * sizeof(uint32_t);
       ctx->input.frame = (uint32_t*)
          scaler_alloc(sizeof(uint32_t),
-               (ctx->input.stride * ctx->in_height) >> 2);
+               (ctx->input.stride * ctx->input.height) >> 2);
       if (!ctx->input.frame)
          return false;
    }
 
    if (ctx->out_fmt != SCALER_FMT_ARGB8888)
    {
-      ctx->output.stride = ((ctx->out_width + 7) & ~7) * sizeof(uint32_t);
       ctx->output.frame  = (uint32_t*)
          scaler_alloc(sizeof(uint32_t),
-               (ctx->output.stride * ctx->out_height) >> 2);
+               (ctx->output.stride * ctx->strip_height) >> 2);
       if (!ctx->output.frame)
          return false;
    }
@@ -95,6 +192,241 @@ static bool allocate_frames(struct scaler_ctx *ctx)
    return true;
 }
 
+/**
+ * scaler_ctx_scale_strip:
+ * @ctx          : pointer to scaler context object.
+ * @worker       : buffers of the thread scaling the strip.
+ * @output       : pointer to output image.
+ * @input        : pointer to input image.
+ * @out_y        : first output row of the strip.
+ * @rows         : number of output rows.
+ *
+ * Converts the input rows needed by the strip, scales them and
+ * converts the result, so the rows stay in cache between the steps.
+ **/
+static void scaler_ctx_scale_strip(const struct scaler_ctx *ctx,
+      struct scaler_worker *worker, uint8_t *output, const uint8_t *input,
+      int out_y, int rows)
+{
+   int in_y, in_rows, keep = 0;
+   int src_stride          = ctx->in_stride;
+   int dst_stride          = ctx->out_stride;
+   const uint8_t *src      = NULL;
+   uint8_t *dst            = output + out_y * ctx->out_stride;
+   const int scaled_stride = ctx->scaled.stride >> 3;
+
+   if (ctx->unscaled)
+   {
+      ctx->direct_pixconv(dst, input + out_y * ctx->in_stride,
+            ctx->out_width, rows,
+            ctx->out_stride, ctx->in_stride);
+      return;
+   }
+
+   in_y    = ctx->vert.filter_pos[out_y];
+   in_rows = scaler_strip_in_rows(ctx, out_y, rows);
+
+   /* Overlapping rows of the previous strip are already scaled. */
+   if (!ctx->scaler_special && worker->scaled_rows
+         && in_y >= worker->scaled_y
+         && in_y < worker->scaled_y + worker->scaled_rows)
+   {
+      keep = worker->scaled_y + worker->scaled_rows - in_y;
+      if (keep > in_rows)
+         keep = in_rows;
+
+      memmove(worker->scaled,
+            worker->scaled + (in_y - worker->scaled_y) * scaled_stride,
+            keep * ctx->scaled.stride);
+   }
+
+   src = input + (in_y + keep) * ctx->in_stride;
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   {
+      ctx->in_pixconv(worker->input, src,
+            ctx->in_width, in_rows - keep,
+            ctx->input.stride, ctx->in_stride);
+
+      src        = (const uint8_t*)worker->input;
+      src_stride = ctx->input.stride;
+   }
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+   {
+      dst        = (uint8_t*)worker->output;
+      dst_stride = ctx->output.stride;
+   }
+
+   if (ctx->scaler_special)
+   {
+      /* Take some special, and (hopefully) more optimized path. */
+      ctx->scaler_special(ctx, dst, dst_stride,
+            src, src_stride, in_y, out_y, rows);
+   }
+   else
+   {
+      /* Take generic filter path. */
+      ctx->scaler_horiz(ctx, src, src_stride,
+            worker->scaled + keep * scaled_stride, in_rows - keep);
+      ctx->scaler_vert(ctx, dst, dst_stride,
+            worker->scaled, in_y, out_y, rows);
+
+      worker->scaled_y    = in_y;
+      worker->scaled_rows = in_rows;
+   }
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+      ctx->out_pixconv(output + out_y * ctx->out_stride, worker->output,
+            ctx->out_width, rows,
+            ctx->out_stride, ctx->output.stride);
+}
+
+static void scaler_ctx_scale_rows(const struct scaler_ctx *ctx,
+      struct scaler_worker *worker, void *output, const void *input)
+{
+   int y;
+   int end = worker->out_y + worker->out_rows;
+
+   worker->scaled_rows = 0;
+
+   for (y = worker->out_y; y < end; y += ctx->strip_height)
+   {
+      int rows = end - y;
+      if (rows > ctx->strip_height)
+         rows = ctx->strip_height;
+
+      scaler_ctx_scale_strip(ctx, worker,
+            (uint8_t*)output, (const uint8_t*)input, y, rows);
+   }
+}
+
+#ifdef HAVE_THREADS
+static void scaler_worker_thread(void *data)
+{
+   struct scaler_worker *worker = (struct scaler_worker*)data;
+   struct scaler_workers *pool  = worker->pool;
+   unsigned frame               = 0;
+
+   for (;;)
+   {
+      bool quit;
+
+      slock_lock(pool->lock);
+      while (pool->frame == frame && !pool->quit)
+         scond_wait(pool->cond, pool->lock);
+      frame = pool->frame;
+      quit  = pool->quit;
+      slock_unlock(pool->lock);
+
+      if (quit)
+         break;
+
+      if (worker->out_rows)
+         scaler_ctx_scale_rows(pool->ctx, worker,
+               pool->output, pool->input);
+
+      slock_lock(pool->lock);
+      if (--pool->pending == 0)
+         scond_signal(pool->done);
+      slock_unlock(pool->lock);
+   }
+}
+
+static void scaler_workers_free(struct scaler_ctx *ctx)
+{
+   unsigned i;
+   struct scaler_workers *pool = (struct scaler_workers*)ctx->workers;
+
+   if (!pool)
+      return;
+
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->quit = true;
+      scond_broadcast(pool->cond);
+      slock_unlock(pool->lock);
+   }
+
+   /* Worker 0 is the calling thread, using the buffers of ctx. */
+   for (i = 1; i < pool->count; i++)
+   {
+      struct scaler_worker *worker = &pool->worker[i];
+
+      if (worker->thread)
+         sthread_join(worker->thread);
+
+      scaler_free(worker->input);
+      scaler_free(worker->scaled);
+      scaler_free(worker->output);
+   }
+
+   if (pool->lock)
+      slock_free(pool->lock);
+   if (pool->cond)
+      scond_free(pool->cond);
+   if (pool->done)
+      scond_free(pool->done);
+
+   free(pool->worker);
+   free(pool);
+   ctx->workers = NULL;
+}
+
+static bool scaler_workers_new(struct scaler_ctx *ctx)
+{
+   unsigned i;
+   struct scaler_workers *pool = (struct scaler_workers*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return false;
+
+   ctx->workers = pool;
+   pool->ctx    = ctx;
+   pool->worker = (struct scaler_worker*)
+      calloc(ctx->threads, sizeof(*pool->worker));
+   pool->lock   = slock_new();
+   pool->cond   = scond_new();
+   pool->done   = scond_new();
+
+   if (!pool->worker || !pool->lock || !pool->cond || !pool->done)
+      return false;
+
+   pool->worker[0].pool = pool;
+
+   for (i = 1; i < ctx->threads; i++)
+   {
+      struct scaler_worker *worker = &pool->worker[i];
+
+      worker->pool   = pool;
+      pool->count    = i + 1;
+
+      if (ctx->scaled.frame)
+         worker->scaled = (uint64_t*)scaler_alloc(sizeof(uint64_t),
+               (ctx->scaled.stride * ctx->scaled.height) >> 3);
+      if (ctx->input.frame)
+         worker->input  = (uint32_t*)scaler_alloc(sizeof(uint32_t),
+               (ctx->input.stride * ctx->input.height) >> 2);
+      if (ctx->output.frame)
+         worker->output = (uint32_t*)scaler_alloc(sizeof(uint32_t),
+               (ctx->output.stride * ctx->strip_height) >> 2);
+
+      if ((ctx->scaled.frame && !worker->scaled)
+            || (ctx->input.frame && !worker->input)
+            || (ctx->output.frame && !worker->output))
+         return false;
+
+      worker->thread = sthread_create(scaler_worker_thread, worker);
+      if (!worker->thread)
+         return false;
+   }
+
+   return true;
+}
+#endif
+
 /**
  * set_direct_pix_conv:
  * @ctx          : pointer to scaler context object.
@@ -226,9 +558,6 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 
    ctx->scaler_special = NULL;
 
-   if (!allocate_frames(ctx))
-      return false;
-
    if (ctx->unscaled)
    {
       if (!set_direct_pix_conv(ctx))
@@ -240,14 +569,30 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
          return false;
    }
 
+   /* Strip sizes depend on the filter. */
    if (!ctx->unscaled && !scaler_gen_filter(ctx))
       return false;
 
+   if (!allocate_frames(ctx))
+      return false;
+
+#ifdef HAVE_THREADS
+   if (ctx->threads > 1 && !scaler_workers_new(ctx))
+   {
+      scaler_workers_free(ctx);
+      return false;
+   }
+#endif
+
    return true;
 }
 
 void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 {
+#ifdef HAVE_THREADS
+   scaler_workers_free(ctx);
+#endif
+
    scaler_free(ctx->horiz.filter);
    scaler_free(ctx->horiz.filter_pos);
    scaler_free(ctx->vert.filter);
@@ -274,55 +619,76 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 void scaler_ctx_scale(struct scaler_ctx *ctx,
       void *output, const void *input)
 {
-   const void *input_frame = input;
-   void *output_frame      = output;
-   int input_stride        = ctx->in_stride;
-   int output_stride       = ctx->out_stride;
-
+   struct scaler_worker worker = {0};
+#ifdef HAVE_THREADS
+   unsigned i, count, strips, per_worker;
+   struct scaler_workers *pool = (struct scaler_workers*)ctx->workers;
+#endif
+
+   worker.input    = ctx->input.frame;
+   worker.scaled   = ctx->scaled.frame;
+   worker.output   = ctx->output.frame;
+   worker.out_rows = ctx->out_height;
+
+   /* Unscaled conversions may change size without a new filter. */
    if (ctx->unscaled)
-   {
-      /* Just perform straight pixel conversion. */
-      ctx->direct_pixconv(output, input,
-            ctx->out_width, ctx->out_height,
-            ctx->out_stride, ctx->in_stride);
-      return;
-   }
+      ctx->strip_height = ctx->out_height;
 
-   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
-   {
-      ctx->in_pixconv(ctx->input.frame, input,
-            ctx->in_width, ctx->in_height,
-            ctx->input.stride, ctx->in_stride);
+#ifdef HAVE_THREADS
+   if (!pool || ctx->out_height < 2)
+      goto single;
 
-      input_frame       = ctx->input.frame;
-      input_stride      = ctx->input.stride;
-   }
+   count = (unsigned)((int64_t)ctx->out_width * ctx->out_height
+         / SCALER_THREAD_PIXELS);
+   if (count > pool->count)
+      count = pool->count;
 
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
-   {
-      output_frame  = ctx->output.frame;
-      output_stride = ctx->output.stride;
-   }
+   /* Unscaled conversions split at any row. */
+   strips = ctx->out_height;
+   if (!ctx->unscaled)
+      strips = (ctx->out_height + ctx->strip_height - 1) / ctx->strip_height;
+   if (count > strips)
+      count = strips;
 
-   if (ctx->scaler_special)
-   {
-      /* Take some special, and (hopefully) more optimized path. */
-      ctx->scaler_special(ctx, output_frame, input_frame,
-            ctx->out_width, ctx->out_height,
-            ctx->in_width, ctx->in_height,
-            output_stride, input_stride);
-   }
-   else
+   if (count < 2)
+      goto single;
+
+   per_worker = (strips + count - 1) / count;
+   if (!ctx->unscaled)
+      per_worker *= ctx->strip_height;
+
+   /* Split whole strips of output rows between the workers. */
+   for (i = 0; i < pool->count; i++)
    {
-      /* Take generic filter path. */
-      if (ctx->scaler_horiz)
-         ctx->scaler_horiz(ctx, input_frame, input_stride);
-      if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
+      int y = i * per_worker;
+
+      pool->worker[i].out_y    = y;
+      pool->worker[i].out_rows = 0;
+
+      if (i < count && y < ctx->out_height)
+         pool->worker[i].out_rows = (y + (int)per_worker > ctx->out_height)
+            ? ctx->out_height - y : (int)per_worker;
    }
 
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
-      ctx->out_pixconv(output, ctx->output.frame,
-            ctx->out_width, ctx->out_height,
-            ctx->out_stride, ctx->output.stride);
+   worker.out_rows = pool->worker[0].out_rows;
+
+   slock_lock(pool->lock);
+   pool->output  = output;
+   pool->input   = input;
+   pool->pending = pool->count - 1;
+   pool->frame++;
+   scond_broadcast(pool->cond);
+   slock_unlock(pool->lock);
+
+   scaler_ctx_scale_rows(ctx, &worker, output, input);
+
+   slock_lock(pool->lock);
+   while (pool->pending)
+      scond_wait(pool->done, pool->lock);
+   slock_unlock(pool->lock);
+   return;
+
+single:
+#endif
+   scaler_ctx_scale_rows(ctx, &worker, output, input);
 }
@@ -66,6 +66,11 @@ static bool gen_filter_point(struct scaler_ctx *ctx)
    y_pos  = (1 << 15) * ctx->in_height / ctx->out_height - (1 << 15);
    y_step = (1 << 16) * ctx->in_height / ctx->out_height;
 
+   if (x_pos < 0)
+      x_pos = 0;
+   if (y_pos < 0)
+      y_pos = 0;
+
    gen_filter_point_sub(&ctx->horiz, ctx->out_width, x_pos, x_step);
    gen_filter_point_sub(&ctx->vert, ctx->out_height, y_pos, y_step);
 
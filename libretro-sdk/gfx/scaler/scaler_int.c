@@ -21,12 +21,36 @@
  */
 
 #include <gfx/scaler/scaler_int.h>
+#include <retro_inline.h>
 
 #ifdef SCALER_NO_SIMD
 #undef __SSE2__
+#undef __AVX2__
 #endif
 
-#if defined(__SSE2__)
+/* Like pixconv.c, GCC and Clang build the SIMD versions regardless of
+ * compiler flags, and scaler_init_simd picks one. Other compilers
+ * only get those enabled at compile time. */
+#if !defined(SCALER_NO_SIMD) && (defined(__i386__) || defined(__x86_64__)) \
+   && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define SCALER_HAVE_SSE2
+#define SCALER_HAVE_AVX2
+#define SCALER_SSE2_TARGET __attribute__((target("sse2")))
+#define SCALER_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(__SSE2__)
+#define SCALER_HAVE_SSE2
+#define SCALER_SSE2_TARGET
+#ifdef __AVX2__
+#define SCALER_HAVE_AVX2
+#define SCALER_AVX2_TARGET
+#endif
+#endif
+
+#if defined(SCALER_HAVE_AVX2)
+#include <immintrin.h>
+#endif
+
+#if defined(SCALER_HAVE_SSE2)
 #include <emmintrin.h>
 #ifdef _WIN32
 #include <intrin.h>
@@ -49,63 +73,246 @@
 // Scaling is now complete. Channels are shifted right by 3, and saturated into 8-bit values.
 //
 // The C version of scalers perform the exact same operations as the SIMD code for testing purposes.
+//
+// The AVX2 versions do the same additions in the same order as SSE2, several pixels at a time,
+// so the two produce identical output.
 
-#if defined(__SSE2__)
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+#ifdef SCALER_HAVE_SSE2
+static INLINE SCALER_SSE2_TARGET uint32_t scaler_argb8888_vert_pixel(const struct scaler_ctx *ctx,
+      const uint64_t *input_base_y, const int16_t *filter_vert)
 {
-   int h, w, y;
-   const uint64_t *input = ctx->scaled.frame;
-   uint32_t *output = (uint32_t*)output_;
+   int y;
+   __m128i res = _mm_setzero_si128();
 
-   const int16_t *filter_vert = ctx->vert.filter;
+   for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2, input_base_y += (ctx->scaled.stride >> 2))
+   {
+      __m128i coeff = _mm_set_epi64x((uint16_t)filter_vert[y + 1] * 0x0001000100010001ll, (uint16_t)filter_vert[y + 0] * 0x0001000100010001ll);
+      __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
 
-   for (h = 0; h < ctx->out_height; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
    {
-      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * (ctx->scaled.stride >> 3);
+      __m128i coeff = _mm_set_epi64x(0, (uint16_t)filter_vert[y] * 0x0001000100010001ll);
+      __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
 
-      for (w = 0; w < ctx->out_width; w++)
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   res = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+   res = _mm_srai_epi16(res, (7 - 2 - 2));
+
+   return _mm_cvtsi128_si32(_mm_packus_epi16(res, res));
+}
+
+static INLINE SCALER_SSE2_TARGET void scaler_argb8888_horiz_pixel(const struct scaler_ctx *ctx,
+      uint64_t *output, const uint32_t *input_base_x, const int16_t *filter_horiz)
+{
+   int x;
+   __m128i res = _mm_setzero_si128();
+
+   for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
+   {
+      __m128i coeff = _mm_set_epi64x((uint16_t)filter_horiz[x + 1] * 0x0001000100010001ll, (uint16_t)filter_horiz[x + 0] * 0x0001000100010001ll);
+
+      __m128i col = _mm_unpacklo_epi8(_mm_set_epi64x(0,
+               ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
+
+      col = _mm_slli_epi16(col, 7);
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   for (; x < ctx->horiz.filter_len; x++)
+   {
+      __m128i coeff = _mm_set_epi64x(0, (uint16_t)filter_horiz[x] * 0x0001000100010001ll);
+      __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
+
+      col = _mm_slli_epi16(col, 7);
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   res = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+
+#ifdef __x86_64__
+   *output = _mm_cvtsi128_si64(res);
+#else // 32-bit doesn't have si64. Do it in two steps.
+   {
+      union
       {
-         __m128i res = _mm_setzero_si128();
+         uint32_t *u32;
+         uint64_t *u64;
+      } u;
+      u.u64 = output;
+      u.u32[0] = _mm_cvtsi128_si32(res);
+      u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
+   }
+#endif
+}
+#endif
+
+#ifdef SCALER_HAVE_AVX2
+/* Four output pixels at a time. Even and odd taps are summed
+ * separately and added last, like the SSE2 version does. */
+static SCALER_AVX2_TARGET void scaler_argb8888_vert_AVX2(const struct scaler_ctx *ctx,
+      void *output_, int stride, const uint64_t *input,
+      int in_y, int out_y, int rows)
+{
+   int h, w, y;
+   uint32_t *output           = (uint32_t*)output_;
+   const int scaled_stride    = ctx->scaled.stride >> 3;
+   const int16_t *filter_vert = ctx->vert.filter + out_y * ctx->vert.filter_stride;
+
+   for (h = out_y; h < out_y + rows; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   {
+      const uint64_t *input_base = input + (ctx->vert.filter_pos[h] - in_y) * scaled_stride;
 
+      for (w = 0; (w + 3) < ctx->out_width; w += 4)
+      {
+         __m256i res_even = _mm256_setzero_si256();
+         __m256i res_odd  = _mm256_setzero_si256();
+         __m256i res;
          const uint64_t *input_base_y = input_base + w;
 
-         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2, input_base_y += (ctx->scaled.stride >> 2))
+         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2, input_base_y += 2 * scaled_stride)
          {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
+            __m256i col_even = _mm256_loadu_si256((const __m256i*)input_base_y);
+            __m256i col_odd  = _mm256_loadu_si256((const __m256i*)(input_base_y + scaled_stride));
 
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+            res_even = _mm256_adds_epi16(_mm256_mulhi_epi16(col_even, _mm256_set1_epi16(filter_vert[y + 0])), res_even);
+            res_odd  = _mm256_adds_epi16(_mm256_mulhi_epi16(col_odd,  _mm256_set1_epi16(filter_vert[y + 1])), res_odd);
          }
 
-         for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
+         for (; y < ctx->vert.filter_len; y++, input_base_y += scaled_stride)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
+            __m256i col = _mm256_loadu_si256((const __m256i*)input_base_y);
+            res_even = _mm256_adds_epi16(_mm256_mulhi_epi16(col, _mm256_set1_epi16(filter_vert[y])), res_even);
+         }
+
+         res = _mm256_adds_epi16(res_odd, res_even);
+         res = _mm256_srai_epi16(res, (7 - 2 - 2));
+         res = _mm256_packus_epi16(res, res);
+         res = _mm256_permute4x64_epi64(res, 0x08);
+
+         _mm_storeu_si128((__m128i*)(output + w), _mm256_castsi256_si128(res));
+      }
+
+      for (; w < ctx->out_width; w++)
+         output[w] = scaler_argb8888_vert_pixel(ctx, input_base + w, filter_vert);
+   }
+}
+
+/* Broadcasts coefficients a, b of one pixel and c, d of the next
+ * over the four lanes of each input pixel. */
+static INLINE SCALER_AVX2_TARGET __m256i scaler_horiz_coeff_avx2(__m128i coeffs)
+{
+   __m128i t = _mm_unpacklo_epi16(coeffs, coeffs);
+   return _mm256_inserti128_si256(_mm256_castsi128_si256(
+            _mm_unpacklo_epi32(t, t)), _mm_unpackhi_epi32(t, t), 1);
+}
+
+/* Two output pixels at a time, taking a pair of taps of each. */
+static SCALER_AVX2_TARGET void scaler_argb8888_horiz_AVX2(const struct scaler_ctx *ctx,
+      const void *input_, int stride, uint64_t *output, int rows)
+{
+   int h, w, x;
+   const uint32_t *input = (const uint32_t*)input_;
+
+   for (h = 0; h < rows; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   {
+      const int16_t *filter_horiz = ctx->horiz.filter;
+
+      for (w = 0; (w + 1) < ctx->scaled.width; w += 2, filter_horiz += 2 * ctx->horiz.filter_stride)
+      {
+         __m256i res = _mm256_setzero_si256();
+         const int16_t *filter_next   = filter_horiz + ctx->horiz.filter_stride;
+         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+         const uint32_t *input_next_x = input + ctx->horiz.filter_pos[w + 1];
 
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+         for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
+         {
+            __m256i coeff = scaler_horiz_coeff_avx2(_mm_set_epi16(0, 0, 0, 0,
+                     filter_next[x + 1], filter_next[x + 0],
+                     filter_horiz[x + 1], filter_horiz[x + 0]));
+            __m256i col   = _mm256_cvtepu8_epi16(_mm_set_epi32(
+                     input_next_x[x + 1], input_next_x[x + 0],
+                     input_base_x[x + 1], input_base_x[x + 0]));
+
+            col = _mm256_slli_epi16(col, 7);
+            res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
          }
 
-         res = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
-         res = _mm_srai_epi16(res, (7 - 2 - 2));
+         for (; x < ctx->horiz.filter_len; x++)
+         {
+            __m256i coeff = scaler_horiz_coeff_avx2(_mm_set_epi16(0, 0, 0, 0,
+                     0, filter_next[x], 0, filter_horiz[x]));
+            __m256i col   = _mm256_cvtepu8_epi16(_mm_set_epi32(
+                     0, input_next_x[x], 0, input_base_x[x]));
 
-         __m128i final = _mm_packus_epi16(res, res);
+            col = _mm256_slli_epi16(col, 7);
+            res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
+         }
 
-         output[w] = _mm_cvtsi128_si32(final);
+         res = _mm256_adds_epi16(_mm256_srli_si256(res, 8), res);
+         res = _mm256_permute4x64_epi64(res, 0x08);
+
+         _mm_storeu_si128((__m128i*)(output + w), _mm256_castsi256_si128(res));
       }
+
+      for (; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+         scaler_argb8888_horiz_pixel(ctx, output + w,
+               input + ctx->horiz.filter_pos[w], filter_horiz);
    }
 }
-#else
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+#endif
+
+#ifdef SCALER_HAVE_SSE2
+static SCALER_SSE2_TARGET void scaler_argb8888_vert_SSE2(const struct scaler_ctx *ctx,
+      void *output_, int stride, const uint64_t *input,
+      int in_y, int out_y, int rows)
+{
+   int h, w;
+   uint32_t *output           = (uint32_t*)output_;
+   const int16_t *filter_vert = ctx->vert.filter + out_y * ctx->vert.filter_stride;
+
+   for (h = out_y; h < out_y + rows; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   {
+      const uint64_t *input_base = input + (ctx->vert.filter_pos[h] - in_y) * (ctx->scaled.stride >> 3);
+
+      for (w = 0; w < ctx->out_width; w++)
+         output[w] = scaler_argb8888_vert_pixel(ctx, input_base + w, filter_vert);
+   }
+}
+
+static SCALER_SSE2_TARGET void scaler_argb8888_horiz_SSE2(const struct scaler_ctx *ctx,
+      const void *input_, int stride, uint64_t *output, int rows)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+
+   for (h = 0; h < rows; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   {
+      const int16_t *filter_horiz = ctx->horiz.filter;
+
+      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+         scaler_argb8888_horiz_pixel(ctx, output + w,
+               input + ctx->horiz.filter_pos[w], filter_horiz);
+   }
+}
+#endif
+
+static void scaler_argb8888_vert_C(const struct scaler_ctx *ctx,
+      void *output_, int stride, const uint64_t *input,
+      int in_y, int out_y, int rows)
 {
    int h, w, y;
-   const uint64_t *input = ctx->scaled.frame;
    uint32_t *output = (uint32_t*)output_;
 
-   const int16_t *filter_vert = ctx->vert.filter;
+   const int16_t *filter_vert = ctx->vert.filter + out_y * ctx->vert.filter_stride;
 
-   for (h = 0; h < ctx->out_height; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   for (h = out_y; h < out_y + rows; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
    {
-      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * (ctx->scaled.stride >> 3);
+      const uint64_t *input_base = input + (ctx->vert.filter_pos[h] - in_y) * (ctx->scaled.stride >> 3);
 
       for (w = 0; w < ctx->out_width; w++)
       {
@@ -141,75 +348,19 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
       }
    }
 }
-#endif
-
-#if defined(__SSE2__)
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
-{
-   int h, w, x;
-   const uint32_t *input = (const uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
-
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
-   {
-      const int16_t *filter_horiz = ctx->horiz.filter;
 
-      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
-      {
-         __m128i res = _mm_setzero_si128();
-
-         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
-
-         for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
-         {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
-
-            __m128i col = _mm_unpacklo_epi8(_mm_set_epi64x(0,
-                     ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
-
-            col = _mm_slli_epi16(col, 7);
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
-
-         for (; x < ctx->horiz.filter_len; x++)
-         {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
-            __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
-
-            col = _mm_slli_epi16(col, 7);
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
-
-         res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
-
-#ifdef __x86_64__
-         output[w] = _mm_cvtsi128_si64(res);
-#else // 32-bit doesn't have si64. Do it in two steps.
-         union
-         {
-            uint32_t *u32;
-            uint64_t *u64;
-         } u;
-         u.u64 = output + w;
-         u.u32[0] = _mm_cvtsi128_si32(res);
-         u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
-#endif
-      }
-   }
-}
-#else
 static inline uint64_t build_argb64(uint16_t a, uint16_t r, uint16_t g, uint16_t b)
 {
    return ((uint64_t)a << 48) | ((uint64_t)r << 32) | ((uint64_t)g << 16) | ((uint64_t)b << 0);
 }
 
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+static void scaler_argb8888_horiz_C(const struct scaler_ctx *ctx,
+      const void *input_, int stride, uint64_t *output, int rows)
 {
    int h, w, x;
    const uint32_t *input = (uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   for (h = 0; h < rows; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
    {
       const int16_t *filter_horiz = ctx->horiz.filter;
 
@@ -243,39 +394,78 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
       }
    }
 }
+
+/* Until scaler_init_simd is called, use what the compiler targets. */
+#if defined(__AVX2__) && defined(SCALER_HAVE_AVX2)
+#define SCALER_DEFAULT(name) name##_AVX2
+#elif defined(__SSE2__) && defined(SCALER_HAVE_SSE2)
+#define SCALER_DEFAULT(name) name##_SSE2
+#else
+#define SCALER_DEFAULT(name) name##_C
 #endif
 
-void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
-      void *output_, const void *input_,
-      int out_width, int out_height,
-      int in_width, int in_height,
-      int out_stride, int in_stride)
-{
-   const uint32_t *input = NULL;
-   uint32_t *output      = NULL;
-   int h, w;
-   int x_pos  = (1 << 15) * in_width / out_width - (1 << 15);
-   int x_step = (1 << 16) * in_width / out_width;
-   int y_pos  = (1 << 15) * in_height / out_height - (1 << 15);
-   int y_step = (1 << 16) * in_height / out_height;
+static void (*scaler_argb8888_vert_func)(const struct scaler_ctx*,
+      void*, int, const uint64_t*, int, int, int) =
+   SCALER_DEFAULT(scaler_argb8888_vert);
+static void (*scaler_argb8888_horiz_func)(const struct scaler_ctx*,
+      const void*, int, uint64_t*, int) =
+   SCALER_DEFAULT(scaler_argb8888_horiz);
 
-   (void)ctx;
+void scaler_argb8888_vert(const struct scaler_ctx *ctx,
+      void *output, int stride, const uint64_t *input,
+      int in_y, int out_y, int rows)
+{
+   scaler_argb8888_vert_func(ctx, output, stride, input, in_y, out_y, rows);
+}
 
-   if (x_pos < 0)
-      x_pos = 0;
-   if (y_pos < 0)
-      y_pos = 0;
+void scaler_argb8888_horiz(const struct scaler_ctx *ctx,
+      const void *input, int stride, uint64_t *output, int rows)
+{
+   scaler_argb8888_horiz_func(ctx, input, stride, output, rows);
+}
 
-   input = (const uint32_t*)input_;
-   output = (uint32_t*)output_;
+/**
+ * scaler_init_simd:
+ * @mask             : SIMD features of the CPU, SCALER_SIMD_*.
+ *
+ * Picks the fastest scalers the CPU supports.
+ * Not thread-safe, call it before scaling any frames.
+ **/
+void scaler_init_simd(scaler_simd_mask_t mask)
+{
+   scaler_argb8888_vert_func  = scaler_argb8888_vert_C;
+   scaler_argb8888_horiz_func = scaler_argb8888_horiz_C;
 
-   for (h = 0; h < out_height; h++, y_pos += y_step, output += out_stride >> 2)
+#ifdef SCALER_HAVE_SSE2
+   if (mask & SCALER_SIMD_SSE2)
    {
-      int x = x_pos;
-      const uint32_t *inp = input + (y_pos >> 16) * (in_stride >> 2);
+      scaler_argb8888_vert_func  = scaler_argb8888_vert_SSE2;
+      scaler_argb8888_horiz_func = scaler_argb8888_horiz_SSE2;
+   }
+#endif
 
-      for (w = 0; w < out_width; w++, x += x_step)
-         output[w] = inp[x >> 16];
+#ifdef SCALER_HAVE_AVX2
+   if (mask & SCALER_SIMD_AVX2)
+   {
+      scaler_argb8888_vert_func  = scaler_argb8888_vert_AVX2;
+      scaler_argb8888_horiz_func = scaler_argb8888_horiz_AVX2;
    }
+#endif
 }
 
+void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
+      void *output_, int out_stride, const void *input_, int in_stride,
+      int in_y, int out_y, int rows)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (h = out_y; h < out_y + rows; h++, output += out_stride >> 2)
+   {
+      const uint32_t *inp = input + (ctx->vert.filter_pos[h] - in_y) * (in_stride >> 2);
+
+      for (w = 0; w < ctx->out_width; w++)
+         output[w] = inp[ctx->horiz.filter_pos[w]];
+   }
+}
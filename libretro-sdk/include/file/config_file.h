@@ -40,6 +40,8 @@ struct config_entry_list
    bool readonly;
    char *key;
    char *value;
+   /* Bytes available at value, terminator included. */
+   size_t value_size;
    struct config_entry_list *next;
 };
 
@@ -49,6 +51,10 @@ struct config_include_list
    struct config_include_list *next;
 };
 
+/* Opaque. */
+struct config_index_slot;
+struct config_arena_block;
+
 struct config_file
 {
    char *path;
@@ -57,6 +63,15 @@ struct config_file
    unsigned include_depth;
 
    struct config_include_list *includes;
+
+   /* Hash index over entries, mapping each key to its
+    * first entry in list order. */
+   struct config_index_slot *index;
+   size_t index_size;
+   size_t index_count;
+
+   /* Storage for entries, keys and values. */
+   struct config_arena_block *arena;
 };
 
 typedef struct config_file config_file_t;
@@ -128,6 +143,12 @@ bool config_get_char(config_file_t *conf, const char *entry, char *in);
  * this function succeeds. */
 bool config_get_string(config_file_t *conf, const char *entry, char **in);
 
+/* Points *in to the string stored in the config file. Does not allocate.
+ * The string is owned by the config file and stays valid until the entry
+ * is set again or the config file is freed. */
+bool config_get_string_ref(config_file_t *conf, const char *entry,
+      const char **in);
+
 /* Extracts a string to a preallocated buffer. Avoid memory allocation. */
 bool config_get_array(config_file_t *conf, const char *entry, char *in, size_t size);
 
@@ -43,6 +43,28 @@ extern "C" {
 struct string_list *dir_list_new(const char *dir, const char *ext,
       bool include_dirs);
 
+typedef bool (*dir_list_batch_cb_t)(struct string_list *batch,
+      void *userdata);
+
+/**
+ * dir_list_read:
+ * @dir          : directory path.
+ * @ext          : allowed extensions of file directory entries to include.
+ * @include_dirs : include directories as part of the finished directory listing?
+ * @batch_size   : number of entries per batch, 0 to pass all entries at once.
+ * @cb           : called with each batch of entries, takes ownership of it.
+ *                 Returns false to stop reading.
+ * @userdata     : userdata passed to @cb.
+ *
+ * Reads a directory listing in batches, as the directory is read.
+ * The last batch, which may be empty, is passed once the whole
+ * directory has been read.
+ *
+ * Returns: true (1) if the whole directory was read, otherwise false (0).
+ **/
+bool dir_list_read(const char *dir, const char *ext, bool include_dirs,
+      size_t batch_size, dir_list_batch_cb_t cb, void *userdata);
+
 /**
  * dir_list_sort:
  * @list      : pointer to the directory listing.
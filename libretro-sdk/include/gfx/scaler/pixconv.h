@@ -25,6 +25,21 @@
 
 #include <clamping.h>
 
+/* Same values as RETRO_SIMD_* in libretro.h. */
+#define PIXCONV_SIMD_SSE2     (1 << 1)
+#define PIXCONV_SIMD_AVX2     (1 << 12)
+
+typedef unsigned pixconv_simd_mask_t;
+
+/**
+ * conv_init_simd:
+ * @mask             : SIMD features of the CPU, PIXCONV_SIMD_*.
+ *
+ * Picks the fastest version of each conversion the CPU supports.
+ * Until called, conversions use the SIMD enabled at compile time.
+ **/
+void conv_init_simd(pixconv_simd_mask_t mask);
+
 void conv_0rgb1555_argb8888(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
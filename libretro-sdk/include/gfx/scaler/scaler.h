@@ -34,6 +34,12 @@ extern "C" {
 
 #define FILTER_UNITY (1 << 14)
 
+/* Same values as RETRO_SIMD_* in libretro.h. */
+#define SCALER_SIMD_SSE2     (1 << 1)
+#define SCALER_SIMD_AVX2     (1 << 12)
+
+typedef unsigned scaler_simd_mask_t;
+
 enum scaler_pix_fmt
 {
    SCALER_FMT_ARGB8888 = 0,
@@ -75,12 +81,14 @@ struct scaler_ctx
    enum scaler_pix_fmt out_fmt;
    enum scaler_type scaler_type;
 
+   /* Frames are scaled in horizontal strips of output rows,
+    * see scaler_int.h. */
    void (*scaler_horiz)(const struct scaler_ctx*,
-         const void*, int);
+         const void*, int, uint64_t*, int);
    void (*scaler_vert)(const struct scaler_ctx*,
-         void*, int);
+         void*, int, const uint64_t*, int, int, int);
    void (*scaler_special)(const struct scaler_ctx*,
-         void*, const void*, int, int, int, int, int, int);
+         void*, int, const void*, int, int, int, int);
 
    void (*in_pixconv)(void*, const void*, int, int, int, int);
    void (*out_pixconv)(void*, const void*, int, int, int, int);
@@ -89,10 +97,19 @@ struct scaler_ctx
    bool unscaled;
    struct scaler_filter horiz, vert;
 
+   /* Number of threads to scale with, set before
+    * scaler_ctx_gen_filter. 0 or 1 scales on the calling thread. */
+   unsigned threads;
+
+   /* Output rows per strip. The buffers below hold one strip,
+    * so they stay in cache between the passes. */
+   int strip_height;
+
    struct
    {
       uint32_t *frame;
       int stride;
+      int height;
    } input;
 
    struct
@@ -108,8 +125,20 @@ struct scaler_ctx
       uint32_t *frame;
       int stride;
    } output;
+
+   /* Worker threads, owned by scaler.c. */
+   void *workers;
 };
 
+/**
+ * scaler_init_simd:
+ * @mask             : SIMD features of the CPU, SCALER_SIMD_*.
+ *
+ * Picks the fastest scalers the CPU supports.
+ * Until called, scalers use the SIMD enabled at compile time.
+ **/
+void scaler_init_simd(scaler_simd_mask_t mask);
+
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx);
 
 void scaler_ctx_gen_reset(struct scaler_ctx *ctx);
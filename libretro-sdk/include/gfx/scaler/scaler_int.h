@@ -25,17 +25,46 @@
 
 #include <gfx/scaler/scaler.h>
 
-void scaler_argb8888_vert(const struct scaler_ctx *ctx,
-      void *output, int stride);
-
+/**
+ * scaler_argb8888_horiz:
+ * @ctx          : pointer to scaler context object.
+ * @input        : first input row to scale.
+ * @stride       : stride of @input.
+ * @output       : intermediate rows, with a stride of ctx->scaled.stride.
+ * @rows         : number of rows to scale.
+ *
+ * Scales @rows rows of ARGB8888 input horizontally into
+ * 16-bit per channel intermediate rows.
+ **/
 void scaler_argb8888_horiz(const struct scaler_ctx *ctx,
-      const void *input, int stride);
+      const void *input, int stride, uint64_t *output, int rows);
 
+/**
+ * scaler_argb8888_vert:
+ * @ctx          : pointer to scaler context object.
+ * @output       : output row @out_y.
+ * @stride       : stride of @output.
+ * @input        : intermediate rows from input row @in_y on.
+ * @in_y         : input row of the first intermediate row.
+ * @out_y        : first output row to scale.
+ * @rows         : number of output rows.
+ *
+ * Scales intermediate rows vertically into ARGB8888 output rows.
+ **/
+void scaler_argb8888_vert(const struct scaler_ctx *ctx,
+      void *output, int stride, const uint64_t *input,
+      int in_y, int out_y, int rows);
+
+/**
+ * scaler_argb8888_point_special:
+ *
+ * Point samples ARGB8888 input, with the same arguments as
+ * scaler_argb8888_vert, except @input being input rows
+ * from @in_y on with a stride of @in_stride.
+ **/
 void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
-      void *output, const void *input,
-      int out_width, int out_height,
-      int in_width, int in_height,
-      int out_stride, int in_stride);
+      void *output, int out_stride, const void *input, int in_stride,
+      int in_y, int out_y, int rows);
 
 #endif
 
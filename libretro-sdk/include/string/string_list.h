@@ -76,6 +76,41 @@ bool string_list_find_elem(const struct string_list *list, const char *elem);
 bool string_list_find_elem_prefix(const struct string_list *list,
       const char *prefix, const char *elem);
 
+/* Case-insensitive hash set of file extensions. */
+struct string_ext_set;
+
+/**
+ * string_ext_set_new:
+ * @list             : pointer to string list of extensions.
+ *
+ * Creates a set of the extensions in @list, for matching many
+ * file extensions against the same list. A leading '.' on an
+ * extension is ignored.
+ *
+ * Returns: new extension set, NULL on error. Has to be freed manually.
+ */
+struct string_ext_set *string_ext_set_new(const struct string_list *list);
+
+/**
+ * string_ext_set_find:
+ * @set              : pointer to extension set.
+ * @ext              : extension to find, without leading '.'.
+ *
+ * Searches for an extension inside the set. Equivalent to
+ * string_list_find_elem_prefix(list, ".", ext) on the source list.
+ *
+ * Returns: true (1) if extension could be found, otherwise false (0).
+ */
+bool string_ext_set_find(const struct string_ext_set *set, const char *ext);
+
+/**
+ * string_ext_set_free:
+ * @set              : pointer to extension set.
+ *
+ * Frees an extension set.
+ */
+void string_ext_set_free(struct string_ext_set *set);
+
 /**
  * string_split:
  * @str              : string to turn into a string list
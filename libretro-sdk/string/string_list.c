@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <string/string_list.h>
 #include <string.h>
+#include <ctype.h>
 #include <retro_miscellaneous.h>
 #include <compat/strl.h>
 #include <compat/posix_string.h>
@@ -266,3 +267,112 @@ bool string_list_find_elem_prefix(const struct string_list *list,
 
    return false;
 }
+
+struct string_ext_set
+{
+   /* Open addressing, stores offset into exts + 1, 0 is empty. */
+   uint32_t *slots;
+   uint32_t *hashes;
+   size_t mask;
+   char *exts;
+};
+
+static uint32_t string_ext_hash(const char *ext)
+{
+   uint32_t hash = 5381;
+
+   while (*ext)
+      hash = (hash << 5) + hash + (uint8_t)tolower((uint8_t)*ext++);
+
+   return hash;
+}
+
+static const uint32_t *string_ext_set_slot(const struct string_ext_set *set,
+      uint32_t hash, const char *ext)
+{
+   size_t i = hash & set->mask;
+
+   while (set->slots[i])
+   {
+      if (set->hashes[i] == hash
+            && strcasecmp(set->exts + set->slots[i] - 1, ext) == 0)
+         break;
+      i = (i + 1) & set->mask;
+   }
+
+   return &set->slots[i];
+}
+
+struct string_ext_set *string_ext_set_new(const struct string_list *list)
+{
+   size_t i, size = 16, exts_size = 0, offset = 0;
+   struct string_ext_set *set = NULL;
+
+   if (!list)
+      return NULL;
+
+   set = (struct string_ext_set*)calloc(1, sizeof(*set));
+   if (!set)
+      return NULL;
+
+   while (size < list->size * 2)
+      size *= 2;
+
+   for (i = 0; i < list->size; i++)
+      exts_size += strlen(list->elems[i].data) + 1;
+
+   set->mask   = size - 1;
+   set->slots  = (uint32_t*)calloc(size, sizeof(*set->slots));
+   set->hashes = (uint32_t*)calloc(size, sizeof(*set->hashes));
+   set->exts   = (char*)malloc(exts_size + 1);
+
+   if (!set->slots || !set->hashes || !set->exts)
+   {
+      string_ext_set_free(set);
+      return NULL;
+   }
+
+   for (i = 0; i < list->size; i++)
+   {
+      uint32_t hash;
+      const uint32_t *slot = NULL;
+      const char *ext      = list->elems[i].data;
+      size_t len;
+
+      if (*ext == '.')
+         ext++;
+
+      hash = string_ext_hash(ext);
+      slot = string_ext_set_slot(set, hash, ext);
+      if (*slot)
+         continue;
+
+      len = strlen(ext) + 1;
+      memcpy(set->exts + offset, ext, len);
+
+      set->hashes[slot - set->slots] = hash;
+      set->slots[slot - set->slots]  = offset + 1;
+      offset += len;
+   }
+
+   return set;
+}
+
+bool string_ext_set_find(const struct string_ext_set *set, const char *ext)
+{
+   if (!set || !ext)
+      return false;
+
+   return *string_ext_set_slot(set, string_ext_hash(ext), ext) != 0;
+}
+
+void string_ext_set_free(struct string_ext_set *set)
+{
+   if (!set)
+      return;
+
+   free(set->slots);
+   free(set->hashes);
+   free(set->exts);
+   free(set);
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Writes a synthetic clrmamepro DAT file, to benchmark database
+ * creation on inputs larger than the real DATs. The output only
+ * depends on the number of games and the seed. */
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+   /* xorshift64* */
+   rng_state ^= rng_state >> 12;
+   rng_state ^= rng_state << 25;
+   rng_state ^= rng_state >> 27;
+   return rng_state * 2685821657736338717ULL;
+}
+
+static void write_hex(FILE *fp, unsigned bytes)
+{
+   unsigned i;
+
+   for (i = 0; i < bytes; i++)
+      fprintf(fp, "%02X", (unsigned)(rng_next() >> 56));
+}
+
+static const char *regions[] = { "USA", "Europe", "Japan", "World" };
+
+int main(int argc, char ** argv)
+{
+   unsigned long i, count;
+   FILE *fp;
+
+   if (argc < 3)
+   {
+      printf("Usage: %s <dat file> <game count> [seed]\n", argv[0]);
+      return 1;
+   }
+
+   count     = strtoul(argv[2], NULL, 0);
+   rng_state = argc > 3 ? strtoull(argv[3], NULL, 0) : 1;
+   if (!rng_state)
+      rng_state = 1;
+
+   if (!(fp = fopen(argv[1], "w")))
+   {
+      printf("Could not open dat file '%s'\n", argv[1]);
+      return 1;
+   }
+
+   fprintf(fp, "clrmamepro (\n\tname \"Synthetic\"\n"
+         "\tdescription \"Synthetic benchmark data\"\n)\n\n");
+
+   for (i = 0; i < count; i++)
+   {
+      const char *region = regions[rng_next() % 4];
+      /* Multiplying by an odd constant is a bijection on 32 bits,
+       * so CRCs, which must be unique in the index, never collide. */
+      uint32_t crc = (uint32_t)(i + 1) * 2654435761u;
+
+      fprintf(fp, "game (\n");
+      fprintf(fp, "\tname \"Game %06lu (%s)\"\n", i, region);
+      fprintf(fp, "\tdescription \"Game %06lu (%s)\"\n", i, region);
+      fprintf(fp, "\tdeveloper \"Developer %u\"\n",
+            (unsigned)(rng_next() % 500));
+      fprintf(fp, "\tpublisher \"Publisher %u\"\n",
+            (unsigned)(rng_next() % 200));
+      fprintf(fp, "\treleaseyear \"%u\"\n",
+            1980 + (unsigned)(rng_next() % 35));
+      fprintf(fp, "\treleasemonth \"%u\"\n",
+            1 + (unsigned)(rng_next() % 12));
+      fprintf(fp, "\tserial \"SLUS-%05lu\"\n", i % 100000);
+      fprintf(fp, "\trom ( name \"Game %06lu (%s).bin\" size %u crc %08X md5 ",
+            i, region, 1u << (16 + rng_next() % 10), crc);
+      write_hex(fp, 16);
+      fprintf(fp, " sha1 ");
+      write_hex(fp, 20);
+      fprintf(fp, " )\n)\n\n");
+   }
+
+   if (fclose(fp) != 0)
+   {
+      printf("Could not write dat file '%s'\n", argv[1]);
+      return 1;
+   }
+
+   return 0;
+}
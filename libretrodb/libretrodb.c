@@ -16,15 +16,35 @@
 
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "libretrodb_endian.h"
 #include "query.h"
 
-struct node_iter_ctx
+/* Key of an index being built, pointing into the key storage
+ * of its builder once all keys have been collected. */
+typedef struct libretrodb_index_key
 {
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
-};
+   const uint8_t *key;
+   size_t key_pos;
+   uint32_t key_len;
+   uint64_t offset;
+} libretrodb_index_key_t;
+
+typedef struct libretrodb_index_builder
+{
+   const char *name;
+   const char *field_name;
+   struct rmsgpack_dom_value field;
+   enum rmsgpack_dom_type key_type;
+   uint64_t key_size;
+
+   uint8_t *keys;
+   size_t keys_len;
+   size_t keys_cap;
+
+   libretrodb_index_key_t *entries;
+   size_t count;
+   size_t cap;
+} libretrodb_index_builder_t;
 
 static struct rmsgpack_dom_value sentinal;
 
@@ -33,11 +53,11 @@ static int libretrodb_read_metadata(int fd, libretrodb_metadata_t *md)
    return rmsgpack_dom_read_into(fd, "count", &md->count, NULL);
 }
 
-static int libretrodb_write_metadata(int fd, libretrodb_metadata_t *md)
+static int libretrodb_write_metadata(FILE *fp, libretrodb_metadata_t *md)
 {
-   rmsgpack_write_map_header(fd, 1);
-   rmsgpack_write_string(fd, "count", strlen("count"));
-   return rmsgpack_write_uint(fd, md->count);
+   rmsgpack_write_map_header(fp, 1);
+   rmsgpack_write_string(fp, "count", strlen("count"));
+   return rmsgpack_write_uint(fp, md->count);
 }
 
 static int validate_document(const struct rmsgpack_dom_value * doc)
@@ -74,75 +94,200 @@ static int validate_document(const struct rmsgpack_dom_value * doc)
    return rv;
 }
 
-int libretrodb_create(int fd, libretrodb_value_provider value_provider,
+int libretrodb_create(FILE *fp, libretrodb_value_provider value_provider,
         void * ctx)
 {
    int rv;
-   off_t root;
+   long root;
    libretrodb_metadata_t md;
    uint64_t item_count = 0;
    struct rmsgpack_dom_value item = {};
    libretrodb_header_t header = {};
 
    memcpy(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1);
-   root = lseek(fd, 0, SEEK_CUR);
+   root = ftell(fp);
 
    /* We write the header in the end because we need to know the size of
     * the db first */
 
-   lseek(fd, sizeof(libretrodb_header_t), SEEK_CUR);
+   fseek(fp, sizeof(libretrodb_header_t), SEEK_CUR);
 
    while ((rv = value_provider(ctx, &item)) == 0)
    {
       if ((rv = validate_document(&item)) < 0)
          goto clean;
 
-      if ((rv = rmsgpack_dom_write(fd, &item)) < 0)
+      if ((rv = rmsgpack_dom_write(fp, &item)) < 0)
          goto clean;
 
+      rmsgpack_dom_value_free(&item);
+      memset(&item, 0, sizeof(item));
       item_count++;
    }
 
    if (rv < 0)
       goto clean;
 
-   if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
+   if ((rv = rmsgpack_dom_write(fp, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = httobe64(lseek(fd, 0, SEEK_CUR));
+   header.metadata_offset = httobe64(ftell(fp));
    md.count = item_count;
-   libretrodb_write_metadata(fd, &md);
-   lseek(fd, root, SEEK_SET);
-   write(fd, &header, sizeof(header));
+   libretrodb_write_metadata(fp, &md);
+   fseek(fp, root, SEEK_SET);
+   fwrite(&header, sizeof(header), 1, fp);
+   rv = fflush(fp) == 0 ? 0 : (errno ? -errno : -EIO);
 clean:
    rmsgpack_dom_value_free(&item);
    return rv;
 }
 
+static const char *libretrodb_key_type_name(enum rmsgpack_dom_type type)
+{
+   switch (type)
+   {
+      case RDT_STRING:
+         return "string";
+      case RDT_UINT:
+         return "uint";
+      default:
+         break;
+   }
+
+   return "binary";
+}
+
+static void libretrodb_index_header_string(
+      const struct rmsgpack_dom_value *map, const char *name,
+      char *s, size_t len)
+{
+   struct rmsgpack_dom_value key;
+   struct rmsgpack_dom_value *value;
+
+   key.type        = RDT_STRING;
+   key.string.len  = strlen(name);
+   key.string.buff = (char*)name;
+
+   value = rmsgpack_dom_value_map_value(map, &key);
+   if (!value || value->type != RDT_STRING)
+      return;
+
+   if (value->string.len < len)
+      len = value->string.len + 1;
+   memcpy(s, value->string.buff, len - 1);
+   s[len - 1] = '\0';
+}
+
+static int libretrodb_index_header_uint(
+      const struct rmsgpack_dom_value *map, const char *name,
+      uint64_t *out)
+{
+   struct rmsgpack_dom_value key;
+   struct rmsgpack_dom_value *value;
+
+   key.type        = RDT_STRING;
+   key.string.len  = strlen(name);
+   key.string.buff = (char*)name;
+
+   value = rmsgpack_dom_value_map_value(map, &key);
+   if (!value || value->type != RDT_UINT)
+      return -EINVAL;
+
+   *out = value->uint_;
+   return 0;
+}
+
+/* Indexes written before key types existed only hold binary keys
+ * and have no field, so these are optional. */
 static int libretrodb_read_index_header(int fd, libretrodb_index_t *idx)
 {
-   uint64_t name_len = 50;
-   return rmsgpack_dom_read_into(fd,
-         "name", idx->name, &name_len,
-         "key_size", &idx->key_size,
-         "next", &idx->next, NULL);
+   int rv;
+   char key_type[16];
+   struct rmsgpack_dom_value map;
+
+   if ((rv = rmsgpack_dom_read(fd, &map)) < 0)
+      return rv;
+
+   memset(idx, 0, sizeof(*idx));
+   key_type[0] = '\0';
+
+   if (map.type != RDT_MAP
+         || libretrodb_index_header_uint(&map, "key_size", &idx->key_size) < 0
+         || libretrodb_index_header_uint(&map, "next", &idx->next) < 0)
+   {
+      rmsgpack_dom_value_free(&map);
+      return -EINVAL;
+   }
+
+   libretrodb_index_header_string(&map, "name",
+         idx->name, sizeof(idx->name));
+   libretrodb_index_header_string(&map, "field",
+         idx->field, sizeof(idx->field));
+   libretrodb_index_header_string(&map, "key_type",
+         key_type, sizeof(key_type));
+   rmsgpack_dom_value_free(&map);
+
+   if (!idx->field[0])
+      strcpy(idx->field, idx->name);
+
+   idx->key_type = RDT_BINARY;
+   if (!strcmp(key_type, "string"))
+      idx->key_type = RDT_STRING;
+   else if (!strcmp(key_type, "uint"))
+      idx->key_type = RDT_UINT;
+
+   idx->count = idx->next / (idx->key_size + sizeof(uint64_t));
+   return 0;
 }
 
-static void libretrodb_write_index_header(int fd, libretrodb_index_t * idx)
+static void libretrodb_write_index_header(FILE *fp, libretrodb_index_t * idx)
 {
-	rmsgpack_write_map_header(fd, 3);
-	rmsgpack_write_string(fd, "name", strlen("name"));
-	rmsgpack_write_string(fd, idx->name, strlen(idx->name));
-	rmsgpack_write_string(fd, "key_size", strlen("key_size"));
-	rmsgpack_write_uint(fd, idx->key_size);
-	rmsgpack_write_string(fd, "next", strlen("next"));
-	rmsgpack_write_uint(fd, idx->next);
+	rmsgpack_write_map_header(fp, 5);
+	rmsgpack_write_string(fp, "name", strlen("name"));
+	rmsgpack_write_string(fp, idx->name, strlen(idx->name));
+	rmsgpack_write_string(fp, "field", strlen("field"));
+	rmsgpack_write_string(fp, idx->field, strlen(idx->field));
+	rmsgpack_write_string(fp, "key_type", strlen("key_type"));
+	rmsgpack_write_string(fp, libretrodb_key_type_name(idx->key_type),
+         strlen(libretrodb_key_type_name(idx->key_type)));
+	rmsgpack_write_string(fp, "key_size", strlen("key_size"));
+	rmsgpack_write_uint(fp, idx->key_size);
+	rmsgpack_write_string(fp, "next", strlen("next"));
+	rmsgpack_write_uint(fp, idx->next);
+}
+
+/**
+ * libretrodb_read_indexes:
+ * @db                  : Handle to database.
+ *
+ * Reads the headers of all indexes following the metadata of @db.
+ **/
+static void libretrodb_read_indexes(libretrodb_t *db)
+{
+   off_t eof    = lseek(db->fd, 0, SEEK_END);
+   off_t offset = lseek(db->fd, db->first_index_offset, SEEK_SET);
+
+   db->index_count = 0;
+
+   while (offset < eof && db->index_count < LIBRETRODB_MAX_INDEXES)
+   {
+      libretrodb_index_t *idx = &db->indexes[db->index_count];
+
+      if (libretrodb_read_index_header(db->fd, idx) < 0)
+         break;
+
+      idx->offset = lseek(db->fd, 0, SEEK_CUR);
+      db->index_count++;
+
+      offset = lseek(db->fd, idx->next, SEEK_CUR);
+   }
 }
 
 void libretrodb_close(libretrodb_t *db)
 {
 	close(db->fd);
 	db->fd = -1;
+	db->index_count = 0;
 }
 
 int libretrodb_open(const char *path, libretrodb_t *db)
@@ -153,18 +298,18 @@ int libretrodb_open(const char *path, libretrodb_t *db)
    int fd = open(path, O_RDWR);
 
    if (fd == -1)
-      return -errno;
+      return errno ? -errno : -EIO;
 
    strcpy(db->path, path);
    db->root = lseek(fd, 0, SEEK_CUR);
 
    if ((rv = read(fd, &header, sizeof(header))) == -1)
    {
-      rv = -errno;
+      rv = errno ? -errno : -EIO;
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -182,103 +327,152 @@ int libretrodb_open(const char *path, libretrodb_t *db)
    db->count = md.count;
    db->first_index_offset = lseek(fd, 0, SEEK_CUR);
    db->fd = fd;
+   libretrodb_read_indexes(db);
    return 0;
 error:
    close(fd);
    return rv;
 }
 
-static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
-      libretrodb_index_t *idx)
+/**
+ * libretrodb_find_index_by_field:
+ * @db                  : Handle to database.
+ * @field               : Name of field.
+ * @len                 : Length of @field.
+ *
+ * Returns: index over @field if found, otherwise NULL.
+ **/
+const libretrodb_index_t *libretrodb_find_index_by_field(
+      const libretrodb_t *db, const char *field, size_t len)
 {
-   off_t eof    = lseek(db->fd, 0, SEEK_END);
-   off_t offset = lseek(db->fd, db->first_index_offset, SEEK_SET);
+   unsigned i;
 
-   while (offset < eof)
+   for (i = 0; i < db->index_count; i++)
    {
-      libretrodb_read_index_header(db->fd, idx);
+      if (strlen(db->indexes[i].field) == len
+            && !memcmp(db->indexes[i].field, field, len))
+         return &db->indexes[i];
+   }
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
-         return 0;
+   return NULL;
+}
 
-      offset = lseek(db->fd, idx->next, SEEK_CUR);
+static const libretrodb_index_t *libretrodb_find_index(libretrodb_t *db,
+      const char *index_name)
+{
+   unsigned i;
+
+   for (i = 0; i < db->index_count; i++)
+   {
+      if (!strcmp(db->indexes[i].name, index_name))
+         return &db->indexes[i];
    }
 
-   return -1;
+   return NULL;
 }
 
-static int node_compare(const void * a, const void * b, void * ctx)
+/**
+ * libretrodb_index_read_record:
+ * @fd                  : File descriptor of database.
+ * @idx                 : Index.
+ * @pos                 : Position of record in @idx.
+ * @record              : Buffer of idx->key_size bytes for the key.
+ * @offset              : Offset of the item the record points to.
+ *
+ * Index records are the key followed by the big endian offset
+ * of the item, sorted by key.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+static int libretrodb_index_read_record(int fd, const libretrodb_index_t *idx,
+      uint64_t pos, uint8_t *record, uint64_t *offset)
 {
-   return memcmp(a, b, *(uint8_t *)ctx);
+   uint64_t tmp;
+
+   lseek(fd, idx->offset + pos * (idx->key_size + sizeof(uint64_t)),
+         SEEK_SET);
+
+   if (read(fd, record, idx->key_size) != (ssize_t)idx->key_size
+         || read(fd, &tmp, sizeof(tmp)) != sizeof(tmp))
+      return -EIO;
+
+   if (offset)
+      *offset = betoht64(tmp);
+   return 0;
 }
 
-static int binsearch(const void * buff, const void * item,
-      uint64_t count, uint8_t field_size, uint64_t * offset)
+/**
+ * libretrodb_index_lower_bound:
+ * @fd                  : File descriptor of database.
+ * @idx                 : Index.
+ * @key                 : Key, or key prefix, to look up.
+ * @len                 : Length of @key, at most idx->key_size.
+ * @record              : Buffer of idx->key_size bytes.
+ * @pos                 : Position of the first record not before @key.
+ *
+ * Binary searches the records of @idx on disk, reading one record
+ * per step.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+static int libretrodb_index_lower_bound(int fd, const libretrodb_index_t *idx,
+      const uint8_t *key, uint64_t len, uint8_t *record, uint64_t *pos)
 {
-   int mid            = count / 2;
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t * current = (uint64_t *)buff + (mid * item_size);
-   int rv             = node_compare(current, item, &field_size);
+   int rv;
+   uint64_t lo = 0;
+   uint64_t hi = idx->count;
 
-   if (rv == 0)
+   while (lo < hi)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
-   }
+      uint64_t mid = lo + (hi - lo) / 2;
 
-   if (count == 0)
-      return -1;
+      if ((rv = libretrodb_index_read_record(fd, idx, mid, record, NULL)) < 0)
+         return rv;
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+      if (memcmp(record, key, len) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+   *pos = lo;
+   return 0;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out)
 {
-   libretrodb_index_t idx;
    int rv;
-   void * buff;
-   uint64_t offset;
-   ssize_t bufflen, nread = 0;
+   uint64_t pos, offset;
+   uint8_t *record              = NULL;
+   const libretrodb_index_t *idx = libretrodb_find_index(db, index_name);
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
+   if (!idx)
       return -1;
 
-   bufflen = idx.next;
-   buff = malloc(bufflen);
-
-   if (!buff)
+   if (!(record = (uint8_t*)malloc(idx->key_size)))
       return -ENOMEM;
 
-   while (nread < bufflen)
-   {
-      void * buff_ = (uint64_t *)buff + nread;
-      rv = read(db->fd, buff_, bufflen - nread);
-
-      if (rv <= 0)
-      {
-         free(buff);
-         return -errno;
-      }
-      nread += rv;
-   }
-
-   rv = binsearch(buff, key, db->count, idx.key_size, &offset);
-   free(buff);
+   rv = libretrodb_index_lower_bound(db->fd, idx, (const uint8_t*)key,
+         idx->key_size, record, &pos);
 
    if (rv == 0)
-      lseek(db->fd, offset, SEEK_SET);
+   {
+      if (pos >= idx->count)
+         rv = -1;
+      else if ((rv = libretrodb_index_read_record(db->fd, idx, pos,
+                  record, &offset)) == 0 && memcmp(record, key, idx->key_size))
+         rv = -1;
+   }
 
-   rv = rmsgpack_dom_read(db->fd, out);
+   free(record);
 
    if (rv < 0)
       return rv;
 
-   return rv;
+   lseek(db->fd, offset, SEEK_SET);
+
+   return rmsgpack_dom_read(db->fd, out);
 }
 
 /**
@@ -292,11 +486,58 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
 	cursor->eof = 0;
+
+	if (cursor->index)
+		return libretrodb_index_lower_bound(cursor->fd, cursor->index,
+            cursor->index_key, cursor->index_key_len,
+            cursor->index_record, &cursor->index_pos);
+
 	return lseek(cursor->fd,
          cursor->db->root + sizeof(libretrodb_header_t),
          SEEK_SET);
 }
 
+/**
+ * libretrodb_cursor_seek_next:
+ * @cursor              : Handle to database cursor.
+ *
+ * Seeks to the item of the next index record matching the key
+ * of @cursor.
+ *
+ * Returns: 0 if successful, EOF past the last match, otherwise negative.
+ **/
+static int libretrodb_cursor_seek_next(libretrodb_cursor_t *cursor)
+{
+   int rv;
+   uint64_t offset;
+
+   if (cursor->index_pos >= cursor->index->count)
+      return EOF;
+
+   if ((rv = libretrodb_index_read_record(cursor->fd, cursor->index,
+               cursor->index_pos, cursor->index_record, &offset)) < 0)
+      return rv;
+
+   if (memcmp(cursor->index_record, cursor->index_key,
+            cursor->index_key_len))
+      return EOF;
+
+   cursor->index_pos++;
+   lseek(cursor->fd, offset, SEEK_SET);
+   return 0;
+}
+
+/**
+ * libretrodb_cursor_read_item:
+ * @cursor              : Handle to database cursor.
+ * @out                 : Item read.
+ *
+ * Reads the next item matching the query of @cursor. @out is owned
+ * by @cursor and stays valid until the next read or until @cursor
+ * is closed. It must not be freed.
+ *
+ * Returns: 0 if successful, EOF past the last item, otherwise negative.
+ **/
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value * out)
 {
@@ -306,7 +547,16 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       return EOF;
 
 retry:
-   rv = rmsgpack_dom_read(cursor->fd, out);
+   rmsgpack_dom_arena_reset(&cursor->arena);
+
+   if (cursor->index && (rv = libretrodb_cursor_seek_next(cursor)) != 0)
+   {
+      if (rv == EOF)
+         cursor->eof = 1;
+      return rv;
+   }
+
+   rv = rmsgpack_dom_read_arena(cursor->fd, out, &cursor->arena);
    if (rv < 0)
       return rv;
 
@@ -341,6 +591,11 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
 	cursor->fd = -1;
 	cursor->eof = 1;
 	cursor->db = NULL;
+	cursor->index = NULL;
+
+	free(cursor->index_record);
+	cursor->index_record = NULL;
+	rmsgpack_dom_arena_free(&cursor->arena);
 
 	if (cursor->query)
 		libretrodb_query_free(cursor->query);
@@ -361,14 +616,40 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
 int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
       libretrodb_query_t *q)
 {
+   int rv;
+
    cursor->fd = dup(db->fd);
 
    if (cursor->fd == -1)
-      return -errno;
+      return errno ? -errno : -EIO;
+
+   cursor->db           = db;
+   cursor->is_valid     = 1;
+   cursor->index        = NULL;
+   cursor->index_record = NULL;
+   rmsgpack_dom_arena_init(&cursor->arena);
+
+   if (q)
+      cursor->index = libretrodb_query_get_index(q,
+            &cursor->index_key, &cursor->index_key_len);
+
+   if (cursor->index && !(cursor->index_record =
+            (uint8_t*)malloc(cursor->index->key_size)))
+   {
+      close(cursor->fd);
+      cursor->is_valid = 0;
+      return -ENOMEM;
+   }
+
+   if ((rv = libretrodb_cursor_reset(cursor)) < 0)
+   {
+      free(cursor->index_record);
+      cursor->index_record = NULL;
+      close(cursor->fd);
+      cursor->is_valid = 0;
+      return rv;
+   }
 
-   cursor->db = db;
-   cursor->is_valid = 1;
-   libretrodb_cursor_reset(cursor);
    cursor->query = q;
 
    if (q)
@@ -377,140 +658,350 @@ int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
    return 0;
 }
 
-static int node_iter(void * value, void * ctx)
+static void libretrodb_index_builder_free(libretrodb_index_builder_t *b)
 {
-	struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
+   free(b->keys);
+   free(b->entries);
+   b->keys    = NULL;
+   b->entries = NULL;
+}
 
-	if (write(nictx->db->fd, value,
-            nictx->idx->key_size + sizeof(uint64_t)) > 0)
-		return 0;
+/**
+ * libretrodb_index_builder_add:
+ * @b                   : Index builder.
+ * @item                : Item read from the database.
+ * @offset              : Offset of @item in the database.
+ *
+ * Appends the key of @item to the keys of @b.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+static int libretrodb_index_builder_add(libretrodb_index_builder_t *b,
+      const struct rmsgpack_dom_value *item, uint64_t offset)
+{
+   uint8_t uint_key[sizeof(uint64_t)];
+   const uint8_t *key = NULL;
+   uint32_t key_len   = 0;
+   struct rmsgpack_dom_value *field =
+      rmsgpack_dom_value_map_value(item, &b->field);
+
+   /* Items without the field are left out of the index. */
+   if (!field)
+      return 0;
 
-	return -1;
+   if (b->key_type == RDT_NULL)
+   {
+      switch (field->type)
+      {
+         case RDT_BINARY:
+         case RDT_STRING:
+            b->key_type = field->type;
+            break;
+         case RDT_UINT:
+         case RDT_INT:
+            b->key_type = RDT_UINT;
+            b->key_size = sizeof(uint64_t);
+            break;
+         default:
+            printf("field is not binary, string or uint\n");
+            return -EINVAL;
+      }
+   }
+
+   switch (b->key_type)
+   {
+      case RDT_STRING:
+         if (field->type != RDT_STRING)
+            return 0;
+
+         key     = (const uint8_t*)field->string.buff;
+         key_len = field->string.len;
+
+         if (key_len > b->key_size)
+            b->key_size = key_len;
+         break;
+      case RDT_UINT:
+      {
+         unsigned i;
+         uint64_t value;
+
+         /* Queries compare uints and non-negative ints as equal. */
+         if (field->type != RDT_UINT
+               && (field->type != RDT_INT || field->int_ < 0))
+            return 0;
+
+         value = field->type == RDT_UINT ? field->uint_ : (uint64_t)field->int_;
+         for (i = 0; i < sizeof(uint_key); i++)
+            uint_key[i] = (uint8_t)(value >> ((sizeof(uint_key) - 1 - i) * 8));
+
+         key     = uint_key;
+         key_len = sizeof(uint_key);
+         break;
+      }
+      case RDT_BINARY:
+         if (field->type != RDT_BINARY)
+         {
+            printf("field is not binary\n");
+            return -EINVAL;
+         }
+
+         if (field->binary.len == 0)
+         {
+            printf("field is empty\n");
+            return -EINVAL;
+         }
+
+         if (b->key_size == 0)
+            b->key_size = field->binary.len;
+         else if (field->binary.len != b->key_size)
+         {
+            printf("field is not of correct size\n");
+            return -EINVAL;
+         }
+
+         key     = (const uint8_t*)field->binary.buff;
+         key_len = field->binary.len;
+         break;
+      default:
+         return 0;
+   }
+
+   if (b->keys_len + key_len > b->keys_cap)
+   {
+      size_t cap    = b->keys_cap ? b->keys_cap * 2 : 4096;
+      uint8_t *keys = NULL;
+
+      while (cap < b->keys_len + key_len)
+         cap *= 2;
+
+      if (!(keys = (uint8_t*)realloc(b->keys, cap)))
+         return -ENOMEM;
+
+      b->keys     = keys;
+      b->keys_cap = cap;
+   }
+
+   if (b->count == b->cap)
+   {
+      size_t cap = b->cap ? b->cap * 2 : 256;
+      libretrodb_index_key_t *entries = (libretrodb_index_key_t*)
+         realloc(b->entries, cap * sizeof(*entries));
+
+      if (!entries)
+         return -ENOMEM;
+
+      b->entries = entries;
+      b->cap     = cap;
+   }
+
+   memcpy(b->keys + b->keys_len, key, key_len);
+
+   b->entries[b->count].key     = NULL;
+   b->entries[b->count].key_pos = b->keys_len;
+   b->entries[b->count].key_len = key_len;
+   b->entries[b->count].offset  = offset;
+   b->count++;
+   b->keys_len += key_len;
+
+   return 0;
 }
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
+/* Orders keys as their zero padded records would be. */
+static int libretrodb_index_key_cmp(const void *a, const void *b)
 {
-	return lseek(db->fd, 0, SEEK_CUR);
+   const libretrodb_index_key_t *ka = (const libretrodb_index_key_t*)a;
+   const libretrodb_index_key_t *kb = (const libretrodb_index_key_t*)b;
+   int rv = memcmp(ka->key, kb->key,
+         ka->key_len < kb->key_len ? ka->key_len : kb->key_len);
+
+   if (rv)
+      return rv;
+   if (ka->key_len != kb->key_len)
+      return ka->key_len < kb->key_len ? -1 : 1;
+
+   /* Keep duplicates in database order. */
+   return (ka->offset > kb->offset) - (ka->offset < kb->offset);
 }
 
-int libretrodb_create_index(libretrodb_t *db,
-      const char *name, const char *field_name)
+/**
+ * libretrodb_index_builder_write:
+ * @b                   : Index builder.
+ * @fp                  : File to append the index to.
+ *
+ * Sorts the keys collected by @b and writes the index in one pass.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+static int libretrodb_index_builder_write(libretrodb_index_builder_t *b,
+      FILE *fp)
 {
-	int rv;
-	struct node_iter_ctx nictx;
-	struct rmsgpack_dom_value key;
-	libretrodb_index_t idx;
-	struct rmsgpack_dom_value item;
-	struct rmsgpack_dom_value * field;
-	struct bintree tree;
-	libretrodb_cursor_t cur;
-	uint64_t idx_header_offset;
-	void * buff = NULL;
-	uint64_t * buff_u64 = NULL;
-	uint8_t field_size = 0;
-	uint64_t item_loc = libretrodb_tell(db);
-
-	bintree_new(&tree, node_compare, &field_size);
-
-	if (libretrodb_cursor_open(db, &cur, NULL) != 0)
+   size_t i;
+   libretrodb_index_t idx;
+   static const uint8_t padding[256] = {0};
+
+   for (i = 0; i < b->count; i++)
+      b->entries[i].key = b->keys + b->entries[i].key_pos;
+
+   qsort(b->entries, b->count, sizeof(*b->entries), libretrodb_index_key_cmp);
+
+   for (i = 1; b->key_type == RDT_BINARY && i < b->count; i++)
    {
-		rv = -1;
-		goto clean;
-	}
+      struct rmsgpack_dom_value field;
+
+      if (memcmp(b->entries[i - 1].key, b->entries[i].key, b->key_size))
+         continue;
+
+      field.type        = RDT_BINARY;
+      field.binary.len  = b->key_size;
+      field.binary.buff = (char*)b->entries[i].key;
+
+      printf("Value is not unique: ");
+      rmsgpack_dom_value_print(&field);
+      printf("\n");
+      return -EINVAL;
+   }
 
-	key.type = RDT_STRING;
-	key.string.len = strlen(field_name);
+   memset(&idx, 0, sizeof(idx));
+   strncpy(idx.name, b->name, sizeof(idx.name) - 1);
+   strncpy(idx.field, b->field_name, sizeof(idx.field) - 1);
 
-	/* We know we aren't going to change it */
-	key.string.buff = (char *) field_name;
+   idx.key_type  = b->key_type;
+   idx.key_size  = b->key_size;
+   idx.next = b->count * (b->key_size + sizeof(uint64_t));
+   libretrodb_write_index_header(fp, &idx);
 
-	while (libretrodb_cursor_read_item(&cur, &item) == 0)
+   for (i = 0; i < b->count; i++)
    {
-		if (item.type != RDT_MAP)
-      {
-			rv = -EINVAL;
-			printf("Only map keys are supported\n");
-			goto clean;
-		}
+      uint64_t pad    = b->key_size - b->entries[i].key_len;
+      uint64_t offset = httobe64(b->entries[i].offset);
 
-		field = rmsgpack_dom_value_map_value(&item, &key);
+      if (fwrite(b->entries[i].key, 1, b->entries[i].key_len, fp)
+            != b->entries[i].key_len)
+         return errno ? -errno : -EIO;
 
-		if (!field)
+      while (pad)
       {
-			rv = -EINVAL;
-			printf("field not found in item\n");
-			goto clean;
-		}
+         size_t len = pad < sizeof(padding) ? pad : sizeof(padding);
 
-		if (field->type != RDT_BINARY)
-      {
-			rv = -EINVAL;
-			printf("field is not binary\n");
-			goto clean;
-		}
+         if (fwrite(padding, 1, len, fp) != len)
+            return errno ? -errno : -EIO;
+         pad -= len;
+      }
 
-		if (field->binary.len == 0)
-      {
-			rv = -EINVAL;
-			printf("field is empty\n");
-			goto clean;
-		}
-
-		if (field_size == 0)
-			field_size = field->binary.len;
-		else if (field->binary.len != field_size)
+      if (fwrite(&offset, sizeof(offset), 1, fp) != 1)
+         return errno ? -errno : -EIO;
+   }
+
+   return 0;
+}
+
+/**
+ * libretrodb_create_indexes:
+ * @db                  : Handle to database.
+ * @names               : Names of the indexes.
+ * @field_names         : Names of the indexed fields.
+ * @count               : Number of indexes.
+ *
+ * Creates @count indexes in a single scan of the database and
+ * appends them to it.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_create_indexes(libretrodb_t *db, const char **names,
+      const char **field_names, unsigned count)
+{
+   unsigned i;
+   int rv                              = 0;
+   FILE *fp                            = NULL;
+   libretrodb_index_builder_t *builders = NULL;
+   struct rmsgpack_dom_value item;
+   libretrodb_cursor_t cur;
+   uint64_t item_loc;
+
+   memset(&cur, 0, sizeof(cur));
+   item.type = RDT_NULL;
+
+   builders = (libretrodb_index_builder_t*)calloc(count, sizeof(*builders));
+   if (!builders)
+      return -ENOMEM;
+
+   for (i = 0; i < count; i++)
+   {
+      builders[i].name = names[i];
+      builders[i].field_name = field_names[i];
+      builders[i].key_type = RDT_NULL;
+      builders[i].field.type = RDT_STRING;
+      builders[i].field.string.len = strlen(field_names[i]);
+
+      /* We know we aren't going to change it */
+      builders[i].field.string.buff = (char *) field_names[i];
+   }
+
+   if ((rv = libretrodb_cursor_open(db, &cur, NULL)) != 0)
+      goto clean;
+
+   item_loc = lseek(cur.fd, 0, SEEK_CUR);
+
+   while ((rv = libretrodb_cursor_read_item(&cur, &item)) == 0)
+   {
+      if (item.type != RDT_MAP)
       {
-			rv = -EINVAL;
-			printf("field is not of correct size\n");
-			goto clean;
-		}
+         rv = -EINVAL;
+         printf("Only map keys are supported\n");
+         goto clean;
+      }
 
-		buff = malloc(field_size + sizeof(uint64_t));
-		if (!buff)
+      for (i = 0; i < count; i++)
       {
-			rv = -ENOMEM;
-			goto clean;
-		}
+         if ((rv = libretrodb_index_builder_add(&builders[i],
+                     &item, item_loc)) < 0)
+            goto clean;
+      }
 
-		memcpy(buff, field->binary.buff, field_size);
+      item_loc = lseek(cur.fd, 0, SEEK_CUR);
+   }
 
-		buff_u64 = (uint64_t *)buff + field_size;
+   if (rv != EOF)
+      goto clean;
 
-		memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+   /* Opened for appending, so this does not truncate the database. */
+   if ((rv = dup(db->fd)) == -1 || !(fp = fdopen(rv, "ab")))
+   {
+      if (rv != -1)
+         close(rv);
+      rv = errno ? -errno : -EIO;
+      goto clean;
+   }
 
-		if (bintree_insert(&tree, buff) != 0)
+   for (i = 0; i < count; i++)
+   {
+      if (builders[i].key_type == RDT_NULL)
       {
-			printf("Value is not unique: ");
-			rmsgpack_dom_value_print(field);
-			printf("\n");
-			rv = -EINVAL;
-			goto clean;
-		}
-		buff = NULL;
-		rmsgpack_dom_value_free(&item);
-		item_loc = libretrodb_tell(db);
-	}
-
-	(void)rv;
-	(void)idx_header_offset;
-
-	idx_header_offset = lseek(db->fd, 0, SEEK_END);
-	strncpy(idx.name, name, 50);
-
-	idx.name[49] = '\0';
-	idx.key_size = field_size;
-	idx.next = db->count * (field_size + sizeof(uint64_t));
-	libretrodb_write_index_header(db->fd, &idx);
-
-	nictx.db = db;
-	nictx.idx = &idx;
-	bintree_iterate(&tree, node_iter, &nictx);
-	bintree_free(&tree);
+         printf("field not found in any item\n");
+         rv = -EINVAL;
+         goto clean;
+      }
+
+      if ((rv = libretrodb_index_builder_write(&builders[i], fp)) < 0)
+         goto clean;
+   }
+
+   rv = 0;
 clean:
-	rmsgpack_dom_value_free(&item);
-	if (buff)
-		free(buff);
-	if (cur.is_valid)
-		libretrodb_cursor_close(&cur);
-	return 0;
+   if (fp && fclose(fp) != 0 && rv == 0)
+      rv = errno ? -errno : -EIO;
+   for (i = 0; i < count; i++)
+      libretrodb_index_builder_free(&builders[i]);
+   free(builders);
+   if (cur.is_valid)
+      libretrodb_cursor_close(&cur);
+   if (rv == 0)
+      libretrodb_read_indexes(db);
+   return rv;
+}
+
+int libretrodb_create_index(libretrodb_t *db,
+      const char *name, const char *field_name)
+{
+   return libretrodb_create_indexes(db, &name, &field_name, 1);
 }
@@ -2,6 +2,7 @@
 #define __LIBRETRODB_H__
 
 #include <stdint.h>
+#include <stdio.h>
 #ifdef _WIN32
 #include <direct.h>
 #else
@@ -11,12 +12,28 @@
 
 #define MAGIC_NUMBER "RARCHDB"
 
+#define LIBRETRODB_MAX_INDEXES 16
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct libretrodb_query libretrodb_query_t;
 
+typedef struct libretrodb_index
+{
+	char name[50];
+	/* Indexed field, same as name for indexes without one. */
+	char field[50];
+	/* RDT_BINARY, RDT_STRING (zero padded) or RDT_UINT (big endian). */
+	enum rmsgpack_dom_type key_type;
+	uint64_t key_size;
+	uint64_t next;
+	/* Offset and number of the records following the header. */
+	uint64_t offset;
+	uint64_t count;
+} libretrodb_index_t;
+
 typedef struct libretrodb
 {
 	int fd;
@@ -24,15 +41,10 @@ typedef struct libretrodb
 	uint64_t count;
 	uint64_t first_index_offset;
    char path[1024];
+   libretrodb_index_t indexes[LIBRETRODB_MAX_INDEXES];
+   unsigned index_count;
 } libretrodb_t;
 
-typedef struct libretrodb_index
-{
-	char name[50];
-	uint64_t key_size;
-	uint64_t next;
-} libretrodb_index_t;
-
 typedef struct libretrodb_metadata
 {
 	uint64_t count;
@@ -51,12 +63,31 @@ typedef struct libretrodb_cursor
 	int eof;
 	libretrodb_query_t * query;
 	libretrodb_t * db;
+	/* Index driving the cursor, see libretrodb_query_compile. */
+	const libretrodb_index_t *index;
+	const uint8_t *index_key;
+	uint64_t index_key_len;
+	uint64_t index_pos;
+	uint8_t *index_record;
+	/* Storage for the last item read. */
+	struct rmsgpack_dom_arena arena;
 } libretrodb_cursor_t;
 
 typedef int (* libretrodb_value_provider)(void * ctx,
       struct rmsgpack_dom_value * out);
 
-int libretrodb_create(int fd, libretrodb_value_provider value_provider,
+/**
+ * libretrodb_create:
+ * @fp                  : File to write the database to.
+ * @value_provider      : Callback returning the items to insert.
+ * @ctx                 : Userdata passed to @value_provider.
+ *
+ * Creates a database from the items returned by @value_provider,
+ * until it returns a non-zero value.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_create(FILE *fp, libretrodb_value_provider value_provider,
       void * ctx);
 
 void libretrodb_close(libretrodb_t * db);
@@ -66,6 +97,37 @@ int libretrodb_open(const char * path, libretrodb_t * db);
 int libretrodb_create_index(libretrodb_t * db, const char *name,
       const char *field_name);
 
+/**
+ * libretrodb_create_indexes:
+ * @db                  : Handle to database.
+ * @names               : Names of the indexes.
+ * @field_names         : Names of the indexed fields.
+ * @count               : Number of indexes.
+ *
+ * Creates @count indexes in a single scan of the database. Keys are
+ * sorted in memory and each index is written out in one pass.
+ *
+ * The key type is taken from the first item holding the field, and
+ * items without the field are left out of the index. Binary keys
+ * must all be of the same size and unique, string and uint keys
+ * may repeat.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_create_indexes(libretrodb_t *db, const char **names,
+      const char **field_names, unsigned count);
+
+/**
+ * libretrodb_find_index_by_field:
+ * @db                  : Handle to database.
+ * @field               : Name of field.
+ * @len                 : Length of @field.
+ *
+ * Returns: index over @field if found, otherwise NULL.
+ **/
+const libretrodb_index_t *libretrodb_find_index_by_field(
+      const libretrodb_t *db, const char *field, size_t len);
+
 int libretrodb_find_entry(
         libretrodb_t * db,
         const char * index_name,
@@ -107,6 +169,19 @@ int libretrodb_cursor_reset(libretrodb_cursor_t * cursor);
  **/
 void libretrodb_cursor_close(libretrodb_cursor_t * cursor);
 
+/**
+ * libretrodb_query_compile:
+ * @db                  : Handle to database.
+ * @query               : Query expression.
+ * @buff_len            : Length of @query.
+ * @error               : Set to an error message if compiling fails.
+ *
+ * Compiles @query. Equality and glob prefix matches on fields with an
+ * index of @db are planned as an index range, so cursors opened with
+ * the query only decode the items within that range.
+ *
+ * Returns: compiled query, only valid if @error is NULL.
+ **/
 void *libretrodb_query_compile(
         libretrodb_t * db,
         const char * query,
@@ -116,6 +191,7 @@ void *libretrodb_query_compile(
 
 void libretrodb_query_free(void *q);
 
+/* The item read is owned by the cursor, see libretrodb.c. */
 int libretrodb_cursor_read_item(libretrodb_cursor_t * cursor,
       struct rmsgpack_dom_value * out);
 
@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "libretrodb.h"
+#include "rmsgpack_dom.h"
+
+/* Benchmarks creating a database from a clrmamepro DAT file, building
+ * its indexes and looking entries up through them. Fields are mapped
+ * like dat_converter.lua does, for DATs made by dat_generator. */
+
+#define BENCH_FIELDS 16
+
+typedef struct bench_token
+{
+   const char *ptr;
+   size_t len;
+} bench_token_t;
+
+typedef struct bench_lexer
+{
+   const char *pos;
+   const char *end;
+} bench_lexer_t;
+
+typedef struct bench_game
+{
+   struct rmsgpack_dom_pair pairs[BENCH_FIELDS];
+   unsigned count;
+} bench_game_t;
+
+typedef struct bench_dat
+{
+   bench_game_t *games;
+   size_t count;
+   size_t cap;
+   size_t next;
+} bench_dat_t;
+
+static double bench_now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int bench_next_token(bench_lexer_t *lex, bench_token_t *tok)
+{
+   while (lex->pos < lex->end && strchr(" \t\r\n", *lex->pos))
+      lex->pos++;
+
+   if (lex->pos >= lex->end)
+      return 0;
+
+   tok->ptr = lex->pos;
+
+   if (*lex->pos == '(' || *lex->pos == ')')
+   {
+      tok->len = 1;
+      lex->pos++;
+      return 1;
+   }
+
+   if (*lex->pos == '"')
+   {
+      const char *quote = (const char*)memchr(lex->pos + 1, '"',
+            lex->end - lex->pos - 1);
+
+      if (!quote)
+         return -EINVAL;
+
+      tok->ptr = lex->pos + 1;
+      tok->len = quote - tok->ptr;
+      lex->pos = quote + 1;
+      return 1;
+   }
+
+   while (lex->pos < lex->end && !strchr(" \t\r\n()", *lex->pos))
+      lex->pos++;
+
+   tok->len = lex->pos - tok->ptr;
+   return 1;
+}
+
+static int bench_token_is(const bench_token_t *tok, const char *str)
+{
+   return tok->len == strlen(str) && !memcmp(tok->ptr, str, tok->len);
+}
+
+static char *bench_strndup(const char *str, size_t len)
+{
+   char *ret = (char*)malloc(len + 1);
+
+   if (!ret)
+      return NULL;
+
+   memcpy(ret, str, len);
+   ret[len] = '\0';
+   return ret;
+}
+
+static int bench_hex_nibble(char c)
+{
+   if (c >= '0' && c <= '9')
+      return c - '0';
+   if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+   return -1;
+}
+
+static int bench_add_field(bench_game_t *game, const char *key,
+      const bench_token_t *tok, enum rmsgpack_dom_type type, int hex)
+{
+   size_t i;
+   struct rmsgpack_dom_pair *pair;
+
+   if (game->count == BENCH_FIELDS)
+      return -EINVAL;
+
+   pair                    = &game->pairs[game->count];
+   pair->key.type          = RDT_STRING;
+   pair->key.string.len    = strlen(key);
+   pair->key.string.buff   = bench_strndup(key, strlen(key));
+   pair->value.type        = type;
+
+   switch (type)
+   {
+      case RDT_UINT:
+         pair->value.uint_ = strtoull(tok->ptr, NULL, 10);
+         break;
+      case RDT_STRING:
+         pair->value.string.len  = tok->len;
+         pair->value.string.buff = bench_strndup(tok->ptr, tok->len);
+         break;
+      case RDT_BINARY:
+         if (!hex)
+         {
+            pair->value.binary.len  = tok->len;
+            pair->value.binary.buff = bench_strndup(tok->ptr, tok->len);
+            break;
+         }
+         if (tok->len % 2)
+            return -EINVAL;
+         pair->value.binary.len  = tok->len / 2;
+         pair->value.binary.buff = (char*)malloc(tok->len / 2 + 1);
+         if (!pair->value.binary.buff)
+            return -ENOMEM;
+         for (i = 0; i < tok->len / 2; i++)
+         {
+            int hi = bench_hex_nibble(tok->ptr[i * 2]);
+            int lo = bench_hex_nibble(tok->ptr[i * 2 + 1]);
+
+            if (hi < 0 || lo < 0)
+               return -EINVAL;
+            pair->value.binary.buff[i] = (char)(hi << 4 | lo);
+         }
+         break;
+      default:
+         return -EINVAL;
+   }
+
+   game->count++;
+   return 0;
+}
+
+/* Field name in the database and type of a DAT key. */
+static int bench_map_field(bench_game_t *game, const bench_token_t *key,
+      const bench_token_t *value, int in_rom)
+{
+   static const struct
+   {
+      const char *dat;
+      const char *db;
+      enum rmsgpack_dom_type type;
+      int hex;
+      int in_rom;
+   } fields[] = {
+      { "name",         "name",         RDT_STRING, 0, 0 },
+      { "description",  "description",  RDT_STRING, 0, 0 },
+      { "developer",    "developer",    RDT_STRING, 0, 0 },
+      { "publisher",    "publisher",    RDT_STRING, 0, 0 },
+      { "releaseyear",  "releaseyear",  RDT_UINT,   0, 0 },
+      { "releasemonth", "releasemonth", RDT_UINT,   0, 0 },
+      { "serial",       "serial",       RDT_BINARY, 0, 0 },
+      { "name",         "rom_name",     RDT_STRING, 0, 1 },
+      { "size",         "size",         RDT_UINT,   0, 1 },
+      { "crc",          "crc",          RDT_BINARY, 1, 1 },
+      { "md5",          "md5",          RDT_BINARY, 1, 1 },
+      { "sha1",         "sha1",         RDT_BINARY, 1, 1 },
+   };
+   unsigned i;
+
+   for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+      if (fields[i].in_rom == in_rom && bench_token_is(key, fields[i].dat))
+         return bench_add_field(game, fields[i].db, value,
+               fields[i].type, fields[i].hex);
+
+   return 0;
+}
+
+static int bench_parse_table(bench_lexer_t *lex, bench_game_t *game,
+      int in_rom)
+{
+   int rv;
+   bench_token_t key, value;
+
+   while ((rv = bench_next_token(lex, &key)) > 0)
+   {
+      if (bench_token_is(&key, ")"))
+         return 0;
+
+      if ((rv = bench_next_token(lex, &value)) <= 0)
+         return rv < 0 ? rv : -EINVAL;
+
+      if (bench_token_is(&value, "("))
+      {
+         if ((rv = bench_parse_table(lex, game,
+                     in_rom || bench_token_is(&key, "rom"))) < 0)
+            return rv;
+         continue;
+      }
+
+      if (game && (rv = bench_map_field(game, &key, &value, in_rom)) < 0)
+         return rv;
+   }
+
+   return rv < 0 ? rv : -EINVAL;
+}
+
+static int bench_parse_dat(bench_dat_t *dat, const char *buf, size_t len)
+{
+   int rv;
+   bench_token_t key, open;
+   bench_lexer_t lex;
+
+   lex.pos = buf;
+   lex.end = buf + len;
+
+   while ((rv = bench_next_token(&lex, &key)) > 0)
+   {
+      bench_game_t *game = NULL;
+
+      if ((rv = bench_next_token(&lex, &open)) <= 0
+            || !bench_token_is(&open, "("))
+         return -EINVAL;
+
+      if (bench_token_is(&key, "game"))
+      {
+         if (dat->count == dat->cap)
+         {
+            size_t cap = dat->cap ? dat->cap * 2 : 1024;
+            bench_game_t *games = (bench_game_t*)realloc(dat->games,
+                  cap * sizeof(*games));
+
+            if (!games)
+               return -ENOMEM;
+
+            dat->games = games;
+            dat->cap   = cap;
+         }
+
+         game = &dat->games[dat->count++];
+         game->count = 0;
+      }
+
+      if ((rv = bench_parse_table(&lex, game, 0)) < 0)
+         return rv;
+   }
+
+   return rv;
+}
+
+static int bench_value_provider(void *ctx, struct rmsgpack_dom_value *out)
+{
+   bench_dat_t *dat = (bench_dat_t*)ctx;
+   bench_game_t *game;
+
+   if (dat->next == dat->count)
+      return 1;
+
+   game = &dat->games[dat->next++];
+
+   /* libretrodb_create frees the item, so it takes over the fields. */
+   out->type      = RDT_MAP;
+   out->map.len   = game->count;
+   out->map.items = (struct rmsgpack_dom_pair*)malloc(
+         game->count * sizeof(*out->map.items));
+   if (!out->map.items)
+      return -ENOMEM;
+
+   memcpy(out->map.items, game->pairs, game->count * sizeof(*game->pairs));
+   return 0;
+}
+
+static const struct rmsgpack_dom_value *bench_field(
+      const bench_game_t *game, const char *key)
+{
+   unsigned i;
+
+   for (i = 0; i < game->count; i++)
+      if (!strcmp(game->pairs[i].key.string.buff, key))
+         return &game->pairs[i].value;
+   return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+   int rv;
+   size_t i, lookups, found = 0;
+   long len;
+   char *buf = NULL;
+   char **queries = NULL;
+   double start, t_parse, t_create, t_index, t_find;
+   FILE *fp;
+   struct stat st;
+   libretrodb_t db;
+   bench_dat_t dat;
+   static const char *index_names[]  = { "crc", "md5", "sha1", "name" };
+   static const char *index_fields[] = { "crc", "md5", "sha1", "name" };
+
+   if (argc < 3)
+   {
+      printf("Usage: %s <dat file> <db file> [lookups]\n", argv[0]);
+      return 1;
+   }
+
+   lookups = argc > 3 ? strtoul(argv[3], NULL, 0) : 10000;
+   memset(&dat, 0, sizeof(dat));
+
+   if (!(fp = fopen(argv[1], "rb")))
+   {
+      printf("Could not open dat file '%s'\n", argv[1]);
+      return 1;
+   }
+
+   fseek(fp, 0, SEEK_END);
+   len = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+
+   if (len < 0 || !(buf = (char*)malloc(len + 1))
+         || fread(buf, 1, len, fp) != (size_t)len)
+   {
+      printf("Could not read dat file '%s'\n", argv[1]);
+      return 1;
+   }
+   fclose(fp);
+
+   start = bench_now();
+   if ((rv = bench_parse_dat(&dat, buf, len)) < 0)
+   {
+      printf("Could not parse dat file: %s\n", strerror(-rv));
+      return 1;
+   }
+   t_parse = bench_now() - start;
+
+   /* Prepared ahead, the fields are handed to the database below. */
+   if (lookups > dat.count)
+      lookups = dat.count;
+   queries = (char**)calloc(lookups ? lookups : 1, sizeof(*queries));
+   for (i = 0; queries && i < lookups; i++)
+   {
+      size_t j;
+      const struct rmsgpack_dom_value *crc =
+         bench_field(&dat.games[(i * 7919) % dat.count], "crc");
+
+      if (!crc || !(queries[i] = (char*)malloc(crc->binary.len * 2 + 16)))
+         continue;
+
+      strcpy(queries[i], "{'crc':b'");
+      for (j = 0; j < crc->binary.len; j++)
+         sprintf(queries[i] + 9 + j * 2, "%02X",
+               (unsigned)(uint8_t)crc->binary.buff[j]);
+      strcat(queries[i], "'}");
+   }
+
+   if (!(fp = fopen(argv[2], "wb")))
+   {
+      printf("Could not open db file '%s'\n", argv[2]);
+      return 1;
+   }
+
+   start = bench_now();
+   rv    = libretrodb_create(fp, bench_value_provider, &dat);
+   if (fclose(fp) != 0 && rv == 0)
+      rv = -errno;
+   t_create = bench_now() - start;
+
+   if (rv < 0)
+   {
+      printf("Could not create db file: %s\n", strerror(-rv));
+      return 1;
+   }
+
+   if ((rv = libretrodb_open(argv[2], &db)) != 0)
+   {
+      printf("Could not open db file '%s': %s\n", argv[2], strerror(-rv));
+      return 1;
+   }
+
+   start = bench_now();
+   rv    = libretrodb_create_indexes(&db, index_names, index_fields,
+         sizeof(index_names) / sizeof(index_names[0]));
+   t_index = bench_now() - start;
+
+   if (rv != 0)
+   {
+      printf("Could not create index: %s\n", strerror(-rv));
+      return 1;
+   }
+
+   start = bench_now();
+   for (i = 0; queries && i < lookups; i++)
+   {
+      const char *error = NULL;
+      libretrodb_cursor_t cur;
+      struct rmsgpack_dom_value item;
+      libretrodb_query_t *q;
+
+      if (!queries[i])
+         continue;
+
+      q = (libretrodb_query_t*)libretrodb_query_compile(&db, queries[i],
+            strlen(queries[i]), &error);
+      if (error)
+      {
+         printf("%s\n", error);
+         return 1;
+      }
+
+      if (libretrodb_cursor_open(&db, &cur, q) == 0)
+      {
+         if (libretrodb_cursor_read_item(&cur, &item) == 0)
+            found++;
+         libretrodb_cursor_close(&cur);
+      }
+      libretrodb_query_free(q);
+   }
+   t_find = bench_now() - start;
+
+   libretrodb_close(&db);
+   stat(argv[2], &st);
+
+   printf("%lu games, %ld byte dat, %ld byte db\n",
+         (unsigned long)dat.count, len, (long)st.st_size);
+   printf("parse:  %8.3f s\n", t_parse);
+   printf("create: %8.3f s\n", t_create);
+   printf("index:  %8.3f s (crc, md5, sha1, name)\n", t_index);
+   printf("find:   %8.3f s for %lu crc lookups, %lu found, %.1f us each\n",
+         t_find, (unsigned long)lookups, (unsigned long)found,
+         lookups ? t_find * 1e6 / lookups : 0.0);
+
+   for (i = 0; queries && i < lookups; i++)
+      free(queries[i]);
+   free(queries);
+   free(dat.games);
+   free(buf);
+   return found == lookups ? 0 : 1;
+}
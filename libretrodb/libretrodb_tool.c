@@ -18,7 +18,7 @@ int main(int argc, char ** argv)
       printf("Usage: %s <db file> <command> [extra args...]\n", argv[0]);
       printf("Available Commands:\n");
       printf("\tlist\n");
-      printf("\tcreate-index <index name> <field name>\n");
+      printf("\tcreate-index <index name> <field name> [<index name> <field name>...]\n");
       printf("\tfind <query expression>\n");
       return 1;
    }
@@ -49,7 +49,6 @@ int main(int argc, char ** argv)
       {
          rmsgpack_dom_value_print(&item);
          printf("\n");
-         rmsgpack_dom_value_free(&item);
       }
    }
    else if (strcmp(command, "find") == 0)
@@ -80,23 +79,33 @@ int main(int argc, char ** argv)
       {
          rmsgpack_dom_value_print(&item);
          printf("\n");
-         rmsgpack_dom_value_free(&item);
       }
    }
    else if (strcmp(command, "create-index") == 0)
    {
-      const char * index_name, * field_name;
+      int i;
+      const char *index_names[16], *field_names[16];
+      unsigned count = (argc - 3) / 2;
 
-      if (argc != 5)
+      if (argc < 5 || (argc - 3) % 2 || count > 16)
       {
-         printf("Usage: %s <db file> create-index <index name> <field name>\n", argv[0]);
+         printf("Usage: %s <db file> create-index <index name> <field name> [<index name> <field name>...]\n", argv[0]);
          return 1;
       }
 
-      index_name = argv[3];
-      field_name = argv[4];
+      /* All indexes are built in a single scan of the database. */
+      for (i = 0; i < (int)count; i++)
+      {
+         index_names[i] = argv[3 + i * 2];
+         field_names[i] = argv[4 + i * 2];
+      }
 
-      libretrodb_create_index(&db, index_name, field_name);
+      if ((rv = libretrodb_create_indexes(&db, index_names,
+                  field_names, count)) != 0)
+      {
+         printf("Could not create index: %s\n", strerror(-rv));
+         return 1;
+      }
    }
    else
    {
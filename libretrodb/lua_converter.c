@@ -76,7 +76,7 @@ int main(
 ){
 	const char * db_file;
 	const char * lua_file;
-	int dst = -1;
+	FILE *dst = NULL;
 	int rv = 0;
 
 	if (argc < 3) {
@@ -97,8 +97,8 @@ int main(
 
 	call_init(L, argc - 2, (const char **) argv + 2);
 
-	dst = open(db_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
-	if (dst == -1) {
+	dst = fopen(db_file, "wb");
+	if (!dst) {
 		printf(
 		        "Could not open destination file '%s': %s\n",
 		        db_file,
@@ -111,8 +111,8 @@ int main(
 	rv = libretrodb_create(dst, &value_provider, L);
 clean:
 	lua_close(L);
-	if (dst != -1) {
-		close(dst);
+	if (dst) {
+		fclose(dst);
 	}
 	return rv;
 }
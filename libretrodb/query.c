@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "libretrodb.h"
+#include "query.h"
 
 #include "rmsgpack_dom.h"
 #include <compat/fnmatch.h>
@@ -58,6 +59,18 @@ static void raise_expected_string(off_t where, const char ** error)
    *error = tmp_error_buff;
 }
 
+static void raise_expected_binary(off_t where, const char ** error)
+{
+   snprintf(tmp_error_buff, MAX_ERROR_LEN,
+#ifdef _WIN32
+         "%I64u::Expected hex string",
+#else
+         "%llu::Expected hex string",
+#endif
+         (unsigned long long)where);
+   *error = tmp_error_buff;
+}
+
 static void raise_unexpected_eof(off_t where, const char ** error)
 {
    snprintf(tmp_error_buff, MAX_ERROR_LEN,
@@ -171,6 +184,10 @@ struct query
 {
 	unsigned ref_count;
 	struct invocation root;
+	/* Index all results are found in, see query_plan. */
+	const libretrodb_index_t *index;
+	uint8_t *index_key;
+	uint64_t index_key_len;
 };
 
 struct registered_func
@@ -541,6 +558,62 @@ static struct buffer parse_integer(struct buffer buff,
    return buff;
 }
 
+static int hex_digit(char c)
+{
+   if (c >= '0' && c <= '9')
+      return c - '0';
+   if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+   return -1;
+}
+
+/* Binary values are written as b'<hex digits>'. */
+static struct buffer parse_binary(struct buffer buff,
+      struct rmsgpack_dom_value *value, const char **error)
+{
+   uint32_t i;
+   off_t start = buff.offset;
+   struct rmsgpack_dom_value str;
+
+   buff.offset++;
+   buff = parse_string(buff, &str, error);
+
+   if (*error)
+      return buff;
+
+   if (str.string.len % 2)
+   {
+      rmsgpack_dom_value_free(&str);
+      raise_expected_binary(start, error);
+      return buff;
+   }
+
+   value->type        = RDT_BINARY;
+   value->binary.len  = str.string.len / 2;
+   value->binary.buff = str.string.buff;
+
+   /* Decode in place, the hex digits are read ahead of the writes. */
+   for (i = 0; i < value->binary.len; i++)
+   {
+      int h = hex_digit(str.string.buff[i * 2]);
+      int l = hex_digit(str.string.buff[i * 2 + 1]);
+
+      if (h < 0 || l < 0)
+      {
+         rmsgpack_dom_value_free(value);
+         value->type = RDT_NULL;
+         raise_expected_binary(start, error);
+         return buff;
+      }
+
+      value->binary.buff[i] = (char)(h * 16 + l);
+   }
+
+   return buff;
+}
+
 static struct buffer parse_value(struct buffer buff,
       struct rmsgpack_dom_value *value, const char **error)
 {
@@ -565,6 +638,8 @@ static struct buffer parse_value(struct buffer buff,
    }
    else if (peek(buff, "\"") || peek(buff, "'"))
       buff = parse_string(buff, value, error);
+   else if (peek(buff, "b\"") || peek(buff, "b'"))
+      buff = parse_binary(buff, value, error);
    else if (isdigit(buff.data[buff.offset]))
       buff = parse_integer(buff, value, error);
    return buff;
@@ -821,6 +896,8 @@ static struct buffer parse_argument(struct buffer buff,
             peek(buff, "nil")
             || peek(buff, "true")
             || peek(buff, "false")
+            || peek(buff, "b\"")
+            || peek(buff, "b'")
             )
       )
    {
@@ -853,6 +930,175 @@ void libretrodb_query_free(void *q)
 
 	for (i = 0; i < real_q->root.argc; i++)
 		argument_free(&real_q->root.argv[i]);
+
+	free(real_q->index_key);
+	real_q->index_key = NULL;
+	real_q->index = NULL;
+}
+
+/**
+ * query_index_key:
+ * @idx                 : Index.
+ * @match               : Value the indexed field is compared against.
+ * @key                 : Key of @match in @idx.
+ *
+ * Returns: length of @key, 0 if @idx can not look up @match.
+ **/
+static uint64_t query_index_key(const libretrodb_index_t *idx,
+      const struct rmsgpack_dom_value *match, uint8_t **key)
+{
+   unsigned i;
+   uint64_t value;
+
+   switch (idx->key_type)
+   {
+      case RDT_BINARY:
+         if (match->type != RDT_BINARY || match->binary.len != idx->key_size)
+            return 0;
+         if (!(*key = (uint8_t*)malloc(idx->key_size)))
+            return 0;
+         memcpy(*key, match->binary.buff, idx->key_size);
+         return idx->key_size;
+      case RDT_STRING:
+         /* Keys are zero padded to the longest string in the index. */
+         if (match->type != RDT_STRING || match->string.len > idx->key_size)
+            return 0;
+         if (!(*key = (uint8_t*)calloc(1, idx->key_size)))
+            return 0;
+         memcpy(*key, match->string.buff, match->string.len);
+         return idx->key_size;
+      case RDT_UINT:
+         if (match->type == RDT_UINT)
+            value = match->uint_;
+         else if (match->type == RDT_INT && match->int_ >= 0)
+            value = (uint64_t)match->int_;
+         else
+            return 0;
+         if (idx->key_size != sizeof(uint64_t)
+               || !(*key = (uint8_t*)malloc(sizeof(uint64_t))))
+            return 0;
+         for (i = 0; i < sizeof(uint64_t); i++)
+            (*key)[i] = (uint8_t)(value >> ((sizeof(uint64_t) - 1 - i) * 8));
+         return sizeof(uint64_t);
+      default:
+         break;
+   }
+
+   return 0;
+}
+
+/**
+ * query_index_prefix:
+ * @idx                 : Index.
+ * @pattern             : Glob pattern the indexed field is matched against.
+ * @key                 : Literal prefix of @pattern.
+ *
+ * Returns: length of @key, 0 if @idx can not look up @pattern.
+ **/
+static uint64_t query_index_prefix(const libretrodb_index_t *idx,
+      const struct rmsgpack_dom_value *pattern, uint8_t **key)
+{
+   uint64_t len = 0;
+
+   if (idx->key_type != RDT_STRING || pattern->type != RDT_STRING)
+      return 0;
+
+   while (len < pattern->string.len
+         && !strchr("*?[\\", pattern->string.buff[len]))
+      len++;
+
+   if (len == 0 || len > idx->key_size)
+      return 0;
+   if (!(*key = (uint8_t*)malloc(len)))
+      return 0;
+
+   memcpy(*key, pattern->string.buff, len);
+   return len;
+}
+
+/**
+ * query_plan:
+ * @db                  : Handle to database.
+ * @q                   : Compiled query.
+ *
+ * Looks for an equality or glob prefix match on an indexed field
+ * among the fields of a table query. Every result of @q then has
+ * a key within that index range, so cursors only need to decode the
+ * items the range points to. Exact matches are preferred over
+ * prefixes, and longer prefixes over shorter ones.
+ **/
+static void query_plan(libretrodb_t *db, struct query *q)
+{
+   unsigned i;
+   int exact = 0;
+
+   if (!db || q->root.func != all_map)
+      return;
+
+   for (i = 0; i + 1 < q->root.argc; i += 2)
+   {
+      uint64_t len                  = 0;
+      uint8_t *key                  = NULL;
+      const struct argument *field  = &q->root.argv[i];
+      const struct argument *match  = &q->root.argv[i + 1];
+      const libretrodb_index_t *idx = NULL;
+
+      if (field->type != AT_VALUE || field->value.type != RDT_STRING)
+         continue;
+
+      idx = libretrodb_find_index_by_field(db,
+            field->value.string.buff, field->value.string.len);
+
+      if (!idx)
+         continue;
+
+      if (match->type == AT_VALUE)
+      {
+         if (!(len = query_index_key(idx, &match->value, &key)))
+            continue;
+
+         if (exact && len <= q->index_key_len)
+         {
+            free(key);
+            continue;
+         }
+         exact = 1;
+      }
+      else if (!exact && match->invocation.func == q_glob
+            && match->invocation.argc == 1
+            && match->invocation.argv[0].type == AT_VALUE)
+      {
+         if (!(len = query_index_prefix(idx,
+                     &match->invocation.argv[0].value, &key)))
+            continue;
+
+         if (len <= q->index_key_len)
+         {
+            free(key);
+            continue;
+         }
+      }
+      else
+         continue;
+
+      free(q->index_key);
+      q->index         = idx;
+      q->index_key     = key;
+      q->index_key_len = len;
+   }
+}
+
+const libretrodb_index_t *libretrodb_query_get_index(libretrodb_query_t *q,
+      const uint8_t **key, uint64_t *key_len)
+{
+   struct query *rq = (struct query*)q;
+
+   if (!rq->index)
+      return NULL;
+
+   *key     = rq->index_key;
+   *key_len = rq->index_key_len;
+   return rq->index;
 }
 
 void *libretrodb_query_compile(libretrodb_t *db,
@@ -892,6 +1138,8 @@ void *libretrodb_query_compile(libretrodb_t *db,
       raise_unexpected_eof(buff.offset, error);
       return NULL;
    }
+
+   query_plan(db, q);
    goto success;
 clean:
    if (q)
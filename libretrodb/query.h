@@ -10,4 +10,16 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 int libretrodb_query_filter(libretrodb_query_t *q,
       struct rmsgpack_dom_value * v);
 
+/**
+ * libretrodb_query_get_index:
+ * @q                   : Compiled query.
+ * @key                 : Key, or key prefix, matched by all results.
+ * @key_len             : Length of @key.
+ *
+ * Returns: index planned for @q by libretrodb_query_compile,
+ * NULL if the query needs a full scan.
+ **/
+const libretrodb_index_t *libretrodb_query_get_index(libretrodb_query_t *q,
+      const uint8_t **key, uint64_t *key_len);
+
 #endif
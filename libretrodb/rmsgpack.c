@@ -19,6 +19,7 @@
 #endif
 #include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "libretrodb_endian.h"
@@ -55,276 +56,218 @@ static const uint8_t MPF_UINT64 = 0xcf;
 
 static const uint8_t MPF_NIL = 0xc0;
 
-int rmsgpack_write_array_header(int fd, uint32_t size)
+static int write_buff(FILE *fp, const void *buff, size_t len)
 {
-   uint16_t tmp_i16;
-   uint32_t tmp_i32;
+   if (fwrite(buff, 1, len, fp) != len)
+      return -(errno ? errno : EIO);
+   return 0;
+}
+
+static int write_type(FILE *fp, uint8_t type)
+{
+   if (putc(type, fp) == EOF)
+      return -(errno ? errno : EIO);
+   return 0;
+}
+
+/* Writes @type followed by the @size low bytes of @value, big endian. */
+static int write_type_be(FILE *fp, uint8_t type, uint64_t value, size_t size)
+{
+   unsigned i;
+   uint8_t buff[sizeof(uint8_t) + sizeof(uint64_t)];
+
+   buff[0] = type;
+   for (i = 0; i < size; i++)
+      buff[1 + i] = (uint8_t)(value >> ((size - 1 - i) * 8));
+
+   return write_buff(fp, buff, sizeof(uint8_t) + size);
+}
+
+int rmsgpack_write_array_header(FILE *fp, uint32_t size)
+{
+   int rv;
 
    if (size < 16)
    {
-      size = (size | MPF_FIXARRAY);
-      if (write(fd, &size, sizeof(int8_t)) == -1)
-         return -errno;
+      if ((rv = write_type(fp, size | MPF_FIXARRAY)) < 0)
+         return rv;
       return sizeof(int8_t);
    }
    else if (size == (uint16_t)size)
    {
-      if (write(fd, &MPF_ARRAY16, sizeof(MPF_ARRAY16)) == -1)
-         return -errno;
-      tmp_i16 = httobe16(size);
-      if (write(fd, (void *)(&tmp_i16), sizeof(uint16_t)) == -1)
-         return -errno;
+      if ((rv = write_type_be(fp, MPF_ARRAY16, size, sizeof(uint16_t))) < 0)
+         return rv;
       return sizeof(int8_t) + sizeof(uint16_t);
    }
 
-   if (write(fd, &MPF_ARRAY32, sizeof(MPF_ARRAY32)) == -1)
-      return -errno;
-   tmp_i32 = httobe32(size);
-   if (write(fd, (void *)(&tmp_i32), sizeof(uint32_t)) == -1)
-      return -errno;
+   if ((rv = write_type_be(fp, MPF_ARRAY32, size, sizeof(uint32_t))) < 0)
+      return rv;
    return sizeof(int8_t) + sizeof(uint32_t);
 }
 
-int rmsgpack_write_map_header(int fd, uint32_t size)
+int rmsgpack_write_map_header(FILE *fp, uint32_t size)
 {
-   uint16_t tmp_i16;
-   uint32_t tmp_i32;
+   int rv;
 
    if (size < 16)
    {
-      size = (size | MPF_FIXMAP);
-      if (write(fd, &size, sizeof(int8_t)) == -1)
-         return -errno;
+      if ((rv = write_type(fp, size | MPF_FIXMAP)) < 0)
+         return rv;
       return sizeof(int8_t);
    }
-   else if (size < (uint16_t)size)
+   else if (size == (uint16_t)size)
    {
-      if (write(fd, &MPF_MAP16, sizeof(MPF_MAP16)) == -1)
-         return -errno;
-      tmp_i16 = httobe16(size);
-      if (write(fd, (void *)(&tmp_i16), sizeof(uint16_t)) == -1)
-         return -errno;
+      if ((rv = write_type_be(fp, MPF_MAP16, size, sizeof(uint16_t))) < 0)
+         return rv;
       return sizeof(uint8_t) + sizeof(uint16_t);
    }
 
-   tmp_i32 = httobe32(size);
-   if (write(fd, &MPF_MAP32, sizeof(MPF_MAP32)) == -1)
-      return -errno;
-   if (write(fd, (void *)(&tmp_i32), sizeof(uint32_t)) == -1)
-      return -errno;
+   if ((rv = write_type_be(fp, MPF_MAP32, size, sizeof(uint32_t))) < 0)
+      return rv;
    return sizeof(int8_t) + sizeof(uint32_t);
 }
 
-int rmsgpack_write_string(int fd, const char *s, uint32_t len)
+int rmsgpack_write_string(FILE *fp, const char *s, uint32_t len)
 {
-   int8_t fixlen = 0;
-   uint16_t tmp_i16;
-   uint32_t tmp_i32;
+   int rv;
    int written = sizeof(int8_t);
 
    if (len < 32)
-   {
-      fixlen = len | MPF_FIXSTR;
-      if (write(fd, &fixlen, sizeof(int8_t)) == -1)
-         return -errno;
-   }
+      rv = write_type(fp, len | MPF_FIXSTR);
    else if (len < (1 << 8))
    {
-      if (write(fd, &MPF_STR8, sizeof(MPF_STR8)) == -1)
-         return -errno;
-      if (write(fd, &len, sizeof(uint8_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_STR8, len, sizeof(uint8_t));
       written += sizeof(uint8_t);
    }
    else if (len < (1 << 16))
    {
-      if (write(fd, &MPF_STR16, sizeof(MPF_STR16)) == -1)
-         return -errno;
-      tmp_i16 = httobe16(len);
-      if (write(fd, &tmp_i16, sizeof(uint16_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_STR16, len, sizeof(uint16_t));
       written += sizeof(uint16_t);
    }
    else
    {
-      if (write(fd, &MPF_STR32, sizeof(MPF_STR32)) == -1)
-         return -errno;
-      tmp_i32 = httobe32(len);
-      if (write(fd, &tmp_i32, sizeof(uint32_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_STR32, len, sizeof(uint32_t));
       written += sizeof(uint32_t);
    }
 
-   if (write(fd, s, len) == -1)
-      return -errno;
+   if (rv < 0)
+      return rv;
+   if ((rv = write_buff(fp, s, len)) < 0)
+      return rv;
    written += len;
    return written;
 }
 
-int rmsgpack_write_bin(int fd, const void *s, uint32_t len)
+int rmsgpack_write_bin(FILE *fp, const void *s, uint32_t len)
 {
-   uint16_t tmp_i16;
-   uint32_t tmp_i32;
+   int rv;
    int written = sizeof(int8_t);
 
    if (len == (uint8_t)len)
    {
-      if (write(fd, &MPF_BIN8, sizeof(MPF_BIN8)) == -1)
-         return -errno;
-      if (write(fd, &len, sizeof(uint8_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_BIN8, len, sizeof(uint8_t));
       written += sizeof(uint8_t);
    }
    else if (len == (uint16_t)len)
    {
-      if (write(fd, &MPF_BIN16, sizeof(MPF_BIN16)) == -1)
-         return -errno;
-      tmp_i16 = httobe16(len);
-      if (write(fd, &tmp_i16, sizeof(uint16_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_BIN16, len, sizeof(uint16_t));
       written += sizeof(uint16_t);
    }
    else
    {
-      if (write(fd, &MPF_BIN32, sizeof(MPF_BIN32)) == -1)
-         return -errno;
-      tmp_i32 = httobe32(len);
-      if (write(fd, &tmp_i32, sizeof(uint32_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_BIN32, len, sizeof(uint32_t));
       written += sizeof(uint32_t);
    }
-   if (write(fd, s, len) == -1)
-      return -errno;
+
+   if (rv < 0)
+      return rv;
+   if ((rv = write_buff(fp, s, len)) < 0)
+      return rv;
    written += len;
-   return 0;
+   return written;
 }
 
-int rmsgpack_write_nil(int fd)
+int rmsgpack_write_nil(FILE *fp)
 {
-   if (write(fd, &MPF_NIL, sizeof(MPF_NIL)) == -1)
-      return -errno;
+   int rv;
+
+   if ((rv = write_type(fp, MPF_NIL)) < 0)
+      return rv;
    return sizeof(uint8_t);
 }
 
-int rmsgpack_write_bool(int fd, int value)
+int rmsgpack_write_bool(FILE *fp, int value)
 {
-   if (value)
-   {
-      if (write(fd, &MPF_TRUE, sizeof(MPF_TRUE)) == -1)
-         return -errno;
-   }
-
-   if (write(fd, &MPF_FALSE, sizeof(MPF_FALSE)) == -1)
-      return -errno;
+   int rv;
 
+   if ((rv = write_type(fp, value ? MPF_TRUE : MPF_FALSE)) < 0)
+      return rv;
    return sizeof(uint8_t);
 }
 
-int rmsgpack_write_int(int fd, int64_t value)
+int rmsgpack_write_int(FILE *fp, int64_t value)
 {
-   int16_t tmp_i16;
-   int32_t tmp_i32;
-   uint8_t tmpval  = 0;
-   int     written = sizeof(uint8_t);
+   int rv;
+   int written = sizeof(uint8_t);
 
    if (value >=0 && value < 128)
-   {
-      if (write(fd, &value, sizeof(int8_t)) == -1)
-         return -errno;
-   }
+      rv = write_type(fp, (uint8_t)value);
    else if (value < 0 && value > -32)
-   {
-      tmpval = (value) | 0xe0;
-      if (write(fd, &tmpval, sizeof(uint8_t)) == -1)
-         return -errno;
-   }
+      rv = write_type(fp, (uint8_t)(value | 0xe0));
    else if (value == (int8_t)value)
    {
-      if (write(fd, &MPF_INT8, sizeof(MPF_INT8)) == -1)
-         return -errno;
-
-      if (write(fd, &value, sizeof(int8_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_INT8, (uint64_t)value, sizeof(int8_t));
       written += sizeof(int8_t);
    }
    else if (value == (int16_t)value)
    {
-      if (write(fd, &MPF_INT16, sizeof(MPF_INT16)) == -1)
-         return -errno;
-
-      tmp_i16 = httobe16(value);
-      if (write(fd, &tmp_i16, sizeof(int16_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_INT16, (uint64_t)value, sizeof(int16_t));
       written += sizeof(int16_t);
    }
    else if (value == (int32_t)value)
    {
-      if (write(fd, &MPF_INT32, sizeof(MPF_INT32)) == -1)
-         return -errno;
-
-      tmp_i32 = httobe32(value);
-      if (write(fd, &tmp_i32, sizeof(int32_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_INT32, (uint64_t)value, sizeof(int32_t));
       written += sizeof(int32_t);
    }
    else
    {
-      if (write(fd, &MPF_INT64, sizeof(MPF_INT64)) == -1)
-         return -errno;
-
-      value = httobe64(value);
-      if (write(fd, &value, sizeof(int64_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_INT64, (uint64_t)value, sizeof(int64_t));
       written += sizeof(int64_t);
    }
+
+   if (rv < 0)
+      return rv;
    return written;
 }
 
-int rmsgpack_write_uint(int fd, uint64_t value)
+int rmsgpack_write_uint(FILE *fp, uint64_t value)
 {
-   uint16_t tmp_i16;
-   uint32_t tmp_i32;
+   int rv;
    int written = sizeof(uint8_t);
 
    if (value == (uint8_t)value)
    {
-      if (write(fd, &MPF_UINT8, sizeof(MPF_UINT8)) == -1)
-         return -errno;
-
-      if (write(fd, &value, sizeof(uint8_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_UINT8, value, sizeof(uint8_t));
       written += sizeof(uint8_t);
    }
    else if (value == (uint16_t)value)
    {
-      if (write(fd, &MPF_UINT16, sizeof(MPF_UINT16)) == -1)
-         return -errno;
-
-      tmp_i16 = httobe16(value);
-      if (write(fd, &tmp_i16, sizeof(uint16_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_UINT16, value, sizeof(uint16_t));
       written += sizeof(uint16_t);
    }
    else if (value == (uint32_t)value)
    {
-      if (write(fd, &MPF_UINT32, sizeof(MPF_UINT32)) == -1)
-         return -errno;
-
-      tmp_i32 = httobe32(value);
-      if (write(fd, &tmp_i32, sizeof(uint32_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_UINT32, value, sizeof(uint32_t));
       written += sizeof(uint32_t);
    }
    else
    {
-      if (write(fd, &MPF_UINT64, sizeof(MPF_UINT64)) == -1)
-         return -errno;
-
-      value = httobe64(value);
-      if (write(fd, &value, sizeof(uint64_t)) == -1)
-         return -errno;
+      rv = write_type_be(fp, MPF_UINT64, value, sizeof(uint64_t));
       written += sizeof(uint64_t);
    }
+
+   if (rv < 0)
+      return rv;
    return written;
 }
 
@@ -386,21 +329,40 @@ static int read_int(int fd, int64_t *out, size_t size)
    return 0;
 }
 
-static int read_buff(int fd, size_t size, char **pbuff, uint64_t *len)
+static char *alloc_buff(struct rmsgpack_read_callbacks *callbacks,
+      void *data, uint64_t len)
+{
+   if (callbacks->alloc_buff)
+      return (char *)callbacks->alloc_buff(len, data);
+   return (char *)calloc(len + 1, sizeof(char));
+}
+
+static void free_buff(struct rmsgpack_read_callbacks *callbacks,
+      char *buff)
+{
+   if (!callbacks->alloc_buff)
+      free(buff);
+}
+
+static int read_buff(int fd, size_t size, char **pbuff, uint64_t *len,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
 {
    uint64_t tmp_len = 0;
 
    if (read_uint(fd, &tmp_len, size) == -1)
       return -errno;
 
-   *pbuff = (char *)calloc(tmp_len + 1, sizeof(char));
+   *pbuff = alloc_buff(callbacks, data, tmp_len);
+   if (!*pbuff)
+      return -ENOMEM;
 
    if (read(fd, *pbuff, tmp_len) == -1)
    {
-      free(*pbuff);
+      free_buff(callbacks, *pbuff);
       return -errno;
    }
 
+   (*pbuff)[tmp_len] = '\0';
    *len = tmp_len;
    return 0;
 }
@@ -477,18 +439,18 @@ int rmsgpack_read(int fd,
    else if (type < MPF_NIL)
    {
       tmp_len = type - MPF_FIXSTR;
-      buff = (char *)calloc(tmp_len + 1, sizeof(char));
+      buff = alloc_buff(callbacks, data, tmp_len);
       if (!buff)
          return -ENOMEM;
       if (read(fd, buff, tmp_len) == -1)
       {
-         free(buff);
+         free_buff(callbacks, buff);
          return -errno;
       }
       buff[tmp_len] = '\0';
       if (!callbacks->read_string)
       {
-         free(buff);
+         free_buff(callbacks, buff);
          return 0;
       }
       return callbacks->read_string(buff, tmp_len, data);
@@ -518,11 +480,12 @@ int rmsgpack_read(int fd,
       case 0xc5:
       case 0xc6:
          if ((rv = read_buff(fd, 1<<(type - 0xc4),
-                     &buff, &tmp_len)) < 0)
+                     &buff, &tmp_len, callbacks, data)) < 0)
             return rv;
 
          if (callbacks->read_bin)
             return callbacks->read_bin(buff, tmp_len, data);
+         free_buff(callbacks, buff);
          break;
       case 0xcc:
       case 0xcd:
@@ -551,11 +514,13 @@ int rmsgpack_read(int fd,
       case 0xd9:
       case 0xda:
       case 0xdb:
-         if ((rv = read_buff(fd, 1<<(type - 0xd9), &buff, &tmp_len)) < 0)
+         if ((rv = read_buff(fd, 1<<(type - 0xd9), &buff, &tmp_len,
+                     callbacks, data)) < 0)
             return rv;
 
          if (callbacks->read_string)
             return callbacks->read_string(buff, tmp_len, data);
+         free_buff(callbacks, buff);
          break;
       case 0xdc:
       case 0xdd:
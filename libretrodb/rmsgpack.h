@@ -2,6 +2,7 @@
 #define __RARCHDB_MSGPACK_H__
 
 #include <stdint.h>
+#include <stdio.h>
 
 struct rmsgpack_read_callbacks {
 	int (* read_nil)(void *);
@@ -35,38 +36,48 @@ struct rmsgpack_read_callbacks {
 	        uint32_t,
 	        void *
 	);
+	/* Optional. Allocates room for a string or binary of the given
+	 * length plus a terminating NUL, handed to read_string or read_bin.
+	 * When set, buffers are never freed by rmsgpack_read. Buffers are
+	 * allocated with calloc() otherwise. */
+	void *(* alloc_buff)(
+	        uint32_t,
+	        void *
+	);
 };
 
 
+/* Writers go through stdio, so a whole database is written with a
+ * handful of write(2) calls instead of several per value. */
 int rmsgpack_write_array_header(
-        int fd,
+        FILE *fp,
         uint32_t size
 );
 int rmsgpack_write_map_header(
-        int fd,
+        FILE *fp,
         uint32_t size
 );
 int rmsgpack_write_string(
-        int fd,
+        FILE *fp,
         const char * s,
         uint32_t len
 );
 int rmsgpack_write_bin(
-        int fd,
+        FILE *fp,
         const void * s,
         uint32_t len
 );
-int rmsgpack_write_nil(int fd);
+int rmsgpack_write_nil(FILE *fp);
 int rmsgpack_write_bool(
-        int fd,
+        FILE *fp,
         int value
 );
 int rmsgpack_write_int(
-        int fd,
+        FILE *fp,
         int64_t value
 );
 int rmsgpack_write_uint(
-        int fd,
+        FILE *fp,
         uint64_t value
 );
 
@@ -10,36 +10,239 @@
 #include "rmsgpack.h"
 
 #define MAX_DEPTH 128
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGN(size) (((size) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1))
+#define INTERN_MIN_SIZE 64
+
+struct rmsgpack_dom_arena_block
+{
+   struct rmsgpack_dom_arena_block *next;
+   size_t size;
+   size_t used;
+};
+
+struct rmsgpack_dom_intern
+{
+   uint32_t hash;
+   uint32_t len;
+   const char *str;
+};
 
 struct dom_reader_state
 {
 	int i;
 	struct rmsgpack_dom_value *stack[MAX_DEPTH];
+	/* Whether the value at the same depth is a map key. */
+	int is_key[MAX_DEPTH];
+	struct rmsgpack_dom_arena *arena;
+	/* Last buffer handed out by dom_read_alloc_buff. */
+	char *buff;
+	size_t buff_size;
 };
 
 static struct rmsgpack_dom_value *dom_reader_state_pop(
-      struct dom_reader_state *s)
+      struct dom_reader_state *s, int *is_key)
 {
 	struct rmsgpack_dom_value *v = s->stack[s->i];
+	if (is_key)
+		*is_key = s->is_key[s->i];
 	s->i--;
 	return v;
 }
 
 static int dom_reader_state_push(struct dom_reader_state *s,
-      struct rmsgpack_dom_value *v)
+      struct rmsgpack_dom_value *v, int is_key)
 {
 	if ((s->i + 1) == MAX_DEPTH)
 		return -ENOMEM;
 	s->i++;
 	s->stack[s->i] = v;
+	s->is_key[s->i] = is_key;
 	return 0;
 }
 
+#define ARENA_BLOCK_HEADER ARENA_ALIGN(sizeof(struct rmsgpack_dom_arena_block))
+
+static void *arena_block_alloc(struct rmsgpack_dom_arena_block **head,
+      size_t size)
+{
+   uint8_t *data = NULL;
+   struct rmsgpack_dom_arena_block *block = *head;
+
+   size = ARENA_ALIGN(size);
+
+   if (!block || block->size - block->used < size)
+   {
+      size_t block_size = size > ARENA_BLOCK_SIZE ?
+         size : ARENA_BLOCK_SIZE;
+
+      block = (struct rmsgpack_dom_arena_block*)
+         malloc(ARENA_BLOCK_HEADER + block_size);
+      if (!block)
+         return NULL;
+
+      block->size = block_size;
+      block->used = 0;
+      block->next = *head;
+      *head       = block;
+   }
+
+   data         = (uint8_t*)block + ARENA_BLOCK_HEADER + block->used;
+   block->used += size;
+   return data;
+}
+
+static void arena_block_free(struct rmsgpack_dom_arena_block *block)
+{
+   while (block)
+   {
+      struct rmsgpack_dom_arena_block *next = block->next;
+      free(block);
+      block = next;
+   }
+}
+
+/* Gives back the last allocation of @size bytes at @data. */
+static void arena_unalloc(struct rmsgpack_dom_arena *arena,
+      void *data, size_t size)
+{
+   struct rmsgpack_dom_arena_block *block = arena->blocks;
+
+   size = ARENA_ALIGN(size);
+
+   if (block && block->used >= size &&
+         (uint8_t*)block + ARENA_BLOCK_HEADER + block->used - size
+         == (uint8_t*)data)
+      block->used -= size;
+}
+
+void rmsgpack_dom_arena_init(struct rmsgpack_dom_arena *arena)
+{
+   memset(arena, 0, sizeof(*arena));
+}
+
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena)
+{
+   size_t size = 0;
+   struct rmsgpack_dom_arena_block *block = arena->blocks;
+
+   if (!block)
+      return;
+
+   if (!block->next)
+   {
+      block->used = 0;
+      return;
+   }
+
+   for (; block; block = block->next)
+      size += block->size;
+
+   arena_block_free(arena->blocks);
+
+   arena->blocks = (struct rmsgpack_dom_arena_block*)
+      malloc(ARENA_BLOCK_HEADER + size);
+   if (!arena->blocks)
+      return;
+
+   arena->blocks->size = size;
+   arena->blocks->used = 0;
+   arena->blocks->next = NULL;
+}
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena)
+{
+   arena_block_free(arena->blocks);
+   arena_block_free(arena->strings);
+   free(arena->intern);
+   memset(arena, 0, sizeof(*arena));
+}
+
+void *rmsgpack_dom_arena_alloc(struct rmsgpack_dom_arena *arena,
+      size_t size)
+{
+   return arena_block_alloc(&arena->blocks, size);
+}
+
+static uint32_t intern_hash(const char *str, uint32_t len)
+{
+   uint32_t i;
+   uint32_t hash = 5381;
+
+   for (i = 0; i < len; i++)
+      hash = (hash << 5) + hash + (uint8_t)str[i];
+   return hash;
+}
+
+static int intern_grow(struct rmsgpack_dom_arena *arena)
+{
+   size_t i;
+   size_t size = arena->intern_size ?
+      arena->intern_size * 2 : INTERN_MIN_SIZE;
+   struct rmsgpack_dom_intern *intern = (struct rmsgpack_dom_intern*)
+      calloc(size, sizeof(*intern));
+
+   if (!intern)
+      return -ENOMEM;
+
+   for (i = 0; i < arena->intern_size; i++)
+   {
+      size_t j;
+      const struct rmsgpack_dom_intern *old = &arena->intern[i];
+
+      if (!old->str)
+         continue;
+
+      for (j = old->hash & (size - 1); intern[j].str; j = (j + 1) & (size - 1));
+      intern[j] = *old;
+   }
+
+   free(arena->intern);
+   arena->intern      = intern;
+   arena->intern_size = size;
+   return 0;
+}
+
+const char *rmsgpack_dom_arena_intern(struct rmsgpack_dom_arena *arena,
+      const char *str, uint32_t len)
+{
+   size_t i;
+   char *copy    = NULL;
+   uint32_t hash = intern_hash(str, len);
+
+   if ((arena->intern_count + 1) * 4 > arena->intern_size * 3
+         && intern_grow(arena) < 0)
+      return NULL;
+
+   for (i = hash & (arena->intern_size - 1); arena->intern[i].str;
+         i = (i + 1) & (arena->intern_size - 1))
+   {
+      const struct rmsgpack_dom_intern *entry = &arena->intern[i];
+
+      if (entry->hash == hash && entry->len == len &&
+            !memcmp(entry->str, str, len))
+         return entry->str;
+   }
+
+   copy = (char*)arena_block_alloc(&arena->strings, len + 1);
+   if (!copy)
+      return NULL;
+
+   memcpy(copy, str, len);
+   copy[len] = '\0';
+
+   arena->intern[i].hash = hash;
+   arena->intern[i].len  = len;
+   arena->intern[i].str  = copy;
+   arena->intern_count++;
+   return copy;
+}
+
 static int dom_read_nil(void *data)
 {
    struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
    struct rmsgpack_dom_value *v =
-      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state);
+      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state, NULL);
    v->type = RDT_NULL;
    return 0;
 }
@@ -48,7 +251,7 @@ static int dom_read_bool(int value, void *data)
 {
    struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
    struct rmsgpack_dom_value *v =
-      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state);
+      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state, NULL);
 
    v->type = RDT_BOOL;
    v->bool_ = value;
@@ -59,7 +262,7 @@ static int dom_read_int(int64_t value, void *data)
 {
    struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
    struct rmsgpack_dom_value *v =
-      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state);
+      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state, NULL);
 
    v->type = RDT_INT;
    v->int_ = value;
@@ -70,7 +273,7 @@ static int dom_read_uint(uint64_t value, void *data)
 {
    struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
    struct rmsgpack_dom_value *v =
-      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state);
+      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state, NULL);
 
    v->type = RDT_UINT;
    v->uint_ = value;
@@ -79,9 +282,23 @@ static int dom_read_uint(uint64_t value, void *data)
 
 static int dom_read_string(char *value, uint32_t len, void *data)
 {
+   int is_key;
    struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
    struct rmsgpack_dom_value *v =
-      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state);
+      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state, &is_key);
+
+   /* Keys repeat in every record, so they are read into the arena
+    * only once and shared from there on. */
+   if (is_key && dom_state->arena && value == dom_state->buff)
+   {
+      const char *key = rmsgpack_dom_arena_intern(dom_state->arena,
+            value, len);
+      if (!key)
+         return -ENOMEM;
+
+      arena_unalloc(dom_state->arena, value, dom_state->buff_size);
+      value = (char*)key;
+   }
 
    v->type = RDT_STRING;
    v->string.len = len;
@@ -93,7 +310,7 @@ static int dom_read_bin(void *value, uint32_t len, void *data)
 {
    struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
    struct rmsgpack_dom_value *v =
-      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state);
+      (struct rmsgpack_dom_value*)dom_reader_state_pop(dom_state, NULL);
    
    v->type = RDT_BINARY;
    v->binary.len = len;
@@ -106,14 +323,22 @@ static int dom_read_map_start(uint32_t len, void *data)
    unsigned i;
    struct rmsgpack_dom_pair *items = NULL;
    struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
-   struct rmsgpack_dom_value *v = dom_reader_state_pop(dom_state);
+   struct rmsgpack_dom_value *v = dom_reader_state_pop(dom_state, NULL);
 
    v->type = RDT_MAP;
    v->map.len = len;
    v->map.items = NULL;
 
-   items = (struct rmsgpack_dom_pair *)calloc(len,
-         sizeof(struct rmsgpack_dom_pair));
+   if (dom_state->arena)
+   {
+      items = (struct rmsgpack_dom_pair *)rmsgpack_dom_arena_alloc(
+            dom_state->arena, len * sizeof(struct rmsgpack_dom_pair));
+      if (items)
+         memset(items, 0, len * sizeof(struct rmsgpack_dom_pair));
+   }
+   else
+      items = (struct rmsgpack_dom_pair *)calloc(len,
+            sizeof(struct rmsgpack_dom_pair));
 
    if (!items)
       return -ENOMEM;
@@ -122,9 +347,9 @@ static int dom_read_map_start(uint32_t len, void *data)
 
    for (i = 0; i < len; i++)
    {
-      if (dom_reader_state_push(dom_state, &items[i].value) < 0)
+      if (dom_reader_state_push(dom_state, &items[i].value, 0) < 0)
          return -ENOMEM;
-      if (dom_reader_state_push(dom_state, &items[i].key) < 0)
+      if (dom_reader_state_push(dom_state, &items[i].key, 1) < 0)
          return -ENOMEM;
    }
 
@@ -135,14 +360,23 @@ static int dom_read_array_start(uint32_t len, void *data)
 {
 	unsigned i;
 	struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
-	struct rmsgpack_dom_value *v       = dom_reader_state_pop(dom_state);
+	struct rmsgpack_dom_value *v       = dom_reader_state_pop(dom_state, NULL);
 	struct rmsgpack_dom_value *items   = NULL;
 
 	v->type = RDT_ARRAY;
 	v->array.len = len;
 	v->array.items = NULL;
 
-	items = (struct rmsgpack_dom_value *)calloc(len, sizeof(struct rmsgpack_dom_pair));
+   if (dom_state->arena)
+   {
+      items = (struct rmsgpack_dom_value *)rmsgpack_dom_arena_alloc(
+            dom_state->arena, len * sizeof(struct rmsgpack_dom_value));
+      if (items)
+         memset(items, 0, len * sizeof(struct rmsgpack_dom_value));
+   }
+   else
+      items = (struct rmsgpack_dom_value *)calloc(len,
+            sizeof(struct rmsgpack_dom_value));
 
 	if (!items)
 		return -ENOMEM;
@@ -151,13 +385,23 @@ static int dom_read_array_start(uint32_t len, void *data)
 
 	for (i = 0; i < len; i++)
    {
-      if (dom_reader_state_push(dom_state, &items[i]) < 0)
+      if (dom_reader_state_push(dom_state, &items[i], 0) < 0)
          return -ENOMEM;
    }
 
 	return 0;
 }
 
+static void *dom_read_alloc_buff(uint32_t len, void *data)
+{
+   struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
+
+   dom_state->buff_size = len + 1;
+   dom_state->buff      = (char*)rmsgpack_dom_arena_alloc(dom_state->arena,
+         dom_state->buff_size);
+   return dom_state->buff;
+}
+
 static struct rmsgpack_read_callbacks dom_reader_callbacks = {
 	dom_read_nil,
 	dom_read_bool,
@@ -166,7 +410,20 @@ static struct rmsgpack_read_callbacks dom_reader_callbacks = {
 	dom_read_string,
 	dom_read_bin,
 	dom_read_map_start,
-	dom_read_array_start
+	dom_read_array_start,
+	NULL
+};
+
+static struct rmsgpack_read_callbacks dom_arena_reader_callbacks = {
+	dom_read_nil,
+	dom_read_bool,
+	dom_read_int,
+	dom_read_uint,
+	dom_read_string,
+	dom_read_bin,
+	dom_read_map_start,
+	dom_read_array_start,
+	dom_read_alloc_buff
 };
 
 void rmsgpack_dom_value_free(struct rmsgpack_dom_value *v)
@@ -246,6 +503,9 @@ int rmsgpack_dom_value_cmp(
       case RDT_STRING:
          if (a->string.len != b->string.len)
             return 1;
+         /* Interned strings. */
+         if (a->string.buff == b->string.buff)
+            return 0;
          return strncmp(a->string.buff, b->string.buff, a->string.len);
       case RDT_BINARY:
          if (a->binary.len != b->binary.len)
@@ -340,7 +600,7 @@ void rmsgpack_dom_value_print(struct rmsgpack_dom_value *obj)
          printf("]");
    }
 }
-int rmsgpack_dom_write(int fd, const struct rmsgpack_dom_value *obj)
+int rmsgpack_dom_write(FILE *fp, const struct rmsgpack_dom_value *obj)
 {
    unsigned i;
    int rv = 0;
@@ -349,40 +609,40 @@ int rmsgpack_dom_write(int fd, const struct rmsgpack_dom_value *obj)
    switch (obj->type)
    {
       case RDT_NULL:
-         return rmsgpack_write_nil(fd);
+         return rmsgpack_write_nil(fp);
       case RDT_BOOL:
-         return rmsgpack_write_bool(fd, obj->bool_);
+         return rmsgpack_write_bool(fp, obj->bool_);
       case RDT_INT:
-         return rmsgpack_write_int(fd, obj->int_);
+         return rmsgpack_write_int(fp, obj->int_);
       case RDT_UINT:
-         return rmsgpack_write_uint(fd, obj->uint_);
+         return rmsgpack_write_uint(fp, obj->uint_);
       case RDT_STRING:
-         return rmsgpack_write_string(fd, obj->string.buff, obj->string.len);
+         return rmsgpack_write_string(fp, obj->string.buff, obj->string.len);
       case RDT_BINARY:
-         return rmsgpack_write_bin(fd, obj->binary.buff, obj->binary.len);
+         return rmsgpack_write_bin(fp, obj->binary.buff, obj->binary.len);
       case RDT_MAP:
-         if ((rv = rmsgpack_write_map_header(fd, obj->map.len)) < 0)
+         if ((rv = rmsgpack_write_map_header(fp, obj->map.len)) < 0)
             return rv;
          written += rv;
 
          for (i = 0; i < obj->map.len; i++)
          {
-            if ((rv = rmsgpack_dom_write(fd, &obj->map.items[i].key)) < 0)
+            if ((rv = rmsgpack_dom_write(fp, &obj->map.items[i].key)) < 0)
                return rv;
             written += rv;
-            if ((rv = rmsgpack_dom_write(fd, &obj->map.items[i].value)) < 0)
+            if ((rv = rmsgpack_dom_write(fp, &obj->map.items[i].value)) < 0)
                return rv;
             written += rv;
          }
          break;
       case RDT_ARRAY:
-         if ((rv = rmsgpack_write_array_header(fd, obj->array.len)) < 0)
+         if ((rv = rmsgpack_write_array_header(fp, obj->array.len)) < 0)
             return rv;
          written += rv;
 
          for (i = 0; i < obj->array.len; i++)
          {
-            if ((rv = rmsgpack_dom_write(fd, &obj->array.items[i])) < 0)
+            if ((rv = rmsgpack_dom_write(fp, &obj->array.items[i])) < 0)
                return rv;
             written += rv;
          }
@@ -395,8 +655,11 @@ int rmsgpack_dom_read(int fd, struct rmsgpack_dom_value *out)
    struct dom_reader_state s;
    int rv = 0;
 
-   s.i        = 0;
-   s.stack[0] = out;
+   s.i         = 0;
+   s.stack[0]  = out;
+   s.is_key[0] = 0;
+   s.arena     = NULL;
+   s.buff      = NULL;
 
    rv = rmsgpack_read(fd, &dom_reader_callbacks, &s);
 
@@ -406,6 +669,22 @@ int rmsgpack_dom_read(int fd, struct rmsgpack_dom_value *out)
    return rv;
 }
 
+int rmsgpack_dom_read_arena(int fd, struct rmsgpack_dom_value *out,
+      struct rmsgpack_dom_arena *arena)
+{
+   struct dom_reader_state s;
+
+   s.i         = 0;
+   s.stack[0]  = out;
+   s.is_key[0] = 0;
+   s.arena     = arena;
+   s.buff      = NULL;
+
+   out->type = RDT_NULL;
+
+   return rmsgpack_read(fd, &dom_arena_reader_callbacks, &s);
+}
+
 int rmsgpack_dom_read_into(int fd, ...)
 {
    va_list ap;
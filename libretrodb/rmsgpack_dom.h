@@ -2,6 +2,7 @@
 #define __RARCHDB_MSGPACK_DOM_H__
 
 #include <stdint.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,6 +49,24 @@ struct rmsgpack_dom_pair {
 	struct rmsgpack_dom_value value;
 };
 
+/* Opaque. */
+struct rmsgpack_dom_arena_block;
+struct rmsgpack_dom_intern;
+
+/* Values read with rmsgpack_dom_read_arena are carved out of the
+ * arena instead of being allocated one by one, and map keys are
+ * interned, so reading a record costs no allocation once the arena
+ * has grown to the size of the largest record. */
+struct rmsgpack_dom_arena {
+	/* Storage for values, rewound by rmsgpack_dom_arena_reset. */
+	struct rmsgpack_dom_arena_block *blocks;
+	/* Storage for interned strings, kept until the arena is freed. */
+	struct rmsgpack_dom_arena_block *strings;
+	struct rmsgpack_dom_intern *intern;
+	size_t intern_size;
+	size_t intern_count;
+};
+
 void rmsgpack_dom_value_print(struct rmsgpack_dom_value * obj);
 void rmsgpack_dom_value_free(struct rmsgpack_dom_value * v);
 int rmsgpack_dom_value_cmp(
@@ -60,12 +79,60 @@ struct rmsgpack_dom_value * rmsgpack_dom_value_map_value(
         const struct rmsgpack_dom_value * key
 );
 
+void rmsgpack_dom_arena_init(struct rmsgpack_dom_arena *arena);
+
+/**
+ * rmsgpack_dom_arena_reset:
+ * @arena               : Arena.
+ *
+ * Releases all values allocated from @arena. Interned strings are
+ * kept. The memory is kept for the next values as well, coalesced
+ * into a single block if the values did not fit in one.
+ **/
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena);
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena);
+
+void *rmsgpack_dom_arena_alloc(struct rmsgpack_dom_arena *arena,
+        size_t size);
+
+/**
+ * rmsgpack_dom_arena_intern:
+ * @arena               : Arena.
+ * @str                 : String to intern.
+ * @len                 : Length of @str.
+ *
+ * Returns: NUL-terminated copy of @str owned by @arena, shared by all
+ * equal strings interned in @arena and kept across resets, or NULL
+ * if out of memory.
+ **/
+const char *rmsgpack_dom_arena_intern(struct rmsgpack_dom_arena *arena,
+        const char *str, uint32_t len);
+
 int rmsgpack_dom_read(
         int fd,
         struct rmsgpack_dom_value * out
 );
-int rmsgpack_dom_write(
+
+/**
+ * rmsgpack_dom_read_arena:
+ * @fd                  : File descriptor to read from.
+ * @out                 : Value read.
+ * @arena               : Arena to allocate @out from.
+ *
+ * Like rmsgpack_dom_read, but @out is owned by @arena and must not be
+ * passed to rmsgpack_dom_value_free. It stays valid until @arena is
+ * reset or freed.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_arena(
         int fd,
+        struct rmsgpack_dom_value * out,
+        struct rmsgpack_dom_arena *arena
+);
+int rmsgpack_dom_write(
+        FILE *fp,
         const struct rmsgpack_dom_value * obj
 );
 
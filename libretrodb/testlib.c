@@ -101,7 +101,7 @@ static int value_provider(
 }
 
 static int create_db (lua_State * L) {
-	int dst;
+	FILE *dst;
 	const char * db_file;
 	int rv;
 	db_file = luaL_checkstring(L, -2);
@@ -111,14 +111,14 @@ static int create_db (lua_State * L) {
 	}
 	lua_setfield(L, LUA_REGISTRYINDEX, "testlib_get_value");
 
-	dst = open(db_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
-	if (dst == -1) {
+	dst = fopen(db_file, "wb");
+	if (!dst) {
 		lua_pushstring(L, "Could not open destination file");
 		lua_error(L);
 	}
 
 	rv = libretrodb_create(dst, &value_provider, L);
-	close(dst);
+	fclose(dst);
 	return 0;
 }
 
@@ -126,6 +126,10 @@ static void glui_render_background(gl_t *gl, glui_handle_t *glui,
       0.0f, 0.0f, 0.0f, alpha,
    };
 
+   /* Text queued so far goes below the background. */
+   if (gl->font_driver && gl->font_driver->flush_batch)
+      gl->font_driver->flush_batch(gl->font_handle);
+
    glViewport(0, 0, gl->win_width, gl->win_height);
 
    coords.vertices      = 4;
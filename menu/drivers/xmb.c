@@ -422,6 +422,10 @@ static void xmb_render_background(gl_t *gl, xmb_handle_t *xmb,
       0.0f, 0.0f, 0.0f, alpha,
    };
 
+   /* Text queued so far goes below the background. */
+   if (gl->font_driver && gl->font_driver->flush_batch)
+      gl->font_driver->flush_batch(xmb->font.buf);
+
    glViewport(0, 0, gl->win_width, gl->win_height);
 
    coords.vertices      = 4;
@@ -1101,6 +1105,10 @@ static void xmb_frame(void)
 
    xmb_render_background(gl, xmb, false);
 
+   /* All text of the frame is drawn at once, after the icons. */
+   if (gl->font_driver && gl->font_driver->begin_batch)
+      gl->font_driver->begin_batch(xmb->font.buf);
+
    xmb_draw_text(gl, xmb,
          xmb->title_name, xmb->margins.title.left, xmb->margins.title.top, 1, 1, 0);
 
@@ -1205,6 +1213,9 @@ static void xmb_frame(void)
       xmb->box_message[0] = '\0';
    }
 
+   if (gl->font_driver && gl->font_driver->end_batch)
+      gl->font_driver->end_batch(xmb->font.buf);
+
    gl_set_viewport(gl, gl->win_width, gl->win_height, false, false);
 }
 
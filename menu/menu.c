@@ -251,6 +251,8 @@ void menu_free(void *data)
 
    if (!menu)
       return;
+
+   menu_entries_dir_scan_deinit();
   
 #ifdef HAVE_SHADER_MANAGER
    if (menu->shader)
@@ -371,6 +373,8 @@ int menu_iterate(retro_input_t input,
    int32_t ret     = 0;
    unsigned action = menu_input_frame(input, trigger_input);
 
+   menu_entries_dir_scan_iterate();
+
    if (driver.menu_ctx)
    {
       if (driver.menu_ctx->set_texture)
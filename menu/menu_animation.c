@@ -247,202 +247,498 @@ static float easing_out_in_bounce(float t, float b, float c, float d)
    return easing_in_bounce((t * 2) - d, b + c / 2, c / 2, d);
 }
 
-void menu_animation_free(animation_t *animation)
+static const easingFunc easing_funcs[] = {
+   /* Linear */
+   easing_linear,
+   /* Quad */
+   easing_in_quad,
+   easing_out_quad,
+   easing_in_out_quad,
+   easing_out_in_quad,
+   /* Cubic */
+   easing_in_cubic,
+   easing_out_cubic,
+   easing_in_out_cubic,
+   easing_out_in_cubic,
+   /* Quart */
+   easing_in_quart,
+   easing_out_quart,
+   easing_in_out_quart,
+   easing_out_in_quart,
+   /* Quint */
+   easing_in_quint,
+   easing_out_quint,
+   easing_in_out_quint,
+   easing_out_in_quint,
+   /* Sine */
+   easing_in_sine,
+   easing_out_sine,
+   easing_in_out_sine,
+   easing_out_in_sine,
+   /* Expo */
+   easing_in_expo,
+   easing_out_expo,
+   easing_in_out_expo,
+   easing_out_in_expo,
+   /* Circ */
+   easing_in_circ,
+   easing_out_circ,
+   easing_in_out_circ,
+   easing_out_in_circ,
+   /* Bounce */
+   easing_in_bounce,
+   easing_out_bounce,
+   easing_in_out_bounce,
+   easing_out_in_bounce,
+};
+
+#define EASING_COUNT (sizeof(easing_funcs) / sizeof(easing_funcs[0]))
+
+/* Handles are (generation << 16) | (slot + 1). */
+#define TWEEN_MAX_SLOTS    0xffff
+#define TWEEN_INDEX_NONE   0xffffffff
+
+/**
+ * tween_soa_carve:
+ * @soa                      : tween arrays to set up.
+ * @block                    : memory block holding all arrays.
+ * @capacity                 : number of tweens per array.
+ *
+ * Points all arrays of @soa into one allocation.
+ * Pointer-sized arrays come first to keep them aligned.
+ **/
+static void tween_soa_carve(struct tween_soa *soa, uint8_t *block,
+      size_t capacity)
+{
+   soa->subject       = (float**)block;
+   block             += capacity * sizeof(float*);
+   soa->cb            = (tween_cb*)block;
+   block             += capacity * sizeof(tween_cb);
+   soa->duration      = (float*)block;
+   block             += capacity * sizeof(float);
+   soa->running_since = (float*)block;
+   block             += capacity * sizeof(float);
+   soa->initial_value = (float*)block;
+   block             += capacity * sizeof(float);
+   soa->target_value  = (float*)block;
+   block             += capacity * sizeof(float);
+   soa->slot          = (uint32_t*)block;
+   block             += capacity * sizeof(uint32_t);
+   soa->easing        = (uint8_t*)block;
+}
+
+static size_t tween_soa_block_size(size_t capacity)
+{
+   return capacity * (sizeof(float*) + sizeof(tween_cb)
+         + 4 * sizeof(float) + sizeof(uint32_t) + sizeof(uint8_t));
+}
+
+static void tween_soa_move(struct tween_soa *dst, size_t dst_idx,
+      const struct tween_soa *src, size_t src_idx)
+{
+   dst->duration[dst_idx]      = src->duration[src_idx];
+   dst->running_since[dst_idx] = src->running_since[src_idx];
+   dst->initial_value[dst_idx] = src->initial_value[src_idx];
+   dst->target_value[dst_idx]  = src->target_value[src_idx];
+   dst->subject[dst_idx]       = src->subject[src_idx];
+   dst->cb[dst_idx]            = src->cb[src_idx];
+   dst->easing[dst_idx]        = src->easing[src_idx];
+   dst->slot[dst_idx]          = src->slot[src_idx];
+}
+
+/**
+ * menu_animation_reserve:
+ * @animation                : animation handle.
+ *
+ * Makes room for one more tween. Storage grows geometrically and
+ * is reused across frames, so pushing tweens does not allocate
+ * in the steady state.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+static bool menu_animation_reserve(animation_t *animation)
 {
    size_t i;
+   size_t capacity;
+   uint8_t *tweens_block  = NULL;
+   uint8_t *scratch_block = NULL;
+   struct tween_soa tweens;
 
-   if (!animation)
-      return;
+   if (animation->size < animation->capacity)
+      return true;
+
+   capacity      = animation->capacity ? animation->capacity * 2 : 64;
+   tweens_block  = (uint8_t*)malloc(tween_soa_block_size(capacity));
+   scratch_block = (uint8_t*)malloc(tween_soa_block_size(capacity));
+
+   if (!tweens_block || !scratch_block)
+   {
+      free(tweens_block);
+      free(scratch_block);
+      return false;
+   }
+
+   tween_soa_carve(&tweens, tweens_block, capacity);
 
    for (i = 0; i < animation->size; i++)
+      tween_soa_move(&tweens, i, &animation->tweens, i);
+
+   free(animation->tweens_block);
+   free(animation->scratch_block);
+
+   animation->tweens        = tweens;
+   animation->tweens_block  = tweens_block;
+   animation->scratch_block = scratch_block;
+   tween_soa_carve(&animation->scratch, scratch_block, capacity);
+   animation->capacity      = capacity;
+
+   return true;
+}
+
+/**
+ * menu_animation_alloc_slot:
+ * @animation                : animation handle.
+ *
+ * Returns: free handle slot, TWEEN_INDEX_NONE if none are left.
+ **/
+static uint32_t menu_animation_alloc_slot(animation_t *animation)
+{
+   if (animation->free_count)
+      return animation->free_slots[--animation->free_count];
+
+   if (animation->slot_count >= TWEEN_MAX_SLOTS)
+      return TWEEN_INDEX_NONE;
+
+   if ((animation->slot_count & (animation->slot_count - 1)) == 0)
    {
-      if (animation->list[i].subject)
-         animation->list[i].subject = NULL;
+      /* Grow on powers of two. */
+      size_t cap = animation->slot_count ? animation->slot_count * 2 : 64;
+      uint32_t *slot_index      = (uint32_t*)realloc(animation->slot_index,
+            cap * sizeof(uint32_t));
+      uint16_t *slot_generation = NULL;
+      uint32_t *free_slots      = NULL;
+
+      if (!slot_index)
+         return TWEEN_INDEX_NONE;
+      animation->slot_index = slot_index;
+
+      slot_generation = (uint16_t*)realloc(animation->slot_generation,
+            cap * sizeof(uint16_t));
+      if (!slot_generation)
+         return TWEEN_INDEX_NONE;
+      animation->slot_generation = slot_generation;
+
+      free_slots = (uint32_t*)realloc(animation->free_slots,
+            cap * sizeof(uint32_t));
+      if (!free_slots)
+         return TWEEN_INDEX_NONE;
+      animation->free_slots = free_slots;
    }
 
-   free(animation->list);
+   animation->slot_generation[animation->slot_count] = 1;
+   return animation->slot_count++;
+}
+
+static void menu_animation_release_slot(animation_t *animation,
+      uint32_t slot)
+{
+   animation->slot_index[slot] = TWEEN_INDEX_NONE;
+   /* Invalidate outstanding handles, generation 0 is never handed out. */
+   if (++animation->slot_generation[slot] == 0)
+      animation->slot_generation[slot] = 1;
+   animation->free_slots[animation->free_count++] = slot;
+}
+
+/**
+ * menu_animation_resolve:
+ * @animation                : animation handle.
+ * @handle                   : tween handle.
+ *
+ * Returns: index of the tween referenced by @handle,
+ * TWEEN_INDEX_NONE if the handle is stale.
+ **/
+static uint32_t menu_animation_resolve(const animation_t *animation,
+      menu_animation_handle_t handle)
+{
+   uint32_t slot = (handle & 0xffff);
+
+   if (!animation || !slot || slot > animation->slot_count)
+      return TWEEN_INDEX_NONE;
+
+   slot--;
+   if (animation->slot_generation[slot] != (handle >> 16))
+      return TWEEN_INDEX_NONE;
+
+   return animation->slot_index[slot];
+}
+
+void menu_animation_free(animation_t *animation)
+{
+   if (!animation)
+      return;
+
+   free(animation->tweens_block);
+   free(animation->scratch_block);
+   free(animation->slot_index);
+   free(animation->slot_generation);
+   free(animation->free_slots);
    free(animation);
 }
 
+menu_animation_handle_t menu_animation_push_handle(animation_t *animation,
+      float duration, float target_value, float* subject,
+      enum animation_easing_type easing_enum, tween_cb cb)
+{
+   size_t idx;
+   uint32_t slot;
+   struct tween_soa *tweens = NULL;
+
+   if (!animation || !subject || (unsigned)easing_enum >= EASING_COUNT)
+      return 0;
+
+   if (!menu_animation_reserve(animation))
+      return 0;
+
+   slot = menu_animation_alloc_slot(animation);
+   if (slot == TWEEN_INDEX_NONE)
+      return 0;
+
+   idx    = animation->size++;
+   tweens = &animation->tweens;
+
+   tweens->duration[idx]      = duration;
+   tweens->running_since[idx] = 0;
+   tweens->initial_value[idx] = *subject;
+   tweens->target_value[idx]  = target_value;
+   tweens->subject[idx]       = subject;
+   tweens->cb[idx]            = cb;
+   tweens->easing[idx]        = easing_enum;
+   tweens->slot[idx]          = slot;
+
+   animation->slot_index[slot] = idx;
+
+   if (idx && tweens->easing[idx - 1] > easing_enum)
+      animation->sorted = false;
+
+   return ((uint32_t)animation->slot_generation[slot] << 16) | (slot + 1);
+}
+
 bool menu_animation_push(animation_t *animation,
       float duration, float target_value, float* subject,
       enum animation_easing_type easing_enum, tween_cb cb)
 {
-   if (animation->size >= animation->capacity)
+   return menu_animation_push_handle(animation, duration, target_value,
+         subject, easing_enum, cb) != 0;
+}
+
+bool menu_animation_cancel(animation_t *animation,
+      menu_animation_handle_t handle)
+{
+   uint32_t idx = menu_animation_resolve(animation, handle);
+
+   if (idx == TWEEN_INDEX_NONE || !animation->tweens.subject[idx])
+      return false;
+
+   /* Removed by the next compaction. */
+   animation->tweens.running_since[idx] = animation->tweens.duration[idx];
+   animation->tweens.cb[idx]            = NULL;
+   animation->tweens.subject[idx]       = NULL;
+   return true;
+}
+
+bool menu_animation_retarget(animation_t *animation,
+      menu_animation_handle_t handle, float duration, float target_value)
+{
+   uint32_t idx = menu_animation_resolve(animation, handle);
+
+   if (idx == TWEEN_INDEX_NONE || !animation->tweens.subject[idx])
+      return false;
+
+   animation->tweens.duration[idx]      = duration;
+   animation->tweens.running_since[idx] = 0;
+   animation->tweens.initial_value[idx] = *animation->tweens.subject[idx];
+   animation->tweens.target_value[idx]  = target_value;
+   return true;
+}
+
+/**
+ * menu_animation_compact:
+ * @animation                : animation handle.
+ *
+ * Drops finished tweens and (if needed) sorts the remaining ones
+ * by easing type with a stable counting sort.
+ **/
+static void menu_animation_compact(animation_t *animation)
+{
+   size_t i;
+   size_t count[EASING_COUNT + 1] = {0};
+   struct tween_soa tmp;
+   struct tween_soa *tweens = &animation->tweens;
+   size_t alive             = 0;
+
+   for (i = 0; i < animation->size; i++)
+   {
+      if (tweens->running_since[i] >= tweens->duration[i])
+         menu_animation_release_slot(animation, tweens->slot[i]);
+      else
+         count[tweens->easing[i] + 1]++;
+   }
+
+   if (animation->sorted)
+   {
+      /* Already grouped, just squeeze out finished tweens. */
+      for (i = 0; i < animation->size; i++)
+      {
+         if (tweens->running_since[i] >= tweens->duration[i])
+            continue;
+         if (alive != i)
+            tween_soa_move(tweens, alive, tweens, i);
+         animation->slot_index[tweens->slot[alive]] = alive;
+         alive++;
+      }
+      animation->size = alive;
+      return;
+   }
+
+   for (i = 1; i <= EASING_COUNT; i++)
+      count[i] += count[i - 1];
+
+   for (i = 0; i < animation->size; i++)
+   {
+      size_t dst;
+
+      if (tweens->running_since[i] >= tweens->duration[i])
+         continue;
+
+      dst = count[tweens->easing[i]]++;
+      tween_soa_move(&animation->scratch, dst, tweens, i);
+      animation->slot_index[animation->scratch.slot[dst]] = dst;
+      alive++;
+   }
+
+   tmp                      = animation->tweens;
+   animation->tweens        = animation->scratch;
+   animation->scratch       = tmp;
    {
-      animation->capacity++;
-      animation->list = (struct tween*)realloc(animation->list,
-            animation->capacity * sizeof(struct tween));
+      void *block              = animation->tweens_block;
+      animation->tweens_block  = animation->scratch_block;
+      animation->scratch_block = block;
    }
 
-   animation->list[animation->size].alive         = 1;
-   animation->list[animation->size].duration      = duration;
-   animation->list[animation->size].running_since = 0;
-   animation->list[animation->size].initial_value = *subject;
-   animation->list[animation->size].target_value  = target_value;
-   animation->list[animation->size].subject       = subject;
-   animation->list[animation->size].cb            = cb;
+   animation->size   = alive;
+   animation->sorted = true;
+}
 
-   switch (easing_enum)
+/**
+ * menu_animation_update_group:
+ * @animation                : animation handle.
+ * @begin                    : first tween of the group.
+ * @end                      : one past the last tween of the group.
+ * @easing                   : easing function shared by the group.
+ * @dt                       : time step.
+ *
+ * Advances a group of tweens with the same easing function.
+ * Values are computed into a plain float array first and only then
+ * written to the subjects, so the arithmetic loops can be vectorized.
+ **/
+static void menu_animation_update_group(animation_t *animation,
+      size_t begin, size_t end, enum animation_easing_type easing,
+      float dt)
+{
+   size_t i;
+   struct tween_soa *tweens = &animation->tweens;
+   float *running_since     = tweens->running_since;
+   const float *duration    = tweens->duration;
+   const float *initial     = tweens->initial_value;
+   const float *target      = tweens->target_value;
+   /* Scratch arrays are only used while compacting. */
+   float *values            = animation->scratch.initial_value;
+
+   for (i = begin; i < end; i++)
+      running_since[i] += dt;
+
+   switch (easing)
    {
+      /* Common cases are spelled out, branch-free. */
       case EASING_LINEAR:
-         animation->list[animation->size].easing        = &easing_linear;
-         break;
-         /* Quad */
-      case EASING_IN_QUAD:
-         animation->list[animation->size].easing        = &easing_in_quad;
-         break;
-      case EASING_OUT_QUAD:
-         animation->list[animation->size].easing        = &easing_out_quad;
+         for (i = begin; i < end; i++)
+         {
+            float t = running_since[i] < duration[i] ?
+               running_since[i] / duration[i] : 1.0f;
+            values[i] = initial[i] + (target[i] - initial[i]) * t;
+         }
          break;
       case EASING_IN_OUT_QUAD:
-         animation->list[animation->size].easing        = &easing_in_out_quad;
-         break;
-      case EASING_OUT_IN_QUAD:
-         animation->list[animation->size].easing        = &easing_out_in_quad;
-         break;
-         /* Cubic */
-      case EASING_IN_CUBIC:
-         animation->list[animation->size].easing        = &easing_in_cubic;
-         break;
-      case EASING_OUT_CUBIC:
-         animation->list[animation->size].easing        = &easing_out_cubic;
-         break;
-      case EASING_IN_OUT_CUBIC:
-         animation->list[animation->size].easing        = &easing_in_out_cubic;
-         break;
-      case EASING_OUT_IN_CUBIC:
-         animation->list[animation->size].easing        = &easing_out_in_cubic;
-         break;
-         /* Quart */
-      case EASING_IN_QUART:
-         animation->list[animation->size].easing        = &easing_in_quart;
-         break;
-      case EASING_OUT_QUART:
-         animation->list[animation->size].easing        = &easing_out_quart;
-         break;
-      case EASING_IN_OUT_QUART:
-         animation->list[animation->size].easing        = &easing_in_out_quart;
-         break;
-      case EASING_OUT_IN_QUART:
-         animation->list[animation->size].easing        = &easing_out_in_quart;
-         break;
-         /* Quint */
-      case EASING_IN_QUINT:
-         animation->list[animation->size].easing        = &easing_in_quint;
-         break;
-      case EASING_OUT_QUINT:
-         animation->list[animation->size].easing        = &easing_out_quint;
-         break;
-      case EASING_IN_OUT_QUINT:
-         animation->list[animation->size].easing        = &easing_in_out_quint;
-         break;
-      case EASING_OUT_IN_QUINT:
-         animation->list[animation->size].easing        = &easing_out_in_quint;
-         break;
-         /* Sine */
-      case EASING_IN_SINE:
-         animation->list[animation->size].easing        = &easing_in_sine;
-         break;
-      case EASING_OUT_SINE:
-         animation->list[animation->size].easing        = &easing_out_sine;
-         break;
-      case EASING_IN_OUT_SINE:
-         animation->list[animation->size].easing        = &easing_in_out_sine;
-         break;
-      case EASING_OUT_IN_SINE:
-         animation->list[animation->size].easing        = &easing_out_in_sine;
-         break;
-         /* Expo */
-      case EASING_IN_EXPO:
-         animation->list[animation->size].easing        = &easing_in_expo;
-         break;
-      case EASING_OUT_EXPO:
-         animation->list[animation->size].easing        = &easing_out_expo;
-         break;
-      case EASING_IN_OUT_EXPO:
-         animation->list[animation->size].easing        = &easing_in_out_expo;
-         break;
-      case EASING_OUT_IN_EXPO:
-         animation->list[animation->size].easing        = &easing_out_in_expo;
-         break;
-         /* Circ */
-      case EASING_IN_CIRC:
-         animation->list[animation->size].easing        = &easing_in_circ;
-         break;
-      case EASING_OUT_CIRC:
-         animation->list[animation->size].easing        = &easing_out_circ;
-         break;
-      case EASING_IN_OUT_CIRC:
-         animation->list[animation->size].easing        = &easing_in_out_circ;
-         break;
-      case EASING_OUT_IN_CIRC:
-         animation->list[animation->size].easing        = &easing_out_in_circ;
-         break;
-         /* Bounce */
-      case EASING_IN_BOUNCE:
-         animation->list[animation->size].easing        = &easing_in_bounce;
-         break;
-      case EASING_OUT_BOUNCE:
-         animation->list[animation->size].easing        = &easing_out_bounce;
-         break;
-      case EASING_IN_OUT_BOUNCE:
-         animation->list[animation->size].easing        = &easing_in_out_bounce;
-         break;
-      case EASING_OUT_IN_BOUNCE:
-         animation->list[animation->size].easing        = &easing_out_in_bounce;
+         for (i = begin; i < end; i++)
+         {
+            float c  = target[i] - initial[i];
+            float t  = running_since[i] < duration[i] ?
+               running_since[i] / duration[i] * 2.0f : 2.0f;
+            float in = c / 2 * t * t;
+            float out = -c / 2 * ((t - 1) * (t - 3) - 1);
+            values[i] = initial[i] + (t < 1.0f ? in : out);
+         }
          break;
       default:
-         animation->list[animation->size].easing        = NULL;
+         {
+            easingFunc func = easing_funcs[easing];
+
+            for (i = begin; i < end; i++)
+               values[i] = func(running_since[i] < duration[i] ?
+                     running_since[i] : duration[i],
+                     initial[i], target[i] - initial[i], duration[i]);
+         }
          break;
    }
 
-   animation->size++;
+   for (i = begin; i < end; i++)
+   {
+      if (!tweens->subject[i])
+         continue;
 
-   return true;
+      *tweens->subject[i] = running_since[i] >= duration[i] ?
+         target[i] : values[i];
+   }
 }
 
-static int menu_animation_iterate(struct tween *tween, float dt,
-      unsigned *active_tweens)
+void menu_animation_update(animation_t *animation, float dt)
 {
-   if (!tween)
-      return -1;
-   if (tween->running_since >= tween->duration)
-      return -1;
+   size_t i, begin;
+   struct tween_soa *tweens = NULL;
 
-   tween->running_since += dt;
+   if (!animation)
+      return;
 
-   if (tween->easing)
-      *tween->subject = tween->easing(
-            tween->running_since,
-            tween->initial_value,
-            tween->target_value - tween->initial_value,
-            tween->duration);
+   if (!animation->sorted)
+      menu_animation_compact(animation);
 
-   if (tween->running_since >= tween->duration)
-   {
-      *tween->subject = tween->target_value;
+   tweens = &animation->tweens;
 
-      if (tween->cb)
-         tween->cb();
-   }
-
-   if (tween->running_since < tween->duration)
-      *active_tweens += 1;
+   for (begin = 0; begin < animation->size; begin = i)
+   {
+      uint8_t easing = tweens->easing[begin];
 
-   return 0;
-}
+      for (i = begin + 1; i < animation->size
+            && tweens->easing[i] == easing; i++);
 
-void menu_animation_update(animation_t *animation, float dt)
-{
-   unsigned i;
-   unsigned active_tweens = 0;
+      menu_animation_update_group(animation, begin, i,
+            (enum animation_easing_type)easing, dt);
+   }
 
-   for(i = 0; i < animation->size; i++)
-      menu_animation_iterate(&animation->list[i], dt, &active_tweens);
+   /* Callbacks may push new tweens, run them after the update. */
+   for (i = 0; i < animation->size; i++)
+   {
+      if (tweens->running_since[i] >= tweens->duration[i]
+            && tweens->cb[i])
+      {
+         tween_cb cb = tweens->cb[i];
+         tweens->cb[i] = NULL;
+         cb();
+         tweens = &animation->tweens;
+      }
+   }
 
-   if (!active_tweens)
-      animation->size = 0;
+   menu_animation_compact(animation);
 }
 
 /**
@@ -28,24 +28,42 @@ extern "C" {
 typedef float (*easingFunc)(float, float, float, float);
 typedef void  (*tween_cb) (void);
 
-struct tween
+/* Stable reference to a tween. Stays valid until the tween finishes
+ * or is cancelled, stale handles are ignored. 0 is never a valid handle. */
+typedef uint32_t menu_animation_handle_t;
+
+/* Tweens are stored as a structure of arrays, one array per field,
+ * kept sorted by easing type so each group updates in a tight loop. */
+struct tween_soa
 {
-   int    alive;
-   float  duration;
-   float  running_since;
-   float  initial_value;
-   float  target_value;
-   float* subject;
-   easingFunc easing;
-   tween_cb cb;
+   float    *duration;
+   float    *running_since;
+   float    *initial_value;
+   float    *target_value;
+   float   **subject;
+   tween_cb *cb;
+   uint8_t  *easing;
+   uint32_t *slot;
 };
 
 typedef struct animation
 {
-   struct tween *list;
+   struct tween_soa tweens;
+   /* Scratch arrays used when compacting/sorting tweens. */
+   struct tween_soa scratch;
+   void *tweens_block;
+   void *scratch_block;
 
    size_t capacity;
    size_t size;
+   bool sorted;
+
+   /* Handle slots, mapping handles to tween indices. */
+   uint32_t *slot_index;
+   uint16_t *slot_generation;
+   uint32_t *free_slots;
+   size_t slot_count;
+   size_t free_count;
 } animation_t;
 
 enum animation_easing_type
@@ -100,6 +118,52 @@ bool menu_animation_push(animation_t *animation, float duration,
       float target_value, float* subject,
       enum animation_easing_type easing_enum, tween_cb cb);
 
+/**
+ * menu_animation_push_handle:
+ * @animation                : animation handle.
+ * @duration                 : duration of the tween.
+ * @target_value             : value @subject will be animated towards.
+ * @subject                  : value to animate.
+ * @easing_enum              : easing function.
+ * @cb                       : called when the tween finishes. Can be NULL.
+ *
+ * Same as menu_animation_push, but returns a handle that can be
+ * used to cancel or retarget the tween later on.
+ *
+ * Returns: handle of the new tween, 0 on failure.
+ **/
+menu_animation_handle_t menu_animation_push_handle(animation_t *animation,
+      float duration, float target_value, float* subject,
+      enum animation_easing_type easing_enum, tween_cb cb);
+
+/**
+ * menu_animation_cancel:
+ * @animation                : animation handle.
+ * @handle                   : tween handle.
+ *
+ * Stops a tween, leaving its subject at the current value.
+ * The tween callback is not called.
+ *
+ * Returns: true (1) if the tween was still running, otherwise false (0).
+ **/
+bool menu_animation_cancel(animation_t *animation,
+      menu_animation_handle_t handle);
+
+/**
+ * menu_animation_retarget:
+ * @animation                : animation handle.
+ * @handle                   : tween handle.
+ * @duration                 : new duration of the tween.
+ * @target_value             : new target value.
+ *
+ * Restarts a running tween from the current value of its subject
+ * towards @target_value.
+ *
+ * Returns: true (1) if the tween was still running, otherwise false (0).
+ **/
+bool menu_animation_retarget(animation_t *animation,
+      menu_animation_handle_t handle, float duration, float target_value);
+
 void menu_animation_update(animation_t *animation, float dt);
 
 /**
@@ -66,8 +66,7 @@ bool menu_database_realloc(const char *path,
 
    menu_database_playlist_free(menu);
 
-   menu->db_playlist = content_playlist_init(path,
-         1000);
+   menu->db_playlist = content_playlist_init(path, 0);
 
    if (!menu->db_playlist)
       return false;
@@ -22,6 +22,26 @@
 #include "../file_extract.h"
 #include "../file_ops.h"
 #include <file/dir_list.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+/* Directory listings kept around, keyed by path, extension filter
+ * and directory mtime. */
+#define MENU_DIR_CACHE_SIZE         4
+
+/* Entries per batch handed over by the scan thread. */
+#define MENU_DIR_SCAN_BATCH         256
+
+/* Entries added to the menu list per frame while scanning. */
+#define MENU_DIR_SCAN_FRAME_ENTRIES 1024
+
+/* How long to wait for a scan before populating the menu
+ * incrementally, so small directories show up at once. */
+#define MENU_DIR_SCAN_WAIT_US       10000
 
 int menu_entries_setting_set_flags(rarch_setting_t *setting)
 {
@@ -323,6 +343,616 @@ static void menu_entries_parse_drive_list(file_list_t *list)
 }
 
 
+typedef struct menu_dir_cache
+{
+   char dir[PATH_MAX_LENGTH];
+   char *exts;
+   int64_t mtime;
+   struct string_list *list;
+} menu_dir_cache_t;
+
+/* Most recently used first. */
+static menu_dir_cache_t menu_dir_cache[MENU_DIR_CACHE_SIZE];
+
+static int64_t menu_dir_mtime(const char *dir)
+{
+   struct stat st;
+
+   if (stat(dir, &st) != 0)
+      return -1;
+   return (int64_t)st.st_mtime;
+}
+
+static void menu_dir_cache_evict(menu_dir_cache_t *entry)
+{
+   string_list_free(entry->list);
+   free(entry->exts);
+   memset(entry, 0, sizeof(*entry));
+}
+
+static void menu_dir_cache_move_front(size_t idx)
+{
+   menu_dir_cache_t entry = menu_dir_cache[idx];
+
+   memmove(&menu_dir_cache[1], &menu_dir_cache[0],
+         idx * sizeof(menu_dir_cache[0]));
+   menu_dir_cache[0] = entry;
+}
+
+/**
+ * menu_dir_cache_get:
+ * @dir                      : Directory path.
+ * @exts                     : Extension filter, can be NULL.
+ * @mtime                    : Current modification time of @dir.
+ *
+ * Returns: sorted directory listing owned by the cache,
+ * or NULL if @dir changed since it was cached.
+ **/
+static struct string_list *menu_dir_cache_get(const char *dir,
+      const char *exts, int64_t mtime)
+{
+   size_t i;
+
+   for (i = 0; i < MENU_DIR_CACHE_SIZE; i++)
+   {
+      menu_dir_cache_t *entry = &menu_dir_cache[i];
+
+      if (!entry->list || strcmp(entry->dir, dir))
+         continue;
+      if ((!exts != !entry->exts) || (exts && strcmp(entry->exts, exts)))
+         continue;
+
+      if (mtime == -1 || entry->mtime != mtime)
+      {
+         menu_dir_cache_evict(entry);
+         return NULL;
+      }
+
+      menu_dir_cache_move_front(i);
+      return menu_dir_cache[0].list;
+   }
+
+   return NULL;
+}
+
+/**
+ * menu_dir_cache_put:
+ * @dir                      : Directory path.
+ * @exts                     : Extension filter, can be NULL.
+ * @mtime                    : Modification time of @dir.
+ * @list                     : Sorted directory listing.
+ *
+ * Adds a directory listing to the cache, evicting the least
+ * recently used one.
+ *
+ * Returns: true (1) if the cache took ownership of @list,
+ * otherwise false (0).
+ **/
+static bool menu_dir_cache_put(const char *dir, const char *exts,
+      int64_t mtime, struct string_list *list)
+{
+   menu_dir_cache_t *entry = &menu_dir_cache[MENU_DIR_CACHE_SIZE - 1];
+   char *exts_copy         = NULL;
+
+   if (mtime == -1)
+      return false;
+
+   if (exts && !(exts_copy = strdup(exts)))
+      return false;
+
+   /* Drops any stale listing of the same directory. */
+   menu_dir_cache_get(dir, exts, -1);
+
+   menu_dir_cache_evict(entry);
+   strlcpy(entry->dir, dir, sizeof(entry->dir));
+   entry->exts  = exts_copy;
+   entry->mtime = mtime;
+   entry->list  = list;
+
+   menu_dir_cache_move_front(MENU_DIR_CACHE_SIZE - 1);
+   return true;
+}
+
+static void menu_dir_cache_free(void)
+{
+   size_t i;
+
+   for (i = 0; i < MENU_DIR_CACHE_SIZE; i++)
+      menu_dir_cache_evict(&menu_dir_cache[i]);
+}
+
+/**
+ * menu_entries_push_dir_entry:
+ * @list                     : File list handle.
+ * @dir                      : Directory being listed.
+ * @label                    : Label of the menu list.
+ * @path                     : Path of the directory listing entry.
+ * @attr                     : File type of the directory listing entry.
+ * @default_type_plain       : Menu type of plain files.
+ * @push_dir                 : Only directories are selectable.
+ * @path_is_compressed       : @dir is an archive.
+ *
+ * Pushes one entry of a directory listing to the menu list.
+ *
+ * Returns: true (1) if the entry was pushed, otherwise false (0).
+ **/
+static bool menu_entries_push_dir_entry(file_list_t *list,
+      const char *dir, const char *label, const char *path, int attr,
+      unsigned default_type_plain, bool push_dir, bool path_is_compressed)
+{
+   bool is_dir;
+   menu_file_type_t file_type = MENU_FILE_NONE;
+
+   switch (attr)
+   {
+      case RARCH_DIRECTORY:
+         file_type = MENU_FILE_DIRECTORY;
+         break;
+      case RARCH_COMPRESSED_ARCHIVE:
+         file_type = MENU_FILE_CARCHIVE;
+         break;
+      case RARCH_COMPRESSED_FILE_IN_ARCHIVE:
+         file_type = MENU_FILE_IN_CARCHIVE;
+         break;
+      case RARCH_PLAIN_FILE:
+      default:
+         if (!strcmp(label, "detect_core_list"))
+         {
+            if (path_is_compressed_file(path))
+            {
+               /* in case of deferred_core_list we have to interpret
+                * every archive as an archive to disallow instant loading
+                */
+               file_type = MENU_FILE_CARCHIVE;
+               break;
+            }
+         }
+         file_type = (menu_file_type_t)default_type_plain;
+         break;
+   }
+
+   is_dir = (file_type == MENU_FILE_DIRECTORY);
+
+   if (push_dir && !is_dir)
+      return false;
+
+   /* Need to preserve slash first time. */
+   if (*dir && !path_is_compressed)
+      path = path_basename(path);
+
+
+#ifdef HAVE_LIBRETRO_MANAGEMENT
+#ifdef RARCH_CONSOLE
+   if (!strcmp(label, "core_list") && (is_dir ||
+            strcasecmp(path, SALAMANDER_FILE) == 0))
+      return false;
+#endif
+#endif
+
+   /* Push type further down in the chain.
+    * Needed for shader manager currently. */
+   if (!strcmp(label, "core_list"))
+   {
+      /* Compressed cores are unsupported */
+      if (file_type == MENU_FILE_CARCHIVE)
+         return false;
+
+      menu_list_push(list, path, "",
+            is_dir ? MENU_FILE_DIRECTORY : MENU_FILE_CORE, 0);
+   }
+   else
+   menu_list_push(list, path, "",
+         file_type, 0);
+
+   return true;
+}
+
+#ifdef HAVE_THREADS
+/* Lists a directory on a thread and streams its entries
+ * into the menu list, a batch per frame. */
+typedef struct menu_dir_scan
+{
+   slock_t *lock;
+   scond_t *cond;
+   sthread_t *thread;
+
+   /* Shared with the scan thread, protected by lock. */
+   struct string_list *pending;
+   bool done;
+   bool ok;
+   bool cancel;
+
+   /* Owned by the scan thread until done. */
+   struct string_list *all;
+
+   /* Main thread only. */
+   struct string_list *inbox;
+   size_t inbox_pos;
+   file_list_t *list;
+   char dir[PATH_MAX_LENGTH];
+   char label[PATH_MAX_LENGTH];
+   char *exts;
+   int64_t mtime;
+   unsigned default_type_plain;
+   bool push_dir;
+
+   /* Entries from base on are kept sorted, attrs holds their
+    * file type for merging in new entries. */
+   size_t base;
+   int *attrs;
+   size_t attrs_cap;
+
+   size_t stack_size;
+   size_t wanted_selection;
+   size_t last_selection;
+   bool restore_selection;
+} menu_dir_scan_t;
+
+static menu_dir_scan_t *menu_dir_scan;
+
+static int menu_dir_scan_elem_cmp(const void *a_, const void *b_)
+{
+   const struct string_list_elem *a = (const struct string_list_elem*)a_;
+   const struct string_list_elem *b = (const struct string_list_elem*)b_;
+
+   /* Same order as dir_list_sort(). */
+   if (a->attr.i != b->attr.i)
+      return b->attr.i - a->attr.i;
+   return strcasecmp(a->data, b->data);
+}
+
+static bool menu_dir_scan_batch_cb(struct string_list *batch, void *data)
+{
+   size_t i;
+   bool cancel;
+   menu_dir_scan_t *scan = (menu_dir_scan_t*)data;
+
+   for (i = 0; i < batch->size; i++)
+      string_list_append(scan->all, batch->elems[i].data,
+            batch->elems[i].attr);
+
+   slock_lock(scan->lock);
+   cancel = scan->cancel;
+   if (!cancel)
+   {
+      for (i = 0; i < batch->size; i++)
+         string_list_append(scan->pending, batch->elems[i].data,
+               batch->elems[i].attr);
+   }
+   slock_unlock(scan->lock);
+
+   string_list_free(batch);
+   return !cancel;
+}
+
+static void menu_dir_scan_thread(void *data)
+{
+   menu_dir_scan_t *scan = (menu_dir_scan_t*)data;
+   bool ok = dir_list_read(scan->dir, scan->exts, true,
+         MENU_DIR_SCAN_BATCH, menu_dir_scan_batch_cb, scan);
+
+   if (ok)
+      dir_list_sort(scan->all, true);
+
+   slock_lock(scan->lock);
+   scan->ok   = ok;
+   scan->done = true;
+   scond_signal(scan->cond);
+   slock_unlock(scan->lock);
+}
+
+static void menu_dir_scan_free(menu_dir_scan_t *scan)
+{
+   if (!scan)
+      return;
+
+   if (scan->thread)
+   {
+      slock_lock(scan->lock);
+      scan->cancel = true;
+      slock_unlock(scan->lock);
+      sthread_join(scan->thread);
+   }
+
+   if (scan->cond)
+      scond_free(scan->cond);
+   if (scan->lock)
+      slock_free(scan->lock);
+
+   string_list_free(scan->pending);
+   string_list_free(scan->all);
+   string_list_free(scan->inbox);
+   free(scan->exts);
+   free(scan->attrs);
+   free(scan);
+}
+
+/**
+ * menu_dir_scan_new:
+ * @dir                      : Directory path.
+ * @exts                     : Extension filter, can be NULL.
+ * @mtime                    : Modification time of @dir.
+ * @str_list                 : Directory listing, if the scan finished
+ *                             within MENU_DIR_SCAN_WAIT_US.
+ *
+ * Starts listing @dir on a thread.
+ *
+ * Returns: the running scan, or NULL if it finished (or failed)
+ * right away, in which case the listing is returned in @str_list.
+ **/
+static menu_dir_scan_t *menu_dir_scan_new(const char *dir,
+      const char *exts, int64_t mtime, struct string_list **str_list)
+{
+   bool done;
+   menu_dir_scan_t *scan = (menu_dir_scan_t*)calloc(1, sizeof(*scan));
+
+   *str_list = NULL;
+
+   if (!scan)
+      return NULL;
+
+   strlcpy(scan->dir, dir, sizeof(scan->dir));
+   scan->exts    = exts ? strdup(exts) : NULL;
+   scan->mtime   = mtime;
+   scan->lock    = slock_new();
+   scan->cond    = scond_new();
+   scan->pending = string_list_new();
+   scan->all     = string_list_new();
+   scan->inbox   = string_list_new();
+
+   if (!scan->lock || !scan->cond || !scan->pending
+         || !scan->all || !scan->inbox || (exts && !scan->exts))
+      goto error;
+
+   scan->thread = sthread_create(menu_dir_scan_thread, scan);
+   if (!scan->thread)
+      goto error;
+
+   slock_lock(scan->lock);
+   if (!scan->done)
+      scond_wait_timeout(scan->cond, scan->lock, MENU_DIR_SCAN_WAIT_US);
+   done = scan->done;
+   slock_unlock(scan->lock);
+
+   if (!done)
+      return scan;
+
+   sthread_join(scan->thread);
+   scan->thread = NULL;
+
+   if (scan->ok)
+   {
+      *str_list = scan->all;
+      scan->all = NULL;
+   }
+
+   menu_dir_scan_free(scan);
+   return NULL;
+
+error:
+   menu_dir_scan_free(scan);
+   *str_list = dir_list_new(dir, exts, true);
+   if (*str_list)
+      dir_list_sort(*str_list, true);
+   return NULL;
+}
+
+static int menu_dir_scan_entry_cmp(const menu_dir_scan_t *scan,
+      size_t a, int attr_a, const struct item_file *b, int attr_b)
+{
+   if (attr_a != attr_b)
+      return attr_b - attr_a;
+   return strcasecmp(scan->list->list[a].path, b->path);
+}
+
+/**
+ * menu_dir_scan_merge:
+ * @scan                     : Directory scan handle.
+ * @old_size                 : Size of the list before the new entries
+ *                             were pushed.
+ *
+ * Merges the sorted entries pushed from @old_size on into the
+ * sorted entries before them, keeping the selected entry selected.
+ * Drivers place rows by index when they are pushed, so they are
+ * told to lay the list out again if any entry moved.
+ **/
+static void menu_dir_scan_merge(menu_dir_scan_t *scan, size_t old_size)
+{
+   size_t count;
+   ssize_t i, j, w;
+   bool moved             = false;
+   struct item_file *tmp  = NULL;
+   int *tmp_attrs         = NULL;
+   file_list_t *list      = scan->list;
+   size_t base            = scan->base;
+   menu_handle_t *menu    = menu_driver_resolve();
+   size_t selection       = menu ? menu->navigation.selection_ptr : 0;
+   size_t new_selection   = selection;
+
+   count = list->size - old_size;
+   if (!count || old_size == base)
+      return;
+
+   tmp       = (struct item_file*)malloc(count * sizeof(*tmp));
+   tmp_attrs = (int*)malloc(count * sizeof(*tmp_attrs));
+
+   if (!tmp || !tmp_attrs)
+      goto end;
+
+   memcpy(tmp, &list->list[old_size], count * sizeof(*tmp));
+   memcpy(tmp_attrs, &scan->attrs[old_size - base],
+         count * sizeof(*tmp_attrs));
+
+   i = old_size - 1;
+   j = count - 1;
+   w = list->size - 1;
+
+   while (j >= 0)
+   {
+      if (i >= (ssize_t)base && menu_dir_scan_entry_cmp(scan, i,
+               scan->attrs[i - base], &tmp[j], tmp_attrs[j]) > 0)
+      {
+         if ((size_t)i == selection)
+            new_selection = w;
+         list->list[w]           = list->list[i];
+         scan->attrs[w - base]   = scan->attrs[i - base];
+         moved                   = true;
+         i--;
+      }
+      else
+      {
+         list->list[w]           = tmp[j];
+         scan->attrs[w - base]   = tmp_attrs[j];
+         j--;
+      }
+      w--;
+   }
+
+   /* Only scroll if the selected entry moved, the driver
+    * updates row positions either way. */
+   if (menu && moved)
+   {
+      menu_navigation_set(&menu->navigation, new_selection,
+            new_selection != selection);
+      scan->last_selection = new_selection;
+   }
+
+end:
+   free(tmp);
+   free(tmp_attrs);
+}
+
+static void menu_dir_scan_finish(menu_dir_scan_t *scan)
+{
+   menu_handle_t *menu = menu_driver_resolve();
+
+   sthread_join(scan->thread);
+   scan->thread = NULL;
+
+   if (scan->ok && menu_dir_cache_put(scan->dir, scan->exts,
+            scan->mtime, scan->all))
+      scan->all = NULL;
+
+   if (menu && scan->restore_selection
+         && scan->wanted_selection < file_list_get_size(scan->list))
+      menu_navigation_set(&menu->navigation,
+            scan->wanted_selection, true);
+
+   menu_dir_scan = NULL;
+   menu_dir_scan_free(scan);
+}
+
+/**
+ * menu_entries_dir_scan_cancel:
+ *
+ * Stops a running directory scan, leaving the entries
+ * already added to the menu list.
+ **/
+static void menu_entries_dir_scan_cancel(void)
+{
+   menu_dir_scan_t *scan = menu_dir_scan;
+
+   menu_dir_scan = NULL;
+   menu_dir_scan_free(scan);
+}
+#endif
+
+void menu_entries_dir_scan_iterate(void)
+{
+#ifdef HAVE_THREADS
+   size_t i, end, old_size;
+   menu_dir_scan_t *scan = menu_dir_scan;
+   menu_handle_t *menu   = menu_driver_resolve();
+
+   if (!scan || !menu)
+      return;
+
+   {
+      const char *label = NULL;
+
+      /* The menu moved on to another list. */
+      menu_list_get_last_stack(menu->menu_list, NULL, &label, NULL);
+      if (!label || strcmp(label, scan->label)
+            || menu_list_get_stack_size(menu->menu_list) != scan->stack_size)
+      {
+         menu_entries_dir_scan_cancel();
+         return;
+      }
+   }
+
+   if (menu->navigation.selection_ptr != scan->last_selection)
+      scan->restore_selection = false;
+
+   if (scan->inbox_pos >= scan->inbox->size)
+   {
+      bool done;
+      struct string_list *inbox = string_list_new();
+
+      if (!inbox)
+         return;
+
+      slock_lock(scan->lock);
+      string_list_free(scan->inbox);
+      scan->inbox   = scan->pending;
+      scan->pending = inbox;
+      done          = scan->done;
+      slock_unlock(scan->lock);
+
+      scan->inbox_pos = 0;
+
+      if (!scan->inbox->size)
+      {
+         if (done)
+            menu_dir_scan_finish(scan);
+         return;
+      }
+   }
+
+   end = scan->inbox_pos + MENU_DIR_SCAN_FRAME_ENTRIES;
+   if (end > scan->inbox->size)
+      end = scan->inbox->size;
+
+   qsort(&scan->inbox->elems[scan->inbox_pos], end - scan->inbox_pos,
+         sizeof(struct string_list_elem), menu_dir_scan_elem_cmp);
+
+   old_size = file_list_get_size(scan->list);
+
+   for (i = scan->inbox_pos; i < end; i++)
+   {
+      size_t size = file_list_get_size(scan->list) - scan->base;
+
+      if (size >= scan->attrs_cap)
+      {
+         size_t cap = scan->attrs_cap ? scan->attrs_cap * 2 : 256;
+         int *attrs = (int*)realloc(scan->attrs, cap * sizeof(*attrs));
+
+         if (!attrs)
+            break;
+
+         scan->attrs     = attrs;
+         scan->attrs_cap = cap;
+      }
+
+      if (menu_entries_push_dir_entry(scan->list, scan->dir, scan->label,
+               scan->inbox->elems[i].data, scan->inbox->elems[i].attr.i,
+               scan->default_type_plain, scan->push_dir, false))
+         scan->attrs[size] = scan->inbox->elems[i].attr.i;
+   }
+   scan->inbox_pos = i;
+
+   menu_dir_scan_merge(scan, old_size);
+   menu_list_refresh_scroll_indices(scan->list);
+#endif
+}
+
+void menu_entries_dir_scan_deinit(void)
+{
+#ifdef HAVE_THREADS
+   menu_entries_dir_scan_cancel();
+#endif
+   menu_dir_cache_free();
+}
+
 int menu_entries_parse_list(
       file_list_t *list, file_list_t *menu_list,
       const char *dir, const char *label, unsigned type,
@@ -332,13 +962,20 @@ int menu_entries_parse_list(
    size_t i, list_size;
    bool path_is_compressed, push_dir;
    int device = 0;
+   int64_t mtime = -1;
+   const char *filter_exts      = NULL;
    struct string_list *str_list = NULL;
+   bool str_list_cached         = false;
 
    (void)device;
 
    if (!list || !menu_list)
       return -1;
 
+#ifdef HAVE_THREADS
+   menu_entries_dir_scan_cancel();
+#endif
+
    menu_list_clear(list);
 
    if (!*dir)
@@ -363,93 +1000,85 @@ int menu_entries_parse_list(
    push_dir           = (setting && setting->browser_selection_type == ST_DIR);
 
    if (path_is_compressed)
+   {
       str_list = compressed_file_list_new(dir,exts);
+      if (str_list)
+         dir_list_sort(str_list, true);
+   }
    else
-      str_list = dir_list_new(dir,
-            g_settings.menu.navigation.browser.filter.supported_extensions_enable 
-            ? exts : NULL, true);
-
-   if (!str_list)
-      return -1;
-
-   dir_list_sort(str_list, true);
-
-   if (push_dir)
-      menu_list_push(list, "<Use this directory>", "",
-            MENU_FILE_USE_DIRECTORY, 0);
-
-   list_size = str_list->size;
-   for (i = 0; i < str_list->size; i++)
    {
-      bool is_dir;
-      const char *path = NULL;
-      menu_file_type_t file_type = MENU_FILE_NONE;
-
-      switch (str_list->elems[i].attr.i)
+      filter_exts = 
+         g_settings.menu.navigation.browser.filter.supported_extensions_enable 
+         ? exts : NULL;
+      mtime       = menu_dir_mtime(dir);
+      str_list    = menu_dir_cache_get(dir, filter_exts, mtime);
+      str_list_cached = (str_list != NULL);
+
+#ifdef HAVE_THREADS
+      /* The core list needs all entries for display names. */
+      if (!str_list && strcmp(label, "core_list"))
       {
-         case RARCH_DIRECTORY:
-            file_type = MENU_FILE_DIRECTORY;
-            break;
-         case RARCH_COMPRESSED_ARCHIVE:
-            file_type = MENU_FILE_CARCHIVE;
-            break;
-         case RARCH_COMPRESSED_FILE_IN_ARCHIVE:
-            file_type = MENU_FILE_IN_CARCHIVE;
-            break;
-         case RARCH_PLAIN_FILE:
-         default:
-            if (!strcmp(label, "detect_core_list"))
-            {
-               if (path_is_compressed_file(str_list->elems[i].data))
-               {
-                  /* in case of deferred_core_list we have to interpret
-                   * every archive as an archive to disallow instant loading
-                   */
-                  file_type = MENU_FILE_CARCHIVE;
-                  break;
-               }
-            }
-            file_type = (menu_file_type_t)default_type_plain;
-            break;
-      }
-
-      is_dir = (file_type == MENU_FILE_DIRECTORY);
-
-      if (push_dir && !is_dir)
-         continue;
-
-      /* Need to preserve slash first time. */
-      path = str_list->elems[i].data;
-
-      if (*dir && !path_is_compressed)
-         path = path_basename(path);
+         menu_handle_t *menu   = menu_driver_resolve();
+         menu_dir_scan_t *scan = menu_dir_scan_new(dir, filter_exts,
+               mtime, &str_list);
 
+         if (scan)
+         {
+            if (push_dir)
+               menu_list_push(list, "<Use this directory>", "",
+                     MENU_FILE_USE_DIRECTORY, 0);
+
+            scan->list               = list;
+            scan->base               = file_list_get_size(list);
+            scan->default_type_plain = default_type_plain;
+            scan->push_dir           = push_dir;
+            scan->stack_size         = menu ?
+               menu_list_get_stack_size(menu->menu_list) : 0;
+            scan->wanted_selection   = menu ? menu->navigation.selection_ptr : 0;
+            scan->restore_selection  = true;
+            strlcpy(scan->label, label, sizeof(scan->label));
+            menu_dir_scan = scan;
+
+            menu_list_populate_generic(list, dir, label, type);
+
+            scan->last_selection = menu ? menu->navigation.selection_ptr : 0;
+            menu_entries_dir_scan_iterate();
+            return 0;
+         }
 
-#ifdef HAVE_LIBRETRO_MANAGEMENT
-#ifdef RARCH_CONSOLE
-      if (!strcmp(label, "core_list") && (is_dir ||
-               strcasecmp(path, SALAMANDER_FILE) == 0))
-         continue;
-#endif
+         if (str_list)
+            str_list_cached = menu_dir_cache_put(dir, filter_exts,
+                  mtime, str_list);
+      }
 #endif
 
-      /* Push type further down in the chain.
-       * Needed for shader manager currently. */
-      if (!strcmp(label, "core_list"))
+      if (!str_list)
       {
-         /* Compressed cores are unsupported */
-         if (file_type == MENU_FILE_CARCHIVE)
-            continue;
+         str_list = dir_list_new(dir, filter_exts, true);
 
-         menu_list_push(list, path, "",
-               is_dir ? MENU_FILE_DIRECTORY : MENU_FILE_CORE, 0);
+         if (str_list)
+         {
+            dir_list_sort(str_list, true);
+            str_list_cached = menu_dir_cache_put(dir, filter_exts,
+                  mtime, str_list);
+         }
       }
-      else
-      menu_list_push(list, path, "",
-            file_type, 0);
    }
 
-   string_list_free(str_list);
+   if (!str_list)
+      return -1;
+
+   if (push_dir)
+      menu_list_push(list, "<Use this directory>", "",
+            MENU_FILE_USE_DIRECTORY, 0);
+
+   for (i = 0; i < str_list->size; i++)
+      menu_entries_push_dir_entry(list, dir, label,
+            str_list->elems[i].data, str_list->elems[i].attr.i,
+            default_type_plain, push_dir, path_is_compressed);
+
+   if (!str_list_cached)
+      string_list_free(str_list);
 
    if (!strcmp(label, "core_list"))
    {
@@ -488,6 +1117,10 @@ int menu_entries_deferred_push(file_list_t *list, file_list_t *menu_list)
    const char *label         = NULL;
    menu_file_list_cbs_t *cbs = NULL;
 
+#ifdef HAVE_THREADS
+   menu_entries_dir_scan_cancel();
+#endif
+
    menu_list_get_last_stack(driver.menu->menu_list, &path, &label, &type);
 
    if (!strcmp(label, "Main Menu"))
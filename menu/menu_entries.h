@@ -36,6 +36,22 @@ int menu_entries_parse_list(file_list_t *list, file_list_t *menu_list,
 
 int menu_entries_deferred_push(file_list_t *list, file_list_t *menu_list);
 
+/**
+ * menu_entries_dir_scan_iterate:
+ *
+ * Adds the entries found by a running directory scan to the
+ * menu list, up to a batch per call. Called once per frame.
+ **/
+void menu_entries_dir_scan_iterate(void);
+
+/**
+ * menu_entries_dir_scan_deinit:
+ *
+ * Stops any running directory scan and frees the
+ * directory listing cache.
+ **/
+void menu_entries_dir_scan_deinit(void);
+
 /**
  * menu_entries_init:
  * @menu                     : Menu handle.
@@ -739,7 +739,7 @@ static int deferred_push_core_information(void *data, void *userdata,
    info = (core_info_t*)g_extern.core_info_current;
    menu_list_clear(list);
 
-   if (info->data)
+   if (info->has_info)
    {
       char tmp[PATH_MAX_LENGTH];
 
@@ -1170,12 +1170,16 @@ static int deferred_push_rdb_entry_detail(void *data, void *userdata,
 
       if (playlist)
       {
-         for (j = 0; j < playlist->size; j++)
+         for (j = 0; j < content_playlist_size(playlist); j++)
          {
             char elem0[PATH_MAX_LENGTH], elem1[PATH_MAX_LENGTH];
             bool match_found = false;
-            struct string_list *tmp_str_list = string_split(
-                  playlist->entries[j].core_name, "|"); 
+            const char *core_name = NULL;
+            struct string_list *tmp_str_list = NULL;
+
+            content_playlist_get_index(playlist, j,
+                  NULL, NULL, &core_name);
+            tmp_str_list = string_split(core_name, "|"); 
 
             if (!tmp_str_list)
                continue;
@@ -1231,6 +1235,7 @@ static int deferred_push_rdb_entry_detail(void *data, void *userdata,
 done:
 #ifdef HAVE_LIBRETRODB
    string_list_free(str_list);
+   database_info_list_free(db_info);
 #endif
    return ret;
 }
@@ -2832,7 +2837,7 @@ static int deferred_push_core_information(void *data, void *userdata,
    info = (core_info_t*)g_extern.core_info_current;
    menu_list_clear(list);
 
-   if (info->data)
+   if (info->has_info)
    {
       char tmp[PATH_MAX_LENGTH];
 
@@ -5245,6 +5250,361 @@ static void menu_action_setting_disp_set_label(file_list_t* list,
    strlcpy(path_buf, path, path_buf_size);
 }
 
+/* Labels with special bindings are looked up through per-binder
+ * tables, hashed on first use, instead of strcmp() chains. */
+#define MENU_CBS_LABEL_SLOTS 256
+
+/* Bound after the checks preceding the later labels of a binder. */
+#define MENU_CBS_LATE           (1 << 0)
+#define MENU_CBS_RDB_ENTRY      (1 << 1)
+#define MENU_CBS_SETTINGS_ENTRY (1 << 2)
+
+typedef struct menu_cbs_label_index
+{
+   bool init;
+   /* Table row + 1, 0 is empty. */
+   uint16_t slots[MENU_CBS_LABEL_SLOTS];
+   uint32_t hashes[MENU_CBS_LABEL_SLOTS];
+} menu_cbs_label_index_t;
+
+static uint32_t menu_cbs_label_hash(const char *label)
+{
+   uint32_t hash = 5381;
+   while (*label)
+      hash = (hash << 5) + hash + (uint8_t)*label++;
+   return hash;
+}
+
+static const char *menu_cbs_label_at(const void *table, size_t stride,
+      size_t idx)
+{
+   return *(const char* const*)((const uint8_t*)table + idx * stride);
+}
+
+/**
+ * menu_cbs_label_find:
+ * @index              : Hash index of @table, built on first use.
+ * @table              : Table of rows starting with a label string.
+ * @count              : Number of rows in @table.
+ * @stride             : Size of a row.
+ * @label              : Label to look up.
+ *
+ * Returns: row of @label in @table if found, otherwise NULL.
+ **/
+static const void *menu_cbs_label_find(menu_cbs_label_index_t *index,
+      const void *table, size_t count, size_t stride, const char *label)
+{
+   size_t i;
+   uint32_t hash;
+   const size_t mask = MENU_CBS_LABEL_SLOTS - 1;
+
+   if (!label)
+      return NULL;
+
+   if (!index->init)
+   {
+      rarch_assert(count * 2 <= MENU_CBS_LABEL_SLOTS);
+
+      for (i = 0; i < count; i++)
+      {
+         size_t j;
+
+         hash = menu_cbs_label_hash(menu_cbs_label_at(table, stride, i));
+
+         for (j = hash & mask; index->slots[j]; j = (j + 1) & mask);
+         index->slots[j]  = i + 1;
+         index->hashes[j] = hash;
+      }
+
+      index->init = true;
+   }
+
+   hash = menu_cbs_label_hash(label);
+
+   for (i = hash & mask; index->slots[i]; i = (i + 1) & mask)
+   {
+      size_t row = index->slots[i] - 1;
+
+      if (index->hashes[i] == hash
+            && !strcmp(menu_cbs_label_at(table, stride, row), label))
+         return (const uint8_t*)table + row * stride;
+   }
+
+   return NULL;
+}
+
+#define MENU_CBS_LABEL_FIND(table, label) \
+   menu_cbs_label_find(&table##_index, table, ARRAY_SIZE(table), \
+         sizeof(table[0]), label)
+
+typedef struct menu_cbs_label_flags
+{
+   const char *label;
+   unsigned flags;
+} menu_cbs_label_flags_t;
+
+static const menu_cbs_label_flags_t menu_cbs_entries[] = {
+   { "rdb_entry_publisher",                MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_developer",                MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_origin",                   MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_franchise",                MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_enhancement_hw",           MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_esrb_rating",              MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_bbfc_rating",              MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_elspa_rating",             MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_pegi_rating",              MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_cero_rating",              MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_edge_magazine_rating",     MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_edge_magazine_issue",      MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_famitsu_magazine_rating",  MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_releasemonth",             MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_releaseyear",              MENU_CBS_RDB_ENTRY },
+   { "rdb_entry_max_users",                MENU_CBS_RDB_ENTRY },
+   { "Driver Settings",                    MENU_CBS_SETTINGS_ENTRY },
+   { "General Settings",                   MENU_CBS_SETTINGS_ENTRY },
+   { "Video Settings",                     MENU_CBS_SETTINGS_ENTRY },
+   { "Shader Settings",                    MENU_CBS_SETTINGS_ENTRY },
+   { "Font Settings",                      MENU_CBS_SETTINGS_ENTRY },
+   { "Audio Settings",                     MENU_CBS_SETTINGS_ENTRY },
+   { "Input Settings",                     MENU_CBS_SETTINGS_ENTRY },
+   { "Overlay Settings",                   MENU_CBS_SETTINGS_ENTRY },
+   { "Menu Settings",                      MENU_CBS_SETTINGS_ENTRY },
+   { "UI Settings",                        MENU_CBS_SETTINGS_ENTRY },
+   { "Patch Settings",                     MENU_CBS_SETTINGS_ENTRY },
+   { "Playlist Settings",                  MENU_CBS_SETTINGS_ENTRY },
+   { "Onscreen Keyboard Overlay Settings", MENU_CBS_SETTINGS_ENTRY },
+   { "Core Updater Settings",              MENU_CBS_SETTINGS_ENTRY },
+   { "Network Settings",                   MENU_CBS_SETTINGS_ENTRY },
+   { "Archive Settings",                   MENU_CBS_SETTINGS_ENTRY },
+   { "User Settings",                      MENU_CBS_SETTINGS_ENTRY },
+   { "Path Settings",                      MENU_CBS_SETTINGS_ENTRY },
+   { "Privacy Settings",                   MENU_CBS_SETTINGS_ENTRY },
+};
+static menu_cbs_label_index_t menu_cbs_entries_index;
+
+typedef struct menu_cbs_label_ok
+{
+   const char *label;
+   int (*action_ok)(const char *path, const char *label, unsigned type,
+         size_t idx);
+   unsigned flags;
+} menu_cbs_label_ok_t;
+
+static const menu_cbs_label_ok_t menu_cbs_ok[] = {
+   { "savestate",                      action_ok_save_state,            0 },
+   { "loadstate",                      action_ok_load_state,            0 },
+   { "resume_content",                 action_ok_resume_content,        0 },
+   { "restart_content",                action_ok_restart_content,       0 },
+   { "take_screenshot",                action_ok_screenshot,            0 },
+   { "file_load_or_resume",            action_ok_file_load_or_resume,   0 },
+   { "quit_retroarch",                 action_ok_quit,                  0 },
+   { "save_new_config",                action_ok_save_new_config,       0 },
+   { "help",                           action_ok_help,                  0 },
+   { "video_shader_pass",              action_ok_shader_pass,           0 },
+   { "video_shader_preset",            action_ok_shader_preset,         0 },
+   { "cheat_file_load",                action_ok_cheat_file,            0 },
+   { "audio_dsp_plugin",               action_ok_audio_dsp_plugin,      0 },
+   { "video_filter",                   action_ok_video_filter,          0 },
+   { "remap_file_load",                action_ok_remap_file,            0 },
+   { "video_shader_parameters",        action_ok_shader_parameters,     0 },
+   { "video_shader_preset_parameters", action_ok_shader_parameters,     0 },
+   { "shader_options",                 action_ok_push_default,          0 },
+   { "Input Settings",                 action_ok_push_default,          0 },
+   { "core_options",                   action_ok_push_default,          0 },
+   { "core_cheat_options",             action_ok_push_default,          0 },
+   { "core_input_remapping_options",   action_ok_push_default,          0 },
+   { "core_information",               action_ok_push_default,          0 },
+   { "disk_options",                   action_ok_push_default,          0 },
+   { "settings",                       action_ok_push_default,          0 },
+   { "performance_counters",           action_ok_push_default,          0 },
+   { "frontend_counters",              action_ok_push_default,          0 },
+   { "core_counters",                  action_ok_push_default,          0 },
+   { "management",                     action_ok_push_default,          0 },
+   { "options",                        action_ok_push_default,          0 },
+   { "load_content",                   action_ok_push_content_list,     0 },
+   { "detect_core_list",               action_ok_push_content_list,     0 },
+   { "history_list",                   action_ok_push_generic_list,     0 },
+   { "core_updater_list",              action_ok_push_generic_list,     0 },
+   { "cursor_manager_list",            action_ok_push_generic_list,     0 },
+   { "database_manager_list",          action_ok_push_generic_list,     0 },
+   /* After directory settings. */
+   { "shader_apply_changes",           action_ok_shader_apply_changes,  MENU_CBS_LATE },
+   { "cheat_apply_changes",            action_ok_cheat_apply_changes,   MENU_CBS_LATE },
+   { "video_shader_preset_save_as",    action_ok_shader_preset_save_as, MENU_CBS_LATE },
+   { "cheat_file_save_as",             action_ok_cheat_file_save_as,    MENU_CBS_LATE },
+   { "remap_file_save_as",             action_ok_remap_file_save_as,    MENU_CBS_LATE },
+   { "core_list",                      action_ok_core_list,             MENU_CBS_LATE },
+   { "disk_image_append",              action_ok_disk_image_append_list, MENU_CBS_LATE },
+   { "configurations",                 action_ok_configurations_list,   MENU_CBS_LATE },
+};
+static menu_cbs_label_index_t menu_cbs_ok_index;
+
+typedef struct menu_cbs_label_action
+{
+   const char *label;
+   int (*action)(unsigned type, const char *label, unsigned action);
+} menu_cbs_label_action_t;
+
+static const menu_cbs_label_action_t menu_cbs_start[] = {
+   { "remap_file_load",          action_start_remap_file_load },
+   { "video_shader_pass",        action_start_shader_pass },
+   { "video_shader_scale_pass",  action_start_shader_scale_pass },
+   { "video_shader_filter_pass", action_start_shader_filter_pass },
+   { "video_shader_num_passes",  action_start_shader_num_passes },
+   { "cheat_num_passes",         action_start_cheat_num_passes },
+};
+static menu_cbs_label_index_t menu_cbs_start_index;
+
+static const menu_cbs_label_action_t menu_cbs_toggle[] = {
+   { "savestate",                   action_toggle_save_state },
+   { "loadstate",                   action_toggle_save_state },
+   { "video_shader_scale_pass",     action_toggle_shader_scale_pass },
+   { "video_shader_filter_pass",    action_toggle_shader_filter_pass },
+   { "video_shader_default_filter", action_toggle_shader_filter_default },
+   { "video_shader_num_passes",     action_toggle_shader_num_passes },
+   { "cheat_num_passes",            action_toggle_cheat_num_passes },
+};
+static menu_cbs_label_index_t menu_cbs_toggle_index;
+
+typedef struct menu_cbs_label_representation
+{
+   const char *label;
+   void (*action_get_representation)(file_list_t* list,
+         unsigned *w, unsigned type, unsigned i,
+         const char *label,
+         char *type_str, size_t type_str_size,
+         const char *entry_label,
+         const char *path,
+         char *path_buf, size_t path_buf_size);
+} menu_cbs_label_representation_t;
+
+static const menu_cbs_label_representation_t menu_cbs_representation[] = {
+   { "cheat_num_passes",
+      menu_action_setting_disp_set_label_cheat_num_passes },
+   { "remap_file_load",
+      menu_action_setting_disp_set_label_remap_file_load },
+   { "video_shader_filter_pass",
+      menu_action_setting_disp_set_label_shader_filter_pass },
+   { "video_shader_scale_pass",
+      menu_action_setting_disp_set_label_shader_scale_pass },
+   { "video_shader_num_passes",
+      menu_action_setting_disp_set_label_shader_num_passes },
+   { "video_shader_pass",
+      menu_action_setting_disp_set_label_shader_pass },
+   { "video_shader_default_filter",
+      menu_action_setting_disp_set_label_shader_default_filter },
+   { "configurations",
+      menu_action_setting_disp_set_label_configurations },
+};
+static menu_cbs_label_index_t menu_cbs_representation_index;
+
+typedef struct menu_cbs_label_deferred_push
+{
+   const char *label;
+   int (*action_deferred_push)(void *data, void *userdata,
+         const char *path, const char *label, unsigned type);
+   unsigned flags;
+} menu_cbs_label_deferred_push_t;
+
+static const menu_cbs_label_deferred_push_t menu_cbs_deferred_push[] = {
+   { "core_updater_list",     deferred_push_core_updater_list,     0 },
+   { "history_list",          deferred_push_history_list,          0 },
+   { "database_manager_list", deferred_push_database_manager_list, 0 },
+   { "cursor_manager_list",   deferred_push_cursor_manager_list,   0 },
+   { "cheat_file_load",       deferred_push_cheat_file_load,       0 },
+   { "remap_file_load",       deferred_push_remap_file_load,       0 },
+   { "content_actions",       deferred_push_content_actions,       0 },
+   { "shader_options",        deferred_push_shader_options,        0 },
+   { "options",               deferred_push_options,               0 },
+   { "management",            deferred_push_management_options,    0 },
+   /* After setting groups. */
+   { "deferred_core_list",
+      deferred_push_core_list_deferred, MENU_CBS_LATE },
+   { "deferred_database_manager_list",
+      deferred_push_database_manager_list_deferred, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list",
+      deferred_push_cursor_manager_list_deferred, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_publisher",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_developer",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_origin",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_franchise",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_enhancement_hw",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_esrb_rating",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_bbfc_rating",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_elspa_rating",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_pegi_rating",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_cero_rating",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_edge_magazine_rating",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_edge_magazine_issue",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_famitsu_magazine_rating",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_max_users",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_releasemonth",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "deferred_cursor_manager_list_rdb_entry_releaseyear",
+      deferred_push_cursor_manager_list_deferred_query_subsearch, MENU_CBS_LATE },
+   { "core_information",
+      deferred_push_core_information, MENU_CBS_LATE },
+   { "performance_counters",
+      deferred_push_performance_counters, MENU_CBS_LATE },
+   { "core_counters",
+      deferred_push_core_counters, MENU_CBS_LATE },
+   { "video_shader_preset_parameters",
+      deferred_push_video_shader_preset_parameters, MENU_CBS_LATE },
+   { "video_shader_parameters",
+      deferred_push_video_shader_parameters, MENU_CBS_LATE },
+   { "settings",
+      deferred_push_settings, MENU_CBS_LATE },
+   { "frontend_counters",
+      deferred_push_frontend_counters, MENU_CBS_LATE },
+   { "core_options",
+      deferred_push_core_options, MENU_CBS_LATE },
+   { "core_cheat_options",
+      deferred_push_core_cheat_options, MENU_CBS_LATE },
+   { "core_input_remapping_options",
+      deferred_push_core_input_remapping_options, MENU_CBS_LATE },
+   { "disk_options",
+      deferred_push_disk_options, MENU_CBS_LATE },
+   { "core_list",
+      deferred_push_core_list, MENU_CBS_LATE },
+   { "configurations",
+      deferred_push_configurations, MENU_CBS_LATE },
+   { "video_shader_preset",
+      deferred_push_video_shader_preset, MENU_CBS_LATE },
+   { "video_shader_pass",
+      deferred_push_video_shader_pass, MENU_CBS_LATE },
+   { "video_filter",
+      deferred_push_video_filter, MENU_CBS_LATE },
+   { "menu_wallpaper",
+      deferred_push_images, MENU_CBS_LATE },
+   { "audio_dsp_plugin",
+      deferred_push_audio_dsp_plugin, MENU_CBS_LATE },
+   { "input_overlay",
+      deferred_push_input_overlay, MENU_CBS_LATE },
+   { "input_osk_overlay",
+      deferred_push_input_osk_overlay, MENU_CBS_LATE },
+   { "video_font_path",
+      deferred_push_video_font_path, MENU_CBS_LATE },
+   { "game_history_path",
+      deferred_push_content_history_path, MENU_CBS_LATE },
+   { "detect_core_list",
+      deferred_push_detect_core_list, MENU_CBS_LATE },
+};
+static menu_cbs_label_index_t menu_cbs_deferred_push_index;
+
 static void menu_entries_cbs_init_bind_select(menu_file_list_cbs_t *cbs,
       const char *path, const char *label, unsigned type, size_t idx,
       const char *elem0, const char *elem1)
@@ -5259,23 +5619,16 @@ static void menu_entries_cbs_init_bind_start(menu_file_list_cbs_t *cbs,
       const char *path, const char *label, unsigned type, size_t idx,
       const char *elem0, const char *elem1)
 {
+   const menu_cbs_label_action_t *row = (const menu_cbs_label_action_t*)
+      MENU_CBS_LABEL_FIND(menu_cbs_start, label);
+
    if (!cbs)
       return;
 
    cbs->action_start = action_start_lookup_setting;
 
-   if (!strcmp(label, "remap_file_load"))
-      cbs->action_start = action_start_remap_file_load;
-   else if (!strcmp(label, "video_shader_pass"))
-      cbs->action_start = action_start_shader_pass;
-   else if (!strcmp(label, "video_shader_scale_pass"))
-      cbs->action_start = action_start_shader_scale_pass;
-   else if (!strcmp(label, "video_shader_filter_pass"))
-      cbs->action_start = action_start_shader_filter_pass;
-   else if (!strcmp(label, "video_shader_num_passes"))
-      cbs->action_start = action_start_shader_num_passes;
-   else if (!strcmp(label, "cheat_num_passes"))
-      cbs->action_start = action_start_cheat_num_passes;
+   if (row)
+      cbs->action_start = row->action;
    else if (type >= MENU_SETTINGS_SHADER_PARAMETER_0
          && type <= MENU_SETTINGS_SHADER_PARAMETER_LAST)
       cbs->action_start = action_start_shader_action_parameter;
@@ -5320,48 +5673,18 @@ static void menu_entries_cbs_init_bind_cancel(menu_file_list_cbs_t *cbs,
 
 static int is_rdb_entry(const char *label)
 {
-   return (
-         !(strcmp(label, "rdb_entry_publisher")) ||
-         !(strcmp(label, "rdb_entry_developer")) ||
-         !(strcmp(label, "rdb_entry_origin")) ||
-         !(strcmp(label, "rdb_entry_franchise")) ||
-         !(strcmp(label, "rdb_entry_enhancement_hw")) ||
-         !(strcmp(label, "rdb_entry_esrb_rating")) ||
-         !(strcmp(label, "rdb_entry_bbfc_rating")) ||
-         !(strcmp(label, "rdb_entry_elspa_rating")) ||
-         !(strcmp(label, "rdb_entry_pegi_rating")) ||
-         !(strcmp(label, "rdb_entry_cero_rating")) ||
-         !(strcmp(label, "rdb_entry_edge_magazine_rating")) ||
-         !(strcmp(label, "rdb_entry_edge_magazine_issue")) ||
-         !(strcmp(label, "rdb_entry_famitsu_magazine_rating")) ||
-         !(strcmp(label, "rdb_entry_releasemonth")) ||
-         !(strcmp(label, "rdb_entry_releaseyear")) ||
-         !(strcmp(label, "rdb_entry_max_users"))
-         );
+   const menu_cbs_label_flags_t *row = (const menu_cbs_label_flags_t*)
+      MENU_CBS_LABEL_FIND(menu_cbs_entries, label);
+
+   return row && (row->flags & MENU_CBS_RDB_ENTRY);
 }
 
 static int is_settings_entry(const char *label)
 {
-   return (
-    !strcmp(label, "Driver Settings") ||
-    !strcmp(label, "General Settings") ||
-    !strcmp(label, "Video Settings") ||
-    !strcmp(label, "Shader Settings") ||
-    !strcmp(label, "Font Settings") ||
-    !strcmp(label, "Audio Settings") ||
-    !strcmp(label, "Input Settings") ||
-    !strcmp(label, "Overlay Settings") ||
-    !strcmp(label, "Menu Settings") ||
-    !strcmp(label, "UI Settings") ||
-    !strcmp(label, "Patch Settings") ||
-    !strcmp(label, "Playlist Settings") ||
-    !strcmp(label, "Onscreen Keyboard Overlay Settings") ||
-    !strcmp(label, "Core Updater Settings") ||
-    !strcmp(label, "Network Settings") ||
-    !strcmp(label, "Archive Settings") ||
-    !strcmp(label, "User Settings") ||
-    !strcmp(label, "Path Settings") ||
-    !strcmp(label, "Privacy Settings"));
+   const menu_cbs_label_flags_t *row = (const menu_cbs_label_flags_t*)
+      MENU_CBS_LABEL_FIND(menu_cbs_entries, label);
+
+   return row && (row->flags & MENU_CBS_SETTINGS_ENTRY);
 }
 
 static void menu_entries_cbs_init_bind_ok(menu_file_list_cbs_t *cbs,
@@ -5369,6 +5692,8 @@ static void menu_entries_cbs_init_bind_ok(menu_file_list_cbs_t *cbs,
       const char *elem0, const char *elem1, const char *menu_label)
 {
    rarch_setting_t *setting = menu_setting_find(label);
+   const menu_cbs_label_ok_t *row = (const menu_cbs_label_ok_t*)
+      MENU_CBS_LABEL_FIND(menu_cbs_ok, label);
    menu_handle_t *menu    = menu_driver_resolve();
    if (!menu)
       return;
@@ -5400,84 +5725,12 @@ static void menu_entries_cbs_init_bind_ok(menu_file_list_cbs_t *cbs,
    else if (type >= MENU_SETTINGS_CHEAT_BEGIN
          && type <= MENU_SETTINGS_CHEAT_END)
       cbs->action_ok = action_ok_cheat;
-   else if (!strcmp(label, "savestate"))
-      cbs->action_ok = action_ok_save_state;
-   else if (!strcmp(label, "loadstate"))
-      cbs->action_ok = action_ok_load_state;
-   else if (!strcmp(label, "resume_content"))
-      cbs->action_ok = action_ok_resume_content;
-   else if (!strcmp(label, "restart_content"))
-      cbs->action_ok = action_ok_restart_content;
-   else if (!strcmp(label, "take_screenshot"))
-      cbs->action_ok = action_ok_screenshot;
-   else if (!strcmp(label, "file_load_or_resume"))
-      cbs->action_ok = action_ok_file_load_or_resume;
-   else if (!strcmp(label, "quit_retroarch"))
-      cbs->action_ok = action_ok_quit;
-   else if (!strcmp(label, "save_new_config"))
-      cbs->action_ok = action_ok_save_new_config;
-   else if (!strcmp(label, "help"))
-      cbs->action_ok = action_ok_help;
-   else if (!strcmp(label, "video_shader_pass"))
-      cbs->action_ok = action_ok_shader_pass;
-   else if (!strcmp(label, "video_shader_preset"))
-      cbs->action_ok = action_ok_shader_preset;
-   else if (!strcmp(label, "cheat_file_load"))
-      cbs->action_ok = action_ok_cheat_file;
-   else if (!strcmp(label, "audio_dsp_plugin"))
-      cbs->action_ok = action_ok_audio_dsp_plugin;
-   else if (!strcmp(label, "video_filter"))
-      cbs->action_ok = action_ok_video_filter;
-   else if (!strcmp(label, "remap_file_load"))
-      cbs->action_ok = action_ok_remap_file;
-   else if (!strcmp(label, "video_shader_parameters") ||
-         !strcmp(label, "video_shader_preset_parameters")
-         )
-      cbs->action_ok = action_ok_shader_parameters;
-   else if (
-         !strcmp(label, "shader_options") ||
-         !strcmp(label, "Input Settings") ||
-         !strcmp(label, "core_options") ||
-         !strcmp(label, "core_cheat_options") ||
-         !strcmp(label, "core_input_remapping_options") ||
-         !strcmp(label, "core_information") ||
-         !strcmp(label, "disk_options") ||
-         !strcmp(label, "settings") ||
-         !strcmp(label, "performance_counters") ||
-         !strcmp(label, "frontend_counters") ||
-         !strcmp(label, "core_counters") ||
-         !strcmp(label, "management") ||
-         !strcmp(label, "options")
-         )
-      cbs->action_ok = action_ok_push_default;
-   else if (
-         !strcmp(label, "load_content") ||
-         !strcmp(label, "detect_core_list")
-         )
-      cbs->action_ok = action_ok_push_content_list;
-   else if (!strcmp(label, "history_list") ||
-         !strcmp(label, "core_updater_list") ||
-         !strcmp(label, "cursor_manager_list") ||
-         !strcmp(label, "database_manager_list") ||
-         (setting && setting->browser_selection_type == ST_DIR)
-         )
+   else if (row && !(row->flags & MENU_CBS_LATE))
+      cbs->action_ok = row->action_ok;
+   else if (setting && setting->browser_selection_type == ST_DIR)
       cbs->action_ok = action_ok_push_generic_list;
-   else if (!strcmp(label, "shader_apply_changes"))
-      cbs->action_ok = action_ok_shader_apply_changes;
-   else if (!strcmp(label, "cheat_apply_changes"))
-      cbs->action_ok = action_ok_cheat_apply_changes;
-   else if (!strcmp(label, "video_shader_preset_save_as"))
-      cbs->action_ok = action_ok_shader_preset_save_as;
-   else if (!strcmp(label, "cheat_file_save_as"))
-      cbs->action_ok = action_ok_cheat_file_save_as;
-   else if (!strcmp(label, "remap_file_save_as"))
-      cbs->action_ok = action_ok_remap_file_save_as;
-   else if (!strcmp(label, "core_list"))
-      cbs->action_ok = action_ok_core_list;
-   else if (!strcmp(label, "disk_image_append"))
-      cbs->action_ok = action_ok_disk_image_append_list;
-   else if (!strcmp(label, "configurations"))
-      cbs->action_ok = action_ok_configurations_list;
+   else if (row)
+      cbs->action_ok = row->action_ok;
    else
    switch (type)
    {
@@ -5602,7 +5855,8 @@ static void menu_entries_cbs_init_bind_toggle(menu_file_list_cbs_t *cbs,
       const char *path, const char *label, unsigned type, size_t idx,
       const char *elem0, const char *elem1, const char *menu_label)
 {
-   int i;
+   unsigned user;
+   const menu_cbs_label_action_t *row = NULL;
 
    if (!cbs)
       return;
@@ -5670,30 +5924,22 @@ static void menu_entries_cbs_init_bind_toggle(menu_file_list_cbs_t *cbs,
    else if (type >= MENU_SETTINGS_INPUT_DESC_BEGIN
          && type <= MENU_SETTINGS_INPUT_DESC_END)
       cbs->action_toggle = action_toggle_input_desc;
-   else if (!strcmp(label, "savestate") ||
-         !strcmp(label, "loadstate"))
-      cbs->action_toggle = action_toggle_save_state;
-   else if (!strcmp(label, "video_shader_scale_pass"))
-      cbs->action_toggle = action_toggle_shader_scale_pass;
-   else if (!strcmp(label, "video_shader_filter_pass"))
-      cbs->action_toggle = action_toggle_shader_filter_pass;
-   else if (!strcmp(label, "video_shader_default_filter"))
-      cbs->action_toggle = action_toggle_shader_filter_default;
-   else if (!strcmp(label, "video_shader_num_passes"))
-      cbs->action_toggle = action_toggle_shader_num_passes;
-   else if (!strcmp(label, "cheat_num_passes"))
-      cbs->action_toggle = action_toggle_cheat_num_passes;
+   else if ((row = (const menu_cbs_label_action_t*)
+            MENU_CBS_LABEL_FIND(menu_cbs_toggle, label)))
+      cbs->action_toggle = row->action;
    else if (type == MENU_SETTINGS_VIDEO_RESOLUTION)
       cbs->action_toggle = action_toggle_video_resolution;
    else if ((type >= MENU_SETTINGS_CORE_OPTION_START))
       cbs->action_toggle = core_setting_toggle;
 
-   for (i = 0; i < MAX_USERS; i++)
+   /* input_player%u_joypad_index */
+   if (!strncmp(label, "input_player", 12))
    {
-      char label_setting[PATH_MAX_LENGTH];
-      snprintf(label_setting, sizeof(label_setting), "input_player%d_joypad_index", i + 1);
+      char *end = NULL;
 
-      if (!strcmp(label, label_setting))
+      user = strtoul(label + 12, &end, 10);
+      if (end != label + 12 && user >= 1 && user <= MAX_USERS
+            && !strcmp(end, "_joypad_index"))
          cbs->action_toggle = menu_setting_set;
    }
 }
@@ -5718,6 +5964,8 @@ static void menu_entries_cbs_init_bind_get_string_representation(menu_file_list_
       const char *path, const char *label, unsigned type, size_t idx,
       const char *elem0, const char *elem1)
 {
+   const menu_cbs_label_representation_t *row = NULL;
+
    if (!cbs)
       return;
 
@@ -5745,30 +5993,9 @@ static void menu_entries_cbs_init_bind_get_string_representation(menu_file_list_
          && type <= MENU_SETTINGS_SHADER_PARAMETER_LAST)
       cbs->action_get_representation = 
          menu_action_setting_disp_set_label_shader_parameter;
-   else if (!strcmp(label, "cheat_num_passes"))
-      cbs->action_get_representation = 
-         menu_action_setting_disp_set_label_cheat_num_passes;
-   else if (!strcmp(label, "remap_file_load"))
-      cbs->action_get_representation = 
-         menu_action_setting_disp_set_label_remap_file_load;
-   else if (!strcmp(label, "video_shader_filter_pass"))
-      cbs->action_get_representation =
-         menu_action_setting_disp_set_label_shader_filter_pass;
-   else if (!strcmp(label, "video_shader_scale_pass"))
-      cbs->action_get_representation =
-         menu_action_setting_disp_set_label_shader_scale_pass;
-   else if (!strcmp(label, "video_shader_num_passes"))
-      cbs->action_get_representation =
-         menu_action_setting_disp_set_label_shader_num_passes;
-   else if (!strcmp(label, "video_shader_pass"))
-      cbs->action_get_representation =
-         menu_action_setting_disp_set_label_shader_pass;
-   else if (!strcmp(label, "video_shader_default_filter"))
-      cbs->action_get_representation =
-         menu_action_setting_disp_set_label_shader_default_filter;
-   else if (!strcmp(label, "configurations"))
-      cbs->action_get_representation =
-         menu_action_setting_disp_set_label_configurations;
+   else if ((row = (const menu_cbs_label_representation_t*)
+            MENU_CBS_LABEL_FIND(menu_cbs_representation, label)))
+      cbs->action_get_representation = row->action_get_representation;
    else
    {
       switch (type)
@@ -5867,6 +6094,9 @@ static void menu_entries_cbs_init_bind_deferred_push(menu_file_list_cbs_t *cbs,
       const char *path, const char *label, unsigned type, size_t idx,
       const char *elem0, const char *elem1)
 {
+   const menu_cbs_label_deferred_push_t *row = (const menu_cbs_label_deferred_push_t*)
+      MENU_CBS_LABEL_FIND(menu_cbs_deferred_push, label);
+
    if (!cbs)
       return;
 
@@ -5886,106 +6116,62 @@ static void menu_entries_cbs_init_bind_deferred_push(menu_file_list_cbs_t *cbs,
 
    if (strstr(label, "deferred_rdb_entry_detail"))
       cbs->action_deferred_push = deferred_push_rdb_entry_detail;
-   else if (!strcmp(label, "core_updater_list"))
-      cbs->action_deferred_push = deferred_push_core_updater_list;
-   else if (!strcmp(label, "history_list"))
-      cbs->action_deferred_push = deferred_push_history_list;
-   else if (!strcmp(label, "database_manager_list"))
-      cbs->action_deferred_push = deferred_push_database_manager_list;
-   else if (!strcmp(label, "cursor_manager_list"))
-      cbs->action_deferred_push = deferred_push_cursor_manager_list;
-   else if (!strcmp(label, "cheat_file_load"))
-      cbs->action_deferred_push = deferred_push_cheat_file_load;
-   else if (!strcmp(label, "remap_file_load"))
-      cbs->action_deferred_push = deferred_push_remap_file_load;
-   else if (!strcmp(label, "content_actions"))
-      cbs->action_deferred_push = deferred_push_content_actions;
-   else if (!strcmp(label, "shader_options"))
-      cbs->action_deferred_push = deferred_push_shader_options;
-   else if (!strcmp(label, "options"))
-      cbs->action_deferred_push = deferred_push_options;
-   else if (!strcmp(label, "management"))
-      cbs->action_deferred_push = deferred_push_management_options;
+   else if (row && !(row->flags & MENU_CBS_LATE))
+      cbs->action_deferred_push = row->action_deferred_push;
    else if (type == MENU_SETTING_GROUP)
       cbs->action_deferred_push = deferred_push_category;
-   else if (!strcmp(label, "deferred_core_list"))
-      cbs->action_deferred_push = deferred_push_core_list_deferred;
-   else if (!strcmp(label, "deferred_database_manager_list"))
-      cbs->action_deferred_push = deferred_push_database_manager_list_deferred;
-   else if (!strcmp(label, "deferred_cursor_manager_list"))
-      cbs->action_deferred_push = deferred_push_cursor_manager_list_deferred;
-   else if (
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_publisher") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_developer") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_origin") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_franchise") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_enhancement_hw") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_esrb_rating") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_bbfc_rating") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_elspa_rating") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_pegi_rating") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_cero_rating") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_edge_magazine_rating") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_edge_magazine_issue") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_famitsu_magazine_rating") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_max_users") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_releasemonth") ||
-         !strcmp(label, "deferred_cursor_manager_list_rdb_entry_releaseyear")
-         )
-      cbs->action_deferred_push = deferred_push_cursor_manager_list_deferred_query_subsearch;
-   else if (!strcmp(label, "core_information"))
-      cbs->action_deferred_push = deferred_push_core_information;
-   else if (!strcmp(label, "performance_counters"))
-      cbs->action_deferred_push = deferred_push_performance_counters;
-   else if (!strcmp(label, "core_counters"))
-      cbs->action_deferred_push = deferred_push_core_counters;
-   else if (!strcmp(label, "video_shader_preset_parameters"))
-      cbs->action_deferred_push = deferred_push_video_shader_preset_parameters;
-   else if (!strcmp(label, "video_shader_parameters"))
-      cbs->action_deferred_push = deferred_push_video_shader_parameters;
-   else if (!strcmp(label, "settings"))
-      cbs->action_deferred_push = deferred_push_settings;
-   else if (!strcmp(label, "frontend_counters"))
-      cbs->action_deferred_push = deferred_push_frontend_counters;
-   else if (!strcmp(label, "core_options"))
-      cbs->action_deferred_push = deferred_push_core_options;
-   else if (!strcmp(label, "core_cheat_options"))
-      cbs->action_deferred_push = deferred_push_core_cheat_options;
-   else if (!strcmp(label, "core_input_remapping_options"))
-      cbs->action_deferred_push = deferred_push_core_input_remapping_options;
-   else if (!strcmp(label, "disk_options"))
-      cbs->action_deferred_push = deferred_push_disk_options;
-   else if (!strcmp(label, "core_list"))
-      cbs->action_deferred_push = deferred_push_core_list;
-   else if (!strcmp(label, "configurations"))
-      cbs->action_deferred_push = deferred_push_configurations;
-   else if (!strcmp(label, "video_shader_preset"))
-      cbs->action_deferred_push = deferred_push_video_shader_preset;
-   else if (!strcmp(label, "video_shader_pass"))
-      cbs->action_deferred_push = deferred_push_video_shader_pass;
-   else if (!strcmp(label, "video_filter"))
-      cbs->action_deferred_push = deferred_push_video_filter;
-   else if (!strcmp(label, "menu_wallpaper"))
-      cbs->action_deferred_push = deferred_push_images;
-   else if (!strcmp(label, "audio_dsp_plugin"))
-      cbs->action_deferred_push = deferred_push_audio_dsp_plugin;
-   else if (!strcmp(label, "input_overlay"))
-      cbs->action_deferred_push = deferred_push_input_overlay;
-   else if (!strcmp(label, "input_osk_overlay"))
-      cbs->action_deferred_push = deferred_push_input_osk_overlay;
-   else if (!strcmp(label, "video_font_path"))
-      cbs->action_deferred_push = deferred_push_video_font_path;
-   else if (!strcmp(label, "game_history_path"))
-      cbs->action_deferred_push = deferred_push_content_history_path;
-   else if (!strcmp(label, "detect_core_list"))
-      cbs->action_deferred_push = deferred_push_detect_core_list;
+   else if (row)
+      cbs->action_deferred_push = row->action_deferred_push;
+}
+
+/**
+ * menu_entries_cbs_split_label:
+ * @label              : Label, with elements separated by '|'.
+ * @elem0              : First element of @label.
+ * @elem0_size         : Size of @elem0.
+ * @elem1              : Second element of @label.
+ * @elem1_size         : Size of @elem1.
+ *
+ * Splits the first two non-empty elements off @label, like
+ * string_split() would, without allocating a string list.
+ **/
+static void menu_entries_cbs_split_label(const char *label,
+      char *elem0, size_t elem0_size, char *elem1, size_t elem1_size)
+{
+   unsigned i;
+   char *elems[2];
+   size_t sizes[2];
+
+   elems[0] = elem0;
+   elems[1] = elem1;
+   sizes[0] = elem0_size;
+   sizes[1] = elem1_size;
+
+   elem0[0] = '\0';
+   elem1[0] = '\0';
+
+   if (!label)
+      return;
+
+   for (i = 0; i < 2; i++)
+   {
+      size_t len;
+
+      while (*label == '|')
+         label++;
+      if (*label == '\0')
+         return;
+
+      len = strcspn(label, "|");
+      strlcpy(elems[i], label, len + 1 < sizes[i] ? len + 1 : sizes[i]);
+      label += len;
+   }
 }
 
 void menu_entries_cbs_init(void *data,
       const char *path, const char *label,
       unsigned type, size_t idx)
 {
-   struct string_list *str_list = NULL;
    char elem0[PATH_MAX_LENGTH], elem1[PATH_MAX_LENGTH];
    const char *menu_label = NULL;
    menu_file_list_cbs_t *cbs = NULL;
@@ -6003,21 +6189,8 @@ void menu_entries_cbs_init(void *data,
    menu_list_get_last_stack(menu->menu_list,
          NULL, &menu_label, NULL);
 
-   if (label)
-      str_list = string_split(label, "|");
-
-   if (str_list && str_list->size > 0)
-      strlcpy(elem0, str_list->elems[0].data, sizeof(elem0));
-   else elem0[0]='\0';
-   if (str_list && str_list->size > 1)
-      strlcpy(elem1, str_list->elems[1].data, sizeof(elem1));
-   else elem1[0]='\0';
-
-   if (str_list)
-   {
-      string_list_free(str_list);
-      str_list = NULL;
-   }
+   menu_entries_cbs_split_label(label, elem0, sizeof(elem0),
+         elem1, sizeof(elem1));
 
    menu_entries_cbs_init_bind_ok(cbs, path, label, type, idx, elem0, elem1, menu_label);
    menu_entries_cbs_init_bind_cancel(cbs, path, label, type, idx, elem0, elem1);
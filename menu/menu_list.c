@@ -447,3 +447,9 @@ int menu_list_populate_generic(file_list_t *list, const char *path,
 
    return 0;
 }
+
+void menu_list_refresh_scroll_indices(file_list_t *list)
+{
+   menu_entries_build_scroll_indices(list);
+   menu_entries_refresh(list);
+}
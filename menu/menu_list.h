@@ -97,6 +97,15 @@ void menu_list_set_alt_at_offset(file_list_t *list, size_t idx,
 int menu_list_populate_generic(file_list_t *list,
       const char *path, const char *label, unsigned type);
 
+/**
+ * menu_list_refresh_scroll_indices:
+ * @list                     : File list handle.
+ *
+ * Rebuilds the quick jumping indices of @list after entries
+ * were added to it, without repopulating the menu driver.
+ **/
+void menu_list_refresh_scroll_indices(file_list_t *list);
+
 #ifdef __cplusplus
 }
 #endif
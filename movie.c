@@ -22,30 +22,559 @@
 #include "general.h"
 #include "dynamic.h"
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(_WIN32) && !defined(_XBOX)
+#include <io.h>
+#elif !defined(RARCH_CONSOLE)
+#include <unistd.h>
+#endif
+
+/* Frames per block. Every block starts with a savestate,
+ * so seeking never has to replay more than this. */
+#define BSV2_KEYFRAME_INTERVAL 600
+
+/* Each block starts with this header, followed by the keyframe,
+ * the number of inputs of each frame (uint32) and the inputs. */
+#define BSV2_BLOCK_FIRST_INDEX 0
+#define BSV2_BLOCK_FRAMES_INDEX 1
+#define BSV2_BLOCK_STATE_INDEX 2
+#define BSV2_BLOCK_INPUTS_INDEX 3
+/* Deflated payload size, 0 if stored as is. */
+#define BSV2_BLOCK_PACKED_INDEX 4
+#define BSV2_BLOCK_HEADER_SIZE 5
+
+/* The index is a block count followed by the first frame and
+ * the 64-bit file offset of each block. */
+#define BSV2_INDEX_ENTRY_SIZE 3
+
+struct bsv_block
+{
+   uint32_t first_frame;
+   uint64_t offset;
+};
+
 struct bsv_movie
 {
    FILE *file;
 
-   /* A ring buffer keeping track of positions
-    * in the file for each frame. */
-   size_t *frame_pos;
-   size_t frame_mask;
-   size_t frame_ptr;
-
-   size_t min_file_pos;
-
+   /* The block being played back or recorded, fully in memory.
+    * frame_start[i] is the input where frame block_first + i
+    * starts, up to frame_start[block_frames]. */
+   uint32_t block_first;
+   uint32_t block_frames;
+   uint32_t *frame_start;
+   size_t frame_cap;
+   int16_t *inputs;
+   size_t input_count;
+   size_t input_cap;
+   size_t input_ptr;
+
+   /* Blocks in the file. While recording, only the flushed ones. */
+   struct bsv_block *blocks;
+   size_t block_count;
+   size_t block_cap;
+   size_t block_index;
+   uint64_t block_offset;
+
+   /* Scratch for packing and unpacking blocks. */
+   uint8_t *raw;
+   size_t raw_size;
+   uint8_t *packed;
+   size_t packed_size;
+
+   uint32_t frame;
+   uint32_t interval;
+   size_t header_size;
+
+   /* Keyframe of the current block. */
    size_t state_size;
    uint8_t *state;
 
    bool playback;
+   /* BSV1 movie, a single block whose frames are found while playing. */
+   bool legacy;
    bool first_rewind;
    bool did_rewind;
+
+   /* Re-recording of a BSV1 movie in BSV2 format. */
+   bsv_movie_t *upgrade;
 };
 
+static bool bsv_movie_reserve(void **ptr, size_t *cap,
+      size_t count, size_t elem_size)
+{
+   size_t new_cap;
+   void *tmp;
+
+   if (count <= *cap)
+      return true;
+
+   new_cap = *cap ? *cap : 64;
+   while (new_cap < count)
+      new_cap *= 2;
+
+   tmp = realloc(*ptr, new_cap * elem_size);
+   if (!tmp)
+      return false;
+
+   *ptr = tmp;
+   *cap = new_cap;
+   return true;
+}
+
+static bool bsv_movie_reserve_frames(bsv_movie_t *handle, size_t frames)
+{
+   return bsv_movie_reserve((void**)&handle->frame_start,
+         &handle->frame_cap, frames + 1, sizeof(uint32_t));
+}
+
+/**
+ * bsv_movie_begin_block:
+ * @handle            : movie handle.
+ *
+ * Starts recording a new block at the current frame, at the end of
+ * the blocks flushed so far, with the current state as keyframe.
+ **/
+static void bsv_movie_begin_block(bsv_movie_t *handle)
+{
+   handle->block_first    = handle->frame;
+   handle->block_frames   = 0;
+   handle->frame_start[0] = 0;
+   handle->input_count    = 0;
+   handle->input_ptr      = 0;
+   handle->block_index    = handle->block_count;
+
+   if (handle->state_size)
+      pretro_serialize(handle->state, handle->state_size);
+}
+
+/**
+ * bsv_movie_flush_block:
+ * @handle            : movie handle.
+ *
+ * Writes out the block being recorded and adds it to the index.
+ * The block is stored as the keyframe, the number of inputs of
+ * each frame and the inputs, deflated if possible.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool bsv_movie_flush_block(bsv_movie_t *handle)
+{
+   size_t i;
+   uint32_t header[BSV2_BLOCK_HEADER_SIZE];
+   const uint8_t *payload;
+   size_t payload_size;
+   uint8_t *ptr;
+   size_t raw_size = handle->state_size
+      + handle->block_frames * sizeof(uint32_t)
+      + handle->input_count * sizeof(int16_t);
+
+   if (!bsv_movie_reserve((void**)&handle->raw, &handle->raw_size,
+            raw_size, 1))
+      return false;
+
+   ptr = handle->raw;
+   memcpy(ptr, handle->state, handle->state_size);
+   ptr += handle->state_size;
+
+   for (i = 0; i < handle->block_frames; i++, ptr += sizeof(uint32_t))
+   {
+      uint32_t count = swap_if_big32(
+            handle->frame_start[i + 1] - handle->frame_start[i]);
+      memcpy(ptr, &count, sizeof(count));
+   }
+
+   for (i = 0; i < handle->input_count; i++, ptr += sizeof(int16_t))
+   {
+      int16_t input = swap_if_big16(handle->inputs[i]);
+      memcpy(ptr, &input, sizeof(input));
+   }
+
+   payload      = handle->raw;
+   payload_size = raw_size;
+   header[BSV2_BLOCK_PACKED_INDEX] = 0;
+
+#ifdef HAVE_ZLIB_DEFLATE
+   {
+      uLongf packed_size = compressBound(raw_size);
+
+      if (bsv_movie_reserve((void**)&handle->packed, &handle->packed_size,
+               packed_size, 1)
+            && compress2(handle->packed, &packed_size, handle->raw,
+               raw_size, Z_BEST_SPEED) == Z_OK
+            && packed_size < raw_size)
+      {
+         payload      = handle->packed;
+         payload_size = packed_size;
+         header[BSV2_BLOCK_PACKED_INDEX] = swap_if_big32(packed_size);
+      }
+   }
+#endif
+
+   header[BSV2_BLOCK_FIRST_INDEX]  = swap_if_big32(handle->block_first);
+   header[BSV2_BLOCK_FRAMES_INDEX] = swap_if_big32(handle->block_frames);
+   header[BSV2_BLOCK_STATE_INDEX]  = swap_if_big32(handle->state_size);
+   header[BSV2_BLOCK_INPUTS_INDEX] = swap_if_big32(handle->input_count);
+
+   if (!bsv_movie_reserve((void**)&handle->blocks, &handle->block_cap,
+            handle->block_count + 1, sizeof(struct bsv_block)))
+      return false;
+
+   if (fseek(handle->file, handle->block_offset, SEEK_SET) != 0
+         || fwrite(header, sizeof(header), 1, handle->file) != 1
+         || fwrite(payload, 1, payload_size, handle->file) != payload_size)
+   {
+      RARCH_ERR("Couldn't write movie block.\n");
+      return false;
+   }
+
+   handle->blocks[handle->block_count].first_frame = handle->block_first;
+   handle->blocks[handle->block_count].offset      = handle->block_offset;
+   handle->block_count++;
+   handle->block_offset += sizeof(header) + payload_size;
+   return true;
+}
+
+/**
+ * bsv_movie_read_block_header:
+ * @handle            : movie handle.
+ * @offset            : file offset of the block.
+ * @header            : read block header, in host byte order.
+ *
+ * Returns: true if a plausible block header was read.
+ **/
+static bool bsv_movie_read_block_header(bsv_movie_t *handle,
+      uint64_t offset, uint32_t *header)
+{
+   unsigned i;
+
+   if (fseek(handle->file, offset, SEEK_SET) != 0
+         || fread(header, sizeof(uint32_t), BSV2_BLOCK_HEADER_SIZE,
+            handle->file) != BSV2_BLOCK_HEADER_SIZE)
+      return false;
+
+   for (i = 0; i < BSV2_BLOCK_HEADER_SIZE; i++)
+      header[i] = swap_if_big32(header[i]);
+
+   return header[BSV2_BLOCK_FRAMES_INDEX] <= handle->interval;
+}
+
+/**
+ * bsv_movie_load_block:
+ * @handle            : movie handle.
+ * @index             : block to load.
+ *
+ * Reads and unpacks block @index, replacing the current block.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool bsv_movie_load_block(bsv_movie_t *handle, size_t index)
+{
+   size_t i, raw_size, state_size, frames, inputs, packed_size;
+   uint32_t header[BSV2_BLOCK_HEADER_SIZE];
+   const uint8_t *ptr;
+
+   if (!bsv_movie_read_block_header(handle,
+            handle->blocks[index].offset, header))
+      goto error;
+
+   frames      = header[BSV2_BLOCK_FRAMES_INDEX];
+   state_size  = header[BSV2_BLOCK_STATE_INDEX];
+   inputs      = header[BSV2_BLOCK_INPUTS_INDEX];
+   packed_size = header[BSV2_BLOCK_PACKED_INDEX];
+   raw_size    = state_size + frames * sizeof(uint32_t)
+      + inputs * sizeof(int16_t);
+
+   if (!bsv_movie_reserve((void**)&handle->raw, &handle->raw_size,
+            raw_size, 1)
+         || !bsv_movie_reserve_frames(handle, frames)
+         || !bsv_movie_reserve((void**)&handle->inputs, &handle->input_cap,
+            inputs, sizeof(int16_t)))
+      goto error;
+
+   if (packed_size)
+   {
+#ifdef HAVE_ZLIB
+      uLongf out_size = raw_size;
+
+      if (!bsv_movie_reserve((void**)&handle->packed,
+               &handle->packed_size, packed_size, 1)
+            || fread(handle->packed, 1, packed_size, handle->file)
+            != packed_size
+            || uncompress(handle->raw, &out_size, handle->packed,
+               packed_size) != Z_OK
+            || out_size != raw_size)
+         goto error;
+#else
+      RARCH_ERR("Movie block is compressed, but zlib support is not available.\n");
+      return false;
+#endif
+   }
+   else if (fread(handle->raw, 1, raw_size, handle->file) != raw_size)
+      goto error;
+
+   ptr = handle->raw;
+
+   if (state_size)
+   {
+      uint8_t *state = (uint8_t*)realloc(handle->state, state_size);
+      if (!state)
+         goto error;
+      handle->state = state;
+      memcpy(handle->state, ptr, state_size);
+      ptr += state_size;
+   }
+   handle->state_size = state_size;
+
+   handle->frame_start[0] = 0;
+   for (i = 0; i < frames; i++, ptr += sizeof(uint32_t))
+   {
+      uint32_t count;
+      memcpy(&count, ptr, sizeof(count));
+      handle->frame_start[i + 1] = handle->frame_start[i]
+         + swap_if_big32(count);
+   }
+
+   if (handle->frame_start[frames] != inputs)
+      goto error;
+
+   for (i = 0; i < inputs; i++, ptr += sizeof(int16_t))
+   {
+      int16_t input;
+      memcpy(&input, ptr, sizeof(input));
+      handle->inputs[i] = swap_if_big16(input);
+   }
+
+   handle->block_index  = index;
+   handle->block_first  = header[BSV2_BLOCK_FIRST_INDEX];
+   handle->block_frames = frames;
+   handle->block_offset = handle->blocks[index].offset;
+   handle->input_count  = inputs;
+   handle->input_ptr    = 0;
+   return true;
+
+error:
+   RARCH_ERR("Couldn't read movie block %u.\n", (unsigned)index);
+   return false;
+}
+
+/**
+ * bsv_movie_find_block:
+ * @handle            : movie handle.
+ * @frame             : frame number.
+ *
+ * Returns: index of the block containing @frame.
+ **/
+static size_t bsv_movie_find_block(bsv_movie_t *handle, uint32_t frame)
+{
+   size_t lo = 0, hi = handle->block_count;
+
+   while (hi - lo > 1)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      if (handle->blocks[mid].first_frame <= frame)
+         lo = mid;
+      else
+         hi = mid;
+   }
+
+   return lo;
+}
+
+/**
+ * bsv_movie_read_index:
+ * @handle            : movie handle.
+ * @index_offset      : offset of the index, 0 if there is none.
+ *
+ * Reads the block index at the end of the file. Movies that were
+ * not closed properly have no index, their blocks are found by
+ * walking the block headers instead.
+ *
+ * Returns: true if at least one block was found.
+ **/
+static bool bsv_movie_read_index(bsv_movie_t *handle, uint64_t index_offset)
+{
+   uint32_t count = 0;
+
+   if (index_offset && fseek(handle->file, index_offset, SEEK_SET) == 0
+         && fread(&count, sizeof(count), 1, handle->file) == 1)
+   {
+      size_t i;
+
+      count = swap_if_big32(count);
+      if (!bsv_movie_reserve((void**)&handle->blocks, &handle->block_cap,
+               count, sizeof(struct bsv_block)))
+         return false;
+
+      for (i = 0; i < count; i++)
+      {
+         uint32_t entry[BSV2_INDEX_ENTRY_SIZE];
+
+         if (fread(entry, sizeof(uint32_t), BSV2_INDEX_ENTRY_SIZE,
+                  handle->file) != BSV2_INDEX_ENTRY_SIZE)
+            break;
+
+         handle->blocks[i].first_frame = swap_if_big32(entry[0]);
+         handle->blocks[i].offset      = swap_if_big32(entry[1])
+            | (uint64_t)swap_if_big32(entry[2]) << 32;
+      }
+
+      handle->block_count = i;
+      if (handle->block_count == count)
+         return count > 0;
+
+      RARCH_WARN("Movie index is truncated, scanning blocks.\n");
+   }
+   else
+      RARCH_WARN("Movie has no index, it was not closed properly. Scanning blocks.\n");
+
+   handle->block_count = 0;
+
+   {
+      uint64_t offset = handle->header_size;
+      uint32_t header[BSV2_BLOCK_HEADER_SIZE];
+      uint32_t next_frame = 0;
+
+      while (bsv_movie_read_block_header(handle, offset, header)
+            && header[BSV2_BLOCK_FIRST_INDEX] == next_frame)
+      {
+         uint64_t size = header[BSV2_BLOCK_PACKED_INDEX];
+
+         if (!size)
+            size = header[BSV2_BLOCK_STATE_INDEX]
+               + (uint64_t)header[BSV2_BLOCK_FRAMES_INDEX] * sizeof(uint32_t)
+               + (uint64_t)header[BSV2_BLOCK_INPUTS_INDEX] * sizeof(int16_t);
+
+         if (!bsv_movie_reserve((void**)&handle->blocks,
+                  &handle->block_cap, handle->block_count + 1,
+                  sizeof(struct bsv_block)))
+            return false;
+
+         handle->blocks[handle->block_count].first_frame = next_frame;
+         handle->blocks[handle->block_count].offset      = offset;
+         handle->block_count++;
+
+         next_frame += header[BSV2_BLOCK_FRAMES_INDEX];
+         offset     += sizeof(header) + size;
+      }
+   }
+
+   /* The last block may have been cut off. */
+   while (handle->block_count
+         && !bsv_movie_load_block(handle, handle->block_count - 1))
+      handle->block_count--;
+
+   return handle->block_count > 0;
+}
+
+/**
+ * bsv_movie_write_header:
+ * @handle            : movie handle.
+ * @frames            : number of frames, 0 while recording.
+ * @index_offset      : offset of the block index, 0 while recording.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool bsv_movie_write_header(bsv_movie_t *handle, uint32_t frames,
+      uint64_t index_offset)
+{
+   uint32_t header[BSV2_HEADER_SIZE] = {0};
+
+   /* This value is supposed to show up as
+    * BSV2 in a HEX editor, big-endian. */
+   header[MAGIC_INDEX]           = swap_if_little32(BSV2_MAGIC);
+   header[CRC_INDEX]             = swap_if_big32(g_extern.content_crc);
+   header[STATE_SIZE_INDEX]      = swap_if_big32(handle->state_size);
+   header[BSV2_INTERVAL_INDEX]   = swap_if_big32(handle->interval);
+   header[BSV2_FRAMES_INDEX]     = swap_if_big32(frames);
+   header[BSV2_INDEX_LOW_INDEX]  = swap_if_big32((uint32_t)index_offset);
+   header[BSV2_INDEX_HIGH_INDEX] = swap_if_big32(
+         (uint32_t)(index_offset >> 32));
+
+   return fseek(handle->file, 0, SEEK_SET) == 0
+      && fwrite(header, sizeof(header), 1, handle->file) == 1;
+}
+
+/**
+ * bsv_movie_write_index:
+ * @handle            : movie handle.
+ *
+ * Flushes the block being recorded, then writes the block index
+ * after the last block and points the file header to it.
+ **/
+static void bsv_movie_write_index(bsv_movie_t *handle)
+{
+   size_t i;
+   uint32_t count;
+   uint64_t index_offset;
+
+   if (handle->block_frames || !handle->block_count)
+      bsv_movie_flush_block(handle);
+
+   index_offset = handle->block_offset;
+   count        = swap_if_big32(handle->block_count);
+
+   fseek(handle->file, index_offset, SEEK_SET);
+   fwrite(&count, sizeof(count), 1, handle->file);
+
+   for (i = 0; i < handle->block_count; i++)
+   {
+      uint32_t entry[BSV2_INDEX_ENTRY_SIZE];
+      entry[0] = swap_if_big32(handle->blocks[i].first_frame);
+      entry[1] = swap_if_big32((uint32_t)handle->blocks[i].offset);
+      entry[2] = swap_if_big32((uint32_t)(handle->blocks[i].offset >> 32));
+      fwrite(entry, sizeof(entry), 1, handle->file);
+   }
+
+   bsv_movie_write_header(handle,
+         handle->block_first + handle->block_frames, index_offset);
+}
+
+static bool init_playback_bsv1(bsv_movie_t *handle)
+{
+   long pos = ftell(handle->file);
+   long end;
+
+   /* Inputs are not split into frames, so the whole stream is kept
+    * as one block and frames are indexed as they are played. */
+   handle->legacy = true;
+
+   if (pos < 0 || fseek(handle->file, 0, SEEK_END) != 0
+         || (end = ftell(handle->file)) < pos
+         || fseek(handle->file, pos, SEEK_SET) != 0)
+      return false;
+
+   handle->input_count = (end - pos) / sizeof(int16_t);
+
+   if (!bsv_movie_reserve((void**)&handle->inputs, &handle->input_cap,
+            handle->input_count, sizeof(int16_t))
+         || fread(handle->inputs, sizeof(int16_t), handle->input_count,
+            handle->file) != handle->input_count)
+   {
+      RARCH_ERR("Couldn't read movie inputs.\n");
+      return false;
+   }
+
+   if (!is_little_endian())
+   {
+      size_t i;
+      for (i = 0; i < handle->input_count; i++)
+         handle->inputs[i] = swap_if_big16(handle->inputs[i]);
+   }
+
+   fclose(handle->file);
+   handle->file = NULL;
+   return true;
+}
+
 static bool init_playback(bsv_movie_t *handle, const char *path)
 {
    uint32_t state_size;
-   uint32_t header[4] = {0};
+   uint32_t header[BSV2_HEADER_SIZE] = {0};
+   bool bsv2;
 
    handle->playback = true;
    handle->file = fopen(path, "rb");
@@ -61,12 +590,14 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
       return false;
    }
 
+   bsv2 = swap_if_little32(header[MAGIC_INDEX]) == BSV2_MAGIC;
+
    /* Compatibility with old implementation that
     * used incorrect documentation. */
-   if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
+   if (!bsv2 && swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
          && swap_if_big32(header[MAGIC_INDEX]) != BSV_MAGIC)
    {
-      RARCH_ERR("Movie file is not a valid BSV1 file.\n");
+      RARCH_ERR("Movie file is not a valid BSV1 or BSV2 file.\n");
       return false;
    }
 
@@ -75,67 +606,92 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
 
    state_size = swap_if_big32(header[STATE_SIZE_INDEX]);
 
-   if (state_size)
+   if (bsv2)
    {
-      handle->state = (uint8_t*)malloc(state_size);
-      handle->state_size = state_size;
-      if (!handle->state)
+      uint64_t index_offset;
+
+      if (fread(header + 4, sizeof(uint32_t), BSV2_HEADER_SIZE - 4,
+               handle->file) != BSV2_HEADER_SIZE - 4)
+      {
+         RARCH_ERR("Couldn't read movie header.\n");
          return false;
+      }
 
-      if (fread(handle->state, 1, state_size, handle->file) != state_size)
+      handle->header_size = sizeof(header);
+      handle->interval    = swap_if_big32(header[BSV2_INTERVAL_INDEX]);
+      index_offset = swap_if_big32(header[BSV2_INDEX_LOW_INDEX])
+         | (uint64_t)swap_if_big32(header[BSV2_INDEX_HIGH_INDEX]) << 32;
+
+      if (!bsv_movie_read_index(handle, index_offset)
+            || !bsv_movie_load_block(handle, 0))
       {
-         RARCH_ERR("Couldn't read state from movie.\n");
+         RARCH_ERR("Couldn't read movie blocks.\n");
          return false;
       }
+   }
+   else
+   {
+      handle->header_size = 4 * sizeof(uint32_t);
 
-      if (pretro_serialize_size() == state_size)
-         pretro_unserialize(handle->state, state_size);
+      if (state_size)
+      {
+         handle->state = (uint8_t*)malloc(state_size);
+         handle->state_size = state_size;
+         if (!handle->state)
+            return false;
+
+         if (fread(handle->state, 1, state_size, handle->file) != state_size)
+         {
+            RARCH_ERR("Couldn't read state from movie.\n");
+            return false;
+         }
+      }
+
+      if (!init_playback_bsv1(handle))
+         return false;
+   }
+
+   if (handle->state_size)
+   {
+      if (pretro_serialize_size() == handle->state_size)
+         pretro_unserialize(handle->state, handle->state_size);
       else
          RARCH_WARN("Movie format seems to have a different serializer version. Will most likely fail.\n");
    }
 
-   handle->min_file_pos = sizeof(header) + state_size;
-
    return true;
 }
 
 static bool init_record(bsv_movie_t *handle, const char *path)
 {
-   uint32_t state_size;
-   uint32_t header[4] = {0};
-
-   handle->file = fopen(path, "wb");
+   /* Rewinding reads flushed blocks back. */
+   handle->file = fopen(path, "w+b");
    if (!handle->file)
    {
       RARCH_ERR("Couldn't open BSV \"%s\" for recording.\n", path);
       return false;
    }
 
+   handle->interval     = BSV2_KEYFRAME_INTERVAL;
+   handle->state_size   = pretro_serialize_size();
+   handle->header_size  = BSV2_HEADER_SIZE * sizeof(uint32_t);
+   handle->block_offset = handle->header_size;
 
-   /* This value is supposed to show up as
-    * BSV1 in a HEX editor, big-endian. */
-   header[MAGIC_INDEX] = swap_if_little32(BSV_MAGIC);
-
-   header[CRC_INDEX] = swap_if_big32(g_extern.content_crc);
-
-   state_size = pretro_serialize_size();
-
-   header[STATE_SIZE_INDEX] = swap_if_big32(state_size);
-   fwrite(header, 4, sizeof(uint32_t), handle->file);
-
-   handle->min_file_pos = sizeof(header) + state_size;
-   handle->state_size = state_size;
+   /* Frame count and index are filled in on close. */
+   if (!bsv_movie_write_header(handle, 0, 0))
+      return false;
 
-   if (state_size)
+   if (handle->state_size)
    {
-      handle->state = (uint8_t*)malloc(state_size);
+      handle->state = (uint8_t*)malloc(handle->state_size);
       if (!handle->state)
          return false;
-
-      pretro_serialize(handle->state, state_size);
-      fwrite(handle->state, 1, state_size, handle->file);
    }
 
+   if (!bsv_movie_reserve_frames(handle, handle->interval))
+      return false;
+
+   bsv_movie_begin_block(handle);
    return true;
 }
 
@@ -144,26 +700,43 @@ void bsv_movie_free(bsv_movie_t *handle)
    if (!handle)
       return;
 
+   /* Only once recording has started. */
+   if (handle->file && !handle->playback && handle->frame_start)
+      bsv_movie_write_index(handle);
+
+   bsv_movie_free(handle->upgrade);
+
    if (handle->file)
       fclose(handle->file);
    free(handle->state);
-   free(handle->frame_pos);
+   free(handle->frame_start);
+   free(handle->inputs);
+   free(handle->blocks);
+   free(handle->raw);
+   free(handle->packed);
    free(handle);
 }
 
 bool bsv_movie_get_input(bsv_movie_t *handle, int16_t *input)
 {
-   if (fread(input, sizeof(int16_t), 1, handle->file) != 1)
+   if (handle->input_ptr >= handle->input_count)
       return false;
 
-   *input = swap_if_big16(*input);
+   *input = handle->inputs[handle->input_ptr++];
+
+   if (handle->upgrade)
+      bsv_movie_set_input(handle->upgrade, *input);
    return true;
 }
 
 void bsv_movie_set_input(bsv_movie_t *handle, int16_t input)
 {
-   input = swap_if_big16(input);
-   fwrite(&input, sizeof(int16_t), 1, handle->file);
+   if (!bsv_movie_reserve((void**)&handle->inputs, &handle->input_cap,
+            handle->input_ptr + 1, sizeof(int16_t)))
+      return;
+
+   handle->inputs[handle->input_ptr++] = input;
+   handle->input_count = handle->input_ptr;
 }
 
 bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
@@ -180,13 +753,9 @@ bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
    else if (!init_record(handle, path))
       goto error;
 
-   /* Just pick something really large 
-    * ~1 million frames rewind should do the trick. */
-   if (!(handle->frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
-      goto error; 
-
-   handle->frame_pos[0] = handle->min_file_pos;
-   handle->frame_mask = (1 << 20) - 1;
+   if (!bsv_movie_reserve_frames(handle, 0))
+      goto error;
+   handle->frame_start[0] = 0;
 
    return handle;
 
@@ -195,61 +764,180 @@ error:
    return NULL;
 }
 
+bool bsv_movie_upgrade(bsv_movie_t *handle, const char *path)
+{
+   if (!handle->playback || handle->upgrade)
+      return false;
+
+   handle->upgrade = bsv_movie_init(path, RARCH_MOVIE_RECORD);
+   return handle->upgrade != NULL;
+}
+
 void bsv_movie_set_frame_start(bsv_movie_t *handle)
 {
    if (!handle)
       return;
-   handle->frame_pos[handle->frame_ptr] = ftell(handle->file);
+
+   bsv_movie_set_frame_start(handle->upgrade);
+
+   if (handle->frame < handle->block_first + handle->block_frames)
+      return;
+
+   if (handle->playback)
+   {
+      /* Moving on to the next block. Its keyframe is not needed,
+       * the state is already there. */
+      if (!handle->legacy && handle->block_index + 1 < handle->block_count)
+         bsv_movie_load_block(handle, handle->block_index + 1);
+   }
+   else if (handle->block_frames >= handle->interval)
+   {
+      bsv_movie_flush_block(handle);
+      bsv_movie_begin_block(handle);
+   }
 }
 
 void bsv_movie_set_frame_end(bsv_movie_t *handle)
 {
+   uint32_t frame;
+
    if (!handle)
       return;
 
-   handle->frame_ptr = (handle->frame_ptr + 1) & handle->frame_mask;
+   bsv_movie_set_frame_end(handle->upgrade);
+
+   handle->frame++;
+   frame = handle->frame - handle->block_first;
+
+   /* Recording, or finding the frames of a BSV1 movie. */
+   if ((!handle->playback || handle->legacy) && frame > handle->block_frames
+         && bsv_movie_reserve_frames(handle, frame))
+   {
+      handle->frame_start[frame] = handle->input_ptr;
+      handle->block_frames       = frame;
+   }
 
    handle->first_rewind = !handle->did_rewind;
    handle->did_rewind = false;
 }
 
-void bsv_movie_frame_rewind(bsv_movie_t *handle)
+/**
+ * bsv_movie_truncate:
+ * @handle            : movie handle.
+ * @size              : new size of the movie file.
+ *
+ * Cuts the movie file off at @size. Platforms without a way to
+ * truncate a file keep the old data after it, which the block
+ * index written on close makes unreachable.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool bsv_movie_truncate(bsv_movie_t *handle, uint64_t size)
 {
-   handle->did_rewind = true;
+   if (fflush(handle->file) != 0)
+      return false;
 
-   if ((handle->frame_ptr <= 1) && (handle->frame_pos[0] == handle->min_file_pos))
-   {
-      /* If we're at the beginning... */
-      handle->frame_ptr = 0;
-      fseek(handle->file, handle->min_file_pos, SEEK_SET);
-   }
-   else
+#if defined(_WIN32) && !defined(_XBOX)
+   return _chsize_s(_fileno(handle->file), (__int64)size) == 0;
+#elif !defined(RARCH_CONSOLE)
+   return ftruncate(fileno(handle->file), (off_t)size) == 0;
+#else
+   (void)size;
+   return true;
+#endif
+}
+
+/**
+ * bsv_movie_enter_block:
+ * @handle            : movie handle.
+ * @frame             : frame number.
+ *
+ * Makes the block holding @frame current. When recording, that block
+ * is read back and everything after it is dropped from the file,
+ * to be recorded again.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool bsv_movie_enter_block(bsv_movie_t *handle, uint32_t frame)
+{
+   size_t index;
+
+   if (frame >= handle->block_first || handle->legacy)
+      return true;
+
+   index = bsv_movie_find_block(handle, frame);
+   if (!bsv_movie_load_block(handle, index))
+      return false;
+
+   if (!handle->playback)
    {
-      /* First time rewind is performed, the old frame is simply replayed.
-       * However, playing back that frame caused us to read data, and push
-       * data to the ring buffer.
-       *
-       * Sucessively rewinding frames, we need to rewind past the read data,
-       * plus another. */
-      handle->frame_ptr = (handle->frame_ptr -
-            (handle->first_rewind ? 1 : 2)) & handle->frame_mask;
-      fseek(handle->file, handle->frame_pos[handle->frame_ptr], SEEK_SET);
+      /* The rewound part is recorded again. */
+      handle->block_count = index;
+
+      if (!bsv_movie_truncate(handle, handle->block_offset))
+         RARCH_WARN("Couldn't truncate movie after rewind.\n");
+
+      if (!bsv_movie_reserve_frames(handle, handle->interval))
+         return false;
    }
 
-   if (ftell(handle->file) <= (long)handle->min_file_pos)
+   return true;
+}
+
+void bsv_movie_frame_rewind(bsv_movie_t *handle)
+{
+   /* First time rewind is performed, the old frame is simply replayed.
+    * However, playing back that frame caused us to read data, and
+    * advance the frame.
+    *
+    * Sucessively rewinding frames, we need to rewind past the read data,
+    * plus another. */
+   uint32_t frames = handle->first_rewind ? 1 : 2;
+   uint32_t frame  = handle->frame > frames ? handle->frame - frames : 0;
+
+   handle->did_rewind = true;
+
+   if (handle->upgrade)
+      bsv_movie_frame_rewind(handle->upgrade);
+
+   if (!bsv_movie_enter_block(handle, frame))
+      frame = handle->block_first;
+
+   handle->frame     = frame;
+   handle->input_ptr = handle->frame_start[frame - handle->block_first];
+
+   if (!handle->playback)
    {
-      /* We rewound past the beginning. */
+      handle->input_count  = handle->input_ptr;
+      handle->block_frames = frame - handle->block_first;
 
-      if (!handle->playback)
-      {
-         /* If recording, we simply reset
-          * the starting point. Nice and easy. */
-         fseek(handle->file, 4 * sizeof(uint32_t), SEEK_SET);
+      /* We rewound past the beginning. If recording, we
+       * simply reset the starting point. Nice and easy. */
+      if (!frame && handle->state_size)
          pretro_serialize(handle->state, handle->state_size);
-         fwrite(handle->state, 1, handle->state_size, handle->file);
-      }
-      else
-         fseek(handle->file, handle->min_file_pos, SEEK_SET);
    }
 }
 
+uint32_t bsv_movie_seek(bsv_movie_t *handle, uint32_t frame)
+{
+   if (!handle->playback)
+      return handle->frame;
+
+   /* BSV1 movies only have the starting state. */
+   if (!handle->legacy)
+   {
+      size_t index = bsv_movie_find_block(handle, frame);
+
+      if (index != handle->block_index
+            && !bsv_movie_load_block(handle, index))
+         return handle->frame;
+   }
+
+   if (handle->state_size && pretro_serialize_size() == handle->state_size)
+      pretro_unserialize(handle->state, handle->state_size);
+
+   handle->frame      = handle->block_first;
+   handle->input_ptr  = handle->frame_start[0];
+   handle->did_rewind = false;
+   return handle->frame;
+}
@@ -26,12 +26,21 @@ extern "C" {
 #include <boolean.h>
 
 #define BSV_MAGIC 0x42535631
+#define BSV2_MAGIC 0x42535632
 
 #define MAGIC_INDEX 0
 #define SERIALIZER_INDEX 1
 #define CRC_INDEX 2
 #define STATE_SIZE_INDEX 3
 
+/* BSV2 header. Inputs are stored in blocks starting with a
+ * savestate, so playback can start from any block. */
+#define BSV2_INTERVAL_INDEX 4
+#define BSV2_FRAMES_INDEX 5
+#define BSV2_INDEX_LOW_INDEX 6
+#define BSV2_INDEX_HIGH_INDEX 7
+#define BSV2_HEADER_SIZE 8
+
 typedef struct bsv_movie bsv_movie_t;
 
 enum rarch_movie_type
@@ -55,6 +64,31 @@ void bsv_movie_set_frame_end(bsv_movie_t *handle);
 
 void bsv_movie_frame_rewind(bsv_movie_t *handle);
 
+/**
+ * bsv_movie_seek:
+ * @handle            : movie handle.
+ * @frame             : frame to seek to.
+ *
+ * Loads the keyframe at or before @frame during playback. The frames
+ * up to @frame are at most a keyframe interval away. BSV1 movies
+ * only have a keyframe at frame 0.
+ *
+ * Returns: frame playback continues from.
+ **/
+uint32_t bsv_movie_seek(bsv_movie_t *handle, uint32_t frame);
+
+/**
+ * bsv_movie_upgrade:
+ * @handle            : movie handle, opened for playback.
+ * @path              : path of BSV2 movie to write.
+ *
+ * Records the movie being played back to @path, which upgrades
+ * BSV1 movies to BSV2 with keyframes taken during playback.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool bsv_movie_upgrade(bsv_movie_t *handle, const char *path);
+
 void bsv_movie_free(bsv_movie_t *handle);
 
 #ifdef __cplusplus
@@ -21,6 +21,7 @@
 #include "hash.h"
 #include <boolean.h>
 #include <compat/msvc.h>
+#include <retro_miscellaneous.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -38,39 +39,91 @@ struct bps_data
    uint8_t *target_data;
    size_t modify_length, source_length, target_length;
    size_t modify_offset, source_offset, target_offset;
-   uint32_t modify_checksum, source_checksum, target_checksum;
 
-   size_t source_relative_offset, target_relative_offset, output_offset;
+   size_t output_offset;
 };
 
-static uint8_t bps_read(struct bps_data *bps)
+static uint32_t patch_read_le32(const uint8_t *data)
 {
-   uint8_t data = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = crc32_adjust(bps->modify_checksum, data);
-   return data;
+   return data[0] | (data[1] << 8) | (data[2] << 16)
+      | ((uint32_t)data[3] << 24);
 }
 
+/* Returns UINT64_MAX if the number runs past the end of the patch. */
 static uint64_t bps_decode(struct bps_data *bps)
 {
    uint64_t data = 0, shift = 1;
 
-   for (;;)
+   while (bps->modify_offset < bps->modify_length)
    {
-      uint8_t x = bps_read(bps);
+      uint8_t x = bps->modify_data[bps->modify_offset++];
       data += (x & 0x7f) * shift;
       if (x & 0x80)
-         break;
+         return data;
       shift <<= 7;
       data += shift;
    }
 
-   return data;
+   return UINT64_MAX;
+}
+
+/**
+ * bps_decode_header:
+ * @bps                 : BPS state, patch fields set.
+ * @source_size         : Source size from the patch header.
+ * @target_size         : Target size from the patch header.
+ *
+ * Checks the magic and reads the header, leaving @bps at the first
+ * command.
+ **/
+static patch_error_t bps_decode_header(struct bps_data *bps,
+      uint64_t *source_size, uint64_t *target_size)
+{
+   uint64_t markup_size;
+   const uint8_t *data = bps->modify_data;
+
+   if (bps->modify_length < 19)
+      return PATCH_PATCH_TOO_SMALL;
+
+   if (data[0] != 'B' || data[1] != 'P' || data[2] != 'S' || data[3] != '1')
+      return PATCH_PATCH_INVALID_HEADER;
+
+   bps->modify_offset = 4;
+   *source_size       = bps_decode(bps);
+   *target_size       = bps_decode(bps);
+   markup_size        = bps_decode(bps);
+
+   if (bps->modify_offset > bps->modify_length - 12)
+      return PATCH_PATCH_INVALID;
+   if (markup_size > bps->modify_length - 12 - bps->modify_offset)
+      return PATCH_PATCH_INVALID;
+
+   bps->modify_offset += markup_size;
+   return PATCH_SUCCESS;
 }
 
-static void bps_write(struct bps_data *bps, uint8_t data)
+patch_error_t bps_get_target_size(
+      const uint8_t *modify_data, size_t modify_length,
+      size_t source_length, size_t *target_length)
 {
-   bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = crc32_adjust(bps->target_checksum, data);
+   patch_error_t err;
+   uint64_t source_size, target_size;
+   struct bps_data bps = {0};
+
+   bps.modify_data   = modify_data;
+   bps.modify_length = modify_length;
+
+   err = bps_decode_header(&bps, &source_size, &target_size);
+   if (err != PATCH_SUCCESS)
+      return err;
+
+   if (source_size > source_length)
+      return PATCH_SOURCE_TOO_SMALL;
+   if (target_size > SIZE_MAX)
+      return PATCH_PATCH_INVALID;
+
+   *target_length = target_size;
+   return PATCH_SUCCESS;
 }
 
 patch_error_t bps_apply_patch(
@@ -78,105 +131,138 @@ patch_error_t bps_apply_patch(
       const uint8_t *source_data, size_t source_length,
       uint8_t *target_data, size_t *target_length)
 {
-   size_t i;
-   size_t modify_source_size, modify_target_size,
-          modify_markup_size;
+   patch_error_t err;
+   uint64_t modify_source_size, modify_target_size;
+   uint32_t modify_source_checksum, modify_target_checksum,
+            modify_modify_checksum;
    struct bps_data bps = {0};
-   uint32_t modify_source_checksum = 0, modify_target_checksum = 0,
-            modify_modify_checksum = 0, checksum;
-
-   if (modify_length < 19)
-      return PATCH_PATCH_TOO_SMALL;
 
-   bps.modify_data = modify_data;
+   bps.modify_data   = modify_data;
    bps.modify_length = modify_length;
-   bps.target_data = target_data;
+   bps.target_data   = target_data;
    bps.target_length = *target_length;
-   bps.source_data = source_data;
+   bps.source_data   = source_data;
    bps.source_length = source_length;
-   bps.modify_checksum = ~0;
-   bps.target_checksum = ~0;
-
-   if ((bps_read(&bps) != 'B') || (bps_read(&bps) != 'P') ||
-         (bps_read(&bps) != 'S') || (bps_read(&bps) != '1'))
-      return PATCH_PATCH_INVALID_HEADER;
 
-   modify_source_size = bps_decode(&bps);
-   modify_target_size = bps_decode(&bps);
-   modify_markup_size = bps_decode(&bps);
-   for (i = 0; i < modify_markup_size; i++)
-      bps_read(&bps);
+   err = bps_decode_header(&bps, &modify_source_size, &modify_target_size);
+   if (err != PATCH_SUCCESS)
+      return err;
 
    if (modify_source_size > bps.source_length)
       return PATCH_SOURCE_TOO_SMALL;
    if (modify_target_size > bps.target_length)
       return PATCH_TARGET_TOO_SMALL;
 
-   while (bps.modify_offset < bps.modify_length - 12)
+   modify_source_checksum = patch_read_le32(modify_data + modify_length - 12);
+   modify_target_checksum = patch_read_le32(modify_data + modify_length - 8);
+   modify_modify_checksum = patch_read_le32(modify_data + modify_length - 4);
+
+   /* Checksum the inputs up front, before decoding anything. */
+   if (crc32_calculate(bps.source_data, bps.source_length)
+         != modify_source_checksum)
+      return PATCH_SOURCE_CHECKSUM_INVALID;
+   if (crc32_calculate(modify_data, modify_length - 4)
+         != modify_modify_checksum)
+      return PATCH_PATCH_CHECKSUM_INVALID;
+
+   /* Only the commands, not the checksums. */
+   bps.modify_length -= 12;
+   bps.target_length  = modify_target_size;
+
+   while (bps.modify_offset < bps.modify_length)
    {
-      size_t length = bps_decode(&bps);
-      unsigned mode = length & 3;
+      uint64_t length = bps_decode(&bps);
+      unsigned mode   = length & 3;
 
       length = (length >> 2) + 1;
 
+      if (length > bps.target_length - bps.output_offset)
+         return PATCH_TARGET_INVALID;
+
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-               bps_write(&bps, bps.source_data[bps.output_offset]);
+            if (bps.output_offset + length > bps.source_length)
+               return PATCH_SOURCE_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.source_data + bps.output_offset, length);
             break;
 
          case TARGET_READ:
-            while (length--)
-               bps_write(&bps, bps_read(&bps));
+            if (length > bps.modify_length - bps.modify_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.modify_data + bps.modify_offset, length);
+            bps.modify_offset += length;
             break;
 
          case SOURCE_COPY:
          case TARGET_COPY:
          {
-            int offset = bps_decode(&bps);
-            bool negative = offset & 1;
+            uint64_t offset = bps_decode(&bps);
+            bool negative   = offset & 1;
+
             offset >>= 1;
-            if (negative)
-               offset = -offset;
 
             if (mode == SOURCE_COPY)
             {
-               bps.source_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.source_data[bps.source_offset++]);
+               if (negative ? offset > bps.source_offset
+                     : offset > bps.source_length - bps.source_offset)
+                  return PATCH_SOURCE_INVALID;
+
+               bps.source_offset = negative ? bps.source_offset - offset
+                  : bps.source_offset + offset;
+
+               if (length > bps.source_length - bps.source_offset)
+                  return PATCH_SOURCE_INVALID;
+
+               memcpy(bps.target_data + bps.output_offset,
+                     bps.source_data + bps.source_offset, length);
+               bps.source_offset += length;
             }
             else
             {
-               bps.target_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.target_data[bps.target_offset++]);
-               break;
+               uint8_t *dst       = bps.target_data + bps.output_offset;
+               const uint8_t *src;
+
+               if (negative ? offset > bps.target_offset
+                     : offset > bps.output_offset - bps.target_offset)
+                  return PATCH_TARGET_INVALID;
+
+               bps.target_offset = negative ? bps.target_offset - offset
+                  : bps.target_offset + offset;
+
+               /* Can only copy from what has been written already. */
+               if (bps.target_offset >= bps.output_offset)
+                  return PATCH_TARGET_INVALID;
+               src = bps.target_data + bps.target_offset;
+
+               /* Overlapping copies repeat the bytes in between,
+                * this is how BPS encodes runs. */
+               if (length <= bps.output_offset - bps.target_offset)
+                  memcpy(dst, src, length);
+               else
+               {
+                  size_t i;
+                  for (i = 0; i < length; i++)
+                     dst[i] = src[i];
+               }
+
+               bps.target_offset += length;
             }
             break;
          }
       }
-   }
 
+      bps.output_offset += length;
+   }
 
-   for (i = 0; i < 32; i += 8)
-      modify_source_checksum |= bps_read(&bps) << i;
-   for (i = 0; i < 32; i += 8)
-      modify_target_checksum |= bps_read(&bps) << i;
-
-   checksum = ~bps.modify_checksum;
-   for (i = 0; i < 32; i += 8)
-      modify_modify_checksum |= bps_read(&bps) << i;
-
-   bps.source_checksum = crc32_calculate(bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
+   if (bps.output_offset != bps.target_length)
+      return PATCH_TARGET_INVALID;
 
-   if (bps.source_checksum != modify_source_checksum)
-      return PATCH_SOURCE_CHECKSUM_INVALID;
-   if (bps.target_checksum != modify_target_checksum)
+   if (crc32_calculate(bps.target_data, bps.target_length)
+         != modify_target_checksum)
       return PATCH_TARGET_CHECKSUM_INVALID;
-   if (checksum != modify_modify_checksum)
-      return PATCH_PATCH_CHECKSUM_INVALID;
 
    *target_length = modify_target_size;
 
@@ -187,57 +273,126 @@ struct ups_data
 {
    const uint8_t *patch_data, *source_data; 
    uint8_t *target_data;
-   unsigned patch_length, source_length, target_length;
-   unsigned patch_offset, source_offset, target_offset;
-   unsigned patch_checksum, source_checksum, target_checksum;
+   size_t patch_length, source_length, target_length;
+   size_t patch_offset, source_offset, target_offset;
 };
 
 static uint8_t ups_patch_read(struct ups_data *data) 
 {
    if (data->patch_offset < data->patch_length) 
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum = crc32_adjust(data->patch_checksum, n);
-      return n;
-   }
+      return data->patch_data[data->patch_offset++];
    return 0x00;
 }
 
 static uint8_t ups_source_read(struct ups_data *data) 
 {
    if (data->source_offset < data->source_length) 
-   {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum = crc32_adjust(data->source_checksum, n);
-      return n;
-   }
+      return data->source_data[data->source_offset++];
    return 0x00;
 }
 
 static void ups_target_write(struct ups_data *data, uint8_t n) 
 {
    if (data->target_offset < data->target_length) 
-   {
       data->target_data[data->target_offset] = n;
-      data->target_checksum = crc32_adjust(data->target_checksum, n);
-   }
 
    data->target_offset++;
 }
 
+/**
+ * ups_copy:
+ * @data                : UPS state.
+ * @length              : Number of bytes.
+ *
+ * Same as @length calls to ups_target_write(ups_source_read()).
+ **/
+static void ups_copy(struct ups_data *data, uint64_t length)
+{
+   size_t n, src = 0, dst = 0;
+
+   if (data->source_offset < data->source_length)
+      src = min(length, data->source_length - data->source_offset);
+   if (data->target_offset < data->target_length)
+      dst = min(length, data->target_length - data->target_offset);
+
+   n = min(src, dst);
+   memcpy(data->target_data + data->target_offset,
+         data->source_data + data->source_offset, n);
+   memset(data->target_data + data->target_offset + n, 0, dst - n);
+
+   data->source_offset += src;
+
+   /* Anything past the end of the target is dropped. */
+   if (dst < length)
+      data->target_offset = max(data->target_offset, data->target_length);
+   else
+      data->target_offset += dst;
+}
+
 static uint64_t ups_decode(struct ups_data *data) 
 {
    uint64_t offset = 0, shift = 1;
-   while (true) 
+   while (data->patch_offset < data->patch_length) 
    {
       uint8_t x = ups_patch_read(data);
       offset += (x & 0x7f) * shift;
       if (x & 0x80) 
-         break;
+         return offset;
       shift <<= 7;
       offset += shift;
    }
-   return offset;
+   return UINT64_MAX;
+}
+
+/**
+ * ups_decode_header:
+ * @data                : UPS state, patch and source fields set.
+ * @source_size         : Source size from the patch header.
+ * @target_size         : Target size from the patch header.
+ *
+ * UPS patches apply both ways, so the sizes are swapped if the
+ * source matches the target size of the patch.
+ **/
+static patch_error_t ups_decode_header(struct ups_data *data,
+      uint64_t *source_size, uint64_t *target_size)
+{
+   const uint8_t *patch = data->patch_data;
+
+   if (data->patch_length < 18) 
+      return PATCH_PATCH_INVALID;
+   if (patch[0] != 'U' || patch[1] != 'P' || patch[2] != 'S' || patch[3] != '1')
+      return PATCH_PATCH_INVALID;
+
+   data->patch_offset = 4;
+   *source_size       = ups_decode(data);
+   *target_size       = ups_decode(data);
+
+   if (data->source_length != *source_size
+         && data->source_length != *target_size) 
+      return PATCH_SOURCE_INVALID;
+
+   return PATCH_SUCCESS;
+}
+
+patch_error_t ups_get_target_size(
+      const uint8_t *patchdata, size_t patchlength,
+      size_t sourcelength, size_t *targetlength)
+{
+   patch_error_t err;
+   uint64_t source_read_length, target_read_length;
+   struct ups_data data = {0};
+
+   data.patch_data    = patchdata;
+   data.patch_length  = patchlength;
+   data.source_length = sourcelength;
+
+   err = ups_decode_header(&data, &source_read_length, &target_read_length);
+   if (err != PATCH_SUCCESS)
+      return err;
+
+   *targetlength = (data.source_length == source_read_length ?
+         target_read_length : source_read_length);
+   return PATCH_SUCCESS;
 }
 
 patch_error_t ups_apply_patch(
@@ -245,10 +400,10 @@ patch_error_t ups_apply_patch(
       const uint8_t *sourcedata, size_t sourcelength,
       uint8_t *targetdata, size_t *targetlength)
 {
-   size_t i;
-   unsigned source_read_length, target_read_length;
-   uint32_t patch_read_checksum = 0, source_read_checksum = 0,
-            target_read_checksum = 0, patch_result_checksum;
+   patch_error_t err;
+   uint64_t source_read_length, target_read_length;
+   uint32_t patch_read_checksum, source_read_checksum,
+            target_read_checksum, source_checksum, target_checksum;
    struct ups_data data = {0};
 
    data.patch_data = patchdata;
@@ -257,38 +412,43 @@ patch_error_t ups_apply_patch(
    data.patch_length = patchlength;
    data.source_length = sourcelength;
    data.target_length = *targetlength;
-   data.patch_checksum = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
 
-   if (data.patch_length < 18) 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'U') 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'P') 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'S') 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != '1') 
+   err = ups_decode_header(&data, &source_read_length, &target_read_length);
+   if (err != PATCH_SUCCESS)
+      return err;
+
+   source_read_checksum = patch_read_le32(patchdata + patchlength - 12);
+   target_read_checksum = patch_read_le32(patchdata + patchlength - 8);
+   patch_read_checksum  = patch_read_le32(patchdata + patchlength - 4);
+
+   if (crc32_calculate(patchdata, patchlength - 4) != patch_read_checksum) 
       return PATCH_PATCH_INVALID;
 
-   source_read_length = ups_decode(&data);
-   target_read_length = ups_decode(&data);
+   /* Pick the direction from the source checksum, then only the
+    * target has to be checked afterwards. */
+   source_checksum = crc32_calculate(sourcedata, sourcelength);
 
-   if (data.source_length != source_read_length
-         && data.source_length != target_read_length) 
+   if (source_checksum == source_read_checksum
+         && data.source_length == source_read_length) 
+      target_checksum = target_read_checksum;
+   else if (source_checksum == target_read_checksum
+         && data.source_length == target_read_length) 
+   {
+      target_checksum    = source_read_checksum;
+      target_read_length = source_read_length;
+   }
+   else
       return PATCH_SOURCE_INVALID;
-   *targetlength = (data.source_length == source_read_length ?
-         target_read_length : source_read_length);
+
+   *targetlength = target_read_length;
    if (data.target_length < *targetlength) 
       return PATCH_TARGET_TOO_SMALL;
    data.target_length = *targetlength;
 
    while (data.patch_offset < data.patch_length - 12) 
    {
-      unsigned length = ups_decode(&data);
-      while (length--) 
-         ups_target_write(&data, ups_source_read(&data));
+      ups_copy(&data, ups_decode(&data));
+
       while (true) 
       {
          uint8_t patch_xor = ups_patch_read(&data);
@@ -298,53 +458,42 @@ patch_error_t ups_apply_patch(
       }
    }
 
-   while (data.source_offset < data.source_length) 
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length) 
-      ups_target_write(&data, ups_source_read(&data));
-
-
-   for (i = 0; i < 4; i++) 
-      source_read_checksum |= ups_patch_read(&data) << (i * 8);
-   for (i = 0; i < 4; i++) 
-      target_read_checksum |= ups_patch_read(&data) << (i * 8);
-
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
+   if (data.source_offset < data.source_length) 
+      ups_copy(&data, data.source_length - data.source_offset);
+   if (data.target_offset < data.target_length) 
+      ups_copy(&data, data.target_length - data.target_offset);
 
-   for (i = 0; i < 4; i++) 
-      patch_read_checksum |= ups_patch_read(&data) << (i * 8);
-
-   if (patch_result_checksum != patch_read_checksum) 
-      return PATCH_PATCH_INVALID;
-
-   if (data.source_checksum == source_read_checksum
-         && data.source_length == source_read_length) 
-   {
-      if (data.target_checksum == target_read_checksum
-            && data.target_length == target_read_length) 
-         return PATCH_SUCCESS;
+   if (crc32_calculate(targetdata, data.target_length) != target_checksum)
       return PATCH_TARGET_INVALID;
-   } 
-   else if (data.source_checksum == target_read_checksum
-         && data.source_length == target_read_length) 
-   {
-      if (data.target_checksum == source_read_checksum
-            && data.target_length == source_read_length) 
-         return PATCH_SUCCESS;
-      return PATCH_TARGET_INVALID;
-   } 
 
-   return PATCH_SOURCE_INVALID;
+   return PATCH_SUCCESS;
 }
 
-patch_error_t ips_apply_patch(
-      const uint8_t *patchdata, size_t patchlen,
-      const uint8_t *sourcedata, size_t sourcelength,
-      uint8_t *targetdata, size_t *targetlength)
+struct ips_data
 {
-   uint32_t offset = 5;
+   /* End of the furthest record. */
+   size_t end;
+   /* Size given after the EOF marker, if any. */
+   size_t truncate;
+   bool truncated;
+};
+
+/**
+ * ips_walk:
+ * @patchdata           : IPS patch.
+ * @patchlen            : Size of @patchdata.
+ * @targetdata          : Buffer to apply the records to, or NULL to only
+ *                        validate the patch.
+ * @ips                 : Filled in with the extent of the patch.
+ *
+ * Returns: PATCH_SUCCESS if the patch is well formed.
+ **/
+static patch_error_t ips_walk(const uint8_t *patchdata, size_t patchlen,
+      uint8_t *targetdata, struct ips_data *ips)
+{
+   size_t offset = 5;
+
+   memset(ips, 0, sizeof(*ips));
 
    if (patchlen < 8 ||
          patchdata[0] != 'P' ||
@@ -354,10 +503,6 @@ patch_error_t ips_apply_patch(
          patchdata[4] != 'H')
       return PATCH_PATCH_INVALID;
 
-   memcpy(targetdata, sourcedata, sourcelength);
-
-   *targetlength = sourcelength;
-
    for (;;)
    {
       uint32_t address;
@@ -379,7 +524,8 @@ patch_error_t ips_apply_patch(
             uint32_t size = patchdata[offset++] << 16;
             size |= patchdata[offset++] << 8;
             size |= patchdata[offset++] << 0;
-            *targetlength = size;
+            ips->truncate  = size;
+            ips->truncated = true;
             return PATCH_SUCCESS;
          }
       }
@@ -395,8 +541,9 @@ patch_error_t ips_apply_patch(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset++];
+         if (targetdata)
+            memcpy(targetdata + address, patchdata + offset, length);
+         offset += length;
       }
       else /* RLE */
       {
@@ -409,16 +556,59 @@ patch_error_t ips_apply_patch(
          if (length == 0) /* Illegal */
             break;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset];
-
+         if (targetdata)
+            memset(targetdata + address, patchdata[offset], length);
          offset++;
       }
 
-      if (address > *targetlength)
-         *targetlength = address;
+      address += length;
+      if (address > ips->end)
+         ips->end = address;
    }
 
    return PATCH_PATCH_INVALID;
 }
 
+patch_error_t ips_get_target_size(
+      const uint8_t *patchdata, size_t patchlen,
+      size_t sourcelength, size_t *targetlength)
+{
+   struct ips_data ips;
+   patch_error_t err = ips_walk(patchdata, patchlen, NULL, &ips);
+
+   if (err != PATCH_SUCCESS)
+      return err;
+
+   /* Records may write past a truncation size. */
+   *targetlength = max(sourcelength, ips.end);
+   if (ips.truncated)
+      *targetlength = max(*targetlength, ips.truncate);
+   return PATCH_SUCCESS;
+}
+
+patch_error_t ips_apply_patch(
+      const uint8_t *patchdata, size_t patchlen,
+      const uint8_t *sourcedata, size_t sourcelength,
+      uint8_t *targetdata, size_t *targetlength)
+{
+   size_t size;
+   struct ips_data ips;
+   patch_error_t err = ips_get_target_size(patchdata, patchlen,
+         sourcelength, &size);
+
+   /* Validated before writing anything, so a bad patch leaves
+    * in-place targets untouched. */
+   if (err != PATCH_SUCCESS)
+      return err;
+   if (size > *targetlength)
+      return PATCH_TARGET_TOO_SMALL;
+
+   if (targetdata != sourcedata)
+      memcpy(targetdata, sourcedata, sourcelength);
+
+   ips_walk(patchdata, patchlen, targetdata, &ips);
+
+   *targetlength = ips.truncated ? ips.truncate
+      : max(sourcelength, ips.end);
+   return PATCH_SUCCESS;
+}
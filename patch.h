@@ -42,6 +42,36 @@ typedef enum
 typedef patch_error_t (*patch_func_t)(const uint8_t*, size_t,
       const uint8_t*, size_t, uint8_t*, size_t*);
 
+typedef patch_error_t (*patch_size_func_t)(const uint8_t*, size_t,
+      size_t, size_t*);
+
+/**
+ * bps_get_target_size:
+ * @patch_data          : BPS patch.
+ * @patch_length        : Size of @patch_data.
+ * @source_length       : Size of the content to be patched.
+ * @target_length       : Size of the buffer the target needs.
+ *
+ * Reads the target size from the patch header, so the target can be
+ * allocated before applying the patch. ups_get_target_size and
+ * ips_get_target_size do the same for UPS and IPS. IPS patches are
+ * validated in full.
+ *
+ * Returns: PATCH_SUCCESS if the patch can be applied to a source of
+ * @source_length bytes.
+ **/
+patch_error_t bps_get_target_size(
+      const uint8_t *patch_data, size_t patch_length,
+      size_t source_length, size_t *target_length);
+
+patch_error_t ups_get_target_size(
+      const uint8_t *patch_data, size_t patch_length,
+      size_t source_length, size_t *target_length);
+
+patch_error_t ips_get_target_size(
+      const uint8_t *patch_data, size_t patch_length,
+      size_t source_length, size_t *target_length);
+
 patch_error_t bps_apply_patch(
       const uint8_t *patch_data, size_t patch_length,
       const uint8_t *source_data, size_t source_length,
@@ -52,7 +82,8 @@ patch_error_t ups_apply_patch(
       const uint8_t *source_data, size_t source_length,
       uint8_t *target_data, size_t *target_length);
 
-
+/* @target_data may be @source_data, IPS only overwrites bytes.
+ * Nothing is written if the patch is invalid. */
 patch_error_t ips_apply_patch(
       const uint8_t *patch_data, size_t patch_length,
       const uint8_t *source_data, size_t source_length,
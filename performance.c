@@ -77,12 +77,72 @@
 #include <sys/sysctl.h>
 #endif
 
+#include <stdlib.h>
 #include <string.h>
+#include <retro_miscellaneous.h>
+
+#if defined(HAVE_THREADS) && !defined(_WIN32) && (defined(__linux__) || defined(__APPLE__) || defined(BSD))
+#include <pthread.h>
+#endif
 
 const struct retro_perf_counter *perf_counters_rarch[MAX_COUNTERS];
 const struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 unsigned perf_ptr_rarch;
 unsigned perf_ptr_libretro;
+/* Open addressing table mapping counters to their histograms,
+ * retro_perf_counter itself is part of the libretro ABI.
+ * Slots are claimed with a compare-and-swap, so counters can
+ * be stopped from any thread. */
+#define PERF_HISTOGRAM_MAP_SIZE (4 * MAX_COUNTERS)
+
+typedef struct perf_histogram_entry
+{
+   const struct retro_perf_counter *perf;
+   rarch_perf_histogram_t *hist;
+} perf_histogram_entry_t;
+
+static perf_histogram_entry_t perf_histogram_map[PERF_HISTOGRAM_MAP_SIZE];
+
+typedef struct perf_trace_event
+{
+   const struct retro_perf_counter *perf;
+   retro_perf_tick_t start;
+   retro_perf_tick_t ticks;
+   uintptr_t thread;
+} perf_trace_event_t;
+
+/* Ring of the most recent counter runs, see rarch_perf_trace_begin.
+ * Allocated once, as other threads may still be adding events
+ * after the trace ends. */
+#define PERF_TRACE_EVENTS (1 << 16)
+
+static perf_trace_event_t *perf_trace_events;
+static volatile bool perf_trace_enable;
+static uint64_t perf_trace_next;
+static retro_perf_tick_t perf_trace_ticks_start;
+static retro_time_t perf_trace_usec_start;
+
+#if defined(__GNUC__)
+#define PERF_ATOMIC_ADD(ptr, val) __sync_fetch_and_add((ptr), (val))
+#define PERF_ATOMIC_CAS(ptr, oldval, newval) \
+   __sync_bool_compare_and_swap((ptr), (oldval), (newval))
+#else
+/* Without atomics concurrent runs may lose samples. */
+#define PERF_ATOMIC_ADD(ptr, val) ((*(ptr) += (val)) - (val))
+#define PERF_ATOMIC_CAS(ptr, oldval, newval) \
+   ((*(ptr) == (oldval)) ? (*(ptr) = (newval), true) : false)
+#endif
+
+static uintptr_t perf_thread_id(void)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   return (uintptr_t)GetCurrentThreadId();
+#elif defined(HAVE_THREADS) && (defined(__linux__) || defined(__APPLE__) || defined(BSD))
+   return (uintptr_t)pthread_self();
+#else
+   return 0;
+#endif
+}
 
 void rarch_perf_register(struct retro_perf_counter *perf)
 {
@@ -103,8 +163,440 @@ void retro_perf_register(struct retro_perf_counter *perf)
    perf->registered = true;
 }
 
+static bool perf_is_rarch(const struct retro_perf_counter *perf)
+{
+   unsigned i;
+
+   for (i = 0; i < perf_ptr_rarch; i++)
+      if (perf_counters_rarch[i] == perf)
+         return true;
+   return false;
+}
+
+static unsigned perf_histogram_slot(const struct retro_perf_counter *perf)
+{
+   uintptr_t hash = (uintptr_t)perf;
+   unsigned slot  = (unsigned)((hash >> 4) ^ (hash >> 12))
+      & (PERF_HISTOGRAM_MAP_SIZE - 1);
+   unsigned i;
+
+   for (i = 0; i < PERF_HISTOGRAM_MAP_SIZE; i++)
+   {
+      const struct retro_perf_counter *cur = perf_histogram_map[slot].perf;
+
+      if (!cur || cur == perf)
+         return slot;
+      slot = (slot + 1) & (PERF_HISTOGRAM_MAP_SIZE - 1);
+   }
+
+   return PERF_HISTOGRAM_MAP_SIZE;
+}
+
+static unsigned perf_histogram_bucket(retro_perf_tick_t value)
+{
+   unsigned msb = 0;
+
+   if (value < (1 << PERF_HISTOGRAM_SUB_BITS))
+      return (unsigned)value;
+
+#if defined(__GNUC__)
+   msb = 63 - __builtin_clzll(value);
+#else
+   {
+      retro_perf_tick_t v = value;
+      while (v >>= 1)
+         msb++;
+   }
+#endif
+
+   return ((msb - PERF_HISTOGRAM_SUB_BITS + 1) << PERF_HISTOGRAM_SUB_BITS)
+      + (unsigned)((value >> (msb - PERF_HISTOGRAM_SUB_BITS))
+            & ((1 << PERF_HISTOGRAM_SUB_BITS) - 1));
+}
+
+static retro_perf_tick_t perf_histogram_bucket_max(unsigned bucket)
+{
+   unsigned shift;
+   retro_perf_tick_t base;
+
+   if (bucket < (1 << PERF_HISTOGRAM_SUB_BITS))
+      return bucket;
+
+   shift = (bucket >> PERF_HISTOGRAM_SUB_BITS) - 1;
+   base  = (retro_perf_tick_t)((1 << PERF_HISTOGRAM_SUB_BITS)
+         + (bucket & ((1 << PERF_HISTOGRAM_SUB_BITS) - 1))) << shift;
+   return base + (((retro_perf_tick_t)1 << shift) - 1);
+}
+
+void rarch_perf_histogram_add(rarch_perf_histogram_t *hist,
+      retro_perf_tick_t value)
+{
+   retro_perf_tick_t cur;
+
+   PERF_ATOMIC_ADD(&hist->buckets[perf_histogram_bucket(value)], 1);
+   PERF_ATOMIC_ADD(&hist->count, 1);
+   PERF_ATOMIC_ADD(&hist->total, value);
+
+   /* min is stored inverted, so an empty histogram is all zeroes. */
+   while (~value > (cur = hist->min_inv))
+      if (PERF_ATOMIC_CAS(&hist->min_inv, cur, ~value))
+         break;
+   while (value > (cur = hist->max))
+      if (PERF_ATOMIC_CAS(&hist->max, cur, value))
+         break;
+}
+
+retro_perf_tick_t rarch_perf_histogram_percentile(
+      const rarch_perf_histogram_t *hist, double percentile)
+{
+   unsigned i;
+   uint64_t seen = 0, rank;
+
+   if (!hist || !hist->count)
+      return 0;
+
+   rank = (uint64_t)(percentile / 100.0 * hist->count + 0.5);
+   if (rank < 1)
+      rank = 1;
+
+   for (i = 0; i < PERF_HISTOGRAM_BUCKETS; i++)
+   {
+      seen += hist->buckets[i];
+      if (seen >= rank)
+         break;
+   }
+
+   /* The top bucket is bounded by the largest value seen. */
+   if (i >= PERF_HISTOGRAM_BUCKETS
+         || perf_histogram_bucket_max(i) > hist->max)
+      return hist->max;
+   return perf_histogram_bucket_max(i);
+}
+
+/* Reads @hist into @out, clearing it in the same pass if @reset
+ * is set so that no concurrent sample gets lost. */
+static void perf_histogram_take(rarch_perf_histogram_t *hist,
+      rarch_perf_histogram_t *out, bool reset)
+{
+   unsigned i;
+   uint64_t cur;
+
+   for (i = 0; i < PERF_HISTOGRAM_BUCKETS; i++)
+   {
+      do
+      {
+         out->buckets[i] = hist->buckets[i];
+      } while (reset && !PERF_ATOMIC_CAS(&hist->buckets[i],
+               out->buckets[i], 0));
+   }
+
+#define PERF_TAKE(field) \
+   do \
+   { \
+      cur = hist->field; \
+   } while (reset && !PERF_ATOMIC_CAS(&hist->field, cur, 0)); \
+   out->field = cur
+
+   PERF_TAKE(count);
+   PERF_TAKE(total);
+   PERF_TAKE(min_inv);
+   PERF_TAKE(max);
+
+#undef PERF_TAKE
+}
+
+static void perf_trace_add(const struct retro_perf_counter *perf,
+      retro_perf_tick_t start, retro_perf_tick_t ticks)
+{
+   perf_trace_event_t *event = &perf_trace_events[
+      PERF_ATOMIC_ADD(&perf_trace_next, 1) & (PERF_TRACE_EVENTS - 1)];
+
+   event->start  = start;
+   event->ticks  = ticks;
+   event->thread = perf_thread_id();
+   event->perf   = perf;
+}
+
+void rarch_perf_sample(const struct retro_perf_counter *perf,
+      retro_perf_tick_t start, retro_perf_tick_t ticks)
+{
+   unsigned slot;
+   rarch_perf_histogram_t *hist = NULL;
+
+   if (perf_trace_enable)
+      perf_trace_add(perf, start, ticks);
+
+   for (;;)
+   {
+      if ((slot = perf_histogram_slot(perf)) >= PERF_HISTOGRAM_MAP_SIZE)
+         return;
+
+      if (perf_histogram_map[slot].perf == perf)
+         break;
+
+      /* First run, claim the slot. Another thread may be
+       * claiming it at the same time, for this or another
+       * counter. */
+      if (PERF_ATOMIC_CAS(&perf_histogram_map[slot].perf,
+               (const struct retro_perf_counter*)NULL, perf))
+      {
+         perf_histogram_map[slot].hist = (rarch_perf_histogram_t*)
+            calloc(1, sizeof(*hist));
+         break;
+      }
+   }
+
+   /* Not set yet if the slot was claimed just now by another thread. */
+   if ((hist = perf_histogram_map[slot].hist))
+      rarch_perf_histogram_add(hist, ticks);
+}
+
+const rarch_perf_histogram_t *rarch_perf_get_histogram(
+      const struct retro_perf_counter *perf)
+{
+   unsigned slot = perf_histogram_slot(perf);
+
+   if (slot >= PERF_HISTOGRAM_MAP_SIZE
+         || perf_histogram_map[slot].perf != perf)
+      return NULL;
+   return perf_histogram_map[slot].hist;
+}
+
+/**
+ * rarch_perf_stats_from_histogram:
+ * @stats              : stats to fill in.
+ * @hist               : histogram of the counter runs.
+ *
+ * Fills in the run statistics of @stats.
+ **/
+void rarch_perf_stats_from_histogram(rarch_perf_stats_t *stats,
+      const rarch_perf_histogram_t *hist)
+{
+   stats->count = hist->count;
+   stats->total = hist->total;
+   stats->min   = hist->count ? ~hist->min_inv : 0;
+   stats->max   = hist->max;
+   stats->p50   = rarch_perf_histogram_percentile(hist, 50.0);
+   stats->p90   = rarch_perf_histogram_percentile(hist, 90.0);
+   stats->p99   = rarch_perf_histogram_percentile(hist, 99.0);
+   stats->p999  = rarch_perf_histogram_percentile(hist, 99.9);
+}
+
+unsigned rarch_perf_snapshot(rarch_perf_stats_t *stats, unsigned size,
+      bool reset)
+{
+   unsigned i, num = 0;
+   rarch_perf_histogram_t *copy = (rarch_perf_histogram_t*)
+      malloc(sizeof(*copy));
+
+   if (!copy)
+      return 0;
+
+   for (i = 0; i < PERF_HISTOGRAM_MAP_SIZE; i++)
+   {
+      const struct retro_perf_counter *perf = perf_histogram_map[i].perf;
+      rarch_perf_histogram_t *hist          = perf_histogram_map[i].hist;
+
+      if (!perf || !hist)
+         continue;
+      if (num >= size && !reset)
+         break;
+
+      perf_histogram_take(hist, copy, reset);
+
+      if (num >= size || !copy->count)
+         continue;
+
+      stats[num].ident    = perf->ident;
+      stats[num].libretro = !perf_is_rarch(perf);
+      rarch_perf_stats_from_histogram(&stats[num], copy);
+      num++;
+   }
+
+   free(copy);
+   return num;
+}
+
+void rarch_perf_reset(void)
+{
+   rarch_perf_snapshot(NULL, 0, true);
+}
+
+void rarch_perf_frame_mark(void)
+{
+   static struct retro_perf_counter frame = {"frame"};
+   retro_perf_tick_t now                  = rarch_get_perf_counter();
+
+   if (!frame.registered)
+      rarch_perf_register(&frame);
+
+   if (frame.start)
+   {
+      frame.call_cnt++;
+      frame.total += now - frame.start;
+      rarch_perf_sample(&frame, frame.start, now - frame.start);
+   }
+
+   frame.start = now;
+}
+
+bool rarch_perf_trace_begin(void)
+{
+   perf_trace_enable = false;
+
+   if (!perf_trace_events)
+      perf_trace_events = (perf_trace_event_t*)
+         calloc(PERF_TRACE_EVENTS, sizeof(*perf_trace_events));
+   if (!perf_trace_events)
+      return false;
+
+   perf_trace_ticks_start = rarch_get_perf_counter();
+   perf_trace_usec_start  = rarch_get_time_usec();
+   perf_trace_next        = 0;
+   perf_trace_enable      = true;
+
+   return true;
+}
+
+void rarch_perf_trace_end(void)
+{
+   perf_trace_enable = false;
+}
+
+bool rarch_perf_trace_active(void)
+{
+   return perf_trace_enable;
+}
+
+/* Chrome trace event strings, counter idents are C identifiers
+ * for the most part. */
+static void perf_trace_write_string(FILE *file, const char *str)
+{
+   fputc('"', file);
+
+   for (; str && *str; str++)
+   {
+      unsigned char c = (unsigned char)*str;
+
+      if (c == '"' || c == '\\')
+         fprintf(file, "\\%c", c);
+      else if (c < 0x20)
+         fprintf(file, "\\u%04x", c);
+      else
+         fputc(c, file);
+   }
+
+   fputc('"', file);
+}
+
+bool rarch_perf_trace_write(const char *path)
+{
+   uint64_t i, first, last;
+   uintptr_t threads[16];
+   unsigned num_threads  = 0;
+   double usec_per_tick  = 0.0;
+   bool comma            = false;
+   retro_perf_tick_t now = rarch_get_perf_counter();
+   retro_time_t usec     = rarch_get_time_usec();
+   FILE *file            = NULL;
+
+   if (!perf_trace_events)
+      return false;
+
+   if (!(file = fopen(path, "w")))
+   {
+      RARCH_ERR("[PERF]: Could not open trace \"%s\".\n", path);
+      return false;
+   }
+
+   /* Ticks are not necessarily a unit of time. */
+   if (now > perf_trace_ticks_start)
+      usec_per_tick = (double)(usec - perf_trace_usec_start)
+         / (now - perf_trace_ticks_start);
+
+   last  = perf_trace_next;
+   first = last > PERF_TRACE_EVENTS ? last - PERF_TRACE_EVENTS : 0;
+
+   fputs("{\"traceEvents\":[\n", file);
+
+   for (i = first; i < last; i++)
+   {
+      unsigned tid;
+      const perf_trace_event_t *event =
+         &perf_trace_events[i & (PERF_TRACE_EVENTS - 1)];
+
+      if (!event->perf || event->start < perf_trace_ticks_start)
+         continue;
+
+      /* Map thread handles to small ids for the viewer. */
+      for (tid = 0; tid < num_threads; tid++)
+         if (threads[tid] == event->thread)
+            break;
+      if (tid == num_threads && num_threads < ARRAY_SIZE(threads))
+         threads[num_threads++] = event->thread;
+
+      fputs(comma ? ",\n{\"name\":" : "{\"name\":", file);
+      perf_trace_write_string(file, event->perf->ident);
+      fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+            "\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+            perf_is_rarch(event->perf) ? "retroarch" : "libretro",
+            (event->start - perf_trace_ticks_start) * usec_per_tick,
+            event->ticks * usec_per_tick, tid);
+      comma = true;
+   }
+
+   fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+
+   if (fclose(file) != 0)
+   {
+      RARCH_ERR("[PERF]: Could not write trace \"%s\".\n", path);
+      return false;
+   }
+
+   RARCH_LOG("[PERF]: Wrote %llu events to trace \"%s\".\n",
+         (unsigned long long)(last - first), path);
+   return true;
+}
+
+/* Core counters go away with the core, keep just our own. Drivers
+ * are down at this point, nothing is running counters. */
+static void perf_histograms_drop_libretro(void)
+{
+   unsigned i;
+   static perf_histogram_entry_t old[PERF_HISTOGRAM_MAP_SIZE];
+
+   memcpy(old, perf_histogram_map, sizeof(old));
+   memset(perf_histogram_map, 0, sizeof(perf_histogram_map));
+
+   for (i = 0; i < PERF_HISTOGRAM_MAP_SIZE; i++)
+   {
+      unsigned slot;
+
+      if (!old[i].perf)
+         continue;
+
+      if (!perf_is_rarch(old[i].perf))
+      {
+         free(old[i].hist);
+         continue;
+      }
+
+      slot = perf_histogram_slot(old[i].perf);
+      perf_histogram_map[slot] = old[i];
+   }
+
+   if (perf_trace_events)
+   {
+      memset(perf_trace_events, 0,
+            PERF_TRACE_EVENTS * sizeof(*perf_trace_events));
+      perf_trace_next = 0;
+   }
+}
+
 void retro_perf_clear(void)
 {
+   perf_histograms_drop_libretro();
+
    perf_ptr_libretro = 0;
    memset(perf_counters_libretro, 0, sizeof(perf_counters_libretro));
 }
@@ -115,13 +607,28 @@ static void log_counters(
    unsigned i;
    for (i = 0; i < num; i++)
    {
-      if (counters[i]->call_cnt)
+      const rarch_perf_histogram_t *hist = NULL;
+
+      if (!counters[i]->call_cnt)
+         continue;
+
+      RARCH_LOG(PERF_LOG_FMT,
+            counters[i]->ident,
+            (unsigned long long)counters[i]->total / 
+            (unsigned long long)counters[i]->call_cnt,
+            (unsigned long long)counters[i]->call_cnt);
+
+      if ((hist = rarch_perf_get_histogram(counters[i])) && hist->count)
       {
-         RARCH_LOG(PERF_LOG_FMT,
+         rarch_perf_stats_t stats;
+         rarch_perf_stats_from_histogram(&stats, hist);
+
+         RARCH_LOG(PERF_LOG_DIST_FMT,
                counters[i]->ident,
-               (unsigned long long)counters[i]->total / 
-               (unsigned long long)counters[i]->call_cnt,
-               (unsigned long long)counters[i]->call_cnt);
+               (unsigned long long)stats.min,
+               (unsigned long long)stats.p50,
+               (unsigned long long)stats.p99,
+               (unsigned long long)stats.max);
       }
    }
 }
@@ -25,8 +25,10 @@ extern "C" {
 
 #ifdef _WIN32
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %I64u ticks, %I64u runs.\n"
+#define PERF_LOG_DIST_FMT "[PERF]: Dist (%s): min %I64u, p50 %I64u, p99 %I64u, max %I64u ticks.\n"
 #else
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %llu ticks, %llu runs.\n"
+#define PERF_LOG_DIST_FMT "[PERF]: Dist (%s): min %llu, p50 %llu, p99 %llu, max %llu ticks.\n"
 #endif
 
 /* Used internally by RetroArch. */
@@ -49,6 +51,35 @@ extern const struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 extern unsigned perf_ptr_rarch;
 extern unsigned perf_ptr_libretro;
 
+/* Log-linear histogram: values below 2^PERF_HISTOGRAM_SUB_BITS get
+ * a bucket each, every power of two above that is split into
+ * 2^PERF_HISTOGRAM_SUB_BITS buckets (~12% relative error). */
+#define PERF_HISTOGRAM_SUB_BITS 3
+#define PERF_HISTOGRAM_BUCKETS  (64 << PERF_HISTOGRAM_SUB_BITS)
+
+typedef struct rarch_perf_histogram
+{
+   uint32_t buckets[PERF_HISTOGRAM_BUCKETS];
+   uint64_t count;
+   retro_perf_tick_t total;
+   /* Inverted, so an empty histogram is all zeroes. */
+   retro_perf_tick_t min_inv;
+   retro_perf_tick_t max;
+} rarch_perf_histogram_t;
+
+typedef struct rarch_perf_stats
+{
+   const char *ident;
+   bool libretro;
+   uint64_t count;
+   retro_perf_tick_t total;
+   retro_perf_tick_t min;
+   retro_perf_tick_t max;
+   retro_perf_tick_t p50;
+   retro_perf_tick_t p90;
+   retro_perf_tick_t p99;
+   retro_perf_tick_t p999;
+} rarch_perf_stats_t;
 
 /**
  * rarch_get_perf_counter:
@@ -79,6 +110,97 @@ void rarch_perf_log(void);
 
 void retro_perf_log(void);
 
+/**
+ * rarch_perf_histogram_add:
+ * @hist               : histogram
+ * @value              : value to add.
+ *
+ * Adds @value to @hist. Safe to call from several threads at once.
+ **/
+void rarch_perf_histogram_add(rarch_perf_histogram_t *hist,
+      retro_perf_tick_t value);
+
+/**
+ * rarch_perf_histogram_percentile:
+ * @hist               : histogram
+ * @percentile         : percentile to query, 0 to 100.
+ *
+ * Returns: upper bound of the bucket holding @percentile
+ * of the values in @hist, or 0 if it is empty.
+ **/
+retro_perf_tick_t rarch_perf_histogram_percentile(
+      const rarch_perf_histogram_t *hist, double percentile);
+
+void rarch_perf_stats_from_histogram(rarch_perf_stats_t *stats,
+      const rarch_perf_histogram_t *hist);
+
+/**
+ * rarch_perf_get_histogram:
+ * @perf               : pointer to performance counter
+ *
+ * Every counter keeps a histogram of its run durations while
+ * performance counters are enabled, frontend and core alike.
+ *
+ * Returns: histogram of the runs of @perf, or NULL if it did
+ * not run yet.
+ **/
+const rarch_perf_histogram_t *rarch_perf_get_histogram(
+      const struct retro_perf_counter *perf);
+
+/* Records a run of @perf, see rarch_perf_stop. */
+void rarch_perf_sample(const struct retro_perf_counter *perf,
+      retro_perf_tick_t start, retro_perf_tick_t ticks);
+
+/**
+ * rarch_perf_snapshot:
+ * @stats              : array to fill in.
+ * @size               : size of @stats.
+ * @reset              : reset the histograms read.
+ *
+ * Reads the statistics of every counter which ran since the last
+ * reset. Counters keep running while being read, resetting loses
+ * no runs.
+ *
+ * Returns: number of counters written to @stats.
+ **/
+unsigned rarch_perf_snapshot(rarch_perf_stats_t *stats, unsigned size,
+      bool reset);
+
+void rarch_perf_reset(void);
+
+/**
+ * rarch_perf_frame_mark:
+ *
+ * Marks a frame boundary. Time between marks is tracked
+ * by the "frame" counter.
+ **/
+void rarch_perf_frame_mark(void);
+
+/**
+ * rarch_perf_trace_begin:
+ *
+ * Starts recording every counter run into a ring buffer holding
+ * the most recent runs, restarting it if already recording.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool rarch_perf_trace_begin(void);
+
+void rarch_perf_trace_end(void);
+
+bool rarch_perf_trace_active(void);
+
+/**
+ * rarch_perf_trace_write:
+ * @path               : path to write the trace to.
+ *
+ * Writes the runs recorded since rarch_perf_trace_begin in the
+ * Chrome trace event format, for chrome://tracing and the like.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool rarch_perf_trace_write(const char *path);
+
 /**
  * rarch_perf_start:
  * @perf               : pointer to performance counter
@@ -102,10 +224,15 @@ static inline void rarch_perf_start(struct retro_perf_counter *perf)
  **/
 static inline void rarch_perf_stop(struct retro_perf_counter *perf)
 {
+   retro_perf_tick_t ticks;
+
    if (!g_extern.perfcnt_enable || !perf)
       return;
 
-   perf->total += rarch_get_perf_counter() - perf->start;
+   ticks = rarch_get_perf_counter() - perf->start;
+   perf->total += ticks;
+
+   rarch_perf_sample(perf, perf->start, ticks);
 }
 
 /**
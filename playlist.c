@@ -23,6 +23,267 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <retro_miscellaneous.h>
+
+#include "file_ops.h"
+#include "hash.h"
+
+#define PLAYLIST_NIL          ((size_t)-1)
+
+#define PLAYLIST_MAGIC        0x424c5052 /* "RPLB" */
+#define PLAYLIST_VERSION      1
+
+#define PLAYLIST_OP_PUSH      1
+#define PLAYLIST_OP_SNAPSHOT  2
+
+/* String length repeating the string of the previous entry. */
+#define PLAYLIST_SAME         0xffffffff
+
+/* Journaled pushes allowed on top of one per entry,
+ * before the playlist file is rewritten. */
+#define PLAYLIST_JOURNAL_SLACK 64
+
+/* Binary playlist file layout (little endian):
+ *
+ * uint32_t magic
+ * uint32_t version
+ * records:
+ *    uint32_t payload_size
+ *    uint8_t  payload[payload_size]
+ *    uint32_t crc32 of payload
+ *
+ * PLAYLIST_OP_SNAPSHOT payload, written when rewriting the file:
+ *    uint8_t  op
+ *    uint32_t count
+ *    count entries, oldest first: path, core_path, core_name
+ *
+ * PLAYLIST_OP_PUSH payload, appended for each push:
+ *    uint8_t  op
+ *    path, core_path, core_name
+ *
+ * Strings are a uint32_t length followed by the characters, an
+ * empty path is no path. In snapshots, core paths and names of
+ * PLAYLIST_SAME length repeat those of the previous entry.
+ *
+ * A push is journaled by appending a record. Loading replays the
+ * records in order through content_playlist_add(). Replay stops
+ * at the first record that is cut short, fails its CRC or does
+ * not parse, wherever it is in the file. That record and all
+ * records after it are dropped when the file is next rewritten.
+ */
+
+struct content_playlist_link
+{
+   size_t prev;
+   size_t next;
+   uint32_t hash;
+};
+
+/* Entries are unique by path and core path, so both are hashed. */
+static uint32_t content_playlist_hash(const char *path,
+      const char *core_path)
+{
+   uint32_t hash = 5381;
+
+   while (path && *path)
+      hash = (hash << 5) + hash + (uint8_t)*path++;
+
+   /* Separates "a" + "bc" from "ab" + "c". */
+   hash = (hash << 5) + hash;
+
+   while (*core_path)
+      hash = (hash << 5) + hash + (uint8_t)*core_path++;
+   return hash;
+}
+
+static bool content_playlist_equal_path(const char *a, const char *b)
+{
+   return (!a && !b) || (a && b && !strcmp(a, b));
+}
+
+/**
+ * content_playlist_find:
+ * @playlist        	   : Playlist handle.
+ * @path                : Path of playlist entry.
+ * @core_path           : Core path of playlist entry.
+ *
+ * Core name can have changed while still being the same core,
+ * so entries are differentiated based on the core path only.
+ *
+ * Returns: index of entry in storage, or PLAYLIST_NIL.
+ **/
+static size_t content_playlist_find(content_playlist_t *playlist,
+      const char *path, const char *core_path)
+{
+   size_t i;
+   uint32_t hash = content_playlist_hash(path, core_path);
+
+   if (!playlist->buckets)
+      return PLAYLIST_NIL;
+
+   for (i = hash & playlist->bucket_mask; playlist->buckets[i];
+         i = (i + 1) & playlist->bucket_mask)
+   {
+      size_t idx = playlist->buckets[i] - 1;
+      const content_playlist_entry_t *entry = &playlist->entries[idx];
+
+      if (playlist->links[idx].hash == hash
+            && content_playlist_equal_path(entry->path, path)
+            && !strcmp(entry->core_path, core_path))
+         return idx;
+   }
+
+   return PLAYLIST_NIL;
+}
+
+static void content_playlist_bucket_insert(content_playlist_t *playlist,
+      size_t idx)
+{
+   size_t i = playlist->links[idx].hash & playlist->bucket_mask;
+
+   while (playlist->buckets[i])
+      i = (i + 1) & playlist->bucket_mask;
+   playlist->buckets[i] = idx + 1;
+}
+
+static void content_playlist_bucket_remove(content_playlist_t *playlist,
+      size_t idx)
+{
+   size_t i, j;
+   size_t mask = playlist->bucket_mask;
+
+   for (i = playlist->links[idx].hash & mask;
+         playlist->buckets[i] != idx + 1; i = (i + 1) & mask)
+   {
+      if (!playlist->buckets[i])
+         return;
+   }
+
+   /* Shift following entries back, so probing needs no tombstones. */
+   for (j = (i + 1) & mask; playlist->buckets[j]; j = (j + 1) & mask)
+   {
+      size_t k = playlist->links[playlist->buckets[j] - 1].hash & mask;
+
+      if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+      {
+         playlist->buckets[i] = playlist->buckets[j];
+         i = j;
+      }
+   }
+
+   playlist->buckets[i] = 0;
+}
+
+static bool content_playlist_reserve(content_playlist_t *playlist,
+      size_t size)
+{
+   size_t i, bucket_count;
+
+   if (size > playlist->alloc)
+   {
+      size_t alloc = playlist->alloc ? playlist->alloc * 2 : 16;
+      content_playlist_entry_t *entries     = NULL;
+      struct content_playlist_link *links   = NULL;
+      size_t *order                         = NULL;
+
+      while (alloc < size)
+         alloc *= 2;
+      if (playlist->cap && alloc > playlist->cap)
+         alloc = playlist->cap;
+
+      entries = (content_playlist_entry_t*)
+         realloc(playlist->entries, alloc * sizeof(*entries));
+      if (!entries)
+         return false;
+      playlist->entries = entries;
+
+      links = (struct content_playlist_link*)
+         realloc(playlist->links, alloc * sizeof(*links));
+      if (!links)
+         return false;
+      playlist->links = links;
+
+      order = (size_t*)realloc(playlist->order, alloc * sizeof(*order));
+      if (!order)
+         return false;
+      playlist->order = order;
+
+      memset(&playlist->entries[playlist->alloc], 0,
+            (alloc - playlist->alloc) * sizeof(*entries));
+      playlist->alloc = alloc;
+   }
+
+   /* Keep the load factor at or below 1/2. */
+   if (playlist->buckets && size * 2 <= playlist->bucket_mask + 1)
+      return true;
+
+   bucket_count = 32;
+   while (bucket_count < size * 2)
+      bucket_count *= 2;
+
+   free(playlist->buckets);
+   playlist->buckets = (size_t*)calloc(bucket_count,
+         sizeof(*playlist->buckets));
+   if (!playlist->buckets)
+      return false;
+   playlist->bucket_mask = bucket_count - 1;
+
+   for (i = 0; i < playlist->size; i++)
+      content_playlist_bucket_insert(playlist, i);
+
+   return true;
+}
+
+static void content_playlist_unlink(content_playlist_t *playlist,
+      size_t idx)
+{
+   struct content_playlist_link *link = &playlist->links[idx];
+
+   if (link->prev != PLAYLIST_NIL)
+      playlist->links[link->prev].next = link->next;
+   else
+      playlist->head = link->next;
+
+   if (link->next != PLAYLIST_NIL)
+      playlist->links[link->next].prev = link->prev;
+   else
+      playlist->tail = link->prev;
+}
+
+static void content_playlist_link_front(content_playlist_t *playlist,
+      size_t idx)
+{
+   struct content_playlist_link *link = &playlist->links[idx];
+
+   link->prev  = PLAYLIST_NIL;
+   link->next  = playlist->head;
+
+   if (playlist->head != PLAYLIST_NIL)
+      playlist->links[playlist->head].prev = idx;
+   playlist->head = idx;
+
+   if (playlist->tail == PLAYLIST_NIL)
+      playlist->tail = idx;
+
+   playlist->order_valid = false;
+}
+
+static const size_t *content_playlist_get_order(
+      content_playlist_t *playlist)
+{
+   if (!playlist->order_valid)
+   {
+      size_t i   = 0;
+      size_t idx = playlist->head;
+
+      for (; idx != PLAYLIST_NIL; idx = playlist->links[idx].next)
+         playlist->order[i++] = idx;
+      playlist->order_valid = true;
+   }
+
+   return playlist->order;
+}
+
 /**
  * content_playlist_get_index:
  * @playlist        	   : Playlist handle.
@@ -38,15 +299,19 @@ void content_playlist_get_index(content_playlist_t *playlist,
       const char **path, const char **core_path,
       const char **core_name)
 {
-   if (!playlist)
+   const content_playlist_entry_t *entry = NULL;
+
+   if (!playlist || idx >= playlist->size)
       return;
 
+   entry = &playlist->entries[content_playlist_get_order(playlist)[idx]];
+
    if (path)
-      *path      = playlist->entries[idx].path;
+      *path      = entry->path;
    if (core_path)
-      *core_path = playlist->entries[idx].core_path;
+      *core_path = entry->core_path;
    if (core_name)
-      *core_name = playlist->entries[idx].core_name;
+      *core_name = entry->core_name;
 }
 
 void content_playlist_get_index_by_path(content_playlist_t *playlist,
@@ -54,24 +319,31 @@ void content_playlist_get_index_by_path(content_playlist_t *playlist,
       char **path, char **core_path,
       char **core_name)
 {
-   size_t i;
-   if (!playlist)
+   size_t idx;
+   content_playlist_entry_t *entry = NULL;
+
+   if (!playlist || !search_path)
       return;
 
-   for (i = 0; i < playlist->size; i++)
-   {
-      if (strcmp(playlist->entries[i].path, search_path) != 0)
-         continue;
+   /* The index is keyed on the core path too, so walk the entries
+    * from the most recently used one. */
+   for (idx = playlist->head; idx != PLAYLIST_NIL;
+         idx = playlist->links[idx].next)
+      if (content_playlist_equal_path(playlist->entries[idx].path,
+               search_path))
+         break;
 
-      if (path)
-         *path      = playlist->entries[i].path;
-      if (core_path)
-         *core_path = playlist->entries[i].core_path;
-      if (core_name)
-         *core_name = playlist->entries[i].core_name;
-      break;
-   }
+   if (idx == PLAYLIST_NIL)
+      return;
+
+   entry = &playlist->entries[idx];
 
+   if (path)
+      *path      = entry->path;
+   if (core_path)
+      *core_path = entry->core_path;
+   if (core_name)
+      *core_name = entry->core_name;
 }
 
 /**
@@ -85,101 +357,376 @@ static void content_playlist_free_entry(content_playlist_entry_t *entry)
    if (!entry)
       return;
 
-   if (entry->path)
-      free(entry->path);
-   entry->path = NULL;
-   if (entry->core_path)
-      free(entry->core_path);
-   entry->core_path = NULL;
-   if (entry->core_name)
-      free(entry->core_name);
-   entry->core_name = NULL;
+   /* Owns the strings of the entry, see content_playlist_add(). */
+   free(entry->core_path);
 
    memset(entry, 0, sizeof(*entry));
 }
 
 /**
- * content_playlist_push:
+ * content_playlist_add:
  * @playlist        	   : Playlist handle.
  * @path                : Path of new playlist entry.
  * @core_path           : Core path of new playlist entry.
  * @core_name           : Core name of new playlist entry.
  *
- * Push entry to top of playlist.
+ * Moves an existing entry to the top of the playlist, or adds
+ * a new one there, evicting the least recently used entry if
+ * the playlist is full.
+ *
+ * Returns: true (1) if the playlist changed, otherwise false (0).
  **/
-void content_playlist_push(content_playlist_t *playlist,
+static bool content_playlist_add(content_playlist_t *playlist,
       const char *path, const char *core_path,
       const char *core_name)
 {
-   size_t i;
-
-   if (!playlist)
-      return;
+   size_t core_path_len, core_name_len, path_len;
+   size_t idx = content_playlist_find(playlist, path, core_path);
+   content_playlist_entry_t *entry = NULL;
+   char *strs                      = NULL;
 
-   for (i = 0; i < playlist->size; i++)
+   if (idx != PLAYLIST_NIL)
    {
-      content_playlist_entry_t tmp;
-      bool equal_path = (!path && !playlist->entries[i].path) ||
-         (path && playlist->entries[i].path &&
-          !strcmp(path,playlist->entries[i].path));
-
-      /* Core name can have changed while still being the same core.
-       * Differentiate based on the core path only. */
-      if (!equal_path)
-         continue;
-
-      if (strcmp(playlist->entries[i].core_path, core_path))
-         continue;
-
       /* If top entry, we don't want to push a new entry since
        * the top and the entry to be pushed are the same. */
-      if (i == 0)
-         return;
+      if (idx == playlist->head)
+         return false;
 
       /* Seen it before, bump to top. */
-      tmp = playlist->entries[i];
-      memmove(playlist->entries + 1, playlist->entries,
-		      i * sizeof(content_playlist_entry_t));
-      playlist->entries[0] = tmp;
+      content_playlist_unlink(playlist, idx);
+      content_playlist_link_front(playlist, idx);
+      return true;
+   }
 
-      return;
+   /* The strings of an entry share one allocation. */
+   core_path_len = strlen(core_path) + 1;
+   core_name_len = strlen(core_name) + 1;
+   path_len      = path ? strlen(path) + 1 : 0;
+
+   strs = (char*)malloc(core_path_len + core_name_len + path_len);
+   if (!strs)
+      return false;
+
+   if (playlist->cap && playlist->size >= playlist->cap)
+   {
+      /* Reuse the least recently used entry. */
+      idx = playlist->tail;
+      content_playlist_unlink(playlist, idx);
+      content_playlist_bucket_remove(playlist, idx);
+      content_playlist_free_entry(&playlist->entries[idx]);
+   }
+   else
+   {
+      if (!content_playlist_reserve(playlist, playlist->size + 1))
+      {
+         free(strs);
+         return false;
+      }
+      idx = playlist->size++;
    }
 
-   if (playlist->size == playlist->cap)
+   entry            = &playlist->entries[idx];
+   entry->core_path = strs;
+   entry->core_name = strs + core_path_len;
+   entry->path      = path ? entry->core_name + core_name_len : NULL;
+
+   memcpy(entry->core_path, core_path, core_path_len);
+   memcpy(entry->core_name, core_name, core_name_len);
+   if (path)
+      memcpy(entry->path, path, path_len);
+
+   playlist->links[idx].hash = content_playlist_hash(path, core_path);
+
+   content_playlist_bucket_insert(playlist, idx);
+   content_playlist_link_front(playlist, idx);
+   return true;
+}
+
+static void content_playlist_put_u32(uint8_t *out, uint32_t val)
+{
+   out[0] = (uint8_t)(val >>  0);
+   out[1] = (uint8_t)(val >>  8);
+   out[2] = (uint8_t)(val >> 16);
+   out[3] = (uint8_t)(val >> 24);
+}
+
+static uint32_t content_playlist_get_u32(const uint8_t *in)
+{
+   return (uint32_t)in[0] | ((uint32_t)in[1] << 8)
+      | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static size_t content_playlist_string_size(const char *str,
+      const char *prev)
+{
+   if (prev && !strcmp(str, prev))
+      return 4;
+   return 4 + strlen(str);
+}
+
+static uint8_t *content_playlist_put_string(uint8_t *out,
+      const char *str, const char *prev)
+{
+   size_t len;
+
+   if (prev && !strcmp(str, prev))
    {
-      content_playlist_free_entry(&playlist->entries[playlist->cap - 1]);
-      playlist->size--;
+      content_playlist_put_u32(out, PLAYLIST_SAME);
+      return out + 4;
    }
 
-   memmove(playlist->entries + 1, playlist->entries,
-         (playlist->cap - 1) * sizeof(content_playlist_entry_t));
+   len = strlen(str);
+   content_playlist_put_u32(out, len);
+   memcpy(out + 4, str, len);
+   return out + 4 + len;
+}
+
+/**
+ * content_playlist_get_string:
+ * @ptr                 : Position in record payload, advanced.
+ * @end                 : End of record payload.
+ * @prev                : String repeated by PLAYLIST_SAME, can be NULL.
+ * @out                 : String read.
+ *
+ * Reads a string, terminating it in place.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool content_playlist_get_string(uint8_t **ptr,
+      const uint8_t *end, char *prev, char **out)
+{
+   uint32_t len;
+
+   if (end - *ptr < 4)
+      return false;
 
-   playlist->entries[0].path      = path ? strdup(path) : NULL;
-   playlist->entries[0].core_path = strdup(core_path);
-   playlist->entries[0].core_name = strdup(core_name);
-   playlist->size++;
+   len = content_playlist_get_u32(*ptr);
+
+   if (len == PLAYLIST_SAME)
+   {
+      if (!prev)
+         return false;
+      *out  = prev;
+      *ptr += 4;
+      return true;
+   }
+
+   if ((size_t)(end - *ptr - 4) < len)
+      return false;
+
+   /* Shift the string over its length field to terminate it. */
+   memmove(*ptr, *ptr + 4, len);
+   (*ptr)[len] = '\0';
+   *out  = (char*)*ptr;
+   *ptr += 4 + len;
+   return true;
 }
 
-static void content_playlist_write_file(content_playlist_t *playlist)
+/**
+ * content_playlist_write_record:
+ * @file                : Playlist file.
+ * @buf                 : Record, with the payload at offset 4 and
+ *                        room for the CRC after it.
+ * @payload_size        : Size of payload.
+ *
+ * Fills in the size and CRC of a record and writes it.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool content_playlist_write_record(FILE *file,
+      uint8_t *buf, size_t payload_size)
 {
-   size_t i;
+   content_playlist_put_u32(buf, payload_size);
+   content_playlist_put_u32(buf + 4 + payload_size,
+         crc32_calculate(buf + 4, payload_size));
+
+   return fwrite(buf, 1, 4 + payload_size + 4, file)
+      == 4 + payload_size + 4;
+}
+
+/**
+ * content_playlist_compact:
+ * @playlist        	   : Playlist handle.
+ *
+ * Rewrites the playlist file as a single snapshot.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool content_playlist_compact(content_playlist_t *playlist)
+{
+   size_t idx, payload_size;
+   bool ret = false;
+   uint8_t header[8];
+   char tmp_path[PATH_MAX_LENGTH];
+   uint8_t *buf, *ptr;
+   const content_playlist_entry_t *prev = NULL;
    FILE *file = NULL;
 
-   if (!playlist)
-      return;
+   payload_size = 1 + 4;
+   for (idx = playlist->tail; idx != PLAYLIST_NIL;
+         idx = playlist->links[idx].prev)
+   {
+      const content_playlist_entry_t *entry = &playlist->entries[idx];
+
+      payload_size += content_playlist_string_size(
+            entry->path ? entry->path : "", NULL);
+      payload_size += content_playlist_string_size(entry->core_path,
+            prev ? prev->core_path : NULL);
+      payload_size += content_playlist_string_size(entry->core_name,
+            prev ? prev->core_name : NULL);
+      prev = entry;
+   }
+
+   buf = (uint8_t*)malloc(4 + payload_size + 4);
+   if (!buf)
+      return false;
+
+   ptr    = buf + 4;
+   *ptr++ = PLAYLIST_OP_SNAPSHOT;
+   content_playlist_put_u32(ptr, playlist->size);
+   ptr   += 4;
+
+   prev = NULL;
+   for (idx = playlist->tail; idx != PLAYLIST_NIL;
+         idx = playlist->links[idx].prev)
+   {
+      const content_playlist_entry_t *entry = &playlist->entries[idx];
+
+      ptr = content_playlist_put_string(ptr,
+            entry->path ? entry->path : "", NULL);
+      ptr = content_playlist_put_string(ptr, entry->core_path,
+            prev ? prev->core_path : NULL);
+      ptr = content_playlist_put_string(ptr, entry->core_name,
+            prev ? prev->core_name : NULL);
+      prev = entry;
+   }
 
-   file = fopen(playlist->conf_path, "w");
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", playlist->conf_path);
 
+   file = fopen(tmp_path, "wb");
    if (!file)
+      goto end;
+
+   content_playlist_put_u32(header + 0, PLAYLIST_MAGIC);
+   content_playlist_put_u32(header + 4, PLAYLIST_VERSION);
+   ret = fwrite(header, 1, sizeof(header), file) == sizeof(header)
+      && content_playlist_write_record(file, buf, payload_size);
+
+   if (fclose(file) != 0)
+      ret = false;
+
+   if (ret)
+   {
+#ifdef _WIN32
+      /* rename() does not replace existing files on Windows. */
+      remove(playlist->conf_path);
+#endif
+      ret = rename(tmp_path, playlist->conf_path) == 0;
+   }
+
+   if (!ret)
+      remove(tmp_path);
+   else
+   {
+      playlist->journal_count = playlist->size;
+      playlist->needs_compact = false;
+   }
+
+end:
+   free(buf);
+   return ret;
+}
+
+/**
+ * content_playlist_journal:
+ * @playlist        	   : Playlist handle.
+ * @entry               : Pushed playlist entry.
+ *
+ * Appends a push to the playlist file, or rewrites it once
+ * the journal has grown too long.
+ **/
+static void content_playlist_journal(content_playlist_t *playlist,
+      const content_playlist_entry_t *entry)
+{
+   size_t payload_size;
+   uint8_t *buf, *ptr;
+   FILE *file = NULL;
+
+   if (!playlist->conf_path)
       return;
 
-   for (i = 0; i < playlist->size; i++)
-      fprintf(file, "%s\n%s\n%s\n",
-            playlist->entries[i].path ? playlist->entries[i].path : "",
-            playlist->entries[i].core_path,
-            playlist->entries[i].core_name);
+   if (playlist->needs_compact || playlist->journal_count
+         >= playlist->size * 2 + PLAYLIST_JOURNAL_SLACK)
+   {
+      content_playlist_compact(playlist);
+      return;
+   }
+
+   payload_size = 1
+      + content_playlist_string_size(entry->path ? entry->path : "", NULL)
+      + content_playlist_string_size(entry->core_path, NULL)
+      + content_playlist_string_size(entry->core_name, NULL);
+
+   /* If the record can't be appended, the push is only saved by
+    * rewriting the whole file, see content_playlist_free. */
+   buf = (uint8_t*)malloc(4 + payload_size + 4);
+   if (!buf)
+   {
+      playlist->needs_compact = true;
+      return;
+   }
+
+   ptr    = buf + 4;
+   *ptr++ = PLAYLIST_OP_PUSH;
+   ptr    = content_playlist_put_string(ptr,
+         entry->path ? entry->path : "", NULL);
+   ptr    = content_playlist_put_string(ptr, entry->core_path, NULL);
+   ptr    = content_playlist_put_string(ptr, entry->core_name, NULL);
+
+   file = fopen(playlist->conf_path, "ab");
+   if (file)
+   {
+      if (content_playlist_write_record(file, buf, payload_size))
+         playlist->journal_count++;
+      else
+         playlist->needs_compact = true;
+
+      if (fclose(file) != 0)
+         playlist->needs_compact = true;
+   }
+   else
+      playlist->needs_compact = true;
+
+   free(buf);
+}
+
+/**
+ * content_playlist_push:
+ * @playlist        	   : Playlist handle.
+ * @path                : Path of new playlist entry.
+ * @core_path           : Core path of new playlist entry.
+ * @core_name           : Core name of new playlist entry.
+ *
+ * Push entry to top of playlist.
+ **/
+void content_playlist_push(content_playlist_t *playlist,
+      const char *path, const char *core_path,
+      const char *core_name)
+{
+   content_playlist_entry_t entry;
 
-   fclose(file);
+   if (!playlist)
+      return;
+
+   if (!content_playlist_add(playlist, path, core_path, core_name))
+      return;
+
+   playlist->modified = true;
+
+   entry.path      = (char*)path;
+   entry.core_path = (char*)core_path;
+   entry.core_name = (char*)core_name;
+   content_playlist_journal(playlist, &entry);
 }
 
 /**
@@ -195,13 +742,19 @@ void content_playlist_free(content_playlist_t *playlist)
    if (!playlist)
       return;
 
-   if (playlist->conf_path)
-      content_playlist_write_file(playlist);
+   /* Pushes are journaled already, only a changed playlist
+    * that could not be journaled needs writing. */
+   if (playlist->conf_path && playlist->modified
+         && playlist->needs_compact)
+      content_playlist_compact(playlist);
    free(playlist->conf_path);
 
-   for (i = 0; i < playlist->cap; i++)
+   for (i = 0; i < playlist->size; i++)
       content_playlist_free_entry(&playlist->entries[i]);
    free(playlist->entries);
+   free(playlist->links);
+   free(playlist->order);
+   free(playlist->buckets);
 
    free(playlist);
 }
@@ -218,9 +771,19 @@ void content_playlist_clear(content_playlist_t *playlist)
    if (!playlist)
       return;
 
-   for (i = 0; i < playlist->cap; i++)
+   for (i = 0; i < playlist->size; i++)
       content_playlist_free_entry(&playlist->entries[i]);
    playlist->size = 0;
+
+   if (playlist->buckets)
+      memset(playlist->buckets, 0,
+            (playlist->bucket_mask + 1) * sizeof(*playlist->buckets));
+
+   playlist->head          = PLAYLIST_NIL;
+   playlist->tail          = PLAYLIST_NIL;
+   playlist->order_valid   = false;
+   playlist->modified      = true;
+   playlist->needs_compact = true;
 }
 
 /**
@@ -237,56 +800,186 @@ size_t content_playlist_size(content_playlist_t *playlist)
    return playlist->size;
 }
 
-static bool content_playlist_read_file(
-      content_playlist_t *playlist, const char *path)
+/**
+ * content_playlist_read_binary:
+ * @playlist        	   : Playlist handle.
+ * @buf                 : Contents of binary playlist file.
+ * @len                 : Size of @buf.
+ *
+ * Replays the records of a binary playlist file.
+ **/
+static void content_playlist_read_binary(content_playlist_t *playlist,
+      uint8_t *buf, size_t len)
 {
-   char buf[3][1024];
-   unsigned i;
-   content_playlist_entry_t *entry = NULL;
-   char *last = NULL;
-   FILE *file = fopen(path, "r");
+   size_t pos = 8;
 
-   /* If playlist file does not exist,
-    * create an empty playlist instead.
-    */
-   if (!file)
-      return true;
+   while (pos < len)
+   {
+      uint32_t i, count, payload_size;
+      uint8_t *payload, *ptr, *end;
+      char *prev_core_path = NULL;
+      char *prev_core_name = NULL;
+
+      if (len - pos < 4)
+         goto torn;
+
+      payload_size = content_playlist_get_u32(buf + pos);
+      if (!payload_size || len - pos - 4 < (size_t)payload_size + 4)
+         goto torn;
+
+      payload = buf + pos + 4;
+      end     = payload + payload_size;
+
+      if (crc32_calculate(payload, payload_size)
+            != content_playlist_get_u32(end))
+         goto torn;
+
+      ptr = payload + 1;
+
+      switch (*payload)
+      {
+         case PLAYLIST_OP_PUSH:
+            count = 1;
+            break;
+         case PLAYLIST_OP_SNAPSHOT:
+            if (end - ptr < 4)
+               goto torn;
+            count = content_playlist_get_u32(ptr);
+            ptr  += 4;
+            break;
+         default:
+            goto torn;
+      }
 
-   for (playlist->size = 0; playlist->size < playlist->cap; )
+      for (i = 0; i < count; i++)
+      {
+         char *path, *core_path, *core_name;
+
+         if (!content_playlist_get_string(&ptr, end, NULL, &path)
+               || !content_playlist_get_string(&ptr, end,
+                  prev_core_path, &core_path)
+               || !content_playlist_get_string(&ptr, end,
+                  prev_core_name, &core_name))
+            goto torn;
+
+         content_playlist_add(playlist, *path ? path : NULL,
+               core_path, core_name);
+         playlist->journal_count++;
+
+         prev_core_path = core_path;
+         prev_core_name = core_name;
+      }
+
+      pos += 4 + payload_size + 4;
+   }
+
+   return;
+
+torn:
+   /* Drop the torn record with the next write. */
+   playlist->needs_compact = true;
+}
+
+/**
+ * content_playlist_read_text:
+ * @playlist        	   : Playlist handle.
+ * @buf                 : Contents of text playlist file.
+ *
+ * Imports a text playlist file, three lines per entry,
+ * most recently used first.
+ **/
+static void content_playlist_read_text(content_playlist_t *playlist,
+      char *buf)
+{
+   size_t i, count = 0, cap = 0, valid = 0;
+   char **lines = NULL;
+   char *line   = buf;
+
+   while (*line)
    {
-      for (i = 0; i < 3; i++)
+      char *next = strchr(line, '\n');
+
+      if (count + 3 > cap)
       {
-         *buf[i] = '\0';
+         char **new_lines = NULL;
+
+         cap       = cap ? cap * 2 : 48;
+         new_lines = (char**)realloc(lines, cap * sizeof(*lines));
+         if (!new_lines)
+            break;
+         lines = new_lines;
+      }
 
-         if (!fgets(buf[i], sizeof(buf[i]), file))
-            goto end;
+      lines[count++] = line;
 
-         last = strrchr(buf[i], '\n');
-         if (last)
-            *last = '\0';
+      if (!next)
+         break;
+
+      *next = '\0';
+      line  = next + 1;
+   }
+
+   /* Skip incomplete entries, and entries that do not fit. */
+   count -= count % 3;
+
+   for (i = 0; i < count; i += 3)
+   {
+      if (!*lines[i + 1] || !*lines[i + 2])
+      {
+         lines[i] = NULL;
+         continue;
       }
 
-      entry = &playlist->entries[playlist->size];
+      if (playlist->cap && valid >= playlist->cap)
+         break;
+      valid++;
+   }
+   count = i;
 
-      if (!*buf[1] || !*buf[2])
+   /* Push oldest first. */
+   for (i = count; i >= 3; i -= 3)
+   {
+      if (!lines[i - 3])
          continue;
 
-      if (*buf[0])
-         entry->path = strdup(buf[0]);
-      entry->core_path = strdup(buf[1]);
-      entry->core_name = strdup(buf[2]);
-      playlist->size++;
+      content_playlist_add(playlist, *lines[i - 3] ? lines[i - 3] : NULL,
+            lines[i - 2], lines[i - 1]);
    }
 
-end:
-   fclose(file);
-   return true;
+   free(lines);
+}
+
+static void content_playlist_read_file(
+      content_playlist_t *playlist, const char *path)
+{
+   uint8_t *buf = NULL;
+   long len     = read_file(path, (void**)&buf);
+
+   /* If playlist file does not exist,
+    * create an empty playlist instead.
+    */
+   playlist->needs_compact = true;
+
+   if (len < 0 || !buf)
+      return;
+
+   if (len >= 8 && content_playlist_get_u32(buf) == PLAYLIST_MAGIC
+         && content_playlist_get_u32(buf + 4) == PLAYLIST_VERSION)
+   {
+      playlist->needs_compact = false;
+      content_playlist_read_binary(playlist, buf, len);
+   }
+   else
+      content_playlist_read_text(playlist, (char*)buf);
+
+   free(buf);
 }
 
 /**
  * content_playlist_init:
  * @path            	   : Path to playlist contents file.
- * @size                : Maximum capacity of playlist size.
+ * @size                : Maximum capacity of playlist size,
+ *                        0 for no limit.
  *
  * Creates and initializes a playlist.
  *
@@ -299,16 +992,16 @@ content_playlist_t *content_playlist_init(const char *path, size_t size)
    if (!playlist)
       return NULL;
 
-   playlist->entries = (content_playlist_entry_t*)calloc(size,
-         sizeof(*playlist->entries));
-   if (!playlist->entries)
-      goto error;
-
-   playlist->cap = size;
+   playlist->cap  = size;
+   playlist->head = PLAYLIST_NIL;
+   playlist->tail = PLAYLIST_NIL;
 
    content_playlist_read_file(playlist, path);
 
    playlist->conf_path = strdup(path);
+   if (!playlist->conf_path)
+      goto error;
+
    return playlist;
 
 error:
@@ -19,6 +19,8 @@
 #define CONTENT_HISTORY_H__
 
 #include <stddef.h>
+#include <stdint.h>
+#include <boolean.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,21 +33,48 @@ typedef struct content_playlist_entry
    char *core_name;
 } content_playlist_entry_t;
 
+/* Opaque. */
+struct content_playlist_link;
+
 typedef struct content_playlist
 {
+   /* Storage, in no particular order.
+    * Use content_playlist_get_index() for playlist order. */
    struct content_playlist_entry *entries;
+   struct content_playlist_link *links;
    size_t size;
+   size_t alloc;
+   /* Maximum number of entries, 0 for no limit. */
    size_t cap;
 
+   /* Most recently used list over entries. */
+   size_t head;
+   size_t tail;
+
+   /* Entries in playlist order, rebuilt when out of date. */
+   size_t *order;
+   bool order_valid;
+
+   /* Hash index on path, stores entry index + 1, 0 is empty. */
+   size_t *buckets;
+   size_t bucket_mask;
+
    char *conf_path;
+   /* Records in the playlist file, journaled pushes included. */
+   size_t journal_count;
+   /* Playlist file is not a binary playlist matching the entries. */
+   bool needs_compact;
+   bool modified;
 } content_playlist_t;
 
 /**
  * content_playlist_init:
  * @path            	   : Path to playlist contents file.
- * @size                : Maximum capacity of playlist size.
+ * @size                : Maximum capacity of playlist size,
+ *                        0 for no limit.
  *
- * Creates and initializes a playlist.
+ * Creates and initializes a playlist. Both binary and
+ * text playlist files are read.
  *
  * Returns: handle to new playlist if successful, otherwise NULL
  **/
@@ -98,7 +127,8 @@ void content_playlist_get_index(content_playlist_t *playlist,
  * @core_path           : Core path of new playlist entry.
  * @core_name           : Core name of new playlist entry.
  *
- * Push entry to top of playlist.
+ * Push entry to top of playlist. The push is appended
+ * to the playlist file right away.
  **/
 void content_playlist_push(content_playlist_t *playlist,
       const char *path, const char *core_path,
@@ -47,6 +47,7 @@ extern "C" {
 #include <queues/fifo_buffer.h>
 #include <rthreads/rthreads.h>
 #include "../../general.h"
+#include "../../performance.h"
 #include <gfx/scaler/scaler.h>
 #include <file/config_file.h>
 #include "../../audio/audio_utils.h"
@@ -62,13 +63,59 @@ extern "C" {
 #define av_frame_free avcodec_free_frame
 #endif
 
+#ifdef _MSC_VER
+#include <windows.h>
+#define FF_BARRIER() MemoryBarrier()
+#else
+#define FF_BARRIER() __sync_synchronize()
+#endif
+
+/* Frames copied from the core, waiting for conversion. */
+#define FF_RAW_FRAMES  16
+/* Converted frames, waiting for the encoder. */
+#define FF_CONV_FRAMES 4
+/* Must be a power of two, and larger than both pools
+ * so only repeated frames can fill up a queue. */
+#define FF_QUEUE_SIZE  64
+
+/* Single producer, single consumer queue. Items are passed without
+ * locking, the lock and condition are only used to sleep on. */
+struct ff_queue
+{
+   void *items[FF_QUEUE_SIZE];
+   volatile unsigned write;
+   volatile unsigned read;
+   volatile unsigned waiters;
+   volatile bool closed;
+   unsigned peak;
+
+   slock_t *lock;
+   scond_t *cond;
+};
+
+/* Frame copied from the core, tightly packed. */
+struct ff_raw_frame
+{
+   struct ffemu_video_data attr;
+   uint8_t *buf;
+};
+
+struct ff_conv_frame
+{
+   AVFrame *frame;
+   uint8_t *buf;
+};
+
 struct ff_video_info
 {
    AVCodecContext *codec;
    AVCodec *encoder;
 
-   AVFrame *conv_frame;
-   uint8_t *conv_frame_buf;
+   struct ff_raw_frame raw_frames[FF_RAW_FRAMES];
+   struct ff_conv_frame conv_frames[FF_CONV_FRAMES];
+   /* Queued instead of a frame to repeat the previous one. */
+   struct ff_raw_frame raw_dupe;
+   struct ff_conv_frame conv_dupe;
    int64_t frame_cnt;
 
    uint8_t *outbuf;
@@ -82,6 +129,16 @@ struct ff_video_info
    unsigned frame_drop_ratio;
    unsigned frame_drop_count;
 
+   /* Last frame queued by the core. Its buffer is only written
+    * to again once the core takes it back from raw_free, so
+    * it can be compared against without copying it. */
+   const struct ff_raw_frame *last_raw;
+
+   /* Repeated frames are left out rather than encoded again,
+    * but at least every max_repeat frames. */
+   bool vfr;
+   unsigned max_repeat;
+
    /* Input pixel size. */
    size_t pix_size;
 
@@ -151,6 +208,7 @@ struct ff_config_param
    unsigned scale_factor;
 
    bool audio_enable;
+   bool vfr;
    /* Keep same naming conventions as libavcodec. */
    bool audio_qscale;
    int audio_global_quality;
@@ -172,18 +230,181 @@ typedef struct ffmpeg
    
    struct ffemu_params params;
 
-   scond_t *cond;
-   slock_t *cond_lock;
-   slock_t *lock;
+   /* Frames flow from the core through raw_queue to the
+    * conversion thread, then through conv_queue to the video
+    * encoder. Buffers go back through the free queues. */
+   struct ff_queue raw_queue;
+   struct ff_queue raw_free;
+   struct ff_queue conv_queue;
+   struct ff_queue conv_free;
+
+   slock_t *audio_lock;
+   scond_t *audio_cond;
    fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
-   sthread_t *thread;
+   volatile bool audio_closed;
+
+   /* Both encoders write packets to the muxer. */
+   slock_t *mux_lock;
+
+   sthread_t *convert_thread;
+   sthread_t *video_thread;
+   sthread_t *audio_thread;
 
    volatile bool alive;
-   volatile bool can_sleep;
+
+   /* Back-pressure on the core. */
+   struct
+   {
+      unsigned frames;
+      /* The core waited for a free buffer or space in a queue. */
+      unsigned video_stalls;
+      unsigned audio_stalls;
+      /* Identical to the previous frame, not converted. */
+      unsigned deduped;
+      /* Left out of the stream, see ff_video_info::vfr. */
+      unsigned skipped;
+   } stats;
 } ffmpeg_t;
 
+static bool ff_queue_init(struct ff_queue *queue)
+{
+   queue->lock = slock_new();
+   queue->cond = scond_new();
+   return queue->lock && queue->cond;
+}
+
+static void ff_queue_free(struct ff_queue *queue)
+{
+   if (queue->lock)
+      slock_free(queue->lock);
+   if (queue->cond)
+      scond_free(queue->cond);
+   queue->lock = NULL;
+   queue->cond = NULL;
+}
+
+static bool ff_queue_put(struct ff_queue *queue, void *item)
+{
+   unsigned depth = queue->write - queue->read;
+
+   if (depth >= FF_QUEUE_SIZE)
+      return false;
+
+   queue->items[queue->write & (FF_QUEUE_SIZE - 1)] = item;
+   FF_BARRIER();
+   queue->write++;
+
+   if (depth + 1 > queue->peak)
+      queue->peak = depth + 1;
+   return true;
+}
+
+static void *ff_queue_take(struct ff_queue *queue)
+{
+   void *item;
+
+   if (queue->write == queue->read)
+      return NULL;
+
+   FF_BARRIER();
+   item = queue->items[queue->read & (FF_QUEUE_SIZE - 1)];
+   FF_BARRIER();
+   queue->read++;
+   return item;
+}
+
+/* Wakes the other side if it sleeps, which it can only do
+ * after announcing itself in waiters. */
+static void ff_queue_wake(struct ff_queue *queue)
+{
+   FF_BARRIER();
+   if (!queue->waiters)
+      return;
+
+   slock_lock(queue->lock);
+   scond_broadcast(queue->cond);
+   slock_unlock(queue->lock);
+}
+
+static bool ff_queue_try_push(struct ff_queue *queue, void *item)
+{
+   if (!ff_queue_put(queue, item))
+      return false;
+
+   ff_queue_wake(queue);
+   return true;
+}
+
+static void *ff_queue_try_pop(struct ff_queue *queue)
+{
+   void *item = ff_queue_take(queue);
+
+   if (item)
+      ff_queue_wake(queue);
+   return item;
+}
+
+/**
+ * ff_queue_push:
+ * @queue             : queue to push to.
+ * @item              : item to push.
+ *
+ * Pushes @item, waiting for space if @queue is full.
+ *
+ * Returns: false if it had to wait.
+ **/
+static bool ff_queue_push(struct ff_queue *queue, void *item)
+{
+   if (ff_queue_try_push(queue, item))
+      return true;
+
+   slock_lock(queue->lock);
+   queue->waiters++;
+   FF_BARRIER();
+   while (!ff_queue_put(queue, item))
+      scond_wait(queue->cond, queue->lock);
+   queue->waiters--;
+   scond_broadcast(queue->cond);
+   slock_unlock(queue->lock);
+
+   return false;
+}
+
+/**
+ * ff_queue_pop:
+ * @queue             : queue to pop from.
+ *
+ * Pops the next item, waiting for one if @queue is empty.
+ *
+ * Returns: next item, or NULL once @queue is closed and empty.
+ **/
+static void *ff_queue_pop(struct ff_queue *queue)
+{
+   void *item = ff_queue_try_pop(queue);
+
+   if (item)
+      return item;
+
+   slock_lock(queue->lock);
+   queue->waiters++;
+   FF_BARRIER();
+   while (!(item = ff_queue_take(queue)) && !queue->closed)
+      scond_wait(queue->cond, queue->lock);
+   queue->waiters--;
+   scond_broadcast(queue->cond);
+   slock_unlock(queue->lock);
+
+   return item;
+}
+
+static void ff_queue_close(struct ff_queue *queue)
+{
+   slock_lock(queue->lock);
+   queue->closed = true;
+   scond_broadcast(queue->cond);
+   slock_unlock(queue->lock);
+}
+
 static bool ffmpeg_codec_has_sample_format(enum AVSampleFormat fmt,
       const enum AVSampleFormat *fmts)
 {
@@ -356,6 +577,8 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle)
 
 static bool ffmpeg_init_video(ffmpeg_t *handle)
 {
+   unsigned i;
+   size_t size;
    struct ff_config_param *params = &handle->config;
    struct ff_video_info *video    = &handle->video;
    struct ffemu_params *param     = &handle->params;
@@ -412,6 +635,9 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
       video->scaler.out_fmt = SCALER_FMT_BGR24;
    }
 
+   /* Recording at high resolutions is bound by the scaler. */
+   video->scaler.threads = rarch_get_cpu_cores();
+
    switch (param->pix_fmt)
    {
       case FFEMU_PIX_RGB565:
@@ -476,13 +702,26 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    video->outbuf = (uint8_t*)av_malloc(video->outbuf_size);
 
    video->frame_drop_ratio = params->frame_drop_ratio;
+   video->vfr              = params->vfr;
+   video->max_repeat       = param->fps / params->frame_drop_ratio;
+   if (!video->max_repeat)
+      video->max_repeat = 1;
 
-   size_t size = avpicture_get_size(video->pix_fmt, param->out_width,
+   size = avpicture_get_size(video->pix_fmt, param->out_width,
          param->out_height);
-   video->conv_frame_buf = (uint8_t*)av_malloc(size);
-   video->conv_frame = av_frame_alloc();
-   avpicture_fill((AVPicture*)video->conv_frame, video->conv_frame_buf,
-         video->pix_fmt, param->out_width, param->out_height);
+
+   for (i = 0; i < FF_CONV_FRAMES; i++)
+   {
+      struct ff_conv_frame *conv = &video->conv_frames[i];
+
+      conv->buf   = (uint8_t*)av_malloc(size);
+      conv->frame = av_frame_alloc();
+      if (!conv->buf || !conv->frame)
+         return false;
+
+      avpicture_fill((AVPicture*)conv->frame, conv->buf,
+            video->pix_fmt, param->out_width, param->out_height);
+   }
 
    return true;
 }
@@ -523,6 +762,7 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
    if (!config_get_bool(params->conf, "audio_enable", &params->audio_enable))
       params->audio_enable = true;
 
+   config_get_bool(params->conf, "vfr", &params->vfr);
    config_get_uint(params->conf, "sample_rate", &params->sample_rate);
    config_get_uint(params->conf, "scale_factor", &params->scale_factor);
 
@@ -614,73 +854,138 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
 
 #define MAX_FRAMES 32
 
-static void ffmpeg_thread(void *data);
+/* Registered from init_thread, as the threads must not race
+ * on the counter list. */
+static struct retro_perf_counter ffmpeg_convert_perf =
+   {"ffmpeg_convert"};
+static struct retro_perf_counter ffmpeg_encode_video_perf =
+   {"ffmpeg_encode_video"};
+static struct retro_perf_counter ffmpeg_encode_audio_perf =
+   {"ffmpeg_encode_audio"};
+
+static void ffmpeg_convert_thread(void *data);
+static void ffmpeg_video_thread(void *data);
+static void ffmpeg_audio_thread(void *data);
 
 static bool init_thread(ffmpeg_t *handle)
 {
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
+   unsigned i;
+
+   if (!ff_queue_init(&handle->raw_queue)
+         || !ff_queue_init(&handle->raw_free)
+         || !ff_queue_init(&handle->conv_queue)
+         || !ff_queue_init(&handle->conv_free))
+      return false;
+
+   handle->audio_lock = slock_new();
+   handle->audio_cond = scond_new();
+   handle->mux_lock   = slock_new();
    handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
          handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct ffemu_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
 
-   handle->alive = true;
-   handle->can_sleep = true;
-   handle->thread = sthread_create(ffmpeg_thread, handle);
+   if (!handle->audio_lock || !handle->audio_cond
+         || !handle->mux_lock || !handle->audio_fifo)
+      return false;
 
-   assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   for (i = 0; i < FF_RAW_FRAMES; i++)
+   {
+      struct ff_raw_frame *raw = &handle->video.raw_frames[i];
 
-   return true;
+      /* For some reason, FFmpeg has a tendency to crash 
+       * if we don't overallocate a bit. */
+      raw->buf = (uint8_t*)av_malloc(2 * handle->params.fb_width *
+            handle->params.fb_height * handle->video.pix_size);
+      if (!raw->buf)
+         return false;
+
+      ff_queue_try_push(&handle->raw_free, raw);
+   }
+
+   for (i = 0; i < FF_CONV_FRAMES; i++)
+      ff_queue_try_push(&handle->conv_free, &handle->video.conv_frames[i]);
+
+   handle->video.raw_dupe.attr.is_dupe = true;
+
+   rarch_perf_register(&ffmpeg_convert_perf);
+   rarch_perf_register(&ffmpeg_encode_video_perf);
+   rarch_perf_register(&ffmpeg_encode_audio_perf);
+
+   handle->alive          = true;
+   handle->convert_thread = sthread_create(ffmpeg_convert_thread, handle);
+   handle->video_thread   = sthread_create(ffmpeg_video_thread, handle);
+   if (handle->config.audio_enable)
+      handle->audio_thread = sthread_create(ffmpeg_audio_thread, handle);
+
+   return handle->convert_thread && handle->video_thread
+      && (handle->audio_thread || !handle->config.audio_enable);
 }
 
+/* Lets the threads drain what is queued and joins them. */
 static void deinit_thread(ffmpeg_t *handle)
 {
-   if (!handle->thread)
+   if (!handle->alive)
       return;
 
-   slock_lock(handle->cond_lock);
    handle->alive = false;
-   handle->can_sleep = false;
-   slock_unlock(handle->cond_lock);
 
-   scond_signal(handle->cond);
-   sthread_join(handle->thread);
+   /* The conversion thread closes conv_queue as it exits. */
+   ff_queue_close(&handle->raw_queue);
+   if (handle->convert_thread)
+      sthread_join(handle->convert_thread);
+   else
+      ff_queue_close(&handle->conv_queue);
+
+   if (handle->video_thread)
+      sthread_join(handle->video_thread);
 
-   slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
+   slock_lock(handle->audio_lock);
+   handle->audio_closed = true;
+   scond_broadcast(handle->audio_cond);
+   slock_unlock(handle->audio_lock);
 
-   handle->thread = NULL;
+   if (handle->audio_thread)
+      sthread_join(handle->audio_thread);
+
+   handle->convert_thread = NULL;
+   handle->video_thread   = NULL;
+   handle->audio_thread   = NULL;
 }
 
 static void deinit_thread_buf(ffmpeg_t *handle)
 {
+   unsigned i;
+
    if (handle->audio_fifo)
    {
       fifo_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
-   
-   if (handle->attr_fifo)
-   {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
-   }
 
-   if (handle->video_fifo)
+   if (handle->audio_lock)
+      slock_free(handle->audio_lock);
+   if (handle->audio_cond)
+      scond_free(handle->audio_cond);
+   if (handle->mux_lock)
+      slock_free(handle->mux_lock);
+   handle->audio_lock = NULL;
+   handle->audio_cond = NULL;
+   handle->mux_lock   = NULL;
+
+   ff_queue_free(&handle->raw_queue);
+   ff_queue_free(&handle->raw_free);
+   ff_queue_free(&handle->conv_queue);
+   ff_queue_free(&handle->conv_free);
+
+   for (i = 0; i < FF_RAW_FRAMES; i++)
    {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
+      av_free(handle->video.raw_frames[i].buf);
+      handle->video.raw_frames[i].buf = NULL;
    }
 }
 
 static void ffmpeg_free(void *data)
 {
+   unsigned i;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    if (!handle)
       return;
@@ -702,8 +1007,11 @@ static void ffmpeg_free(void *data)
       av_free(handle->video.codec);
    }
 
-   av_frame_free(&handle->video.conv_frame);
-   av_free(handle->video.conv_frame_buf);
+   for (i = 0; i < FF_CONV_FRAMES; i++)
+   {
+      av_frame_free(&handle->video.conv_frames[i].frame);
+      av_free(handle->video.conv_frames[i].buf);
+   }
 
    scaler_ctx_gen_reset(&handle->video.scaler);
 
@@ -766,17 +1074,50 @@ error:
    return NULL;
 }
 
+/**
+ * ffmpeg_frame_equal:
+ * @frame             : previously queued frame.
+ * @data              : frame from the core.
+ *
+ * Compares row by row, as the core's pitch usually differs from
+ * the packed one. memcmp is vectorized by libc and stops at the
+ * first difference, so changed frames rarely get read in full.
+ *
+ * Returns: true if @data is identical to @frame.
+ **/
+static bool ffmpeg_frame_equal(const struct ff_raw_frame *frame,
+      const struct ffemu_video_data *data)
+{
+   unsigned y;
+   const uint8_t *src = (const uint8_t*)data->data;
+   const uint8_t *dst = frame->buf;
+
+   if (frame->attr.width != data->width
+         || frame->attr.height != data->height)
+      return false;
+
+   for (y = 0; y < data->height; y++,
+         src += data->pitch, dst += frame->attr.pitch)
+      if (memcmp(src, dst, frame->attr.pitch))
+         return false;
+
+   return true;
+}
+
 static bool ffmpeg_push_video(void *data,
       const struct ffemu_video_data *video_data)
 {
    unsigned y;
    bool drop_frame;
-   struct ffemu_video_data attr_data;
+   struct ff_raw_frame *frame = NULL;
    ffmpeg_t *handle = (ffmpeg_t*)data;
 
    if (!handle || !video_data)
       return false;
 
+   if (!handle->alive)
+      return false;
+
    drop_frame = handle->video.frame_drop_count++ %
       handle->video.frame_drop_ratio;
 
@@ -785,53 +1126,50 @@ static bool ffmpeg_push_video(void *data,
    if (drop_frame)
       return true;
 
-   for (;;)
-   {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->attr_fifo);
-      slock_unlock(handle->lock);
+   handle->stats.frames++;
 
-      if (!handle->alive)
-         return false;
+   if (!video_data->is_dupe && handle->video.last_raw
+         && ffmpeg_frame_equal(handle->video.last_raw, video_data))
+   {
+      handle->stats.deduped++;
+      if (!ff_queue_push(&handle->raw_queue, &handle->video.raw_dupe))
+         handle->stats.video_stalls++;
+      return true;
+   }
 
-      if (avail >= sizeof(*video_data))
-         break;
+   if (!video_data->is_dupe)
+   {
+      frame = (struct ff_raw_frame*)ff_queue_try_pop(&handle->raw_free);
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
+      /* Wait for the encoder rather than lose the frame. */
+      if (!frame)
       {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
+         handle->stats.video_stalls++;
+         frame = (struct ff_raw_frame*)ff_queue_pop(&handle->raw_free);
       }
-      else
-         scond_signal(handle->cond);
-
-      slock_unlock(handle->cond_lock);
    }
 
-   slock_lock(handle->lock);
-
-   /* Tightly pack our frame to conserve memory.
-    * libretro tends to use a very large pitch.
-    */
-   attr_data = *video_data;
+   if (frame)
+   {
+      const uint8_t *src = (const uint8_t*)video_data->data;
 
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
-   else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
+      /* Tightly pack our frame to conserve memory.
+       * libretro tends to use a very large pitch.
+       */
+      frame->attr       = *video_data;
+      frame->attr.pitch = video_data->width * handle->video.pix_size;
+      frame->attr.data  = frame->buf;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+      for (y = 0; y < video_data->height; y++, src += video_data->pitch)
+         memcpy(frame->buf + y * frame->attr.pitch, src, frame->attr.pitch);
 
-   int offset = 0;
-   for (y = 0; y < attr_data.height; y++, offset += video_data->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)video_data->data + offset, attr_data.pitch);
+      handle->video.last_raw = frame;
+   }
+   else
+      frame = &handle->video.raw_dupe;
 
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   if (!ff_queue_push(&handle->raw_queue, frame))
+      handle->stats.video_stalls++;
 
    return true;
 }
@@ -839,7 +1177,9 @@ static bool ffmpeg_push_video(void *data,
 static bool ffmpeg_push_audio(void *data,
       const struct ffemu_audio_data *audio_data)
 {
+   bool stalled     = false;
    ffmpeg_t *handle = (ffmpeg_t*)data;
+   size_t size;
 
    if (!handle || !audio_data)
       return false;
@@ -847,38 +1187,26 @@ static bool ffmpeg_push_audio(void *data,
    if (!handle->config.audio_enable)
       return true;
 
-   for (;;)
-   {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->audio_fifo);
-      slock_unlock(handle->lock);
-
-      if (!handle->alive)
-         return false;
-
-      if (avail >= audio_data->frames * handle->params.channels
-            * sizeof(int16_t))
-         break;
+   size = audio_data->frames * handle->params.channels * sizeof(int16_t);
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
+   slock_lock(handle->audio_lock);
+   while (fifo_write_avail(handle->audio_fifo) < size && handle->alive)
+   {
+      if (!stalled)
+         handle->stats.audio_stalls++;
+      stalled = true;
+      scond_wait(handle->audio_cond, handle->audio_lock);
+   }
 
-      slock_unlock(handle->cond_lock);
+   if (!handle->alive)
+   {
+      slock_unlock(handle->audio_lock);
+      return false;
    }
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, audio_data->data,
-         audio_data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   fifo_write(handle->audio_fifo, audio_data->data, size);
+   scond_broadcast(handle->audio_cond);
+   slock_unlock(handle->audio_lock);
 
    return true;
 }
@@ -919,7 +1247,7 @@ static bool encode_video(ffmpeg_t *handle, AVPacket *pkt, AVFrame *frame)
 }
 
 static void ffmpeg_scale_input(ffmpeg_t *handle,
-      const struct ffemu_video_data *data)
+      const struct ffemu_video_data *data, AVFrame *frame)
 {
    /* Attempt to preserve more information if we scale down. */
    bool shrunk = handle->params.out_width < data->width
@@ -935,8 +1263,7 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
 
       int linesize = data->pitch;
       sws_scale(handle->video.sws, (const uint8_t* const*)&data->data,
-            &linesize, 0, data->height, handle->video.conv_frame->data,
-            handle->video.conv_frame->linesize);
+            &linesize, 0, data->height, frame->data, frame->linesize);
    }
    else
    {
@@ -952,35 +1279,37 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
 
          handle->video.scaler.out_width  = handle->params.out_width;
          handle->video.scaler.out_height = handle->params.out_height;
-         handle->video.scaler.out_stride = 
-            handle->video.conv_frame->linesize[0];
+         handle->video.scaler.out_stride = frame->linesize[0];
 
          scaler_ctx_gen_filter(&handle->video.scaler);
       }
 
-      scaler_ctx_scale(&handle->video.scaler,
-            handle->video.conv_frame->data[0], data->data);
+      scaler_ctx_scale(&handle->video.scaler, frame->data[0], data->data);
    }
 }
 
-static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
-      const struct ffemu_video_data *data)
+static bool ffmpeg_write_packet(ffmpeg_t *handle, AVPacket *pkt)
 {
-   AVPacket pkt;
+   int ret;
 
-   if (!data->is_dupe)
-      ffmpeg_scale_input(handle, data);
+   slock_lock(handle->mux_lock);
+   ret = av_interleaved_write_frame(handle->muxer.ctx, pkt);
+   slock_unlock(handle->mux_lock);
+
+   return ret >= 0;
+}
+
+static bool ffmpeg_push_video_thread(ffmpeg_t *handle, AVFrame *frame)
+{
+   AVPacket pkt;
 
-   handle->video.conv_frame->pts = handle->video.frame_cnt;
+   frame->pts = handle->video.frame_cnt;
 
-   if (!encode_video(handle, &pkt, handle->video.conv_frame))
+   if (!encode_video(handle, &pkt, frame))
       return false;
 
-   if (pkt.size)
-   {
-      if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
-         return false;
-   }
+   if (pkt.size && !ffmpeg_write_packet(handle, &pkt))
+      return false;
 
    handle->video.frame_cnt++;
    return true;
@@ -1205,11 +1534,8 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
       handle->audio.frame_cnt       += handle->audio.frames_in_buffer;
       handle->audio.frames_in_buffer = 0;
 
-      if (pkt.size)
-      {
-         if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
-            return false;
-      }
+      if (pkt.size && !ffmpeg_write_packet(handle, &pkt))
+         return false;
    }
 
    return true;
@@ -1235,7 +1561,7 @@ static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
    {
       AVPacket pkt;
       if (!encode_audio(handle, &pkt, true) || !pkt.size ||
-            av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+            !ffmpeg_write_packet(handle, &pkt))
          break;
    }
 }
@@ -1246,16 +1572,14 @@ static void ffmpeg_flush_video(ffmpeg_t *handle)
    {
       AVPacket pkt;
       if (!encode_video(handle, &pkt, NULL) || !pkt.size ||
-            av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+            !ffmpeg_write_packet(handle, &pkt))
          break;
    }
 }
 
+/* Runs once the threads are joined. */
 static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
-   bool did_work;
-   void *video_buf = av_malloc(2 * handle->params.fb_width * 
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ? 
       (handle->audio.codec->frame_size * 
        handle->params.channels * sizeof(int16_t)) : 0;
@@ -1263,50 +1587,27 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
    if (audio_buf_size)
       audio_buf = av_malloc(audio_buf_size);
-   /* Try pushing data in an interleaving pattern to 
-    * ease the work of the muxer a bit. */
 
-   do
+   if (handle->config.audio_enable && audio_buf)
    {
-      struct ffemu_video_data attr_buf;
-
-      did_work = false;
-
-      if (handle->config.audio_enable)
+      while (fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
       {
-         if (fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
-         {
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
-
-            struct ffemu_audio_data aud = {0};
-            aud.frames = handle->audio.codec->frame_size;
-            aud.data = audio_buf;
-
-            ffmpeg_push_audio_thread(handle, &aud, true);
-            did_work = true;
-         }
-      }
+         struct ffemu_audio_data aud = {0};
 
-      if (fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
-      {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf, 
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
+         fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
+         aud.frames = handle->audio.codec->frame_size;
+         aud.data = audio_buf;
 
-         did_work = true;
+         ffmpeg_push_audio_thread(handle, &aud, true);
       }
-   } while (did_work);
 
-   /* Flush out last audio. */
-   if (handle->config.audio_enable)
+      /* Flush out last audio. */
       ffmpeg_flush_audio(handle, audio_buf, audio_buf_size);
+   }
 
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -1322,6 +1623,15 @@ static bool ffmpeg_finalize(void *data)
    /* Flush out data still in buffers (internal, and FFmpeg internal). */
    ffmpeg_flush_buffers(handle);
 
+   RARCH_LOG("[FFmpeg]: %u frames, "
+         "%u video / %u audio stalls, peak queue %u/%u.\n",
+         handle->stats.frames,
+         handle->stats.video_stalls, handle->stats.audio_stalls,
+         handle->raw_queue.peak, handle->conv_queue.peak);
+   RARCH_LOG("[FFmpeg]: %u frames identical to the previous one, "
+         "%u left out of the stream.\n",
+         handle->stats.deduped, handle->stats.skipped);
+
    deinit_thread_buf(handle);
 
    /* Write final data. */
@@ -1330,80 +1640,129 @@ static bool ffmpeg_finalize(void *data)
    return true;
 }
 
-static void ffmpeg_thread(void *data)
+/* Converts frames queued by the core to the output format.
+ * The scaler splits large frames over its own threads. */
+static void ffmpeg_convert_thread(void *data)
 {
+   struct ff_raw_frame *raw;
    ffmpeg_t *ff = (ffmpeg_t*)data;
 
-   /* For some reason, FFmpeg has a tendency to crash 
-    * if we don't overallocate a bit. */
-   void *video_buf = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
-   assert(video_buf);
+   while ((raw = (struct ff_raw_frame*)ff_queue_pop(&ff->raw_queue)))
+   {
+      struct ff_conv_frame *conv;
 
-   size_t audio_buf_size = ff->config.audio_enable ? 
-      (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
-   void *audio_buf = audio_buf_size ? av_malloc(audio_buf_size) : NULL;
+      if (raw->attr.is_dupe)
+      {
+         ff_queue_push(&ff->conv_queue, &ff->video.conv_dupe);
+         continue;
+      }
 
-   while (ff->alive)
-   {
-      struct ffemu_video_data attr_buf;
+      conv = (struct ff_conv_frame*)ff_queue_pop(&ff->conv_free);
+      if (!conv)
+         break;
 
-      bool avail_video = false;
-      bool avail_audio = false;
+      RARCH_PERFORMANCE_START(ffmpeg_convert_perf);
+      ffmpeg_scale_input(ff, &raw->attr, conv->frame);
+      RARCH_PERFORMANCE_STOP(ffmpeg_convert_perf);
 
-      slock_lock(ff->lock);
-      if (fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
+      ff_queue_push(&ff->raw_free, raw);
+      ff_queue_push(&ff->conv_queue, conv);
+   }
 
-      if (ff->config.audio_enable)
-         if (fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
-            avail_audio = true;
-      slock_unlock(ff->lock);
+   ff_queue_close(&ff->conv_queue);
+}
 
-      if (!avail_video && !avail_audio)
-      {
-         slock_lock(ff->cond_lock);
-         if (ff->can_sleep)
-         {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
-         }
-         else
-            scond_signal(ff->cond);
+static void ffmpeg_video_thread(void *data)
+{
+   struct ff_conv_frame *conv;
+   struct ff_conv_frame *last = NULL;
+   ffmpeg_t *ff = (ffmpeg_t*)data;
 
-         slock_unlock(ff->cond_lock);
-      }
+   unsigned repeats = 0;
 
-      if (avail_video)
+   while ((conv = (struct ff_conv_frame*)ff_queue_pop(&ff->conv_queue)))
+   {
+      if (conv != &ff->video.conv_dupe)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
+         if (last)
+            ff_queue_push(&ff->conv_free, last);
+         last    = conv;
+         repeats = 0;
       }
+      else if (!last)
+      {
+         /* Nothing to repeat yet. */
+         ff->video.frame_cnt++;
+         continue;
+      }
+      else if (ff->video.vfr && ++repeats < ff->video.max_repeat)
+      {
+         /* The timestamp of the next frame covers the gap. */
+         ff->stats.skipped++;
+         ff->video.frame_cnt++;
+         continue;
+      }
+      else
+         repeats = 0;
+
+      RARCH_PERFORMANCE_START(ffmpeg_encode_video_perf);
+      ffmpeg_push_video_thread(ff, last->frame);
+      RARCH_PERFORMANCE_STOP(ffmpeg_encode_video_perf);
+   }
 
-      if (avail_audio)
+   if (last)
+   {
+      /* Let the last frame last until the end. */
+      if (repeats)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
+         ff->video.frame_cnt--;
+         ff->stats.skipped--;
+         ffmpeg_push_video_thread(ff, last->frame);
+      }
 
-         struct ffemu_audio_data aud = {0};
-         aud.frames = ff->audio.codec->frame_size;
-         aud.data = audio_buf;
+      ff_queue_push(&ff->conv_free, last);
+   }
+}
+
+/* Encodes audio in codec sized chunks. Whatever is left
+ * when recording stops is flushed by ffmpeg_flush_buffers. */
+static void ffmpeg_audio_thread(void *data)
+{
+   ffmpeg_t *ff = (ffmpeg_t*)data;
+   size_t audio_buf_size = ff->audio.codec->frame_size *
+      ff->params.channels * sizeof(int16_t);
+   void *audio_buf = av_malloc(audio_buf_size);
+
+   if (!audio_buf)
+      return;
+
+   for (;;)
+   {
+      struct ffemu_audio_data aud = {0};
+
+      slock_lock(ff->audio_lock);
+      while (fifo_read_avail(ff->audio_fifo) < audio_buf_size
+            && !ff->audio_closed)
+         scond_wait(ff->audio_cond, ff->audio_lock);
 
-         ffmpeg_push_audio_thread(ff, &aud, true);
+      if (ff->audio_closed)
+      {
+         slock_unlock(ff->audio_lock);
+         break;
       }
+
+      fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
+      scond_broadcast(ff->audio_cond);
+      slock_unlock(ff->audio_lock);
+
+      aud.frames = ff->audio.codec->frame_size;
+      aud.data   = audio_buf;
+
+      RARCH_PERFORMANCE_START(ffmpeg_encode_audio_perf);
+      ffmpeg_push_audio_thread(ff, &aud, true);
+      RARCH_PERFORMANCE_STOP(ffmpeg_encode_audio_perf);
    }
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -25,6 +25,12 @@
 #include "dynamic.h"
 #include "content.h"
 #include "file_ops.h"
+#ifdef HAVE_COMPRESSION
+#include "file_archive_cache.h"
+#endif
+#ifdef HAVE_ZLIB
+#include "file_archive_index.h"
+#endif
 #include <file/file_path.h>
 #include <file/dir_list.h>
 #include "general.h"
@@ -32,7 +38,10 @@
 #include "settings.h"
 #include <compat/strl.h>
 #include "screenshot.h"
+#include "benchmark.h"
 #include "performance.h"
+#include <gfx/scaler/pixconv.h>
+#include <gfx/scaler/scaler.h>
 #include "cheats.h"
 #include <compat/getopt.h>
 #include <compat/posix_string.h>
@@ -211,6 +220,9 @@ static void print_help(void)
    puts("\t-P/--bsvplay: Playback a BSV movie file.");
    puts("\t-R/--bsvrecord: Start recording a BSV movie file from the beginning.");
    puts("\t--eof-exit: Exit upon reaching the end of the BSV movie file.");
+   puts("\t--bsvupgrade: Write the movie played back with -P to this path in BSV2 format.");
+   puts("\t\tUse together with --eof-exit to convert BSV1 movies.");
+   puts("\t--bsvseek: Start playback with -P from the keyframe at or before this frame.");
    puts("\t-M/--sram-mode: Takes an argument telling how SRAM should be handled in the session.");
    puts("\t\t{no,}load-{no,}save describes if SRAM should be loaded, and if SRAM should be saved.");
    puts("\t\tDo note that noload-save implies that save files will be deleted and overwritten.");
@@ -239,7 +251,11 @@ static void print_help(void)
    puts("\t--ips: Specifies path for IPS patch that will be applied to content.");
    puts("\t--no-patch: Disables all forms of content patching.");
    puts("\t-D/--detach: Detach " RETRO_FRONTEND " from the running console. Not relevant for all platforms.");
-   puts("\t--max-frames: Runs for the specified number of frames, then exits.\n");
+   puts("\t--max-frames: Runs for the specified number of frames, then exits.");
+   puts("\t--benchmark: Runs headless without frame limiting and writes a JSON report to this path on exit.");
+   puts("\t\tUse together with -P and --max-frames or --eof-exit.");
+   puts("\t--evdev-replay: Plays back a raw evdev event stream (as read from /dev/input/event*)");
+   puts("\t\twith its original timing, as an extra keyboard and mouse. Only supported by the udev input driver.\n");
 }
 
 static void set_basename(const char *path)
@@ -453,6 +469,10 @@ static void parse_input(int argc, char *argv[])
       { "subsystem", 1, NULL, 'Z' },
       { "max-frames", 1, NULL, 'm' },
       { "eof-exit", 0, &val, 'e' },
+      { "bsvupgrade", 1, &val, 'b' },
+      { "bsvseek", 1, &val, 'j' },
+      { "benchmark", 1, &val, 'k' },
+      { "evdev-replay", 1, &val, 'E' },
       { NULL, 0, NULL, 0 }
    };
 
@@ -736,6 +756,26 @@ static void parse_input(int argc, char *argv[])
                   g_extern.bsv.eof_exit = true;
                   break;
 
+               case 'b':
+                  strlcpy(g_extern.bsv.movie_upgrade_path, optarg,
+                        sizeof(g_extern.bsv.movie_upgrade_path));
+                  break;
+
+               case 'j':
+                  g_extern.bsv.movie_start_frame = strtoul(optarg, NULL, 0);
+                  break;
+
+               case 'k':
+                  g_extern.benchmark.enable = true;
+                  strlcpy(g_extern.benchmark.report_path, optarg,
+                        sizeof(g_extern.benchmark.report_path));
+                  break;
+
+               case 'E':
+                  strlcpy(g_extern.evdev_replay, optarg,
+                        sizeof(g_extern.evdev_replay));
+                  break;
+
                default:
                   break;
             }
@@ -941,6 +981,29 @@ static void init_movie(void)
       g_extern.bsv.movie_playback = true;
       msg_queue_push(g_extern.msg_queue, "Starting movie playback.", 2, 180);
       RARCH_LOG("Starting movie playback.\n");
+
+      /* The upgraded copy has to start from the first frame. */
+      if (g_extern.bsv.movie_start_frame && *g_extern.bsv.movie_upgrade_path)
+         RARCH_WARN("Ignoring --bsvseek, the movie is being upgraded.\n");
+      else if (g_extern.bsv.movie_start_frame)
+      {
+         uint32_t frame = bsv_movie_seek(g_extern.bsv.movie,
+               g_extern.bsv.movie_start_frame);
+
+         RARCH_LOG("Seeked movie to frame %u (requested %u).\n",
+               frame, g_extern.bsv.movie_start_frame);
+      }
+
+      if (*g_extern.bsv.movie_upgrade_path)
+      {
+         if (bsv_movie_upgrade(g_extern.bsv.movie,
+                  g_extern.bsv.movie_upgrade_path))
+            RARCH_LOG("Upgrading movie to \"%s\".\n",
+                  g_extern.bsv.movie_upgrade_path);
+         else
+            RARCH_ERR("Failed to upgrade movie to \"%s\".\n",
+                  g_extern.bsv.movie_upgrade_path);
+      }
       g_settings.rewind_granularity = 1;
    }
    else if (g_extern.bsv.movie_start_recording)
@@ -1336,12 +1399,14 @@ static void rarch_save_state(const char *path,
       return;
    }
 
+   /* The outcome is reported once the state is on disk,
+    * see check_save_state_written. */
    if (g_settings.state_slot < 0)
       snprintf(msg, sizeof_msg,
-            "Saved state to slot #-1 (auto).");
+            "Saving state to slot #-1 (auto).");
    else
       snprintf(msg, sizeof_msg,
-            "Saved state to slot #%d.", g_settings.state_slot);
+            "Saving state to slot #%d.", g_settings.state_slot);
 }
 
 static void main_state(unsigned cmd)
@@ -1657,6 +1722,13 @@ void rarch_main_state_new(void)
 {
    main_clear_state(g_extern.main_is_init);
    rarch_main_command(RARCH_CMD_MSG_QUEUE_INIT);
+
+#ifdef HAVE_COMPRESSION
+   archive_cache_init();
+#endif
+#ifdef HAVE_ZLIB
+   archive_index_init();
+#endif
 }
 
 void rarch_main_state_free(void)
@@ -1664,6 +1736,13 @@ void rarch_main_state_free(void)
    rarch_main_command(RARCH_CMD_MSG_QUEUE_DEINIT);
    rarch_main_command(RARCH_CMD_LOG_FILE_DEINIT);
 
+#ifdef HAVE_COMPRESSION
+   archive_cache_free();
+#endif
+#ifdef HAVE_ZLIB
+   archive_index_free_all();
+#endif
+
    main_clear_state(false);
 
 }
@@ -1749,6 +1828,10 @@ static void validate_cpu_features(void)
    if (!(cpu & RETRO_SIMD_AVX))
       FAIL_CPU("AVX");
 #endif
+
+   /* Pixel conversions and scalers are picked at runtime. */
+   conv_init_simd(cpu);
+   scaler_init_simd(cpu);
 }
 
 /**
@@ -1856,6 +1939,9 @@ int rarch_main_init(int argc, char *argv[])
    validate_cpu_features();
    config_load();
 
+   if (g_extern.benchmark.enable)
+      benchmark_init();
+
    init_libretro_sym(g_extern.libretro_dummy);
    init_system_info();
 
@@ -2800,6 +2886,9 @@ bool rarch_main_command(unsigned cmd)
  **/
 void rarch_main_deinit(void)
 {
+   if (g_extern.benchmark.enable)
+      benchmark_report(g_extern.benchmark.report_path);
+
    rarch_main_command(RARCH_CMD_NETPLAY_DEINIT);
    rarch_main_command(RARCH_CMD_COMMAND_DEINIT);
 
@@ -2814,6 +2903,7 @@ void rarch_main_deinit(void)
    rarch_main_command(RARCH_CMD_BSV_MOVIE_DEINIT);
 
    rarch_main_command(RARCH_CMD_AUTOSAVE_STATE);
+   save_state_deinit();
 
    rarch_main_command(RARCH_CMD_CORE_DEINIT);
 
@@ -19,10 +19,12 @@
 #include <file/file_path.h>
 #include "dynamic.h"
 #include "performance.h"
+#include "benchmark.h"
 #include "retroarch_logger.h"
 #include "intl/intl.h"
 #include "retroarch.h"
 #include "runloop.h"
+#include "content.h"
 
 #ifdef HAVE_MENU
 #include "menu/menu.h"
@@ -191,6 +193,33 @@ static void check_stateslots(bool pressed_increase, bool pressed_decrease)
    RARCH_LOG("%s\n", msg);
 }
 
+/**
+ * check_save_state_written:
+ *
+ * Reports savestates once the background writer is done with them,
+ * rather than when they were queued.
+ **/
+static void check_save_state_written(void)
+{
+   char path[PATH_MAX_LENGTH], msg[PATH_MAX_LENGTH];
+   bool success = false;
+
+   while (save_state_poll(path, sizeof(path), &success))
+   {
+      snprintf(msg, sizeof(msg), success ?
+            "Saved state to \"%s\"." : "Failed to save state to \"%s\".",
+            path_basename(path));
+
+      if (g_extern.msg_queue)
+      {
+         msg_queue_clear(g_extern.msg_queue);
+         msg_queue_push(g_extern.msg_queue, msg, 2, 180);
+      }
+
+      RARCH_LOG("%s\n", msg);
+   }
+}
+
 static inline void setup_rewind_audio(void)
 {
    unsigned i;
@@ -1022,6 +1051,7 @@ int rarch_main_iterate(void)
       update_frame_time();
 
    do_pre_state_checks(input, old_input, trigger_input);
+   check_save_state_written();
 
 #ifdef HAVE_NETWORKING
    if (g_extern.http_handle)
@@ -1108,6 +1138,12 @@ int rarch_main_iterate(void)
    if (g_extern.bsv.movie)
       bsv_movie_set_frame_end(g_extern.bsv.movie);
 
+   if (g_extern.perfcnt_enable)
+      rarch_perf_frame_mark();
+
+   if (g_extern.benchmark.enable)
+      benchmark_frame();
+
 #ifdef HAVE_NETPLAY
    if (driver.netplay_data)
       netplay_post_frame((netplay_t*)driver.netplay_data);
@@ -466,6 +466,7 @@ static void config_set_defaults(void)
    g_settings.rewind_enable = rewind_enable;
    g_settings.rewind_buffer_size = rewind_buffer_size;
    g_settings.rewind_granularity = rewind_granularity;
+   g_settings.archive_cache_size = archive_cache_size;
    g_settings.slowmotion_ratio = slowmotion_ratio;
    g_settings.fastforward_ratio = fastforward_ratio;
    g_settings.fastforward_ratio_throttle_enable = fastforward_ratio_throttle_enable;
@@ -474,6 +475,7 @@ static void config_set_defaults(void)
 
    g_settings.block_sram_overwrite = block_sram_overwrite;
    g_settings.savestate_auto_index = savestate_auto_index;
+   g_settings.savestate_compression = savestate_compression;
    g_settings.savestate_auto_save  = savestate_auto_save;
    g_settings.savestate_auto_load  = savestate_auto_load;
    g_settings.network_cmd_enable   = network_cmd_enable;
@@ -554,6 +556,7 @@ static void config_set_defaults(void)
    g_settings.input.overlay_scale = 1.0f;
    g_settings.input.autodetect_enable = input_autodetect_enable;
    *g_settings.input.keyboard_layout = '\0';
+   g_settings.input.threaded = input_threaded;
 
    for (i = 0; i < MAX_USERS; i++)
    {
@@ -1294,6 +1297,7 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_STRING(input.driver, "input_driver");
    CONFIG_GET_STRING(input.joypad_driver, "input_joypad_driver");
    CONFIG_GET_STRING(input.keyboard_layout, "input_keyboard_layout");
+   CONFIG_GET_BOOL(input.threaded, "input_threaded");
 
    if (!g_extern.has_set_libretro)
       CONFIG_GET_PATH(libretro, "libretro_path");
@@ -1387,6 +1391,11 @@ static bool config_load_file(const char *path, bool set_defaults)
       g_settings.rewind_buffer_size = buffer_size * UINT64_C(1000000);
 
    CONFIG_GET_INT(rewind_granularity, "rewind_granularity");
+
+   buffer_size = 0;
+   if (config_get_int(conf, "archive_cache_size", &buffer_size))
+      g_settings.archive_cache_size = buffer_size * UINT64_C(1000000);
+
    CONFIG_GET_FLOAT(slowmotion_ratio, "slowmotion_ratio");
    if (g_settings.slowmotion_ratio < 1.0f)
       g_settings.slowmotion_ratio = 1.0f;
@@ -1410,6 +1419,7 @@ static bool config_load_file(const char *path, bool set_defaults)
 
    CONFIG_GET_BOOL(block_sram_overwrite, "block_sram_overwrite");
    CONFIG_GET_BOOL(savestate_auto_index, "savestate_auto_index");
+   CONFIG_GET_BOOL(savestate_compression, "savestate_compression");
    CONFIG_GET_BOOL(savestate_auto_save, "savestate_auto_save");
    CONFIG_GET_BOOL(savestate_auto_load, "savestate_auto_load");
 
@@ -2046,6 +2056,8 @@ bool config_save_file(const char *path)
          g_settings.block_sram_overwrite);
    config_set_bool(conf, "savestate_auto_index",
          g_settings.savestate_auto_index);
+   config_set_bool(conf, "savestate_compression",
+         g_settings.savestate_compression);
    config_set_bool(conf, "savestate_auto_save",
          g_settings.savestate_auto_save);
    config_set_bool(conf, "savestate_auto_load",
@@ -2081,6 +2093,7 @@ bool config_save_file(const char *path)
          g_settings.input.joypad_driver);
    config_set_string(conf, "input_keyboard_layout",
          g_settings.input.keyboard_layout);
+   config_set_bool(conf, "input_threaded", g_settings.input.threaded);
    for (i = 0; i < MAX_USERS; i++)
    {
       char cfg[64];
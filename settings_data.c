@@ -126,21 +126,9 @@ void setting_data_reset(rarch_setting_t* settings)
 rarch_setting_t* setting_data_find_setting(rarch_setting_t* settings,
       const char* name)
 {
-   bool found = false;
+   settings = settings_list_find(settings, name);
 
-   if (!settings || !name)
-      return NULL;
-
-   for (; settings->type != ST_NONE; settings++)
-   {
-      if (settings->type <= ST_GROUP && !strcmp(settings->name, name))
-      {
-         found = true;
-         break;
-      }
-   }
-
-   if (!found)
+   if (!settings)
       return NULL;
 
    if (settings->short_description && settings->short_description[0] == '\0')
@@ -2428,6 +2416,16 @@ int setting_data_get_description(const char *label, char *msg,
             "Will attempt to auto-configure \n"
             "joypads, Plug-and-Play style.");
    }
+   else if (!strcmp(label, "input_threaded"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Read input events on a thread \n"
+            "as they arrive.\n"
+            " \n"
+            "Events are applied when the core polls \n"
+            "input, instead of being read once per \n"
+            "frame. Only supported by the udev driver.");
+   }
    else if (!strcmp(label, "camera_allow"))
    {
       snprintf(msg, sizeof_msg,
@@ -3678,6 +3676,20 @@ static bool setting_data_append_list_general_options(
          general_write_handler,
          general_read_handler);
 
+#ifdef HAVE_ZLIB_DEFLATE
+   CONFIG_BOOL(
+         g_settings.savestate_compression,
+         "savestate_compression",
+         "Save State Compression",
+         savestate_compression,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+#endif
+
    CONFIG_BOOL(
          g_settings.savestate_auto_save,
          "savestate_auto_save",
@@ -4648,6 +4660,22 @@ static bool setting_data_append_list_input_options(
          general_write_handler,
          general_read_handler);
 
+#if defined(HAVE_THREADS) && defined(HAVE_UDEV)
+   CONFIG_BOOL(
+         g_settings.input.threaded,
+         "input_threaded",
+         "Threaded Input",
+         input_threaded,
+         "OFF",
+         "ON",
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_cmd(list, list_info, RARCH_CMD_REINIT);
+   settings_data_list_current_add_flags(list, list_info, SD_FLAG_CMD_APPLY_AUTO);
+#endif
+
    CONFIG_BOOL(
          g_settings.input.autoconfig_descriptor_label_show,
          "autoconfig_descriptor_label_show",
@@ -6248,6 +6276,9 @@ rarch_setting_t *setting_data_new(unsigned mask)
    else
       goto error;
 
+   if (!settings_list_build_index(list))
+      goto error;
+
    settings_info_list_free(list_info);
 
    return list;
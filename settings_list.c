@@ -14,8 +14,43 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "settings_list.h"
 
+typedef struct settings_list_slot
+{
+   uint32_t hash;
+   /* Setting index + 1, 0 is empty. */
+   uint32_t idx;
+} settings_list_slot_t;
+
+struct settings_list_index
+{
+   settings_list_slot_t *slots;
+   size_t mask;
+};
+
+static uint32_t settings_list_hash(const char *name)
+{
+   uint32_t hash = 5381;
+   while (*name)
+      hash = (hash << 5) + hash + (uint8_t)*name++;
+   return hash;
+}
+
+/* Only settings of these types can be looked up by name. */
+static bool settings_list_is_named(const rarch_setting_t *setting)
+{
+   return setting->type <= ST_GROUP && setting->name;
+}
+
+static void settings_list_free_index(rarch_setting_t *list)
+{
+   free(list->name_index);
+   list->name_index = NULL;
+}
+
 void settings_info_list_free(rarch_setting_info_t *list_info)
 {
    if (list_info)
@@ -52,7 +87,8 @@ bool settings_list_append(rarch_setting_t **list,
          return false;
    }
 
-   (*list)[list_info->index++] = value;
+   (*list)[list_info->index] = value;
+   (*list)[list_info->index++].name_index = NULL;
    return true;
 }
 
@@ -122,8 +158,100 @@ void settings_list_current_add_cmd(
 
 void settings_list_free(rarch_setting_t *list)
 {
-   if (list)
-      free(list);
+   if (!list)
+      return;
+
+   settings_list_free_index(list);
+   free(list);
+}
+
+bool settings_list_build_index(rarch_setting_t *list)
+{
+   size_t i, count = 0, slot_count = 16;
+   struct settings_list_index *index = NULL;
+
+   if (!list)
+      return false;
+
+   settings_list_free_index(list);
+
+   for (i = 0; list[i].type != ST_NONE; i++)
+      if (settings_list_is_named(&list[i]))
+         count++;
+
+   while (slot_count < count * 2)
+      slot_count *= 2;
+
+   index = (struct settings_list_index*)calloc(1,
+         sizeof(*index) + slot_count * sizeof(*index->slots));
+   if (!index)
+      return false;
+
+   index->slots = (settings_list_slot_t*)(index + 1);
+   index->mask  = slot_count - 1;
+
+   for (i = 0; list[i].type != ST_NONE; i++)
+   {
+      size_t j;
+      uint32_t hash;
+
+      if (!settings_list_is_named(&list[i]))
+         continue;
+
+      hash = settings_list_hash(list[i].name);
+
+      /* Keep the first setting of a name, like a linear search. */
+      for (j = hash & index->mask; index->slots[j].idx;
+            j = (j + 1) & index->mask)
+      {
+         if (index->slots[j].hash == hash
+               && !strcmp(list[index->slots[j].idx - 1].name, list[i].name))
+            break;
+      }
+
+      if (index->slots[j].idx)
+         continue;
+
+      index->slots[j].hash = hash;
+      index->slots[j].idx  = i + 1;
+   }
+
+   list->name_index = index;
+   return true;
+}
+
+rarch_setting_t *settings_list_find(rarch_setting_t *list,
+      const char *name)
+{
+   size_t i;
+   uint32_t hash;
+   const struct settings_list_index *index = NULL;
+
+   if (!list || !name)
+      return NULL;
+
+   index = list->name_index;
+
+   if (!index)
+   {
+      for (; list->type != ST_NONE; list++)
+         if (settings_list_is_named(list) && !strcmp(list->name, name))
+            return list;
+      return NULL;
+   }
+
+   hash = settings_list_hash(name);
+
+   for (i = hash & index->mask; index->slots[i].idx;
+         i = (i + 1) & index->mask)
+   {
+      rarch_setting_t *setting = &list[index->slots[i].idx - 1];
+
+      if (index->slots[i].hash == hash && !strcmp(setting->name, name))
+         return setting;
+   }
+
+   return NULL;
 }
 
 rarch_setting_t *settings_list_new(unsigned size)
@@ -106,6 +106,8 @@ typedef struct rarch_setting_group_info
    const char *name;
 } rarch_setting_group_info_t;
 
+struct settings_list_index;
+
 typedef struct rarch_setting
 {
    enum setting_type type;
@@ -188,6 +190,10 @@ typedef struct rarch_setting
    const char *rounding_fraction;
    bool enforce_minrange;
    bool enforce_maxrange;
+
+   /* Name index, only set on the first setting of a list
+    * by settings_list_build_index(). */
+   struct settings_list_index *name_index;
 }  rarch_setting_t;
 
 
@@ -224,6 +230,33 @@ void settings_info_list_free(rarch_setting_info_t *list_info);
 
 void settings_list_free(rarch_setting_t *list);
 
+/**
+ * settings_list_build_index:
+ * @list               : finished settings list.
+ *
+ * Builds a hash index over the names of the settings in @list,
+ * for settings_list_find(). The index is kept in the first
+ * setting of @list and freed along with it. It has to be rebuilt
+ * if @list is reallocated.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool settings_list_build_index(rarch_setting_t *list);
+
+/**
+ * settings_list_find:
+ * @list               : settings list.
+ * @name               : name of setting to search for.
+ *
+ * Finds the first setting or group named @name. Uses the index
+ * built by settings_list_build_index() if @list has one, otherwise
+ * searches @list linearly.
+ *
+ * Returns: pointer to setting if found, otherwise NULL.
+ **/
+rarch_setting_t *settings_list_find(rarch_setting_t *list,
+      const char *name);
+
 rarch_setting_info_t *settings_info_list_new(void);
 
 rarch_setting_t *settings_list_new(unsigned size);